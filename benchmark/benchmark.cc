@@ -0,0 +1,134 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Usage: dsp_benchmark [-d seconds] [filter...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif  // __SSE__
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+// Denormals are very slow on the host: without flushing them to zero, the
+// decaying tails of the resonators and reverbs would dominate the results.
+void FlushDenormalsToZero() {
+#if defined(__SSE__)
+  _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#elif defined(__aarch64__)
+  // FPCR.FZ, bit 24.
+  uint64_t fpcr;
+  __asm__ __volatile__("mrs %0, fpcr" : "=r" (fpcr));
+  fpcr |= uint64_t(1) << 24;
+  __asm__ __volatile__("msr fpcr, %0" : : "r" (fpcr));
+#endif  // __SSE__, __aarch64__
+}
+
+void Reporter::Init(int num_filters, char** filters, float duration) {
+  num_filters_ = num_filters;
+  filters_ = filters;
+  duration_ = duration;
+
+  printf("module\tcase\tsample_rate\tblock_size\t");
+  printf("ns_per_sample\tcycles_per_block\tcpu_percent\tarena_bytes\t");
+  printf("units_per_core\n");
+}
+
+bool Reporter::Enabled(const Case& c) const {
+  if (!num_filters_) {
+    return true;
+  }
+
+  char name[128];
+  snprintf(name, sizeof(name), "%s/%s", c.module, c.name);
+  for (int i = 0; i < num_filters_; ++i) {
+    if (!strncmp(name, filters_[i], strlen(filters_[i]))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t Reporter::num_blocks(const Case& c) const {
+  return size_t(duration_ * c.sample_rate) / c.block_size;
+}
+
+void Reporter::Report(
+    const Case& c,
+    size_t num_blocks,
+    const Timer& timer,
+    size_t arena_size) {
+  const double num_samples = double(num_blocks * c.block_size);
+  const double ns_per_sample = timer.elapsed() * 1e9 / num_samples;
+
+  // Share of a host core needed to run in real time.
+  const double cpu_percent = ns_per_sample * c.sample_rate * 1e-7;
+  printf(
+      "%s\t%s\t%.0f\t%d\t%.2f\t%.0f\t%.3f\t",
+      c.module,
+      c.name,
+      c.sample_rate,
+      int(c.block_size),
+      ns_per_sample,
+      double(timer.elapsed_cycles()) / double(num_blocks),
+      cpu_percent);
+  if (arena_size != kArenaUnknown) {
+    printf("%d\t", int(arena_size));
+  } else {
+    printf("-\t");
+  }
+  if (c.num_units) {
+    printf("%.0f\n", double(c.num_units) * 100.0 / cpu_percent);
+  } else {
+    printf("-\n");
+  }
+  fflush(stdout);
+}
+
+}  // namespace benchmark
+
+using namespace benchmark;
+
+int main(int argc, char** argv) {
+  FlushDenormalsToZero();
+
+  float duration = kDefaultDuration;
+  int first_filter = 1;
+  if (argc >= 3 && !strcmp(argv[1], "-d")) {
+    duration = atof(argv[2]);
+    first_filter = 3;
+  }
+
+  Reporter reporter;
+  reporter.Init(argc - first_filter, argv + first_filter, duration);
+
+  RunPlaitsBenchmarks(&reporter);
+  RunBraidsBenchmarks(&reporter);
+  RunRingsBenchmarks(&reporter);
+  RunElementsBenchmarks(&reporter);
+  RunCloudsBenchmarks(&reporter);
+  RunWarpsBenchmarks(&reporter);
+  RunTides2Benchmarks(&reporter);
+  RunStagesBenchmarks(&reporter);
+  RunMarblesBenchmarks(&reporter);
+  RunFramesBenchmarks(&reporter);
+}
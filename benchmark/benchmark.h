@@ -0,0 +1,145 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Runs the DSP code of all modules under fixed parameter sweeps, and reports
+// one tab-separated line per case, so that the results can be diffed or
+// loaded in a spreadsheet.
+
+#ifndef BENCHMARK_BENCHMARK_H_
+#define BENCHMARK_BENCHMARK_H_
+
+#include <ctime>
+
+#include "stmlib/stmlib.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define BENCHMARK_HAS_CYCLE_COUNTER
+#endif  // __i386__ || __x86_64__
+
+namespace benchmark {
+
+// Seconds of audio rendered for each case.
+const float kDefaultDuration = 4.0f;
+
+// Reported instead of an arena size when the module uses an external memory
+// block, but doesn't tell how much of it is actually allocated.
+const size_t kArenaUnknown = ~size_t(0);
+
+void FlushDenormalsToZero();
+
+// Triangle LFO in [0, 1], completing num_cycles cycles over the run. All
+// parameter sweeps are derived from it, so that they don't depend on the
+// duration of the run.
+inline float Sweep(size_t block, size_t num_blocks, float num_cycles) {
+  float phase = float(block) / float(num_blocks) * num_cycles;
+  phase -= static_cast<float>(static_cast<int32_t>(phase));
+  return phase < 0.5f ? 2.0f * phase : 2.0f - 2.0f * phase;
+}
+
+class Timer {
+ public:
+  Timer() { }
+  ~Timer() { }
+
+  inline void Start() {
+    start_clock_ = clock();
+    start_cycles_ = cycles();
+  }
+
+  inline void Stop() {
+    elapsed_cycles_ = cycles() - start_cycles_;
+    elapsed_ = double(clock() - start_clock_) / CLOCKS_PER_SEC;
+  }
+
+  inline double elapsed() const { return elapsed_; }
+  inline uint64_t elapsed_cycles() const { return elapsed_cycles_; }
+
+ private:
+  static inline uint64_t cycles() {
+#ifdef BENCHMARK_HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif  // BENCHMARK_HAS_CYCLE_COUNTER
+  }
+
+  clock_t start_clock_;
+  uint64_t start_cycles_;
+
+  double elapsed_;
+  uint64_t elapsed_cycles_;
+
+  DISALLOW_COPY_AND_ASSIGN(Timer);
+};
+
+struct Case {
+  const char* module;
+  const char* name;
+  float sample_rate;
+  size_t block_size;
+
+  // Optional number of identical units (voices, partials...) rendered by the
+  // case. When set, the report also gives how many of them a host core can
+  // run in real time.
+  size_t num_units;
+};
+
+class Reporter {
+ public:
+  Reporter() { }
+  ~Reporter() { }
+
+  void Init(int num_filters, char** filters, float duration);
+
+  // Returns true if the case is selected by the command line filters. Cases
+  // are named "module/name", a filter selects all cases starting with it.
+  bool Enabled(const Case& c) const;
+
+  // Number of blocks to render for the case.
+  size_t num_blocks(const Case& c) const;
+
+  // Arena size is in bytes, 0 if the case doesn't use an external memory
+  // block, kArenaUnknown (printed as "-") if the allocated size is not known.
+  void Report(
+      const Case& c,
+      size_t num_blocks,
+      const Timer& timer,
+      size_t arena_size);
+
+ private:
+  int num_filters_;
+  char** filters_;
+  float duration_;
+
+  DISALLOW_COPY_AND_ASSIGN(Reporter);
+};
+
+void RunBraidsBenchmarks(Reporter* reporter);
+void RunCloudsBenchmarks(Reporter* reporter);
+void RunElementsBenchmarks(Reporter* reporter);
+void RunFramesBenchmarks(Reporter* reporter);
+void RunMarblesBenchmarks(Reporter* reporter);
+void RunPlaitsBenchmarks(Reporter* reporter);
+void RunRingsBenchmarks(Reporter* reporter);
+void RunStagesBenchmarks(Reporter* reporter);
+void RunTides2Benchmarks(Reporter* reporter);
+void RunWarpsBenchmarks(Reporter* reporter);
+
+}  // namespace benchmark
+
+#endif  // BENCHMARK_BENCHMARK_H_
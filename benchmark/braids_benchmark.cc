@@ -0,0 +1,138 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Braids: every shape of the macro oscillator.
+
+#include "benchmark/benchmark.h"
+
+#include <cstring>
+
+#include "braids/macro_oscillator.h"
+
+namespace benchmark {
+
+using namespace braids;
+using namespace stmlib;
+
+const float kBraidsSampleRate = 96000.0f;
+const size_t kBraidsBlockSize = 24;
+
+const char* const braids_shape_names[] = {
+  "csaw",
+  "morph",
+  "saw_square",
+  "sine_triangle",
+  "buzz",
+  "square_sub",
+  "saw_sub",
+  "square_sync",
+  "saw_sync",
+  "triple_saw",
+  "triple_square",
+  "triple_triangle",
+  "triple_sine",
+  "triple_ring_mod",
+  "saw_swarm",
+  "saw_comb",
+  "toy",
+  "digital_filter_lp",
+  "digital_filter_pk",
+  "digital_filter_bp",
+  "digital_filter_hp",
+  "vosim",
+  "vowel",
+  "vowel_fof",
+  "harmonics",
+  "fm",
+  "feedback_fm",
+  "chaotic_feedback_fm",
+  "plucked",
+  "bowed",
+  "blown",
+  "fluted",
+  "struck_bell",
+  "struck_drum",
+  "kick",
+  "cymbal",
+  "snare",
+  "wavetables",
+  "wave_map",
+  "wave_line",
+  "wave_paraphonic",
+  "filtered_noise",
+  "twin_peaks_noise",
+  "clocked_noise",
+  "granular_cloud",
+  "particle_noise",
+  "digital_modulation",
+  "question_mark"
+};
+
+STATIC_ASSERT(
+    sizeof(braids_shape_names) / sizeof(const char*) == MACRO_OSC_SHAPE_LAST,
+    missing_shape_names);
+
+void BenchmarkShape(Reporter* reporter, MacroOscillatorShape shape) {
+  Case c = {
+    "braids",
+    braids_shape_names[shape],
+    kBraidsSampleRate,
+    kBraidsBlockSize
+  };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  MacroOscillator osc;
+  osc.Init();
+  osc.set_shape(shape);
+
+  // Struck every 500ms. The pitch sweeps over 4 octaves, TIMBRE and COLOR at
+  // different rates.
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t strike_period = size_t(kBraidsSampleRate * 0.5f) / \
+      kBraidsBlockSize;
+
+  uint8_t sync_buffer[kBraidsBlockSize];
+  int16_t buffer[kBraidsBlockSize];
+  memset(sync_buffer, 0, sizeof(sync_buffer));
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    if (i % strike_period == 0) {
+      osc.Strike();
+    }
+    const float note = 36.0f + 48.0f * Sweep(i, num_blocks, 1.0f);
+    osc.set_pitch(static_cast<int16_t>(note * 128.0f));
+    osc.set_parameters(
+        static_cast<int16_t>(Sweep(i, num_blocks, 3.0f) * 32767.0f),
+        static_cast<int16_t>(Sweep(i, num_blocks, 5.0f) * 32767.0f));
+    osc.Render(sync_buffer, buffer, kBraidsBlockSize);
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+}
+
+void RunBraidsBenchmarks(Reporter* reporter) {
+  for (int i = 0; i < MACRO_OSC_SHAPE_LAST; ++i) {
+    BenchmarkShape(reporter, MacroOscillatorShape(i));
+  }
+}
+
+}  // namespace benchmark
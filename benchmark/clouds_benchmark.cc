@@ -0,0 +1,136 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Clouds: every playback mode, and the lo-fi/mono qualities of the granular
+// mode.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark/benchmark.h"
+
+#include "clouds/dsp/granular_processor.h"
+
+namespace benchmark {
+
+using namespace clouds;
+using namespace stmlib;
+
+const float kCloudsSampleRate = 32000.0f;
+const size_t kCloudsBlockSize = 32;
+
+// Same sizes as the SRAM and CCM blocks of the module.
+static uint8_t clouds_large_buffer[118784];
+static uint8_t clouds_small_buffer[65536 - 128];
+
+// The input is a sine wave, with a new note every 250ms. POSITION, SIZE,
+// DENSITY and TEXTURE sweep at different rates, the processor is frozen for
+// a quarter of the run.
+void BenchmarkProcessor(
+    Reporter* reporter,
+    const char* name,
+    PlaybackMode playback_mode,
+    int32_t quality) {
+  Case c = { "clouds", name, kCloudsSampleRate, kCloudsBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  GranularProcessor* processor = new GranularProcessor;
+  processor->Init(
+      clouds_large_buffer, sizeof(clouds_large_buffer),
+      clouds_small_buffer, sizeof(clouds_small_buffer));
+  processor->set_quality(quality);
+  processor->set_playback_mode(playback_mode);
+
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t note_period = size_t(kCloudsSampleRate * 0.25f) /
+      kCloudsBlockSize;
+  const float notes[] = { 57.0f, 64.0f, 69.0f, 60.0f };
+
+  Parameters* p = processor->mutable_parameters();
+  p->pitch = 0.0f;
+  p->dry_wet = 1.0f;
+  p->stereo_spread = 0.5f;
+  p->feedback = 0.3f;
+  p->reverb = 0.3f;
+  p->trigger = false;
+  p->gate = false;
+
+  ShortFrame input[kCloudsBlockSize];
+  ShortFrame output[kCloudsBlockSize];
+  float phase = 0.0f;
+  bool silent = true;
+
+  processor->Prepare();
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const float note = notes[(i / note_period) % 4];
+    const float frequency = 440.0f / kCloudsSampleRate *
+        powf(2.0f, (note - 69.0f) / 12.0f);
+    for (size_t j = 0; j < kCloudsBlockSize; ++j) {
+      phase += frequency;
+      if (phase >= 1.0f) {
+        phase -= 1.0f;
+      }
+      input[j].l = input[j].r = static_cast<short>(
+          16384.0f * sinf(phase * 2.0f * M_PI));
+    }
+    p->freeze = Sweep(i, num_blocks, 2.0f) > 0.75f;
+    p->position = Sweep(i, num_blocks, 3.0f);
+    p->size = Sweep(i, num_blocks, 5.0f);
+    p->density = Sweep(i, num_blocks, 7.0f);
+    p->texture = Sweep(i, num_blocks, 11.0f);
+    processor->Process(input, output, kCloudsBlockSize);
+    processor->Prepare();
+    for (size_t j = 0; j < kCloudsBlockSize; ++j) {
+      silent = silent && !output[j].l && !output[j].r;
+    }
+  }
+  timer.Stop();
+
+  // A processor stuck in silence or bypass only times the copy of its
+  // output buffer - don't report this as the cost of the playback mode.
+  if (silent) {
+    fprintf(stderr, "clouds/%s: the processor rendered silence\n", name);
+    exit(1);
+  }
+
+  // The processor carves its buffers up internally, and doesn't tell how
+  // much of them it uses.
+  reporter->Report(
+      c,
+      num_blocks,
+      timer,
+      kArenaUnknown);
+  delete processor;
+}
+
+void RunCloudsBenchmarks(Reporter* reporter) {
+  BenchmarkProcessor(reporter, "granular", PLAYBACK_MODE_GRANULAR, 0);
+  BenchmarkProcessor(reporter, "granular_mono", PLAYBACK_MODE_GRANULAR, 1);
+  BenchmarkProcessor(reporter, "granular_lofi", PLAYBACK_MODE_GRANULAR, 2);
+  BenchmarkProcessor(reporter, "stretch", PLAYBACK_MODE_STRETCH, 0);
+  BenchmarkProcessor(
+      reporter, "looping_delay", PLAYBACK_MODE_LOOPING_DELAY, 0);
+  BenchmarkProcessor(reporter, "spectral", PLAYBACK_MODE_SPECTRAL, 0);
+}
+
+}  // namespace benchmark
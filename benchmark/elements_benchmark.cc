@@ -0,0 +1,108 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Elements: every resonator model, and the ominous voice easter egg.
+
+#include <algorithm>
+
+#include "benchmark/benchmark.h"
+
+#include "elements/dsp/part.h"
+
+namespace benchmark {
+
+using namespace elements;
+using namespace stmlib;
+
+// Same size as the reverb buffer of the module.
+static uint16_t elements_reverb_buffer[32768];
+
+// Some members are not cleared by Init(), and rely on the part being in
+// zero-initialized memory, as it is on the module.
+static Part elements_part;
+
+// A 1s gate, high for half of it. The note sweeps over 4 octaves. All three
+// exciters are active, so that the cost of the bow and blow generators is
+// included.
+void BenchmarkElementsPart(
+    Reporter* reporter,
+    const char* name,
+    ResonatorModel model,
+    bool easter_egg) {
+  Case c = { "elements", name, kSampleRate, kMaxBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  Part* part = &elements_part;
+  part->Init(elements_reverb_buffer);
+  part->set_resonator_model(model);
+  part->set_easter_egg(easter_egg);
+
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t gate_period = size_t(kSampleRate) / kMaxBlockSize;
+
+  Patch* p = part->mutable_patch();
+  p->exciter_envelope_shape = 0.5f;
+  p->exciter_strike_level = 0.8f;
+  p->space = 0.5f;
+
+  PerformanceState performance;
+  performance.modulation = 0.0f;
+  performance.strength = 0.5f;
+
+  float silence[kMaxBlockSize];
+  std::fill(&silence[0], &silence[kMaxBlockSize], 0.0f);
+  float main[kMaxBlockSize];
+  float aux[kMaxBlockSize];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    performance.gate = i % gate_period < gate_period / 2;
+    performance.note = 36.0f + 48.0f * Sweep(i, num_blocks, 1.0f);
+    p->exciter_bow_level = Sweep(i, num_blocks, 2.0f);
+    p->exciter_bow_timbre = Sweep(i, num_blocks, 3.0f);
+    p->exciter_blow_level = Sweep(i, num_blocks, 3.0f);
+    p->exciter_blow_meta = Sweep(i, num_blocks, 5.0f);
+    p->exciter_blow_timbre = Sweep(i, num_blocks, 7.0f);
+    p->exciter_strike_meta = Sweep(i, num_blocks, 5.0f);
+    p->exciter_strike_timbre = Sweep(i, num_blocks, 7.0f);
+    p->resonator_geometry = Sweep(i, num_blocks, 3.0f);
+    p->resonator_brightness = Sweep(i, num_blocks, 5.0f);
+    p->resonator_damping = Sweep(i, num_blocks, 7.0f);
+    p->resonator_position = Sweep(i, num_blocks, 11.0f);
+    part->Process(performance, silence, silence, main, aux, kMaxBlockSize);
+  }
+  timer.Stop();
+
+  // The delay lines of the reverb span the whole buffer.
+  reporter->Report(
+      c,
+      num_blocks,
+      timer,
+      sizeof(elements_reverb_buffer));
+}
+
+void RunElementsBenchmarks(Reporter* reporter) {
+  BenchmarkElementsPart(reporter, "modal", RESONATOR_MODEL_MODAL, false);
+  BenchmarkElementsPart(reporter, "string", RESONATOR_MODEL_STRING, false);
+  BenchmarkElementsPart(reporter, "strings", RESONATOR_MODEL_STRINGS, false);
+  BenchmarkElementsPart(reporter, "ominous_voice", RESONATOR_MODEL_MODAL, true);
+}
+
+}  // namespace benchmark
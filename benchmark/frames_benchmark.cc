@@ -0,0 +1,82 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Frames: the keyframer evaluated at the rate of the module, with a full
+// timeline of keyframes, for the 4 channels of the module and for larger
+// numbers of channels. ns_per_sample is the time taken by one evaluation.
+
+#include <cstdlib>
+
+#include "benchmark/benchmark.h"
+
+#include "frames/keyframer.h"
+
+namespace benchmark {
+
+using namespace frames;
+
+// The keyframer is evaluated once for every update of the 4 DAC channels,
+// each of them refreshed at 32kHz.
+const float kFramesSampleRate = 32000.0f;
+
+// The timeline is scrubbed back and forth by a slow LFO, and each channel
+// has its own easing curve and response.
+template<size_t num_channels>
+void BenchmarkKeyframer(Reporter* reporter, const char* name) {
+  Case c = { "frames", name, kFramesSampleRate, 1, num_channels };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  typedef BasicKeyframer<num_channels, kMaxNumKeyframe> K;
+  K* keyframer = new K;
+  keyframer->Init();
+  keyframer->Clear();
+  srand(0);
+  for (size_t i = 0; i < num_channels; ++i) {
+    ChannelSettings* s = keyframer->mutable_settings(i);
+    s->easing_curve = EasingCurve(i % EASING_CURVE_LAST);
+    s->response = rand() % 256;
+  }
+  uint16_t values[num_channels];
+  for (size_t i = 0; i < kMaxNumKeyframe; ++i) {
+    for (size_t j = 0; j < num_channels; ++j) {
+      values[j] = rand() % 65536;
+    }
+    keyframer->AddKeyframe(i * (65536 / kMaxNumKeyframe), values);
+  }
+
+  const size_t num_blocks = reporter->num_blocks(c);
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    keyframer->Evaluate(65535.0f * Sweep(i, num_blocks, 2.0f));
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+  delete keyframer;
+}
+
+void RunFramesBenchmarks(Reporter* reporter) {
+  BenchmarkKeyframer<kNumChannels>(reporter, "keyframer_4");
+  BenchmarkKeyframer<64>(reporter, "keyframer_64");
+  BenchmarkKeyframer<1024>(reporter, "keyframer_1024");
+}
+
+}  // namespace benchmark
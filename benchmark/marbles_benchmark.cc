@@ -0,0 +1,170 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Marbles: every model of the T section on its own, then the X/Y section
+// clocked by the T section, in every control mode.
+
+#include <algorithm>
+
+#include "benchmark/benchmark.h"
+
+#include "marbles/io_buffer.h"
+#include "marbles/random/random_generator.h"
+#include "marbles/random/random_stream.h"
+#include "marbles/random/t_generator.h"
+#include "marbles/random/x_y_generator.h"
+
+namespace benchmark {
+
+using namespace marbles;
+using namespace stmlib;
+
+const float kMarblesSampleRate = 32000.0f;
+
+const char* const marbles_t_model_names[] = {
+  "t_complementary_bernoulli",
+  "t_clusters",
+  "t_drums",
+  "t_independent_bernoulli",
+  "t_divider",
+  "t_three_states",
+  "t_markov"
+};
+
+const char* const marbles_control_mode_names[] = {
+  "xy_identical",
+  "xy_bump",
+  "xy_tilt"
+};
+
+// The T section runs from its internal clock, with RATE, BIAS, JITTER and
+// DEJA VU sweeping at different rates. When run_xy is set, the X/Y section is
+// clocked by T1, T2 and T3, and quantizes to a major scale.
+void BenchmarkGenerators(
+    Reporter* reporter,
+    const char* name,
+    TGeneratorModel t_model,
+    ControlMode control_mode,
+    bool run_xy) {
+  Case c = { "marbles", name, kMarblesSampleRate, kBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  RandomGenerator random_generator;
+  RandomStream random_stream;
+  random_generator.Init(1);
+  random_stream.Init(&random_generator);
+
+  TGenerator* t_generator = new TGenerator;
+  t_generator->Init(&random_stream, kMarblesSampleRate);
+  t_generator->set_model(t_model);
+  t_generator->set_range(T_GENERATOR_RANGE_1X);
+  t_generator->set_length(8);
+  t_generator->set_pulse_width_mean(0.5f);
+  t_generator->set_pulse_width_std(0.2f);
+
+  XYGenerator* xy_generator = new XYGenerator;
+  xy_generator->Init(&random_stream, kMarblesSampleRate);
+  Scale scale;
+  scale.InitMajor();
+  xy_generator->LoadScale(0, scale);
+
+  GroupSettings x;
+  x.control_mode = control_mode;
+  x.voltage_range = VOLTAGE_RANGE_FULL;
+  x.register_mode = false;
+  x.register_value = 0.0f;
+  x.scale_index = 0;
+  x.length = 8;
+  x.ratio.p = 1;
+  x.ratio.q = 1;
+
+  GroupSettings y = x;
+  y.control_mode = CONTROL_MODE_IDENTICAL;
+  y.spread = 0.5f;
+  y.bias = 0.5f;
+  y.steps = 0.5f;
+  y.deja_vu = 0.0f;
+  y.length = 1;
+  y.ratio.q = 4;
+
+  const size_t num_blocks = reporter->num_blocks(c);
+
+  float ramp_buffer[kBlockSize * 4];
+  Ramps ramps;
+  ramps.master = &ramp_buffer[0];
+  ramps.external = &ramp_buffer[kBlockSize];
+  ramps.slave[0] = &ramp_buffer[kBlockSize * 2];
+  ramps.slave[1] = &ramp_buffer[kBlockSize * 3];
+
+  GateFlags no_clock[kBlockSize];
+  std::fill(&no_clock[0], &no_clock[kBlockSize], GATE_FLAG_LOW);
+  bool gates[kBlockSize * 2];
+  float voltages[kBlockSize * 4];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const float deja_vu = Sweep(i, num_blocks, 7.0f);
+    t_generator->set_rate(48.0f * Sweep(i, num_blocks, 1.0f) - 24.0f);
+    t_generator->set_bias(Sweep(i, num_blocks, 3.0f));
+    t_generator->set_jitter(Sweep(i, num_blocks, 5.0f));
+    t_generator->set_deja_vu(deja_vu);
+    t_generator->Process(false, no_clock, ramps, gates, kBlockSize);
+    if (run_xy) {
+      x.spread = Sweep(i, num_blocks, 3.0f);
+      x.bias = Sweep(i, num_blocks, 5.0f);
+      x.steps = Sweep(i, num_blocks, 11.0f);
+      x.deja_vu = deja_vu;
+      xy_generator->Process(
+          CLOCK_SOURCE_INTERNAL_T1_T2_T3,
+          x,
+          y,
+          no_clock,
+          ramps,
+          voltages,
+          kBlockSize);
+    }
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+  delete xy_generator;
+  delete t_generator;
+}
+
+void RunMarblesBenchmarks(Reporter* reporter) {
+  for (int i = 0; i <= T_GENERATOR_MODEL_MARKOV; ++i) {
+    BenchmarkGenerators(
+        reporter,
+        marbles_t_model_names[i],
+        TGeneratorModel(i),
+        CONTROL_MODE_IDENTICAL,
+        false);
+  }
+  for (int i = 0; i <= CONTROL_MODE_TILT; ++i) {
+    BenchmarkGenerators(
+        reporter,
+        marbles_control_mode_names[i],
+        T_GENERATOR_MODEL_COMPLEMENTARY_BERNOULLI,
+        ControlMode(i),
+        true);
+  }
+}
+
+}  // namespace benchmark
@@ -0,0 +1,271 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Plaits: every engine, in the order of the voice.
+
+#include "benchmark/benchmark.h"
+
+#include "plaits/dsp/engine/additive_engine.h"
+#include "plaits/dsp/engine/bass_drum_engine.h"
+#include "plaits/dsp/engine/chord_engine.h"
+#include "plaits/dsp/engine/fm_engine.h"
+#include "plaits/dsp/engine/grain_engine.h"
+#include "plaits/dsp/engine/hi_hat_engine.h"
+#include "plaits/dsp/engine/modal_engine.h"
+#include "plaits/dsp/engine/noise_engine.h"
+#include "plaits/dsp/engine/particle_engine.h"
+#include "plaits/dsp/engine/snare_drum_engine.h"
+#include "plaits/dsp/engine/speech_engine.h"
+#include "plaits/dsp/engine/string_engine.h"
+#include "plaits/dsp/engine/swarm_engine.h"
+#include "plaits/dsp/engine/virtual_analog_engine.h"
+#include "plaits/dsp/engine/waveshaping_engine.h"
+#include "plaits/dsp/engine/wavetable_engine.h"
+#include "plaits/dsp/engine2/chiptune_engine.h"
+#include "plaits/dsp/engine2/phase_distortion_engine.h"
+#include "plaits/dsp/engine2/six_op_engine.h"
+#include "plaits/dsp/engine2/string_machine_engine.h"
+#include "plaits/dsp/engine2/virtual_analog_vcf_engine.h"
+#include "plaits/dsp/engine2/wave_terrain_engine.h"
+#include "plaits/dsp/oscillator/harmonic_oscillator.h"
+#include "plaits/host/poly_fm.h"
+#include "plaits/resources.h"
+
+namespace benchmark {
+
+using namespace plaits;
+using namespace stmlib;
+
+// Same size as the buffer shared by all engines on the module.
+static char plaits_ram_block[16 * 1024];
+
+template<typename T>
+void BenchmarkEngine(
+    Reporter* reporter,
+    const char* name,
+    const uint8_t* user_data) {
+  Case c = { "plaits", name, kSampleRate, kBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  T engine;
+  BufferAllocator allocator(plaits_ram_block, sizeof(plaits_ram_block));
+  engine.Init(&allocator);
+  engine.LoadUserData(user_data);
+  engine.Reset();
+
+  // A note every 500ms, gate high for half of it. The pitch sweeps over 4
+  // octaves, TIMBRE, MORPH and HARMONICS at different rates.
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t trigger_period = size_t(kSampleRate * 0.5f) / kBlockSize;
+
+  EngineParameters p;
+  p.accent = 0.8f;
+
+  float out[kBlockSize];
+  float aux[kBlockSize];
+  bool already_enveloped;
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const size_t t = i % trigger_period;
+    p.trigger = t < trigger_period / 2 ? TRIGGER_HIGH : TRIGGER_LOW;
+    p.trigger |= t == 0 ? TRIGGER_RISING_EDGE : TRIGGER_LOW;
+    p.note = 36.0f + 48.0f * Sweep(i, num_blocks, 1.0f);
+    p.timbre = Sweep(i, num_blocks, 3.0f);
+    p.morph = Sweep(i, num_blocks, 5.0f);
+    p.harmonics = Sweep(i, num_blocks, 7.0f);
+    engine.Render(p, out, aux, kBlockSize, &already_enveloped);
+  }
+  timer.Stop();
+
+  reporter->Report(
+      c,
+      num_blocks,
+      timer,
+      sizeof(plaits_ram_block) - allocator.free());
+}
+
+// A single oscillator with many partials, to find out how many of them can
+// run in real time.
+template<int num_harmonics, bool scalar>
+void BenchmarkHarmonicOscillator(Reporter* reporter, const char* name) {
+  Case c = { "plaits", name, kSampleRate, kBlockSize, num_harmonics };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  HarmonicOscillator<num_harmonics> oscillator;
+  oscillator.Init();
+
+  float amplitudes[num_harmonics];
+  for (int i = 0; i < num_harmonics; ++i) {
+    amplitudes[i] = 1.0f / float(i + 1);
+  }
+
+  // Low enough for all partials to stay below Nyquist.
+  const size_t num_blocks = reporter->num_blocks(c);
+  const float max_f0 = 0.5f / float(num_harmonics);
+  float out[kBlockSize];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const float f0 = max_f0 * (0.25f + 0.75f * Sweep(i, num_blocks, 1.0f));
+    amplitudes[i % num_harmonics] = Sweep(i, num_blocks, 3.0f);
+#ifdef PLAITS_SIMD
+    if (scalar) {
+      oscillator.template RenderScalar<1>(f0, amplitudes, out, kBlockSize);
+      continue;
+    }
+#endif  // PLAITS_SIMD
+    oscillator.template Render<1>(f0, amplitudes, out, kBlockSize);
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+}
+
+// A 16-voice DX7-style instrument, playing the first patch of the first bank,
+// to find out how many 6-op voices can run in real time.
+template<int num_voices, bool lanes>
+void BenchmarkPolyFM(Reporter* reporter, const char* name) {
+  Case c = { "plaits", name, kSampleRate, kBlockSize, num_voices };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  PolyFM* poly = new PolyFM;
+  poly->Init(num_voices, kSampleRate);
+  poly->LoadBank(fm_patches_table[0]);
+  poly->set_use_lanes(lanes);
+
+  // A new note every 62.5ms, each voice is released after 8 notes.
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t note_period = size_t(kSampleRate / 16.0f) / kBlockSize;
+  float out[kBlockSize];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    if (i % note_period == 0) {
+      const int note = i / note_period;
+      poly->NoteOff((note + num_voices / 2) % num_voices);
+      poly->NoteOn(
+          note % num_voices,
+          0,
+          36.0f + 48.0f * Sweep(i, num_blocks, 1.0f),
+          0.8f);
+    }
+    poly->set_brightness(Sweep(i, num_blocks, 3.0f));
+    poly->set_envelope_control(Sweep(i, num_blocks, 5.0f));
+    poly->Render(out, kBlockSize);
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+  delete poly;
+}
+
+#ifdef PLAITS_SIMD
+
+// Swarms larger than the one of the engine, with the same parameter sweeps,
+// to find out how many voices can run in real time.
+template<int num_voices>
+void BenchmarkSwarmLanes(Reporter* reporter, const char* name) {
+  Case c = { "plaits", name, kSampleRate, kBlockSize, num_voices };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  SwarmLanes<num_voices>* swarm = new SwarmLanes<num_voices>;
+  swarm->Init();
+
+  const size_t num_blocks = reporter->num_blocks(c);
+  float out[kBlockSize];
+  float aux[kBlockSize];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const float note = 36.0f + 48.0f * Sweep(i, num_blocks, 1.0f);
+    const float timbre = Sweep(i, num_blocks, 3.0f);
+    const float morph = Sweep(i, num_blocks, 5.0f);
+    const float harmonics = Sweep(i, num_blocks, 7.0f);
+    swarm->Render(
+        NoteToFrequency(note),
+        NoteToFrequency(timbre * 120.0f) * 0.025f * float(kBlockSize),
+        false,
+        false,
+        harmonics * harmonics * harmonics,
+        0.25f * SemitonesToRatio((1.0f - morph) * 84.0f),
+        out,
+        aux,
+        kBlockSize);
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+  delete swarm;
+}
+
+#endif  // PLAITS_SIMD
+
+void RunPlaitsBenchmarks(Reporter* reporter) {
+  BenchmarkEngine<VirtualAnalogVCFEngine>(reporter, "virtual_analog_vcf", NULL);
+  BenchmarkEngine<PhaseDistortionEngine>(reporter, "phase_distortion", NULL);
+  BenchmarkEngine<SixOpEngine>(reporter, "six_op_1", fm_patches_table[0]);
+  BenchmarkEngine<SixOpEngine>(reporter, "six_op_2", fm_patches_table[1]);
+  BenchmarkEngine<SixOpEngine>(reporter, "six_op_3", fm_patches_table[2]);
+  BenchmarkEngine<WaveTerrainEngine>(reporter, "wave_terrain", NULL);
+  BenchmarkEngine<StringMachineEngine>(reporter, "string_machine", NULL);
+  BenchmarkEngine<ChiptuneEngine>(reporter, "chiptune", NULL);
+
+  BenchmarkEngine<VirtualAnalogEngine>(reporter, "virtual_analog", NULL);
+  BenchmarkEngine<WaveshapingEngine>(reporter, "waveshaping", NULL);
+  BenchmarkEngine<FMEngine>(reporter, "fm", NULL);
+  BenchmarkEngine<GrainEngine>(reporter, "grain", NULL);
+  BenchmarkEngine<AdditiveEngine>(reporter, "additive", NULL);
+  BenchmarkEngine<WavetableEngine>(reporter, "wavetable", NULL);
+  BenchmarkEngine<ChordEngine>(reporter, "chord", NULL);
+  BenchmarkEngine<SpeechEngine>(reporter, "speech", NULL);
+
+  BenchmarkEngine<SwarmEngine>(reporter, "swarm", NULL);
+  BenchmarkEngine<NoiseEngine>(reporter, "noise", NULL);
+  BenchmarkEngine<ParticleEngine>(reporter, "particle", NULL);
+  BenchmarkEngine<StringEngine>(reporter, "string", NULL);
+  BenchmarkEngine<ModalEngine>(reporter, "modal", NULL);
+  BenchmarkEngine<BassDrumEngine>(reporter, "bass_drum", NULL);
+  BenchmarkEngine<SnareDrumEngine>(reporter, "snare_drum", NULL);
+  BenchmarkEngine<HiHatEngine>(reporter, "hi_hat", NULL);
+
+  BenchmarkHarmonicOscillator<64, false>(reporter, "harmonic_oscillator_64");
+  BenchmarkHarmonicOscillator<256, false>(reporter, "harmonic_oscillator_256");
+  BenchmarkPolyFM<16, true>(reporter, "poly_fm_16");
+  BenchmarkPolyFM<16, false>(reporter, "poly_fm_16_scalar");
+#ifdef PLAITS_SIMD
+  BenchmarkHarmonicOscillator<64, true>(
+      reporter, "harmonic_oscillator_64_scalar");
+  BenchmarkSwarmLanes<8>(reporter, "swarm_lanes_8");
+  BenchmarkSwarmLanes<32>(reporter, "swarm_lanes_32");
+  BenchmarkSwarmLanes<64>(reporter, "swarm_lanes_64");
+#endif  // PLAITS_SIMD
+}
+
+}  // namespace benchmark
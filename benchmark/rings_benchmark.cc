@@ -0,0 +1,150 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Rings: every resonator model, and every effect of the string synth easter
+// egg.
+
+#include "benchmark/benchmark.h"
+
+#include "rings/dsp/part.h"
+#include "rings/dsp/string_synth_part.h"
+
+namespace benchmark {
+
+using namespace rings;
+using namespace stmlib;
+
+// Same size as the reverb buffer of the module.
+static uint16_t rings_reverb_buffer[32768];
+
+// Some members are not cleared by Init(), and rely on the parts being in
+// zero-initialized memory, as they are on the module.
+static Part rings_part;
+static StringSynthPart rings_string_synth;
+
+const char* const rings_model_names[] = {
+  "modal",
+  "sympathetic_string",
+  "string",
+  "fm_voice",
+  "sympathetic_string_quantized",
+  "string_and_reverb"
+};
+
+STATIC_ASSERT(
+    sizeof(rings_model_names) / sizeof(const char*) == RESONATOR_MODEL_LAST,
+    missing_model_names);
+
+const char* const rings_fx_names[] = {
+  "string_synth_formant",
+  "string_synth_chorus",
+  "string_synth_reverb",
+  "string_synth_formant_2",
+  "string_synth_ensemble",
+  "string_synth_reverb_2"
+};
+
+STATIC_ASSERT(
+    sizeof(rings_fx_names) / sizeof(const char*) == FX_LAST,
+    missing_fx_names);
+
+// Init() resets the model, so it is applied afterwards.
+inline void ConfigureRingsPart(Part* part, int32_t model) {
+  part->set_model(ResonatorModel(model));
+}
+
+inline void ConfigureRingsPart(StringSynthPart* part, int32_t fx) {
+  part->set_fx(FxType(fx));
+}
+
+// A strum every 500ms, with an impulse on the input. The note sweeps over
+// 4 octaves, STRUCTURE, BRIGHTNESS, DAMPING and POSITION at different rates.
+template<typename T>
+void BenchmarkRingsPart(
+    Reporter* reporter,
+    const char* name,
+    T* part,
+    int32_t model,
+    int32_t polyphony) {
+  Case c = { "rings", name, kSampleRate, kMaxBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  part->Init(rings_reverb_buffer);
+  part->set_polyphony(polyphony);
+  ConfigureRingsPart(part, model);
+
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t strum_period = size_t(kSampleRate * 0.5f) / kMaxBlockSize;
+
+  PerformanceState performance;
+  performance.internal_exciter = false;
+  performance.internal_strum = false;
+  performance.internal_note = false;
+  performance.tonic = 0.0f;
+  performance.fm = 0.0f;
+
+  Patch patch;
+
+  float impulse = 0.0f;
+  float in[kMaxBlockSize];
+  float out[kMaxBlockSize];
+  float aux[kMaxBlockSize];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    performance.strum = i % strum_period == 0;
+    if (performance.strum) {
+      impulse = 1.0f;
+    }
+    for (size_t j = 0; j < kMaxBlockSize; ++j) {
+      in[j] = impulse;
+      impulse *= 0.99f;
+    }
+    performance.note = 24.0f + 48.0f * Sweep(i, num_blocks, 1.0f);
+    performance.chord = int32_t(Sweep(i, num_blocks, 2.0f) * (kNumChords - 1));
+    patch.structure = Sweep(i, num_blocks, 3.0f);
+    patch.brightness = Sweep(i, num_blocks, 5.0f);
+    patch.damping = Sweep(i, num_blocks, 7.0f);
+    patch.position = Sweep(i, num_blocks, 11.0f);
+    part->Process(performance, patch, in, out, aux, kMaxBlockSize);
+  }
+  timer.Stop();
+
+  // The delay lines of the reverb span the whole buffer.
+  reporter->Report(
+      c,
+      num_blocks,
+      timer,
+      sizeof(rings_reverb_buffer));
+}
+
+void RunRingsBenchmarks(Reporter* reporter) {
+  for (int32_t i = 0; i < RESONATOR_MODEL_LAST; ++i) {
+    BenchmarkRingsPart(reporter, rings_model_names[i], &rings_part, i, 1);
+  }
+  BenchmarkRingsPart(
+      reporter, "modal_polyphony_4", &rings_part, RESONATOR_MODEL_MODAL, 4);
+
+  for (int32_t i = 0; i < FX_LAST; ++i) {
+    BenchmarkRingsPart(reporter, rings_fx_names[i], &rings_string_synth, i, 4);
+  }
+}
+
+}  // namespace benchmark
@@ -0,0 +1,151 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Stages: the segment configurations of the tests, and a full module of
+// free-running LFOs.
+
+#include "benchmark/benchmark.h"
+
+#include "stmlib/utils/gate_flags.h"
+
+#include "stages/io_buffer.h"
+#include "stages/segment_generator.h"
+#include "stages/segment_pool.h"
+
+namespace benchmark {
+
+using namespace stages;
+using namespace stmlib;
+
+// num_generators generators share a pool, as on the module, and each of them
+// is configured with the same segments. The gate input is a 250ms clock,
+// high for half of it.
+void BenchmarkSegmentGenerators(
+    Reporter* reporter,
+    const char* name,
+    size_t num_generators,
+    bool has_trigger,
+    const segment::Configuration* configuration,
+    int num_segments,
+    const float* primary,
+    const float* secondary) {
+  Case c = { "stages", name, kSampleRate, kBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  SegmentGenerator* generator = new SegmentGenerator[num_generators];
+  SegmentPool* pool = new SegmentPool;
+  pool->Init();
+  pool->Allocate(generator, num_generators, num_generators + num_segments - 1);
+  for (size_t i = 0; i < num_generators; ++i) {
+    generator[i].Init();
+    generator[i].Configure(has_trigger, configuration, num_segments);
+    for (int j = 0; j < num_segments; ++j) {
+      generator[i].set_segment_parameters(j, primary[j], secondary[j]);
+    }
+  }
+
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t gate_period = size_t(kSampleRate * 0.25f) / kBlockSize;
+
+  GateFlags gate_flags[kBlockSize];
+  GateFlags previous_gate_flag = GATE_FLAG_LOW;
+  SegmentGenerator::Output out[kBlockSize];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const bool gate = i % gate_period < gate_period / 2;
+    for (size_t j = 0; j < kBlockSize; ++j) {
+      previous_gate_flag = ExtractGateFlags(previous_gate_flag, gate);
+      gate_flags[j] = previous_gate_flag;
+    }
+    for (size_t j = 0; j < num_generators; ++j) {
+      generator[j].Process(gate_flags, out, kBlockSize);
+    }
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, sizeof(SegmentPool));
+  delete pool;
+  delete[] generator;
+}
+
+void RunStagesBenchmarks(Reporter* reporter) {
+  {
+    const segment::Configuration configuration[] = {
+      { segment::TYPE_RAMP, false },
+      { segment::TYPE_RAMP, false },
+      { segment::TYPE_RAMP, false },
+      { segment::TYPE_HOLD, true },
+      { segment::TYPE_RAMP, false },
+    };
+    const float primary[] = { 0.15f, 0.25f, 0.25f, 0.5f, 0.5f };
+    const float secondary[] = { 0.0f, 0.3f, 0.75f, 0.1f, 0.25f };
+    BenchmarkSegmentGenerators(
+        reporter, "adsr", 1, true, configuration, 5, primary, secondary);
+  }
+  {
+    const segment::Configuration configuration[] = {
+      { segment::TYPE_HOLD, false },
+      { segment::TYPE_HOLD, false },
+    };
+    const float primary[] = { 0.2f, -1.0f };
+    const float secondary[] = { 0.3f, 0.5f };
+    BenchmarkSegmentGenerators(
+        reporter, "two_step_sequence", 1, true, configuration, 2,
+        primary, secondary);
+  }
+
+  // Single segments.
+  struct SingleSegment {
+    const char* name;
+    bool has_trigger;
+    segment::Configuration configuration;
+    float primary;
+    float secondary;
+  };
+  const SingleSegment single_segments[] = {
+    { "single_decay", true, { segment::TYPE_RAMP, false }, 0.7f, 0.2f },
+    { "timed_pulse", true, { segment::TYPE_HOLD, false }, -1.0f, 0.4f },
+    { "gate", true, { segment::TYPE_HOLD, true }, 0.5f, 0.5f },
+    { "sample_and_hold", true, { segment::TYPE_STEP, true }, -1.0f, 0.5f },
+    { "portamento", false, { segment::TYPE_STEP, true }, -1.0f, 0.7f },
+    { "free_running_lfo", false, { segment::TYPE_RAMP, true }, 0.7f, -3.0f },
+    { "tap_lfo", true, { segment::TYPE_RAMP, true }, 0.5f, 0.5f },
+    { "delay", false, { segment::TYPE_HOLD, false }, -1.0f, 0.5f },
+    { "audio_oscillator", false, { segment::TYPE_ALT, true }, 0.5f, 0.7f },
+  };
+  for (size_t i = 0; i < sizeof(single_segments) / sizeof(SingleSegment); ++i) {
+    const SingleSegment& s = single_segments[i];
+    BenchmarkSegmentGenerators(
+        reporter, s.name, 1, s.has_trigger, &s.configuration, 1,
+        &s.primary, &s.secondary);
+  }
+
+  {
+    const segment::Configuration configuration = { segment::TYPE_RAMP, true };
+    const float primary = 0.7f;
+    const float secondary = 0.5f;
+    BenchmarkSegmentGenerators(
+        reporter, "free_running_lfo_x6", kNumChannels, false, &configuration,
+        1, &primary, &secondary);
+  }
+}
+
+}  // namespace benchmark
@@ -0,0 +1,120 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Tides: every combination of ramp mode, output mode and range.
+
+#include <cmath>
+#include <cstdio>
+
+#include "benchmark/benchmark.h"
+
+#include "stmlib/utils/gate_flags.h"
+
+#include "tides2/io_buffer.h"
+#include "tides2/poly_slope_generator.h"
+
+namespace benchmark {
+
+using namespace tides;
+using namespace stmlib;
+
+const char* const tides2_ramp_mode_names[] = { "ad", "looping", "ar" };
+
+const char* const tides2_output_mode_names[] = {
+  "gates",
+  "amplitude",
+  "slope_phase",
+  "frequency"
+};
+
+const char* const tides2_range_names[] = { "control", "audio" };
+
+// A gate every 250ms, high for half of it. The frequency sweeps over 4
+// octaves from the root of the range, SLOPE, SHAPE, SMOOTHNESS and SHIFT at
+// different rates.
+void BenchmarkPolySlopeGenerator(
+    Reporter* reporter,
+    RampMode ramp_mode,
+    OutputMode output_mode,
+    Range range) {
+  char name[64];
+  snprintf(
+      name,
+      sizeof(name),
+      "%s_%s_%s",
+      tides2_ramp_mode_names[ramp_mode],
+      tides2_output_mode_names[output_mode],
+      tides2_range_names[range]);
+  Case c = { "tides2", name, kSampleRate, kBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  PolySlopeGenerator* generator = new PolySlopeGenerator;
+  generator->Init();
+
+  const size_t num_blocks = reporter->num_blocks(c);
+  const size_t gate_period = size_t(kSampleRate * 0.25f) / kBlockSize;
+  const float root = (range == RANGE_CONTROL ? 2.0f : 130.81f) / kSampleRate;
+
+  GateFlags gate_flags[kBlockSize];
+  GateFlags previous_gate_flag = GATE_FLAG_LOW;
+  PolySlopeGenerator::OutputSample out[kBlockSize];
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const bool gate = i % gate_period < gate_period / 2;
+    for (size_t j = 0; j < kBlockSize; ++j) {
+      previous_gate_flag = ExtractGateFlags(previous_gate_flag, gate);
+      gate_flags[j] = previous_gate_flag;
+    }
+    generator->Render(
+        ramp_mode,
+        output_mode,
+        range,
+        root * powf(2.0f, 4.0f * Sweep(i, num_blocks, 1.0f)),
+        Sweep(i, num_blocks, 3.0f),
+        Sweep(i, num_blocks, 5.0f),
+        Sweep(i, num_blocks, 7.0f),
+        Sweep(i, num_blocks, 11.0f),
+        gate_flags,
+        NULL,
+        out,
+        kBlockSize);
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+  delete generator;
+}
+
+void RunTides2Benchmarks(Reporter* reporter) {
+  for (int ramp_mode = 0; ramp_mode < RAMP_MODE_LAST; ++ramp_mode) {
+    for (int output_mode = 0; output_mode < OUTPUT_MODE_LAST; ++output_mode) {
+      for (int range = 0; range < RANGE_LAST; ++range) {
+        BenchmarkPolySlopeGenerator(
+            reporter,
+            RampMode(ramp_mode),
+            OutputMode(output_mode),
+            Range(range));
+      }
+    }
+  }
+}
+
+}  // namespace benchmark
@@ -0,0 +1,128 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Warps: every cross-modulation algorithm, the vocoder, the internal
+// oscillator, and the frequency shifter easter egg.
+
+#include <cmath>
+
+#include "benchmark/benchmark.h"
+
+#include "warps/dsp/modulator.h"
+
+namespace benchmark {
+
+using namespace warps;
+using namespace stmlib;
+
+const float kWarpsSampleRate = 96000.0f;
+const size_t kWarpsBlockSize = 60;
+
+const char* const warps_algorithm_names[] = {
+  "xfade",
+  "fold",
+  "analog_ringmod",
+  "digital_ringmod",
+  "xor",
+  "compare"
+};
+
+// Both inputs are sine waves. The carrier sweeps over 4 octaves, the
+// modulator is a fifth above it, and the parameter of the algorithm sweeps
+// over its range.
+void BenchmarkModulator(
+    Reporter* reporter,
+    const char* name,
+    float algorithm,
+    int32_t carrier_shape,
+    bool easter_egg) {
+  Case c = { "warps", name, kWarpsSampleRate, kWarpsBlockSize };
+  if (!reporter->Enabled(c)) {
+    return;
+  }
+
+  Modulator* modulator = new Modulator;
+  modulator->Init(kWarpsSampleRate);
+  modulator->set_easter_egg(easter_egg);
+
+  const size_t num_blocks = reporter->num_blocks(c);
+
+  Parameters* p = modulator->mutable_parameters();
+  p->channel_drive[0] = 0.5f;
+  p->channel_drive[1] = 0.5f;
+  p->modulation_algorithm = algorithm;
+  p->frequency_shift_cv = 0.0f;
+  p->carrier_shape = carrier_shape;
+
+  ShortFrame input[kWarpsBlockSize];
+  ShortFrame output[kWarpsBlockSize];
+  float carrier_phase = 0.0f;
+  float modulator_phase = 0.0f;
+
+  Timer timer;
+  timer.Start();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const float note = 36.0f + 48.0f * Sweep(i, num_blocks, 1.0f);
+    const float frequency = 440.0f / kWarpsSampleRate *
+        powf(2.0f, (note - 69.0f) / 12.0f);
+    for (size_t j = 0; j < kWarpsBlockSize; ++j) {
+      carrier_phase += frequency;
+      if (carrier_phase >= 1.0f) {
+        carrier_phase -= 1.0f;
+      }
+      modulator_phase += frequency * 1.5f;
+      if (modulator_phase >= 1.0f) {
+        modulator_phase -= 1.0f;
+      }
+      input[j].l = static_cast<short>(
+          16384.0f * sinf(carrier_phase * 2.0f * M_PI));
+      input[j].r = static_cast<short>(
+          16384.0f * sinf(modulator_phase * 2.0f * M_PI));
+    }
+    p->note = note;
+    p->modulation_parameter = Sweep(i, num_blocks, 3.0f);
+    p->frequency_shift_pot = Sweep(i, num_blocks, 3.0f);
+    p->phase_shift = Sweep(i, num_blocks, 5.0f);
+    modulator->Process(input, output, kWarpsBlockSize);
+  }
+  timer.Stop();
+
+  reporter->Report(c, num_blocks, timer, 0);
+  delete modulator;
+}
+
+void RunWarpsBenchmarks(Reporter* reporter) {
+  // The algorithm knob covers the 6 cross-modulation algorithms over
+  // [0, 0.75], each point is taken a quarter of the way into its segment,
+  // outside of the cross-fade with the vocoder.
+  for (int32_t i = 0; i < 6; ++i) {
+    BenchmarkModulator(
+        reporter,
+        warps_algorithm_names[i],
+        (float(i) + 0.25f) / 8.0f,
+        0,
+        false);
+  }
+  BenchmarkModulator(reporter, "vocoder", 1.0f, 0, false);
+  BenchmarkModulator(reporter, "vocoder_internal_carrier", 1.0f, 1, false);
+  BenchmarkModulator(reporter, "xfade_internal_carrier", 0.03125f, 1, false);
+  BenchmarkModulator(reporter, "frequency_shifter", 0.0f, 0, true);
+  BenchmarkModulator(
+      reporter, "frequency_shifter_internal_carrier", 0.0f, 1, true);
+}
+
+}  // namespace benchmark
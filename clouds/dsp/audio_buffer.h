@@ -37,6 +37,7 @@
 #include "stmlib/utils/dsp.h"
 
 #include "clouds/dsp/mu_law.h"
+#include "clouds/dsp/simd.h"
 
 const int32_t kCrossFadeSize = 256;
 const int32_t kInterpolationTail = 8;
@@ -89,24 +90,7 @@ class AudioBuffer {
   }
   
   inline void Write(float in) {
-    if (resolution == RESOLUTION_16_BIT) {
-      s16_[write_head_] = stmlib::Clip16(
-            static_cast<int32_t>(in * 32768.0f));
-    } else if (resolution == RESOLUTION_8_BIT_DITHERED) {
-      float sample = in * 127.0f;
-      sample += quantization_error_;
-      int32_t quantized = static_cast<int32_t>(sample);
-      if (quantized < -127) quantized = -127;
-      else if (quantized > 127) quantized = 127;
-      quantization_error_ = sample - static_cast<float>(in);
-      s8_[write_head_] = quantized;
-    } else if (resolution == RESOLUTION_8_BIT_MU_LAW) {
-      int16_t sample = stmlib::Clip16(static_cast<int32_t>(in * 32768.0f));
-      s8_[write_head_] = Lin2MuLaw(sample);
-    } else {
-      s8_[write_head_] = static_cast<int8_t>(
-          stmlib::Clip16(in * 32768.0f) >> 8);
-    }
+    Encode(&in, 1, &s16_[write_head_], &s8_[write_head_], 1);
     
     if (resolution == RESOLUTION_16_BIT) {
       if (write_head_ < kInterpolationTail) {
@@ -140,16 +124,9 @@ class AudioBuffer {
           }
         }
       }
-    } else if (write && !crossfade_counter_ && 
-        resolution == RESOLUTION_16_BIT &&
-        write_head_ >= kInterpolationTail && write_head_ < (size_ - size)) {
+    } else if (write && !crossfade_counter_) {
       // Fast write routine for the most common case.
-      while (size--) {
-        s16_[write_head_] = stmlib::Clip16(
-            static_cast<int32_t>(*in * 32767.0f));
-        ++write_head_;
-        in += stride;
-      }
+      WriteBlock(in, size, stride);
     } else {
       while (size--) {
         float sample = *in;
@@ -165,21 +142,27 @@ class AudioBuffer {
     }
   }
   
-  inline void Write(const float* in, int32_t size, int32_t stride) {
-    if (resolution == RESOLUTION_16_BIT
-        && write_head_ >= kInterpolationTail && write_head_ < (size_ - size)) {
-      // Fast write routine for the most common case.
-      while (size--) {
-        s16_[write_head_] = stmlib::Clip16(
-            static_cast<int32_t>(*in * 32768.0f));
-        ++write_head_;
-        in += stride;
+  // Same as a sequence of Write(), but the wrap-around and the interpolation
+  // tail are handled once per contiguous block rather than for each sample,
+  // and samples are converted 4 at a time.
+  inline void WriteBlock(const float* in, int32_t size, int32_t stride) {
+    while (size) {
+      int32_t n = std::min(size, size_ - write_head_);
+      Encode(in, stride, &s16_[write_head_], &s8_[write_head_], n);
+      for (int32_t i = write_head_; i < kInterpolationTail && \
+           i < write_head_ + n; ++i) {
+        if (resolution == RESOLUTION_16_BIT) {
+          s16_[i + size_] = s16_[i];
+        } else {
+          s8_[i + size_] = s8_[i];
+        }
       }
-    } else {
-      while (size--) {
-        Write(*in);
-        in += stride;
+      write_head_ += n;
+      if (write_head_ >= size_) {
+        write_head_ = 0;
       }
+      in += n * stride;
+      size -= n;
     }
   }
   
@@ -194,6 +177,100 @@ class AudioBuffer {
     }
   }
   
+  // Same as a sequence of Read(), for a read head starting at
+  // integral + phase / 65536 and moving by increment / 65536 samples.
+  template<InterpolationMethod method>
+  inline void ReadBlock(
+      int32_t integral,
+      int32_t phase,
+      int32_t increment,
+      float* out,
+      size_t size) const {
+#ifdef CLOUDS_SIMD
+    // The samples covered by a chunk of the output are decoded first, and
+    // the interpolation is done for 4 output samples at a time. A chunk ends
+    // before the read head wraps around.
+    const size_t kChunkSize = 32;
+    const int32_t kMaxSpan = 512;
+    float samples[kMaxSpan + kNumLanes];
+    float result[kChunkSize];
+    int32_t offset[kChunkSize + kNumLanes];
+    int32_t fractional[kChunkSize + kNumLanes];
+    
+    const LaneFloat scale = SplatLanes(
+        resolution == RESOLUTION_16_BIT || \
+        resolution == RESOLUTION_8_BIT_MU_LAW
+            ? 1.0f / 32768.0f
+            : 1.0f / 128.0f);
+    const LaneFloat half = SplatLanes(0.5f);
+    
+    while (size) {
+      int32_t start = integral + (phase >> 16);
+      const bool wrapped = start >= size_;
+      if (wrapped) {
+        start -= size_;
+      }
+      size_t n = 0;
+      while (n < size && n < kChunkSize) {
+        int32_t position = integral + (phase >> 16);
+        if (!wrapped && position >= size_) {
+          break;
+        }
+        position -= start + (wrapped ? size_ : 0);
+        if (position + int32_t(kNumLanes) > kMaxSpan) {
+          break;
+        }
+        offset[n] = position;
+        fractional[n] = phase & 65535;
+        phase += increment;
+        ++n;
+      }
+      for (size_t i = n; i < n + kNumLanes; ++i) {
+        offset[i] = offset[n - 1];
+        fractional[i] = fractional[n - 1];
+      }
+      Decode(start, offset[n - 1] + kNumLanes, samples);
+      
+      for (size_t i = 0; i < n; i += kNumLanes) {
+        LaneFloat x0 = LoadLanes(&samples[offset[i]]);
+        LaneFloat x1 = LoadLanes(&samples[offset[i + 1]]);
+        LaneFloat x2 = LoadLanes(&samples[offset[i + 2]]);
+        LaneFloat x3 = LoadLanes(&samples[offset[i + 3]]);
+        TransposeLanes(&x0, &x1, &x2, &x3);
+        LaneFloat t = MulLanes(
+            ConvertLanes(LoadLanes(&fractional[i])),
+            SplatLanes(1.0f / 65536.0f));
+        LaneFloat y;
+        if (method == INTERPOLATION_ZOH) {
+          y = x0;
+        } else if (method == INTERPOLATION_LINEAR) {
+          y = AddLanes(x0, MulLanes(SubLanes(x1, x0), t));
+        } else {
+          // Laurent de Soras's Hermite interpolator (x0 is x[-1]).
+          const LaneFloat c = MulLanes(SubLanes(x2, x0), half);
+          const LaneFloat v = SubLanes(x1, x2);
+          const LaneFloat w = AddLanes(c, v);
+          const LaneFloat a = AddLanes(
+              AddLanes(w, v), MulLanes(SubLanes(x3, x1), half));
+          const LaneFloat b_neg = AddLanes(w, a);
+          y = SubLanes(MulLanes(a, t), b_neg);
+          y = AddLanes(MulLanes(y, t), c);
+          y = AddLanes(MulLanes(y, t), x1);
+        }
+        StoreLanes(&result[i], MulLanes(y, scale));
+      }
+      std::copy(&result[0], &result[n], out);
+      out += n;
+      size -= n;
+    }
+#else
+    while (size--) {
+      *out++ = Read<method>(integral + (phase >> 16), phase & 65535);
+      phase += increment;
+    }
+#endif  // CLOUDS_SIMD
+  }
+  
   inline float ReadZOH(int32_t integral, uint16_t fractional) const {
     if (integral >= size_) {
       integral -= size_;
@@ -281,6 +358,103 @@ class AudioBuffer {
   inline int32_t head() const { return write_head_; }
   
  private:
+  // Converts size samples to the storage format.
+  inline void Encode(
+      const float* in,
+      int32_t stride,
+      int16_t* s16,
+      int8_t* s8,
+      int32_t size) {
+    int32_t i = 0;
+    if (resolution == RESOLUTION_8_BIT_DITHERED) {
+      // The quantization error of a sample is fed into the next one, so
+      // there is no point in processing several samples at once.
+      for (; i < size; ++i) {
+        float sample = *in * 127.0f;
+        sample += quantization_error_;
+        int32_t quantized = static_cast<int32_t>(sample);
+        if (quantized < -127) quantized = -127;
+        else if (quantized > 127) quantized = 127;
+        quantization_error_ = sample - static_cast<float>(*in);
+        s8[i] = quantized;
+        in += stride;
+      }
+      return;
+    }
+    
+#ifdef CLOUDS_SIMD
+    const LaneFloat gain = SplatLanes(32768.0f);
+    const LaneFloat lowest = SplatLanes(-32768.0f);
+    const LaneFloat highest = SplatLanes(32767.0f);
+    for (; i + int32_t(kNumLanes) <= size; i += kNumLanes) {
+      LaneFloat x;
+      if (stride == 1) {
+        x = LoadLanes(in);
+      } else if (stride == 2 && i + int32_t(kNumLanes) < size) {
+        // Also loads the odd samples, in[1] to in[7]. On the last group, in[7]
+        // might be past the end of the input: it goes through the gather.
+        LaneFloat odd;
+        DeinterleaveLanes(LoadLanes(in), LoadLanes(in + kNumLanes), &x, &odd);
+      } else {
+        float gathered[kNumLanes];
+        for (size_t j = 0; j < kNumLanes; ++j) {
+          gathered[j] = in[j * stride];
+        }
+        x = LoadLanes(gathered);
+      }
+      in += kNumLanes * stride;
+      
+      // Same as Clip16(static_cast<int32_t>(x * 32768.0f)).
+      LaneInt pcm = TruncateLanes(
+          MinLanes(MaxLanes(MulLanes(x, gain), lowest), highest));
+      if (resolution == RESOLUTION_16_BIT) {
+        StoreLanes(&s16[i], pcm);
+      } else if (resolution == RESOLUTION_8_BIT_MU_LAW) {
+        StoreLanes(&s8[i], Lin2MuLawLanes(pcm));
+      } else {
+        StoreLanes(&s8[i], ShiftRightArithmeticLanes<8>(pcm));
+      }
+    }
+#endif  // CLOUDS_SIMD
+
+    for (; i < size; ++i) {
+      if (resolution == RESOLUTION_16_BIT) {
+        s16[i] = stmlib::Clip16(static_cast<int32_t>(*in * 32768.0f));
+      } else if (resolution == RESOLUTION_8_BIT_MU_LAW) {
+        int16_t sample = stmlib::Clip16(static_cast<int32_t>(*in * 32768.0f));
+        s8[i] = Lin2MuLaw(sample);
+      } else {
+        s8[i] = static_cast<int8_t>(stmlib::Clip16(*in * 32768.0f) >> 8);
+      }
+      in += stride;
+    }
+  }
+  
+  // Converts size stored samples to float, without scaling.
+  inline void Decode(int32_t start, int32_t size, float* out) const {
+    int32_t i = 0;
+#ifdef CLOUDS_SIMD
+    if (resolution == RESOLUTION_16_BIT) {
+      for (; i + int32_t(kNumLanes) <= size; i += kNumLanes) {
+        StoreLanes(&out[i], LoadLanes(&s16_[start + i]));
+      }
+    } else if (resolution != RESOLUTION_8_BIT_MU_LAW) {
+      for (; i + int32_t(kNumLanes) <= size; i += kNumLanes) {
+        StoreLanes(&out[i], LoadLanes(&s8_[start + i]));
+      }
+    }
+#endif  // CLOUDS_SIMD
+    for (; i < size; ++i) {
+      if (resolution == RESOLUTION_16_BIT) {
+        out[i] = s16_[start + i];
+      } else if (resolution == RESOLUTION_8_BIT_MU_LAW) {
+        out[i] = MuLaw2Lin(s8_[start + i]);
+      } else {
+        out[i] = s8_[start + i];
+      }
+    }
+  }
+  
   int16_t* s16_;
   int8_t* s8_;
   
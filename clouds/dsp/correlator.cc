@@ -30,15 +30,49 @@
 
 #include <algorithm>
 
+#include "clouds/dsp/simd.h"
+
 namespace clouds {
 
 using namespace std;
 
+namespace {
+
+inline uint32_t CountBits(uint32_t x) {
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  return (((x + (x >> 4)) & 0xf0f0f0f) * 0x1010101) >> 24;
+}
+
+// 32 bits read from a bit string, starting at the shift-th bit of bits[0].
+inline uint32_t ReadBits(const uint32_t* bits, int32_t shift) {
+  return shift ? (bits[0] << shift) | (bits[1] >> (32 - shift)) : bits[0];
+}
+
+#ifdef CLOUDS_SIMD
+
+inline LaneInt CountBits(LaneInt x) {
+  const LaneInt m1 = SplatLanes(0x55555555);
+  const LaneInt m2 = SplatLanes(0x33333333);
+  const LaneInt m4 = SplatLanes(0x0f0f0f0f);
+  x = SubLanes(x, AndLanes(ShiftRightLanes<1>(x), m1));
+  x = AddLanes(AndLanes(x, m2), AndLanes(ShiftRightLanes<2>(x), m2));
+  x = AndLanes(AddLanes(x, ShiftRightLanes<4>(x)), m4);
+  x = AddLanes(x, ShiftRightLanes<8>(x));
+  x = AddLanes(x, ShiftRightLanes<16>(x));
+  return AndLanes(x, SplatLanes(0x3f));
+}
+
+#endif  // CLOUDS_SIMD
+
+}  // namespace
+
 void Correlator::Init(uint32_t* source, uint32_t* destination) {
   source_ = source;
   destination_ = destination;
   offset_ = 0;
   best_match_ = 0;
+  latency_ = 0;
   done_ = true;
 }
 
@@ -55,14 +89,8 @@ void Correlator::EvaluateNextCandidate() {
   uint32_t xcorr = 0;
   for (uint32_t i = 0; i < num_words; ++i) {
     uint32_t source_bits = source[i];
-    uint32_t destination_bits = 0;
-    destination_bits |= destination[i] << offset_bits;
-    destination_bits |= destination[i + 1] >> (32 - offset_bits);
-    uint32_t count = ~(source_bits ^ destination_bits);
-    count = count - ((count >> 1) & 0x55555555);
-    count = (count & 0x33333333) + ((count >> 2) & 0x33333333);
-    count = (((count + (count >> 4)) & 0xf0f0f0f) * 0x1010101) >> 24;
-    xcorr += count;
+    uint32_t destination_bits = ReadBits(&destination[i], offset_bits);
+    xcorr += CountBits(~(source_bits ^ destination_bits));
   }
   if (xcorr > best_score_) {
     best_match_ = candidate_;
@@ -72,6 +100,99 @@ void Correlator::EvaluateNextCandidate() {
   done_ = candidate_ >= size_;
 }
 
+void Correlator::ScoreCandidates(
+    int32_t candidate,
+    int32_t stride,
+    uint32_t* score) {
+  const int32_t num_words = size_ >> 5;
+  const uint32_t* destination[kNumParallelCandidates];
+  int32_t shift[kNumParallelCandidates];
+  uint32_t mismatches[kNumParallelCandidates];
+  for (int32_t j = 0; j < kNumParallelCandidates; ++j) {
+    // Candidates past the end are scored as the last one, and ignored.
+    int32_t c = min(candidate + j * stride, size_ - 1);
+    destination[j] = &destination_[c >> 5];
+    shift[j] = c & 0x1f;
+    mismatches[j] = 0;
+  }
+  
+  int32_t i = 0;
+#ifdef CLOUDS_SIMD
+  LaneInt count[kNumParallelCandidates];
+  for (int32_t j = 0; j < kNumParallelCandidates; ++j) {
+    count[j] = SplatLanes(0);
+  }
+  for (; i + int32_t(kNumLanes) <= num_words; i += kNumLanes) {
+    LaneInt source_bits = LoadLanes(
+        reinterpret_cast<const int32_t*>(&source_[i]));
+    for (int32_t j = 0; j < kNumParallelCandidates; ++j) {
+      const int32_t* d = reinterpret_cast<const int32_t*>(&destination[j][i]);
+      LaneInt destination_bits = OrLanes(
+          ShiftLeftLanes(LoadLanes(d), shift[j]),
+          ShiftRightLanes(LoadLanes(d + 1), 32 - shift[j]));
+      count[j] = AddLanes(
+          count[j], CountBits(XorLanes(source_bits, destination_bits)));
+    }
+  }
+  for (int32_t j = 0; j < kNumParallelCandidates; ++j) {
+    int32_t lanes[kNumLanes];
+    StoreLanes(lanes, count[j]);
+    for (size_t k = 0; k < kNumLanes; ++k) {
+      mismatches[j] += lanes[k];
+    }
+  }
+#endif  // CLOUDS_SIMD
+  for (; i < num_words; ++i) {
+    for (int32_t j = 0; j < kNumParallelCandidates; ++j) {
+      mismatches[j] += CountBits(
+          source_[i] ^ ReadBits(&destination[j][i], shift[j]));
+    }
+  }
+  for (int32_t j = 0; j < kNumParallelCandidates; ++j) {
+    score[j] = (num_words << 5) - mismatches[j];
+  }
+}
+
+void Correlator::ScoreRange(int32_t first, int32_t end, int32_t stride) {
+  uint32_t score[kNumParallelCandidates];
+  for (int32_t c = first; c < end; c += kNumParallelCandidates * stride) {
+    ScoreCandidates(c, stride, score);
+    // Same order and same strict comparison as EvaluateNextCandidate, so
+    // that ties are resolved identically.
+    for (int32_t j = 0; j < kNumParallelCandidates; ++j) {
+      int32_t candidate = c + j * stride;
+      if (candidate < end && score[j] > best_score_) {
+        best_match_ = candidate;
+        best_score_ = score[j];
+      }
+    }
+  }
+}
+
+void Correlator::EvaluateAllCandidates() {
+  if (done_) {
+    return;
+  }
+  ++latency_;
+  ScoreRange(candidate_, size_, 1);
+  candidate_ = size_;
+  done_ = true;
+}
+
+void Correlator::EvaluateCoarseToFine(int32_t coarse_step) {
+  if (done_) {
+    return;
+  }
+  ++latency_;
+  ScoreRange(candidate_, size_, coarse_step);
+  ScoreRange(
+      max(best_match_ - coarse_step + 1, candidate_),
+      min(best_match_ + coarse_step, size_),
+      1);
+  candidate_ = size_;
+  done_ = true;
+}
+
 void Correlator::StartSearch(
     int32_t size,
     int32_t offset,
@@ -82,6 +203,7 @@ void Correlator::StartSearch(
   best_match_ = 0;
   candidate_ = 0;
   size_ = size;
+  latency_ = 0;
   done_ = false;
 }
 
@@ -27,6 +27,10 @@
 // Search for stretch/shift splicing points by maximizing correlation.
 // Correlation is computed by XOR-ing the bit sign of samples - this allows
 // 32 samples to be matched in one single XOR operation.
+//
+// On the module, the search is spread across several blocks. When vector
+// registers are available, candidates are scored kNumParallelCandidates at a
+// time, 4 words per instruction, and the whole search fits in one block.
 
 #ifndef CLOUDS_DSP_CORRELATOR_H_
 #define CLOUDS_DSP_CORRELATOR_H_
@@ -49,6 +53,10 @@ class Correlator {
   }
 
   inline void EvaluateSomeCandidates() {
+    if (done_) {
+      return;
+    }
+    ++latency_;
     size_t num_candidates = (size_ >> 2) + 16;
     while (num_candidates) {
       EvaluateNextCandidate();
@@ -57,6 +65,14 @@ class Correlator {
   }
 
   void EvaluateNextCandidate();
+  
+  // Evaluates all the remaining candidates. Finds the same best match as
+  // repeated calls to EvaluateNextCandidate.
+  void EvaluateAllCandidates();
+  
+  // Scores one candidate out of coarse_step, then all the candidates around
+  // the best of them. Much faster, but might miss a narrow peak.
+  void EvaluateCoarseToFine(int32_t coarse_step);
 
   inline uint32_t* source() { return source_; }
   inline uint32_t* destination() { return destination_; }
@@ -64,7 +80,19 @@ class Correlator {
 
   inline bool done() { return done_; }
   
+  // Number of blocks during which the current (or last) search has run.
+  inline int32_t latency() const { return latency_; }
+  
  private:
+  enum {
+    kNumParallelCandidates = 4
+  };
+  
+  // Scores kNumParallelCandidates candidates spaced by stride, sharing the
+  // reads of the source words.
+  void ScoreCandidates(int32_t candidate, int32_t stride, uint32_t* score);
+  void ScoreRange(int32_t first, int32_t last, int32_t stride);
+  
   uint32_t* source_;
   uint32_t* destination_;
   
@@ -77,6 +105,7 @@ class Correlator {
   int32_t best_match_;
   
   int32_t trace_;
+  int32_t latency_;
   
   bool done_;
   
@@ -73,7 +73,10 @@ class Reverb {
     E::DelayLine<Memory, 7> dap2a;
     E::DelayLine<Memory, 8> dap2b;
     E::DelayLine<Memory, 9> del2;
-    E::Context c;
+    
+    // The shortest feedback path is the AP1 smearing tap, 10 samples long.
+    const size_t kBlockSize = 8;
+    E::BlockContext<kBlockSize> c;
 
     const float kap = diffusion_;
     const float klp = lp_;
@@ -84,16 +87,28 @@ class Reverb {
     float lp_1 = lp_decay_1_;
     float lp_2 = lp_decay_2_;
 
-    while (size--) {
-      float wet;
-      float apout = 0.0f;
-      engine_.Start(&c);
+    while (size) {
+      float input[kBlockSize];
+      float apout[kBlockSize];
+      float wet[kBlockSize];
+      float del2_tap[kBlockSize];
+      const size_t block = engine_.Start(&c, size);
+      
+      for (size_t i = 0; i < block; ++i) {
+        input[i] = in_out[i].l + in_out[i].r;
+      }
+      
+      // At the top of its modulation range, this tap reads the memory that
+      // AP1 is about to overwrite a few samples later. Read it before AP1 is
+      // written.
+      c.Interpolate(del2, 4680.0f, LFO_2, 100.0f, krt);
+      c.Write(del2_tap, 0.0f);
       
       // Smear AP1 inside the loop.
       c.Interpolate(ap1, 10.0f, LFO_1, 60.0f, 1.0f);
       c.Write(ap1, 100, 0.0f);
       
-      c.Read(in_out->l + in_out->r, gain);
+      c.Read(input, gain);
 
       // Diffuse through 4 allpasses.
       c.Read(ap1 TAIL, kap);
@@ -108,7 +123,7 @@ class Reverb {
       
       // Main reverb loop.
       c.Load(apout);
-      c.Interpolate(del2, 4680.0f, LFO_2, 100.0f, krt);
+      c.Read(del2_tap);
       c.Lp(lp_1, klp);
       c.Read(dap1a TAIL, -kap);
       c.WriteAllPass(dap1a, kap);
@@ -117,7 +132,9 @@ class Reverb {
       c.Write(del1, 2.0f);
       c.Write(wet, 0.0f);
 
-      in_out->l += (wet - in_out->l) * amount;
+      for (size_t i = 0; i < block; ++i) {
+        in_out[i].l += (wet[i] - in_out[i].l) * amount;
+      }
 
       c.Load(apout);
       // c.Interpolate(del1, 4450.0f, LFO_1, 50.0f, krt);
@@ -130,9 +147,12 @@ class Reverb {
       c.Write(del2, 2.0f);
       c.Write(wet, 0.0f);
 
-      in_out->r += (wet - in_out->r) * amount;
+      for (size_t i = 0; i < block; ++i) {
+        in_out[i].r += (wet[i] - in_out[i].r) * amount;
+      }
       
-      ++in_out;
+      in_out += block;
+      size -= block;
     }
     
     lp_decay_1_ = lp_1;
@@ -24,16 +24,25 @@
 //
 // -----------------------------------------------------------------------------
 //
-// Single grain synthesis.
+// Grain synthesis.
+//
+// The state of the grains is stored as a structure of arrays, and the active
+// grains are packed at the beginning of the arrays, so that groups of 4
+// neighbouring grains can be processed at once (envelope rendering) without
+// scanning the whole pool. A finished grain is replaced by the last active one.
 
 #ifndef CLOUDS_DSP_GRAIN_H_
 #define CLOUDS_DSP_GRAIN_H_
 
 #include "stmlib/stmlib.h"
 
+#include <algorithm>
+
 #include "stmlib/dsp/dsp.h"
 
 #include "clouds/dsp/audio_buffer.h"
+#include "clouds/dsp/frame.h"
+#include "clouds/dsp/simd.h"
 
 #include "clouds/resources.h"
 
@@ -45,16 +54,32 @@ enum GrainQuality {
   GRAIN_QUALITY_HIGH
 };
 
-class Grain {
+template<int32_t capacity>
+class GrainPool {
  public:
-  Grain() { }
-  ~Grain() { }
-
-  void Init() {
-    active_ = false;
-    envelope_phase_ = 2.0f;
+  GrainPool() { }
+  ~GrainPool() { }
+  
+  void Init(int32_t max_num_grains) {
+    max_num_grains_ = std::min(max_num_grains, capacity);
+    num_active_ = 0;
+    std::fill(&first_sample_[0], &first_sample_[capacity], 0);
+    std::fill(&phase_[0], &phase_[capacity], 0);
+    std::fill(&phase_increment_[0], &phase_increment_[capacity], 0);
+    std::fill(&pre_delay_[0], &pre_delay_[capacity], 0);
+    std::fill(&envelope_phase_[0], &envelope_phase_[capacity], 2.0f);
+    std::fill(
+        &envelope_phase_increment_[0],
+        &envelope_phase_increment_[capacity],
+        0.0f);
+    std::fill(&envelope_smoothness_[0], &envelope_smoothness_[capacity], 0.0f);
+    std::fill(&envelope_slope_[0], &envelope_slope_[capacity], 1.0f);
+    std::fill(&gain_l_[0], &gain_l_[capacity], 0.0f);
+    std::fill(&gain_r_[0], &gain_r_[capacity], 0.0f);
+    std::fill(&quality_[0], &quality_[capacity], GRAIN_QUALITY_LOW);
   }
-
+  
+  // Must only be called when num_available() is not zero.
   void Start(
       int32_t pre_delay,
       int32_t buffer_size,
@@ -64,140 +89,288 @@ class Grain {
       float window_shape,
       float gain_l,
       float gain_r,
-      GrainQuality recommended_quality) {
-    pre_delay_ = pre_delay;
-    width_ = width;
-    first_sample_ = (start + buffer_size) % buffer_size;
-    phase_increment_ = phase_increment;
-    phase_ = 0;
-    envelope_phase_ = 0.0f;
-    envelope_phase_increment_ = 2.0f / static_cast<float>(width);
+      GrainQuality quality) {
+    int32_t i = num_active_++;
+    pre_delay_[i] = pre_delay;
+    first_sample_[i] = (start + buffer_size) % buffer_size;
+    phase_increment_[i] = phase_increment;
+    phase_[i] = 0;
+    envelope_phase_[i] = 0.0f;
+    envelope_phase_increment_[i] = 2.0f / static_cast<float>(width);
+    
+    float smoothness = 0.0f;
+    float slope = 0.0f;
     if (window_shape >= 0.5f) {
-      envelope_smoothness_ = (window_shape - 0.5f) * 2.0f;
-      envelope_slope_ = 0.0f;
+      smoothness = (window_shape - 0.5f) * 2.0f;
     } else {
-      envelope_smoothness_ = 0.0f;
-      envelope_slope_ = 0.5f / (window_shape + 0.01f);
+      slope = 0.5f / (window_shape + 0.01f);
     }
-    active_ = true;
-    gain_l_ = gain_l;
-    gain_r_ = gain_r;
-    recommended_quality_ = recommended_quality;
+    // The lower quality settings skip the window lookup, or the slope. This
+    // is equivalent to a smoothness of 0, or a slope of 1.
+    envelope_smoothness_[i] = quality == GRAIN_QUALITY_HIGH ? smoothness : 0.0f;
+    envelope_slope_[i] = smoothness == 0.0f && quality >= GRAIN_QUALITY_MEDIUM
+        ? slope
+        : 1.0f;
+    gain_l_[i] = gain_l;
+    gain_r_[i] = gain_r;
+    quality_[i] = quality;
   }
   
-  template<bool use_lut_for_envelope, GrainQuality quality>
-  inline void RenderEnvelope(float* destination, size_t size) {
-    const float increment = envelope_phase_increment_;
-    const float smoothness = envelope_smoothness_;
-    const float slope = envelope_slope_;
-
-    float phase = envelope_phase_;
-    while (size--) {
-      float gain = phase;
-      gain = gain >= 1.0f ? 2.0f - gain : gain;
-      if (use_lut_for_envelope) {
-        if (quality == GRAIN_QUALITY_HIGH) {
-          float window = 0.0f;
-          window = stmlib::Interpolate(lut_window, gain, 4096.0f);
-          gain += smoothness * (window - gain);
-        }
-      } else {
-        if (quality >= GRAIN_QUALITY_MEDIUM) {
-          gain *= slope;
-          if (gain >= 1.0f) gain = 1.0f;
-        }
+  template<int32_t num_channels, Resolution resolution>
+  void OverlapAdd(
+      const AudioBuffer<resolution>* buffer,
+      float* destination,
+      size_t size) {
+    for (int32_t i = 0; i < num_active_; i += kNumLanes) {
+      RenderEnvelopes(i, size);
+      for (int32_t j = 0; j < int32_t(kNumLanes) && i + j < num_active_; ++j) {
+        Render<num_channels>(buffer, i + j, j, destination);
       }
-      phase += increment;
-      if (phase >= 2.0f) {
-        *destination = -1.0f;
-        break;
+    }
+    
+    // Remove the grains which have reached the end of their envelope. The
+    // pool is scanned backwards so that the grain moved into the slot of a
+    // finished grain has already been checked.
+    for (int32_t i = num_active_ - 1; i >= 0; --i) {
+      if (envelope_phase_[i] >= 2.0f) {
+        Move(num_active_ - 1, i);
+        --num_active_;
       }
-      *destination++ = gain;
     }
-    envelope_phase_ = phase;
   }
   
-  template<int32_t num_channels, GrainQuality quality, Resolution resolution>
-  inline void OverlapAdd(
-      const AudioBuffer<resolution>* buffer,
-      float* destination,
-      float* envelope,
-      size_t size) {
-    if (!active_) {
-      return;
-    }
-    // Rendering is done on 32-sample long blocks. The pre-delay allows grains
-    // to start at arbitrary samples within a block, rather than at block
-    // boundaries.
-    while (pre_delay_ && size) {
-      destination += 2;
-      --size;
-      --pre_delay_;
+  inline int32_t num_active() const { return num_active_; }
+  inline int32_t num_available() const {
+    return max_num_grains_ - num_active_;
+  }
+  
+ private:
+  // Renders the envelopes of the grains in slots first to first + 3 into
+  // envelope_, and the range of samples covered by each grain in this block.
+  void RenderEnvelopes(int32_t first, size_t size) {
+#ifdef CLOUDS_SIMD
+    bool use_window = false;
+    for (size_t i = 0; i < kNumLanes; ++i) {
+      use_window = use_window || envelope_smoothness_[first + i] != 0.0f;
     }
     
-    // Pre-render the envelope in one pass.
-    if (envelope_smoothness_ == 0.0f) {
-      RenderEnvelope<false, quality>(envelope, size);
-    } else {
-      RenderEnvelope<true, quality>(envelope, size);
+    const LaneFloat zero = SplatLanes(0.0f);
+    const LaneFloat one = SplatLanes(1.0f);
+    const LaneFloat two = SplatLanes(2.0f);
+    const LaneFloat window_size = SplatLanes(4096.0f);
+    const LaneInt lsb = SplatLanes(int32_t(1));
+    const LaneFloat increment = LoadLanes(&envelope_phase_increment_[first]);
+    const LaneFloat smoothness = LoadLanes(&envelope_smoothness_[first]);
+    const LaneFloat slope = LoadLanes(&envelope_slope_[first]);
+    LaneFloat phase = LoadLanes(&envelope_phase_[first]);
+    LaneFloat delay = SubLanes(
+        ConvertLanes(LoadLanes(&pre_delay_[first])),
+        SplatLanes(0.5f));
+    LaneInt length = SplatLanes(int32_t(0));
+    
+    float envelope[kMaxBlockSize][kNumLanes];
+    for (size_t t = 0; t < size; ++t) {
+      LaneFloat gain = SelectLanes(
+          GreaterLanes(one, phase), phase, SubLanes(two, phase));
+      gain = MinLanes(MulLanes(gain, slope), one);
+      if (use_window) {
+        // Same as stmlib::Interpolate(lut_window, gain, 4096.0f).
+        LaneFloat x = MulLanes(gain, window_size);
+        LaneInt x_integral = TruncateLanes(x);
+        LaneFloat x_fractional = SubLanes(x, ConvertLanes(x_integral));
+        int32_t index[kNumLanes];
+        float a[kNumLanes];
+        float b[kNumLanes];
+        StoreLanes(index, x_integral);
+        for (size_t i = 0; i < kNumLanes; ++i) {
+          int32_t j = index[i];
+          CONSTRAIN(j, 0, 4096);
+          a[i] = lut_window[j];
+          b[i] = lut_window[std::min(j + 1, int32_t(4096))];
+        }
+        LaneFloat window = AddLanes(
+            LoadLanes(a),
+            MulLanes(SubLanes(LoadLanes(b), LoadLanes(a)), x_fractional));
+        gain = AddLanes(gain, MulLanes(smoothness, SubLanes(window, gain)));
+      }
+      
+      // The envelope of a grain advances once its pre-delay has elapsed,
+      // and until its phase reaches 2.0.
+      LaneInt running = AndLanes(
+          GreaterLanes(SplatLanes(static_cast<float>(t)), delay),
+          GreaterLanes(two, phase));
+      LaneFloat next_phase = AddLanes(phase, increment);
+      LaneInt playing = AndLanes(running, GreaterLanes(two, next_phase));
+      phase = SelectLanes(running, next_phase, phase);
+      length = AddLanes(length, AndLanes(playing, lsb));
+      StoreLanes(envelope[t], SelectLanes(playing, gain, zero));
     }
+    StoreLanes(&envelope_phase_[first], phase);
     
-    const int32_t phase_increment = phase_increment_;
-    const int32_t first_sample = first_sample_;
-    const float gain_l = gain_l_;
-    const float gain_r = gain_r_;
-    int32_t phase = phase_;
-    while (size--) {
-      int32_t sample_index = first_sample + (phase >> 16);
+    int32_t lengths[kNumLanes];
+    StoreLanes(lengths, length);
+    for (size_t i = 0; i < kNumLanes; ++i) {
+      int32_t start = std::min(pre_delay_[first + i], int32_t(size));
+      pre_delay_[first + i] -= start;
+      start_[i] = start;
+      length_[i] = lengths[i];
+      for (size_t t = start; t < size_t(start + lengths[i]); ++t) {
+        envelope_[i][t] = envelope[t][i];
+      }
+    }
+#else
+    for (int32_t i = 0;
+         i < int32_t(kNumLanes) && first + i < num_active_;
+         ++i) {
+      const int32_t slot = first + i;
+      const float increment = envelope_phase_increment_[slot];
+      const float smoothness = envelope_smoothness_[slot];
+      const float slope = envelope_slope_[slot];
       
-      float gain = *envelope++;
-      if (gain == -1.0f) {
-        active_ = false;
-        break;
+      // Rendering is done on 32-sample long blocks. The pre-delay allows
+      // grains to start at arbitrary samples within a block, rather than at
+      // block boundaries.
+      int32_t start = std::min(pre_delay_[slot], int32_t(size));
+      pre_delay_[slot] -= start;
+      
+      float phase = envelope_phase_[slot];
+      float* destination = envelope_[i];
+      size_t t = start;
+      for (; t < size && phase < 2.0f; ++t) {
+        float gain = phase;
+        gain = gain >= 1.0f ? 2.0f - gain : gain;
+        gain *= slope;
+        if (gain >= 1.0f) gain = 1.0f;
+        if (smoothness != 0.0f) {
+          float window = stmlib::Interpolate(lut_window, gain, 4096.0f);
+          gain += smoothness * (window - gain);
+        }
+        phase += increment;
+        if (phase >= 2.0f) {
+          break;
+        }
+        destination[t] = gain;
       }
+      envelope_phase_[slot] = phase;
+      start_[i] = start;
+      length_[i] = t - start;
+    }
+#endif  // CLOUDS_SIMD
+  }
+  
+  template<int32_t num_channels, Resolution resolution>
+  void Render(
+      const AudioBuffer<resolution>* buffer,
+      int32_t slot,
+      int32_t lane,
+      float* destination) {
+    const size_t n = length_[lane];
+    const float* envelope = &envelope_[lane][start_[lane]];
+    destination += 2 * start_[lane];
+    
+    float samples[2][kMaxBlockSize];
+    for (int32_t i = 0; i < num_channels; ++i) {
+      if (quality_[slot] == GRAIN_QUALITY_HIGH) {
+        buffer[i].template ReadBlock<INTERPOLATION_HERMITE>(
+            first_sample_[slot], phase_[slot], phase_increment_[slot],
+            samples[i], n);
+      } else if (quality_[slot] == GRAIN_QUALITY_MEDIUM) {
+        buffer[i].template ReadBlock<INTERPOLATION_LINEAR>(
+            first_sample_[slot], phase_[slot], phase_increment_[slot],
+            samples[i], n);
+      } else {
+        buffer[i].template ReadBlock<INTERPOLATION_ZOH>(
+            first_sample_[slot], phase_[slot], phase_increment_[slot],
+            samples[i], n);
+      }
+    }
+    phase_[slot] += static_cast<int32_t>(n) * phase_increment_[slot];
 
-      float l = buffer[0].template Read<InterpolationMethod(quality)>(
-          sample_index, phase & 65535) * gain;
+    const float gain_l = gain_l_[slot];
+    const float gain_r = gain_r_[slot];
+    size_t i = 0;
+#ifdef CLOUDS_SIMD
+    const LaneFloat lanes_gain_l = SplatLanes(gain_l);
+    const LaneFloat lanes_gain_r = SplatLanes(gain_r);
+    const LaneFloat lanes_bleed_l = SplatLanes(1.0f - gain_l);
+    const LaneFloat lanes_bleed_r = SplatLanes(1.0f - gain_r);
+    for (; i + kNumLanes <= n; i += kNumLanes) {
+      LaneFloat gain = LoadLanes(&envelope[i]);
+      LaneFloat l = MulLanes(LoadLanes(&samples[0][i]), gain);
+      LaneFloat out_l, out_r;
+      if (num_channels == 1) {
+        out_l = MulLanes(l, lanes_gain_l);
+        out_r = MulLanes(l, lanes_gain_r);
+      } else {
+        LaneFloat r = MulLanes(LoadLanes(&samples[1][i]), gain);
+        out_l = AddLanes(MulLanes(l, lanes_gain_l), MulLanes(r, lanes_bleed_r));
+        out_r = AddLanes(MulLanes(r, lanes_gain_r), MulLanes(l, lanes_bleed_l));
+      }
+      StoreLanes(
+          destination,
+          AddLanes(LoadLanes(destination), InterleaveLowLanes(out_l, out_r)));
+      StoreLanes(
+          destination + kNumLanes,
+          AddLanes(
+              LoadLanes(destination + kNumLanes),
+              InterleaveHighLanes(out_l, out_r)));
+      destination += 2 * kNumLanes;
+    }
+#endif  // CLOUDS_SIMD
+    for (; i < n; ++i) {
+      float gain = envelope[i];
+      float l = samples[0][i] * gain;
       if (num_channels == 1) {
         *destination++ += l * gain_l;
         *destination++ += l * gain_r;
       } else if (num_channels == 2) {
-        float r = buffer[1].template Read<InterpolationMethod(quality)>(
-            sample_index, phase & 65535) * gain;
+        float r = samples[1][i] * gain;
         *destination++ += l * gain_l + r * (1.0f - gain_r);
         *destination++ += r * gain_r + l * (1.0f - gain_l);
       }
-      phase += phase_increment;
     }
-    phase_ = phase;
   }
   
-  inline bool active() { return active_; }
-  
-  inline GrainQuality recommended_quality() const {
-    return recommended_quality_;
+  inline void Move(int32_t from, int32_t to) {
+    first_sample_[to] = first_sample_[from];
+    phase_[to] = phase_[from];
+    phase_increment_[to] = phase_increment_[from];
+    pre_delay_[to] = pre_delay_[from];
+    envelope_phase_[to] = envelope_phase_[from];
+    envelope_phase_increment_[to] = envelope_phase_increment_[from];
+    envelope_smoothness_[to] = envelope_smoothness_[from];
+    envelope_slope_[to] = envelope_slope_[from];
+    gain_l_[to] = gain_l_[from];
+    gain_r_[to] = gain_r_[from];
+    quality_[to] = quality_[from];
   }
-
- private:
-  int32_t first_sample_;
-  int32_t width_;
-  int32_t phase_;
-  int32_t phase_increment_;
-  int32_t pre_delay_;
-
-  float envelope_smoothness_;
-  float envelope_slope_;
-  float envelope_phase_;
-  float envelope_phase_increment_;
-
-  float gain_l_;
-  float gain_r_;
-
-  bool active_;
   
-  GrainQuality recommended_quality_;
-
-  DISALLOW_COPY_AND_ASSIGN(Grain);
+  // Groups of 4 grains are always read from the arrays.
+  STATIC_ASSERT(capacity % kNumLanes == 0, capacity_is_a_multiple_of_4);
+  
+  int32_t max_num_grains_;
+  int32_t num_active_;
+  
+  int32_t first_sample_[capacity];
+  int32_t phase_[capacity];
+  int32_t phase_increment_[capacity];
+  int32_t pre_delay_[capacity];
+  
+  float envelope_phase_[capacity];
+  float envelope_phase_increment_[capacity];
+  float envelope_smoothness_[capacity];
+  float envelope_slope_[capacity];
+  
+  float gain_l_[capacity];
+  float gain_r_[capacity];
+  
+  GrainQuality quality_[capacity];
+  
+  float envelope_[kNumLanes][kMaxBlockSize];
+  int32_t start_[kNumLanes];
+  int32_t length_[kNumLanes];
+  
+  DISALLOW_COPY_AND_ASSIGN(GrainPool);
 };
 
 }  // namespace clouds
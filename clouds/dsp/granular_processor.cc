@@ -52,6 +52,7 @@ void GranularProcessor::Init(
   
   num_channels_ = 2;
   low_fidelity_ = false;
+  silence_ = false;
   bypass_ = false;
   
   src_down_.Init();
@@ -177,7 +177,7 @@ class GranularProcessor {
   
   Correlator correlator_;
   
-  GranularSamplePlayer player_;
+  GranularSamplePlayer<kMaxNumGrains> player_;
   WSOLASamplePlayer ws_player_;
   LoopingSamplePlayer looper_;
   PhaseVocoder phase_vocoder_;
@@ -50,18 +50,18 @@ const int32_t kMaxNumGrains = 64;
 
 using namespace stmlib;
 
+// The number of grains is set at run time by Init(), and is at most capacity.
+template<int32_t capacity>
 class GranularSamplePlayer {
  public:
   GranularSamplePlayer() { }
   ~GranularSamplePlayer() { }
   
   void Init(int32_t num_channels, int32_t max_num_grains) {
-    max_num_grains_ = max_num_grains;
-    num_midfi_grains_ = 3 * max_num_grains / 4;
+    max_num_grains_ = std::min(max_num_grains, capacity);
+    num_midfi_grains_ = 3 * max_num_grains_ / 4;
     gain_normalization_ = 1.0f;
-    for (int32_t i = 0; i < kMaxNumGrains; ++i) {
-      grains_[i].Init();
-    }
+    grains_.Init(max_num_grains_);
     num_grains_ = 0.0f;
     num_channels_ = num_channels;
     grain_size_hint_ = 1024.0f;
@@ -83,8 +83,7 @@ class GranularSamplePlayer {
       grain_rate_phasor_ = -1000.0f;
     }
     
-    // Build a list of available grains.
-    int32_t num_available_grains = FillAvailableGrainsList();
+    int32_t num_available_grains = grains_.num_available();
     
     // Try to schedule new grains.
     bool seed_trigger = parameters.trigger;
@@ -96,7 +95,6 @@ class GranularSamplePlayer {
       bool seed = seed_probabilistic || seed_deterministic || seed_trigger;
       if (num_available_grains && seed) {
         --num_available_grains;
-        int32_t index = available_grains_[num_available_grains];
         GrainQuality quality;
         if (num_available_grains < num_midfi_grains_) {
           quality = GRAIN_QUALITY_MEDIUM;
@@ -104,9 +102,7 @@ class GranularSamplePlayer {
           quality = GRAIN_QUALITY_HIGH;
         }
         
-        Grain* g = &grains_[index];
         ScheduleGrain(
-            g,
             parameters,
             t,
             buffer->size(),
@@ -119,32 +115,14 @@ class GranularSamplePlayer {
     
     // Overlap grains.
     std::fill(&out[0], &out[size * 2], 0.0f);
-    float* e = envelope_buffer_;
-    for (int32_t i = 0; i < max_num_grains_; ++i) {
-      Grain* g = &grains_[i];
-      if (g->recommended_quality() == GRAIN_QUALITY_HIGH) {
-        if (num_channels_ == 1) {
-          g->OverlapAdd<1, GRAIN_QUALITY_HIGH>(buffer, out, e, size);
-        } else {
-          g->OverlapAdd<2, GRAIN_QUALITY_HIGH>(buffer, out, e, size);
-        }
-      } else if (g->recommended_quality() == GRAIN_QUALITY_MEDIUM) {
-        if (num_channels_ == 1) {
-          g->OverlapAdd<1, GRAIN_QUALITY_MEDIUM>(buffer, out, e, size);
-        } else {
-          g->OverlapAdd<2, GRAIN_QUALITY_MEDIUM>(buffer, out, e, size);
-        }
-      } else {
-        if (num_channels_ == 1) {
-          g->OverlapAdd<1, GRAIN_QUALITY_LOW>(buffer, out, e, size);
-        } else {
-          g->OverlapAdd<2, GRAIN_QUALITY_LOW>(buffer, out, e, size);
-        }
-      }
+    int32_t active_grains = grains_.num_active();
+    if (num_channels_ == 1) {
+      grains_.template OverlapAdd<1>(buffer, out, size);
+    } else {
+      grains_.template OverlapAdd<2>(buffer, out, size);
     }
     
     // Compute normalization factor.
-    int32_t active_grains = max_num_grains_ - num_available_grains;
     SLOPE(num_grains_, static_cast<float>(active_grains), 0.9f, 0.2f);
 
     float gain_normalization = num_grains_ > 2.0f
@@ -164,19 +142,7 @@ class GranularSamplePlayer {
   }
   
  private:
-  int32_t FillAvailableGrainsList() {
-    int32_t num_available_grains = 0;
-    for (int32_t i = 0; i < max_num_grains_; ++i) {
-      if (!grains_[i].active()) {
-        available_grains_[num_available_grains] = i;
-        ++num_available_grains;
-      }
-    }
-    return num_available_grains;
-  }
-  
   void ScheduleGrain(
-      Grain* grain,
       const Parameters& parameters,
       int32_t pre_delay,
       int32_t buffer_size,
@@ -222,7 +188,7 @@ class GranularSamplePlayer {
     int32_t size = static_cast<int32_t>(grain_size) & ~1;
     int32_t start = buffer_head - static_cast<int32_t>(
         position * available + eaten_by_play_head);
-    grain->Start(
+    grains_.Start(
         pre_delay,
         buffer_size,
         start,
@@ -244,9 +210,7 @@ class GranularSamplePlayer {
   float grain_size_hint_;
   float grain_rate_phasor_;
   
-  Grain grains_[kMaxNumGrains];
-  int32_t available_grains_[kMaxNumGrains];
-  float envelope_buffer_[kMaxBlockSize];
+  GrainPool<capacity> grains_;
   
   DISALLOW_COPY_AND_ASSIGN(GranularSamplePlayer);
 };
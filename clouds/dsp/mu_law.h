@@ -31,6 +31,8 @@
 
 #include "stmlib/stmlib.h"
 
+#include "clouds/dsp/simd.h"
+
 namespace clouds {
 
 // inline short MuLaw2Lin(uint8_t u_val) {
@@ -78,6 +80,38 @@ inline unsigned char Lin2MuLaw(int16_t pcm_val) {
   }
 }
 
+#ifdef CLOUDS_SIMD
+
+// Same as Lin2MuLaw, for 4 samples in the 16-bit range. The segment number
+// and the 4 bits following the leading 1 are read from the exponent and
+// mantissa of the sample converted to float.
+inline LaneInt Lin2MuLawLanes(LaneInt pcm) {
+  LaneInt x = ShiftRightArithmeticLanes<2>(pcm);
+  LaneInt sign = ShiftRightArithmeticLanes<31>(x);
+  x = SubLanes(XorLanes(x, sign), sign);
+
+  LaneFloat v = AddLanes(
+      MinLanes(ConvertLanes(x), SplatLanes(8159.0f)),
+      SplatLanes(float(0x84 >> 2)));
+  LaneInt bits = BitsLanes(v);
+  LaneInt segment = SubLanes(
+      ShiftRightLanes<23>(bits),
+      SplatLanes(int32_t(127 + 5)));
+  LaneInt u = AddLanes(
+      ShiftLeftLanes<4>(segment),
+      AndLanes(ShiftRightLanes<19>(bits), SplatLanes(int32_t(0x0f))));
+  // Segment 8 (only reached by the clipped value) is encoded as 0x7f.
+  u = AddLanes(u, GreaterLanes(v, SplatLanes(8191.5f)));
+  LaneInt mask = XorLanes(
+      SplatLanes(int32_t(0xff)),
+      AndLanes(sign, SplatLanes(int32_t(0x80))));
+  u = XorLanes(u, mask);
+  // Sign-extend, so that the value survives the saturation to int8_t.
+  return ShiftRightArithmeticLanes<24>(ShiftLeftLanes<24>(u));
+}
+
+#endif  // CLOUDS_SIMD
+
 }  // namespace clouds
 
 #endif  // CLOUDS_DSP_MU_LAW_H_
@@ -36,6 +36,9 @@
 
 #include "clouds/dsp/frame.h"
 #include "clouds/dsp/parameters.h"
+#ifdef USE_SIMD_FFT
+#include "clouds/dsp/simd.h"
+#endif  // USE_SIMD_FFT
 
 namespace clouds {
 
@@ -105,6 +108,70 @@ void FrameTransformation::Process(
   ifft_in[fft_size_ >> 1] = 0.0f;
 }
 
+#ifdef USE_SIMD_FFT
+
+void FrameTransformation::RectangularToPolar(float* fft_data) {
+  float* real = &fft_data[0];
+  float* imag = &fft_data[fft_size_ >> 1];
+  float* magnitude = &fft_data[0];
+  int32_t i = 1;
+  for (; i < static_cast<int32_t>(kNumLanes); ++i) {
+    uint16_t angle = fast_atan2r(imag[i], real[i], &magnitude[i]);
+    phases_delta_[i] = angle - phases_[i];
+    phases_[i] = angle;
+  }
+  
+  const LaneFloat zero = SplatLanes(0.0f);
+  const LaneFloat pi = SplatLanes(float(M_PI));
+  const LaneFloat half_pi = SplatLanes(float(M_PI_2));
+  const LaneFloat two_pi = SplatLanes(float(2.0 * M_PI));
+  const LaneFloat scale = SplatLanes(float(65536.0 / (2.0 * M_PI)));
+  for (; i + static_cast<int32_t>(kNumLanes) <= size_; i += kNumLanes) {
+    LaneFloat x = LoadLanes(&real[i]);
+    LaneFloat y = LoadLanes(&imag[i]);
+    LaneFloat ax = AbsLanes(x);
+    LaneFloat ay = AbsLanes(y);
+
+    // atan(z) for z in [0, 1], error below 1e-5 (A&S 4.4.49).
+    LaneFloat z = DivLanes(
+        MinLanes(ax, ay),
+        MaxLanes(MaxLanes(ax, ay), SplatLanes(1e-30f)));
+    LaneFloat z2 = MulLanes(z, z);
+    LaneFloat t = SplatLanes(0.0208351f);
+    t = AddLanes(MulLanes(t, z2), SplatLanes(-0.0851330f));
+    t = AddLanes(MulLanes(t, z2), SplatLanes(0.1801410f));
+    t = AddLanes(MulLanes(t, z2), SplatLanes(-0.3302995f));
+    t = AddLanes(MulLanes(t, z2), SplatLanes(0.9998660f));
+    t = MulLanes(t, z);
+
+    // Unfold to the full circle, in [0, 2pi).
+    t = SelectLanes(GreaterLanes(ay, ax), SubLanes(half_pi, t), t);
+    t = SelectLanes(GreaterLanes(zero, x), SubLanes(pi, t), t);
+    t = SelectLanes(GreaterLanes(zero, y), SubLanes(two_pi, t), t);
+    
+    int32_t angle[kNumLanes];
+    StoreLanes(
+        angle,
+        TruncateLanes(AddLanes(MulLanes(t, scale), SplatLanes(0.5f))));
+    StoreLanes(
+        &magnitude[i],
+        SqrtLanes(AddLanes(MulLanes(x, x), MulLanes(y, y))));
+    for (size_t j = 0; j < kNumLanes; ++j) {
+      uint16_t a = static_cast<uint16_t>(angle[j]);
+      phases_delta_[i + j] = a - phases_[i + j];
+      phases_[i + j] = a;
+    }
+  }
+  
+  for (; i < size_; ++i) {
+    uint16_t angle = fast_atan2r(imag[i], real[i], &magnitude[i]);
+    phases_delta_[i] = angle - phases_[i];
+    phases_[i] = angle;
+  }
+}
+
+#else
+
 void FrameTransformation::RectangularToPolar(float* fft_data) {
   float* real = &fft_data[0];
   float* imag = &fft_data[fft_size_ >> 1];
@@ -116,6 +183,8 @@ void FrameTransformation::RectangularToPolar(float* fft_data) {
   }
 }
 
+#endif  // USE_SIMD_FFT
+
 void FrameTransformation::SetPhases(
     float* destination,
     float phase_randomization,
@@ -142,7 +211,57 @@ void FrameTransformation::PolarToRectangular(float* fft_data) {
   float* imag = &fft_data[fft_size_ >> 1];
   float* magnitude = &fft_data[0];
   uint32_t* angle = (uint32_t*) &fft_data[fft_size_ >> 1];
-  for (int32_t i = 1; i < size_; ++i) {
+  int32_t i = 1;
+#ifdef USE_SIMD_FFT
+  for (; i < static_cast<int32_t>(kNumLanes); ++i) {
+    fast_p2r(magnitude[i], angle[i], &real[i], &imag[i]);
+  }
+  
+  // Same angle resolution as fast_p2r, but the sine and cosine are computed
+  // with polynomials on [-pi/4, pi/4] instead of a table lookup.
+  const LaneInt one = SplatLanes(int32_t(1));
+  const LaneInt two = SplatLanes(int32_t(2));
+  const LaneFloat scale = SplatLanes(float(2.0 * M_PI / 65536.0));
+  for (; i + static_cast<int32_t>(kNumLanes) <= size_; i += kNumLanes) {
+    LaneInt a = AndLanes(
+        LoadLanes((const int32_t*) &angle[i]),
+        SplatLanes(int32_t(0xffc0)));
+    LaneInt quadrant = ShiftRightLanes<14>(
+        AddLanes(a, SplatLanes(int32_t(8192))));
+    LaneFloat r = MulLanes(
+        ConvertLanes(SubLanes(a, ShiftLeftLanes<14>(quadrant))),
+        scale);
+    LaneFloat r2 = MulLanes(r, r);
+    
+    LaneFloat s = SplatLanes(-1.0f / 5040.0f);
+    s = AddLanes(MulLanes(s, r2), SplatLanes(1.0f / 120.0f));
+    s = AddLanes(MulLanes(s, r2), SplatLanes(-1.0f / 6.0f));
+    s = AddLanes(MulLanes(s, r2), SplatLanes(1.0f));
+    s = MulLanes(s, r);
+    
+    LaneFloat c = SplatLanes(1.0f / 40320.0f);
+    c = AddLanes(MulLanes(c, r2), SplatLanes(-1.0f / 720.0f));
+    c = AddLanes(MulLanes(c, r2), SplatLanes(1.0f / 24.0f));
+    c = AddLanes(MulLanes(c, r2), SplatLanes(-0.5f));
+    c = AddLanes(MulLanes(c, r2), SplatLanes(1.0f));
+    
+    // Odd quadrants swap sine and cosine. The cosine is negative in
+    // quadrants 1 and 2, the sine in quadrants 2 and 3.
+    LaneInt swap = SubLanes(SplatLanes(int32_t(0)), AndLanes(quadrant, one));
+    LaneInt cos_sign = ShiftLeftLanes<30>(
+        AndLanes(AddLanes(quadrant, one), two));
+    LaneInt sin_sign = ShiftLeftLanes<30>(AndLanes(quadrant, two));
+    LaneFloat cosine = FromBitsLanes(
+        XorLanes(BitsLanes(SelectLanes(swap, s, c)), cos_sign));
+    LaneFloat sine = FromBitsLanes(
+        XorLanes(BitsLanes(SelectLanes(swap, c, s)), sin_sign));
+    
+    LaneFloat m = LoadLanes(&magnitude[i]);
+    StoreLanes(&real[i], MulLanes(m, cosine));
+    StoreLanes(&imag[i], MulLanes(m, sine));
+  }
+#endif  // USE_SIMD_FFT
+  for (; i < size_; ++i) {
     fast_p2r(magnitude[i], angle[i], &real[i], &imag[i]);
   }
   for (int32_t i = size_; i < fft_size_ >> 1; ++i) {
@@ -0,0 +1,363 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Real FFT vectorized with SSE2/NEON, for hosts.
+//
+// Same interface and data layout as ShyFFT, so that it can be used as the
+// STFT backend: the spectrum of a size n real signal is stored as n/2 real
+// parts (the Nyquist bin being stored at n/2), followed by n/2 - 1 imaginary
+// parts. Neither transform is normalized.
+//
+// The size n real FFT is computed as a size n/2 complex FFT. The complex FFT
+// is a radix-2 Stockham autosort FFT operating on separate real and imaginary
+// arrays, so that each pass vectorizes on 4 butterflies at a time without
+// any bit-reversal permutation.
+//
+// The twiddle tables are stored for each pass size, and take 6 * size
+// floats, which make this a poor fit for the module's RAM.
+
+#ifndef CLOUDS_DSP_PVOC_SIMD_FFT_H_
+#define CLOUDS_DSP_PVOC_SIMD_FFT_H_
+
+#include "stmlib/stmlib.h"
+
+#include <cmath>
+
+#include "clouds/dsp/simd.h"
+
+namespace clouds {
+
+template<size_t size>
+class SimdFFT {
+ public:
+  SimdFFT() { }
+  ~SimdFFT() { }
+
+  static const size_t max_size = size;
+
+  void Init() {
+    STATIC_ASSERT(size >= 16 && !(size & (size - 1)), size_not_power_of_2);
+    num_passes_ = 0;
+    for (size_t t = size; t > 1; t >>= 1) {
+      ++num_passes_;
+    }
+
+    // Twiddles for the butterflies of a complex FFT of size n are stored at
+    // n / 2 - 1. Twiddles for the post-processing of a real FFT of size n are
+    // stored at n / 2 - 1.
+    for (size_t n = 2; n <= size; n <<= 1) {
+      for (size_t k = 0; k < n / 2; ++k) {
+        double t = -2.0 * M_PI * double(k) / double(n);
+        if (n <= size / 2) {
+          pass_re_[n / 2 - 1 + k] = static_cast<float>(cos(t));
+          pass_im_[n / 2 - 1 + k] = static_cast<float>(sin(t));
+        }
+        split_re_[n / 2 - 1 + k] = static_cast<float>(cos(t));
+        split_im_[n / 2 - 1 + k] = static_cast<float>(sin(t));
+      }
+    }
+  }
+
+  void Direct(const float* input, float* output) {
+    Direct(input, output, num_passes_);
+  }
+
+  void Inverse(const float* input, float* output) {
+    Inverse(input, output, num_passes_);
+  }
+
+  void Direct(const float* input, float* output, size_t num_passes) {
+    const size_t n = 1 << num_passes;
+    const size_t m = n >> 1;
+
+    // Pack the even and odd samples as the real and imaginary parts of a
+    // signal of size n / 2.
+    float* re = buffer_[0];
+    float* im = buffer_[1];
+    for (size_t i = 0; i < m; i += kNumLanes) {
+      LaneFloat even, odd;
+      DeinterleaveLanes(
+          LoadLanes(&input[2 * i]),
+          LoadLanes(&input[2 * i + kNumLanes]),
+          &even,
+          &odd);
+      StoreLanes(&re[i], even);
+      StoreLanes(&im[i], odd);
+    }
+
+    size_t source = ComplexFFT(m);
+    re = buffer_[source];
+    im = buffer_[source + 1];
+
+    // Untangle the spectra of the even and odd samples.
+    // X[k] = 1/2 (A + B - i W^k (A - B)), with A = Z[k], B = Z*[m - k].
+    float* out_re = &output[0];
+    float* out_im = &output[m];
+    const float* w_re = &split_re_[m - 1];
+    const float* w_im = &split_im_[m - 1];
+
+    out_re[0] = re[0] + im[0];
+    out_im[0] = re[0] - im[0];
+
+    const LaneFloat half = SplatLanes(0.5f);
+    size_t k = 1;
+    for (; k + kNumLanes <= m; k += kNumLanes) {
+      LaneFloat a_re = LoadLanes(&re[k]);
+      LaneFloat a_im = LoadLanes(&im[k]);
+      LaneFloat b_re = ReverseLanes(LoadLanes(&re[m - k - 3]));
+      LaneFloat b_im = ReverseLanes(LoadLanes(&im[m - k - 3]));
+
+      LaneFloat s_re = AddLanes(a_re, b_re);
+      LaneFloat s_im = SubLanes(a_im, b_im);
+      LaneFloat d_re = SubLanes(a_re, b_re);
+      LaneFloat d_im = AddLanes(a_im, b_im);
+
+      LaneFloat wr = LoadLanes(&w_re[k]);
+      LaneFloat wi = LoadLanes(&w_im[k]);
+      LaneFloat t_re = SubLanes(MulLanes(wr, d_re), MulLanes(wi, d_im));
+      LaneFloat t_im = AddLanes(MulLanes(wr, d_im), MulLanes(wi, d_re));
+
+      StoreLanes(&out_re[k], MulLanes(half, AddLanes(s_re, t_im)));
+      StoreLanes(&out_im[k], MulLanes(half, SubLanes(s_im, t_re)));
+    }
+    for (; k < m; ++k) {
+      float s_re = re[k] + re[m - k];
+      float s_im = im[k] - im[m - k];
+      float d_re = re[k] - re[m - k];
+      float d_im = im[k] + im[m - k];
+      float t_re = w_re[k] * d_re - w_im[k] * d_im;
+      float t_im = w_re[k] * d_im + w_im[k] * d_re;
+      out_re[k] = 0.5f * (s_re + t_im);
+      out_im[k] = 0.5f * (s_im - t_re);
+    }
+  }
+
+  void Inverse(const float* input, float* output, size_t num_passes) {
+    const size_t n = 1 << num_passes;
+    const size_t m = n >> 1;
+
+    // Z[k] = A + B + i W^-k (A - B), with A = X[k], B = X*[m - k].
+    // The inverse transform is computed as the conjugate of the direct
+    // transform of Z*.
+    const float* in_re = &input[0];
+    const float* in_im = &input[m];
+    const float* w_re = &split_re_[m - 1];
+    const float* w_im = &split_im_[m - 1];
+    float* re = buffer_[0];
+    float* im = buffer_[1];
+
+    re[0] = in_re[0] + in_im[0];
+    im[0] = -(in_re[0] - in_im[0]);
+
+    size_t k = 1;
+    for (; k + kNumLanes <= m; k += kNumLanes) {
+      LaneFloat a_re = LoadLanes(&in_re[k]);
+      LaneFloat a_im = LoadLanes(&in_im[k]);
+      LaneFloat b_re = ReverseLanes(LoadLanes(&in_re[m - k - 3]));
+      LaneFloat b_im = ReverseLanes(LoadLanes(&in_im[m - k - 3]));
+
+      LaneFloat s_re = AddLanes(a_re, b_re);
+      LaneFloat s_im = SubLanes(a_im, b_im);
+      LaneFloat d_re = SubLanes(a_re, b_re);
+      LaneFloat d_im = AddLanes(a_im, b_im);
+
+      LaneFloat wr = LoadLanes(&w_re[k]);
+      LaneFloat wi = LoadLanes(&w_im[k]);
+      LaneFloat t_re = AddLanes(MulLanes(wr, d_re), MulLanes(wi, d_im));
+      LaneFloat t_im = SubLanes(MulLanes(wr, d_im), MulLanes(wi, d_re));
+
+      StoreLanes(&re[k], SubLanes(s_re, t_im));
+      StoreLanes(&im[k], SubLanes(SplatLanes(0.0f), AddLanes(s_im, t_re)));
+    }
+    for (; k < m; ++k) {
+      // The imaginary part of X[m - k] is stored at in_im[m - k], except
+      // for k = m which is not reached here.
+      float s_re = in_re[k] + in_re[m - k];
+      float s_im = in_im[k] - in_im[m - k];
+      float d_re = in_re[k] - in_re[m - k];
+      float d_im = in_im[k] + in_im[m - k];
+      float t_re = w_re[k] * d_re + w_im[k] * d_im;
+      float t_im = w_re[k] * d_im - w_im[k] * d_re;
+      re[k] = s_re - t_im;
+      im[k] = -(s_im + t_re);
+    }
+
+    size_t source = ComplexFFT(m);
+    re = buffer_[source];
+    im = buffer_[source + 1];
+
+    const LaneFloat zero = SplatLanes(0.0f);
+    for (size_t i = 0; i < m; i += kNumLanes) {
+      LaneFloat x_re = LoadLanes(&re[i]);
+      LaneFloat x_im = SubLanes(zero, LoadLanes(&im[i]));
+      StoreLanes(&output[2 * i], InterleaveLowLanes(x_re, x_im));
+      StoreLanes(&output[2 * i + kNumLanes], InterleaveHighLanes(x_re, x_im));
+    }
+  }
+
+ private:
+  // Complex FFT of size n of the signal in buffers 0 and 1. Returns the index
+  // of the buffer in which the result has been written (0 or 2).
+  size_t ComplexFFT(size_t n) {
+    size_t source = 0;
+    size_t stride = 1;
+    while (n > 1) {
+      Pass(
+          n,
+          stride,
+          buffer_[source], buffer_[source + 1],
+          buffer_[2 - source], buffer_[3 - source]);
+      source = 2 - source;
+      stride <<= 1;
+      n >>= 1;
+    }
+    return source;
+  }
+
+  // One radix-2 pass of a Stockham FFT, for sub-transforms of size n
+  // interleaved with a given stride.
+  //
+  // y[q + s * (2p)] = x[q + s * p] + x[q + s * (p + n / 2)]
+  // y[q + s * (2p + 1)] = (x[q + s * p] - x[q + s * (p + n / 2)]) * w^p
+  void Pass(
+      size_t n,
+      size_t s,
+      const float* x_re,
+      const float* x_im,
+      float* y_re,
+      float* y_im) {
+    const size_t half = n >> 1;
+    const float* w_re = &pass_re_[half - 1];
+    const float* w_im = &pass_im_[half - 1];
+
+    if (s >= kNumLanes) {
+      for (size_t p = 0; p < half; ++p) {
+        const LaneFloat wr = SplatLanes(w_re[p]);
+        const LaneFloat wi = SplatLanes(w_im[p]);
+        const float* a_re = &x_re[s * p];
+        const float* a_im = &x_im[s * p];
+        const float* b_re = &x_re[s * (p + half)];
+        const float* b_im = &x_im[s * (p + half)];
+        float* sum_re = &y_re[s * 2 * p];
+        float* sum_im = &y_im[s * 2 * p];
+        float* difference_re = &y_re[s * (2 * p + 1)];
+        float* difference_im = &y_im[s * (2 * p + 1)];
+        for (size_t q = 0; q < s; q += kNumLanes) {
+          LaneFloat ar = LoadLanes(&a_re[q]);
+          LaneFloat ai = LoadLanes(&a_im[q]);
+          LaneFloat br = LoadLanes(&b_re[q]);
+          LaneFloat bi = LoadLanes(&b_im[q]);
+          LaneFloat dr = SubLanes(ar, br);
+          LaneFloat di = SubLanes(ai, bi);
+          StoreLanes(&sum_re[q], AddLanes(ar, br));
+          StoreLanes(&sum_im[q], AddLanes(ai, bi));
+          StoreLanes(
+              &difference_re[q],
+              SubLanes(MulLanes(dr, wr), MulLanes(di, wi)));
+          StoreLanes(
+              &difference_im[q],
+              AddLanes(MulLanes(dr, wi), MulLanes(di, wr)));
+        }
+      }
+    } else if (s == 1 && half >= kNumLanes) {
+      // First pass: vectorize over p, interleave sums and differences.
+      for (size_t p = 0; p < half; p += kNumLanes) {
+        LaneFloat ar = LoadLanes(&x_re[p]);
+        LaneFloat ai = LoadLanes(&x_im[p]);
+        LaneFloat br = LoadLanes(&x_re[p + half]);
+        LaneFloat bi = LoadLanes(&x_im[p + half]);
+        LaneFloat wr = LoadLanes(&w_re[p]);
+        LaneFloat wi = LoadLanes(&w_im[p]);
+        LaneFloat sr = AddLanes(ar, br);
+        LaneFloat si = AddLanes(ai, bi);
+        LaneFloat dr = SubLanes(ar, br);
+        LaneFloat di = SubLanes(ai, bi);
+        LaneFloat tr = SubLanes(MulLanes(dr, wr), MulLanes(di, wi));
+        LaneFloat ti = AddLanes(MulLanes(dr, wi), MulLanes(di, wr));
+        StoreLanes(&y_re[2 * p], InterleaveLowLanes(sr, tr));
+        StoreLanes(&y_re[2 * p + kNumLanes], InterleaveHighLanes(sr, tr));
+        StoreLanes(&y_im[2 * p], InterleaveLowLanes(si, ti));
+        StoreLanes(&y_im[2 * p + kNumLanes], InterleaveHighLanes(si, ti));
+      }
+    } else if (s == 2 && half >= kNumLanes) {
+      // Second pass: each vector holds 2 values of q for 2 values of p.
+      for (size_t p = 0; p < half; p += kNumLanes) {
+        LaneFloat w_r = LoadLanes(&w_re[p]);
+        LaneFloat w_i = LoadLanes(&w_im[p]);
+        for (size_t j = 0; j < 2; ++j) {
+          const size_t i = 2 * (p + 2 * j);
+          LaneFloat wr = j ? InterleaveHighLanes(w_r, w_r) : \
+              InterleaveLowLanes(w_r, w_r);
+          LaneFloat wi = j ? InterleaveHighLanes(w_i, w_i) : \
+              InterleaveLowLanes(w_i, w_i);
+          LaneFloat ar = LoadLanes(&x_re[i]);
+          LaneFloat ai = LoadLanes(&x_im[i]);
+          LaneFloat br = LoadLanes(&x_re[i + 2 * half]);
+          LaneFloat bi = LoadLanes(&x_im[i + 2 * half]);
+          LaneFloat sr = AddLanes(ar, br);
+          LaneFloat si = AddLanes(ai, bi);
+          LaneFloat dr = SubLanes(ar, br);
+          LaneFloat di = SubLanes(ai, bi);
+          LaneFloat tr = SubLanes(MulLanes(dr, wr), MulLanes(di, wi));
+          LaneFloat ti = AddLanes(MulLanes(dr, wi), MulLanes(di, wr));
+          StoreLanes(&y_re[2 * i], LowHalvesLanes(sr, tr));
+          StoreLanes(&y_re[2 * i + kNumLanes], HighHalvesLanes(sr, tr));
+          StoreLanes(&y_im[2 * i], LowHalvesLanes(si, ti));
+          StoreLanes(&y_im[2 * i + kNumLanes], HighHalvesLanes(si, ti));
+        }
+      }
+    } else {
+      for (size_t p = 0; p < half; ++p) {
+        for (size_t q = 0; q < s; ++q) {
+          float ar = x_re[q + s * p];
+          float ai = x_im[q + s * p];
+          float br = x_re[q + s * (p + half)];
+          float bi = x_im[q + s * (p + half)];
+          float dr = ar - br;
+          float di = ai - bi;
+          y_re[q + s * 2 * p] = ar + br;
+          y_im[q + s * 2 * p] = ai + bi;
+          y_re[q + s * (2 * p + 1)] = dr * w_re[p] - di * w_im[p];
+          y_im[q + s * (2 * p + 1)] = dr * w_im[p] + di * w_re[p];
+        }
+      }
+    }
+  }
+
+  size_t num_passes_;
+
+  float pass_re_[size / 2];
+  float pass_im_[size / 2];
+  float split_re_[size];
+  float split_im_[size];
+  float buffer_[4][size / 2];
+
+  DISALLOW_COPY_AND_ASSIGN(SimdFFT);
+};
+
+}  // namespace clouds
+
+#endif  // CLOUDS_DSP_PVOC_SIMD_FFT_H_
@@ -33,8 +33,15 @@
 
 // #define USE_ARM_FFT
 
-#ifdef USE_ARM_FFT
+// Use the SSE2/NEON FFT, and vectorize the polar/rectangular conversions of
+// the frame transformation. For hosts (the twiddle tables are too large for
+// the module's RAM).
+// #define USE_SIMD_FFT
+
+#if defined(USE_ARM_FFT)
   #include <arm_math.h>
+#elif defined(USE_SIMD_FFT)
+  #include "clouds/dsp/pvoc/simd_fft.h"
 #else
   #include "stmlib/fft/shy_fft.h"
 #endif  // USE_ARM_FFT
@@ -44,8 +51,10 @@ namespace clouds {
 struct Parameters;
 
 const size_t kMaxFftSize = 4096;
-#ifdef USE_ARM_FFT
+#if defined(USE_ARM_FFT)
   typedef arm_rfft_fast_instance_f32 FFT;
+#elif defined(USE_SIMD_FFT)
+  typedef SimdFFT<kMaxFftSize> FFT;
 #else
   typedef stmlib::ShyFFT<float, kMaxFftSize, stmlib::RotationPhasor> FFT;
 #endif  // USE_ARM_FFT
@@ -0,0 +1,684 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// 4-lane float and int operations, mapped to SSE2 or NEON when available.
+// The scalar fallback produces the same results as the SSE2 version, except
+// for divisions and square roots which are refined estimates on ARMv7 NEON.
+//
+// Loads and stores do not require any alignment. 16-bit and 8-bit samples
+// are converted from/to float/int lanes as they are loaded/stored.
+//
+// CLOUDS_SIMD is defined when the lanes map to actual vector registers - and
+// code with a cheaper scalar formulation should not use the fallback.
+
+#ifndef CLOUDS_DSP_SIMD_H_
+#define CLOUDS_DSP_SIMD_H_
+
+#include "stmlib/stmlib.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CLOUDS_SIMD
+#endif
+
+namespace clouds {
+
+const size_t kNumLanes = 4;
+
+#if defined(__SSE2__)
+
+typedef __m128 LaneFloat;
+typedef __m128i LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return _mm_loadu_ps(p);
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  _mm_storeu_ps(p, x);
+}
+
+inline void StoreLanes(int32_t* p, LaneInt x) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return _mm_set1_ps(x);
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  return _mm_set1_epi32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return _mm_add_ps(a, b);
+}
+
+inline LaneInt AddLanes(LaneInt a, LaneInt b) {
+  return _mm_add_epi32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return _mm_sub_ps(a, b);
+}
+
+inline LaneInt SubLanes(LaneInt a, LaneInt b) {
+  return _mm_sub_epi32(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return _mm_mul_ps(a, b);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+  return _mm_div_ps(a, b);
+}
+
+inline LaneFloat MinLanes(LaneFloat a, LaneFloat b) {
+  return _mm_min_ps(a, b);
+}
+
+inline LaneFloat MaxLanes(LaneFloat a, LaneFloat b) {
+  return _mm_max_ps(a, b);
+}
+
+inline LaneFloat AbsLanes(LaneFloat x) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+inline LaneFloat SqrtLanes(LaneFloat x) {
+  return _mm_sqrt_ps(x);
+}
+
+inline LaneInt AndLanes(LaneInt a, LaneInt b) {
+  return _mm_and_si128(a, b);
+}
+
+inline LaneInt OrLanes(LaneInt a, LaneInt b) {
+  return _mm_or_si128(a, b);
+}
+
+inline LaneInt XorLanes(LaneInt a, LaneInt b) {
+  return _mm_xor_si128(a, b);
+}
+
+template<int shift>
+inline LaneInt ShiftLeftLanes(LaneInt x) {
+  return _mm_slli_epi32(x, shift);
+}
+
+template<int shift>
+inline LaneInt ShiftRightLanes(LaneInt x) {
+  return _mm_srli_epi32(x, shift);
+}
+
+template<int shift>
+inline LaneInt ShiftRightArithmeticLanes(LaneInt x) {
+  return _mm_srai_epi32(x, shift);
+}
+
+// Shifts by a count only known at run time. Shifting by 32 or more clears
+// the lanes.
+inline LaneInt ShiftLeftLanes(LaneInt x, int32_t shift) {
+  return _mm_sll_epi32(x, _mm_cvtsi32_si128(shift));
+}
+
+inline LaneInt ShiftRightLanes(LaneInt x, int32_t shift) {
+  return _mm_srl_epi32(x, _mm_cvtsi32_si128(shift));
+}
+
+// Conversions (truncating towards 0).
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return _mm_cvttps_epi32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return _mm_cvtepi32_ps(x);
+}
+
+// Reinterpretations.
+inline LaneInt BitsLanes(LaneFloat x) {
+  return _mm_castps_si128(x);
+}
+
+inline LaneFloat FromBitsLanes(LaneInt x) {
+  return _mm_castsi128_ps(x);
+}
+
+// Comparisons return a mask with all bits set in the lanes where the
+// condition holds.
+inline LaneInt GreaterLanes(LaneFloat a, LaneFloat b) {
+  return _mm_castps_si128(_mm_cmpgt_ps(a, b));
+}
+
+inline LaneFloat SelectLanes(LaneInt mask, LaneFloat a, LaneFloat b) {
+  __m128 m = _mm_castsi128_ps(mask);
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+// a3 a2 a1 a0
+inline LaneFloat ReverseLanes(LaneFloat a) {
+  return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+// a0 b0 a1 b1
+inline LaneFloat InterleaveLowLanes(LaneFloat a, LaneFloat b) {
+  return _mm_unpacklo_ps(a, b);
+}
+
+// a2 b2 a3 b3
+inline LaneFloat InterleaveHighLanes(LaneFloat a, LaneFloat b) {
+  return _mm_unpackhi_ps(a, b);
+}
+
+// a0 a1 b0 b1
+inline LaneFloat LowHalvesLanes(LaneFloat a, LaneFloat b) {
+  return _mm_movelh_ps(a, b);
+}
+
+// a2 a3 b2 b3
+inline LaneFloat HighHalvesLanes(LaneFloat a, LaneFloat b) {
+  return _mm_movehl_ps(b, a);
+}
+
+// a0 a2 b0 b2 / a1 a3 b1 b3
+inline void DeinterleaveLanes(
+    LaneFloat a, LaneFloat b, LaneFloat* even, LaneFloat* odd) {
+  *even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  *odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline void TransposeLanes(
+    LaneFloat* a, LaneFloat* b, LaneFloat* c, LaneFloat* d) {
+  _MM_TRANSPOSE4_PS(*a, *b, *c, *d);
+}
+
+// Loads 4 16-bit or 8-bit samples, and converts them to float.
+inline LaneFloat LoadLanes(const int16_t* p) {
+  __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+  return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+
+inline LaneFloat LoadLanes(const int8_t* p) {
+  int32_t word;
+  memcpy(&word, p, sizeof(word));
+  __m128i x = _mm_cvtsi32_si128(word);
+  x = _mm_unpacklo_epi8(x, x);
+  return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 24));
+}
+
+// Stores 4 ints as 16-bit or 8-bit samples, with saturation.
+inline void StoreLanes(int16_t* p, LaneInt x) {
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(x, x));
+}
+
+inline void StoreLanes(int8_t* p, LaneInt x) {
+  x = _mm_packs_epi32(x, x);
+  int32_t word = _mm_cvtsi128_si32(_mm_packs_epi16(x, x));
+  memcpy(p, &word, sizeof(word));
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+typedef float32x4_t LaneFloat;
+typedef int32x4_t LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return vld1q_f32(p);
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  return vld1q_s32(p);
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  vst1q_f32(p, x);
+}
+
+inline void StoreLanes(int32_t* p, LaneInt x) {
+  vst1q_s32(p, x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return vdupq_n_f32(x);
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  return vdupq_n_s32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return vaddq_f32(a, b);
+}
+
+inline LaneInt AddLanes(LaneInt a, LaneInt b) {
+  return vaddq_s32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return vsubq_f32(a, b);
+}
+
+inline LaneInt SubLanes(LaneInt a, LaneInt b) {
+  return vsubq_s32(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return vmulq_f32(a, b);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  float32x4_t r = vrecpeq_f32(b);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+#endif  // __aarch64__
+}
+
+inline LaneFloat MinLanes(LaneFloat a, LaneFloat b) {
+  return vminq_f32(a, b);
+}
+
+inline LaneFloat MaxLanes(LaneFloat a, LaneFloat b) {
+  return vmaxq_f32(a, b);
+}
+
+inline LaneFloat AbsLanes(LaneFloat x) {
+  return vabsq_f32(x);
+}
+
+inline LaneFloat SqrtLanes(LaneFloat x) {
+#if defined(__aarch64__)
+  return vsqrtq_f32(x);
+#else
+  float32x4_t r = vrsqrteq_f32(x);
+  r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x, r), r), r);
+  r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x, r), r), r);
+  // 0 * inf is a NaN, fix the square root of 0.
+  return vbslq_f32(vcgtq_f32(x, vdupq_n_f32(0.0f)), vmulq_f32(x, r), x);
+#endif  // __aarch64__
+}
+
+inline LaneInt AndLanes(LaneInt a, LaneInt b) {
+  return vandq_s32(a, b);
+}
+
+inline LaneInt OrLanes(LaneInt a, LaneInt b) {
+  return vorrq_s32(a, b);
+}
+
+inline LaneInt XorLanes(LaneInt a, LaneInt b) {
+  return veorq_s32(a, b);
+}
+
+template<int shift>
+inline LaneInt ShiftLeftLanes(LaneInt x) {
+  return vshlq_n_s32(x, shift);
+}
+
+template<int shift>
+inline LaneInt ShiftRightLanes(LaneInt x) {
+  return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(x), shift));
+}
+
+template<int shift>
+inline LaneInt ShiftRightArithmeticLanes(LaneInt x) {
+  return vshrq_n_s32(x, shift);
+}
+
+inline LaneInt ShiftLeftLanes(LaneInt x, int32_t shift) {
+  return vreinterpretq_s32_u32(
+      vshlq_u32(vreinterpretq_u32_s32(x), vdupq_n_s32(shift)));
+}
+
+inline LaneInt ShiftRightLanes(LaneInt x, int32_t shift) {
+  return vreinterpretq_s32_u32(
+      vshlq_u32(vreinterpretq_u32_s32(x), vdupq_n_s32(-shift)));
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return vcvtq_s32_f32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return vcvtq_f32_s32(x);
+}
+
+inline LaneInt BitsLanes(LaneFloat x) {
+  return vreinterpretq_s32_f32(x);
+}
+
+inline LaneFloat FromBitsLanes(LaneInt x) {
+  return vreinterpretq_f32_s32(x);
+}
+
+inline LaneInt GreaterLanes(LaneFloat a, LaneFloat b) {
+  return vreinterpretq_s32_u32(vcgtq_f32(a, b));
+}
+
+inline LaneFloat SelectLanes(LaneInt mask, LaneFloat a, LaneFloat b) {
+  return vbslq_f32(vreinterpretq_u32_s32(mask), a, b);
+}
+
+inline LaneFloat ReverseLanes(LaneFloat a) {
+  float32x4_t r = vrev64q_f32(a);
+  return vcombine_f32(vget_high_f32(r), vget_low_f32(r));
+}
+
+inline LaneFloat InterleaveLowLanes(LaneFloat a, LaneFloat b) {
+  float32x2x2_t r = vzip_f32(vget_low_f32(a), vget_low_f32(b));
+  return vcombine_f32(r.val[0], r.val[1]);
+}
+
+inline LaneFloat InterleaveHighLanes(LaneFloat a, LaneFloat b) {
+  float32x2x2_t r = vzip_f32(vget_high_f32(a), vget_high_f32(b));
+  return vcombine_f32(r.val[0], r.val[1]);
+}
+
+inline LaneFloat LowHalvesLanes(LaneFloat a, LaneFloat b) {
+  return vcombine_f32(vget_low_f32(a), vget_low_f32(b));
+}
+
+inline LaneFloat HighHalvesLanes(LaneFloat a, LaneFloat b) {
+  return vcombine_f32(vget_high_f32(a), vget_high_f32(b));
+}
+
+inline void DeinterleaveLanes(
+    LaneFloat a, LaneFloat b, LaneFloat* even, LaneFloat* odd) {
+  float32x4x2_t r = vuzpq_f32(a, b);
+  *even = r.val[0];
+  *odd = r.val[1];
+}
+
+inline void TransposeLanes(
+    LaneFloat* a, LaneFloat* b, LaneFloat* c, LaneFloat* d) {
+  float32x4x2_t ab = vtrnq_f32(*a, *b);
+  float32x4x2_t cd = vtrnq_f32(*c, *d);
+  *a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+  *b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+  *c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+  *d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+inline LaneFloat LoadLanes(const int16_t* p) {
+  return vcvtq_f32_s32(vmovl_s16(vld1_s16(p)));
+}
+
+inline LaneFloat LoadLanes(const int8_t* p) {
+  int32_t word;
+  memcpy(&word, p, sizeof(word));
+  int8x8_t x = vreinterpret_s8_s32(vdup_n_s32(word));
+  return vcvtq_f32_s32(vmovl_s16(vget_low_s16(vmovl_s8(x))));
+}
+
+inline void StoreLanes(int16_t* p, LaneInt x) {
+  vst1_s16(p, vqmovn_s32(x));
+}
+
+inline void StoreLanes(int8_t* p, LaneInt x) {
+  int16x4_t x_16 = vqmovn_s32(x);
+  int8x8_t x_8 = vqmovn_s16(vcombine_s16(x_16, x_16));
+  vst1_lane_s32(
+      reinterpret_cast<int32_t*>(static_cast<void*>(p)),
+      vreinterpret_s32_s8(x_8),
+      0);
+}
+
+#else
+
+struct LaneFloat {
+  float x[kNumLanes];
+};
+
+struct LaneInt {
+  int32_t x[kNumLanes];
+};
+
+#define CLOUDS_LANE_LOOP(type, expression) \
+  type r; \
+  for (size_t i = 0; i < kNumLanes; ++i) { \
+    r.x[i] = expression; \
+  } \
+  return r;
+
+inline LaneFloat LoadLanes(const float* p) {
+  CLOUDS_LANE_LOOP(LaneFloat, p[i])
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  CLOUDS_LANE_LOOP(LaneInt, p[i])
+}
+
+inline void StoreLanes(float* p, const LaneFloat& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    p[i] = x.x[i];
+  }
+}
+
+inline void StoreLanes(int32_t* p, const LaneInt& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    p[i] = x.x[i];
+  }
+}
+
+inline LaneFloat SplatLanes(float x) {
+  CLOUDS_LANE_LOOP(LaneFloat, x)
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  CLOUDS_LANE_LOOP(LaneInt, x)
+}
+
+inline LaneFloat AddLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, a.x[i] + b.x[i])
+}
+
+inline LaneInt AddLanes(const LaneInt& a, const LaneInt& b) {
+  CLOUDS_LANE_LOOP(LaneInt, int32_t(uint32_t(a.x[i]) + uint32_t(b.x[i])))
+}
+
+inline LaneFloat SubLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, a.x[i] - b.x[i])
+}
+
+inline LaneInt SubLanes(const LaneInt& a, const LaneInt& b) {
+  CLOUDS_LANE_LOOP(LaneInt, int32_t(uint32_t(a.x[i]) - uint32_t(b.x[i])))
+}
+
+inline LaneFloat MulLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, a.x[i] * b.x[i])
+}
+
+inline LaneFloat DivLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, a.x[i] / b.x[i])
+}
+
+inline LaneFloat MinLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, a.x[i] < b.x[i] ? a.x[i] : b.x[i])
+}
+
+inline LaneFloat MaxLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, a.x[i] > b.x[i] ? a.x[i] : b.x[i])
+}
+
+inline LaneFloat AbsLanes(const LaneFloat& x) {
+  CLOUDS_LANE_LOOP(LaneFloat, fabsf(x.x[i]))
+}
+
+inline LaneFloat SqrtLanes(const LaneFloat& x) {
+  CLOUDS_LANE_LOOP(LaneFloat, sqrtf(x.x[i]))
+}
+
+inline LaneInt AndLanes(const LaneInt& a, const LaneInt& b) {
+  CLOUDS_LANE_LOOP(LaneInt, a.x[i] & b.x[i])
+}
+
+inline LaneInt OrLanes(const LaneInt& a, const LaneInt& b) {
+  CLOUDS_LANE_LOOP(LaneInt, a.x[i] | b.x[i])
+}
+
+inline LaneInt XorLanes(const LaneInt& a, const LaneInt& b) {
+  CLOUDS_LANE_LOOP(LaneInt, a.x[i] ^ b.x[i])
+}
+
+template<int shift>
+inline LaneInt ShiftLeftLanes(const LaneInt& x) {
+  CLOUDS_LANE_LOOP(LaneInt, int32_t(uint32_t(x.x[i]) << shift))
+}
+
+template<int shift>
+inline LaneInt ShiftRightLanes(const LaneInt& x) {
+  CLOUDS_LANE_LOOP(LaneInt, int32_t(uint32_t(x.x[i]) >> shift))
+}
+
+template<int shift>
+inline LaneInt ShiftRightArithmeticLanes(const LaneInt& x) {
+  CLOUDS_LANE_LOOP(LaneInt, x.x[i] >> shift)
+}
+
+inline LaneInt ShiftLeftLanes(const LaneInt& x, int32_t shift) {
+  CLOUDS_LANE_LOOP(
+      LaneInt, shift >= 32 ? 0 : int32_t(uint32_t(x.x[i]) << shift))
+}
+
+inline LaneInt ShiftRightLanes(const LaneInt& x, int32_t shift) {
+  CLOUDS_LANE_LOOP(
+      LaneInt, shift >= 32 ? 0 : int32_t(uint32_t(x.x[i]) >> shift))
+}
+
+inline LaneInt TruncateLanes(const LaneFloat& x) {
+  CLOUDS_LANE_LOOP(LaneInt, static_cast<int32_t>(x.x[i]))
+}
+
+inline LaneFloat ConvertLanes(const LaneInt& x) {
+  CLOUDS_LANE_LOOP(LaneFloat, static_cast<float>(x.x[i]))
+}
+
+inline LaneInt BitsLanes(const LaneFloat& x) {
+  LaneInt r;
+  memcpy(&r.x[0], &x.x[0], sizeof(r.x));
+  return r;
+}
+
+inline LaneFloat FromBitsLanes(const LaneInt& x) {
+  LaneFloat r;
+  memcpy(&r.x[0], &x.x[0], sizeof(r.x));
+  return r;
+}
+
+inline LaneInt GreaterLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneInt, a.x[i] > b.x[i] ? -1 : 0)
+}
+
+inline LaneFloat SelectLanes(
+    const LaneInt& mask, const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, mask.x[i] ? a.x[i] : b.x[i])
+}
+
+inline LaneFloat ReverseLanes(const LaneFloat& a) {
+  CLOUDS_LANE_LOOP(LaneFloat, a.x[kNumLanes - 1 - i])
+}
+
+inline LaneFloat InterleaveLowLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, (i & 1) ? b.x[i >> 1] : a.x[i >> 1])
+}
+
+inline LaneFloat InterleaveHighLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, (i & 1) ? b.x[2 + (i >> 1)] : a.x[2 + (i >> 1)])
+}
+
+inline LaneFloat LowHalvesLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, i < 2 ? a.x[i] : b.x[i - 2])
+}
+
+inline LaneFloat HighHalvesLanes(const LaneFloat& a, const LaneFloat& b) {
+  CLOUDS_LANE_LOOP(LaneFloat, i < 2 ? a.x[i + 2] : b.x[i])
+}
+
+inline void DeinterleaveLanes(
+    const LaneFloat& a, const LaneFloat& b, LaneFloat* even, LaneFloat* odd) {
+  even->x[0] = a.x[0]; even->x[1] = a.x[2];
+  even->x[2] = b.x[0]; even->x[3] = b.x[2];
+  odd->x[0] = a.x[1]; odd->x[1] = a.x[3];
+  odd->x[2] = b.x[1]; odd->x[3] = b.x[3];
+}
+
+inline void TransposeLanes(
+    LaneFloat* a, LaneFloat* b, LaneFloat* c, LaneFloat* d) {
+  LaneFloat* rows[kNumLanes] = { a, b, c, d };
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    for (size_t j = i + 1; j < kNumLanes; ++j) {
+      float t = rows[i]->x[j];
+      rows[i]->x[j] = rows[j]->x[i];
+      rows[j]->x[i] = t;
+    }
+  }
+}
+
+inline LaneFloat LoadLanes(const int16_t* p) {
+  CLOUDS_LANE_LOOP(LaneFloat, static_cast<float>(p[i]))
+}
+
+inline LaneFloat LoadLanes(const int8_t* p) {
+  CLOUDS_LANE_LOOP(LaneFloat, static_cast<float>(p[i]))
+}
+
+inline void StoreLanes(int16_t* p, const LaneInt& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    int32_t s = x.x[i];
+    p[i] = s < -32768 ? -32768 : (s > 32767 ? 32767 : s);
+  }
+}
+
+inline void StoreLanes(int8_t* p, const LaneInt& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    int32_t s = x.x[i];
+    p[i] = s < -128 ? -128 : (s > 127 ? 127 : s);
+  }
+}
+
+#undef CLOUDS_LANE_LOOP
+
+#endif
+
+}  // namespace clouds
+
+#endif  // CLOUDS_DSP_SIMD_H_
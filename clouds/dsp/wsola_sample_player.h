@@ -43,6 +43,7 @@
 #include "clouds/dsp/frame.h"
 #include "clouds/dsp/window.h"
 #include "clouds/dsp/parameters.h"
+#include "clouds/dsp/simd.h"
 #include "clouds/resources.h"
 
 namespace clouds {
@@ -73,6 +74,7 @@ class WSOLASamplePlayer {
     correlator_loaded_ = true;
     search_source_ = 0;
     search_target_ = 0;
+    search_latency_ = 0;
     
     window_size_ = kMaxWSOLASize / 2;
     env_phase_ = 0.0f;
@@ -210,14 +212,24 @@ class WSOLASamplePlayer {
         num_samples,
         search_target_ - window_size_ + (window_size_ >> 1),
         increment);
+#ifdef CLOUDS_SIMD
+    // Fast enough to run the whole search as soon as the bits are loaded,
+    // rather than spreading it over the next blocks.
+    correlator_->EvaluateAllCandidates();
+#endif  // CLOUDS_SIMD
     correlator_loaded_ = true;
   }
+  
+  // Number of blocks the search for the last scheduled window has run for.
+  inline int32_t search_latency() const { return search_latency_; }
+  
  private:
   template<Resolution resolution>
   void ScheduleAlignedWindow(
       const AudioBuffer<resolution>* buffer,
       Window* window) {
     int32_t next_window_position = correlator_->best_match();
+    search_latency_ = correlator_->latency();
     correlator_loaded_ = false;
     window->Start(
         buffer->size(),
@@ -277,6 +289,7 @@ class WSOLASamplePlayer {
   bool correlator_loaded_;
   int32_t search_source_;
   int32_t search_target_;
+  int32_t search_latency_;
   
   float env_phase_;
   float env_phase_increment_;
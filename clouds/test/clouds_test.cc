@@ -29,11 +29,17 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <vector>
 #include <xmmintrin.h>
 
+#include "stmlib/fft/shy_fft.h"
+
+#include "clouds/dsp/fx/fx_engine.h"
 #include "clouds/dsp/granular_processor.h"
+#include "clouds/dsp/pvoc/simd_fft.h"
 #include "clouds/resources.h"
+#include "clouds/test/reference_granular_sample_player.h"
 
 using namespace clouds;
 using namespace std;
@@ -223,8 +229,432 @@ void TestGrainSize() {
   }
 }
 
+void TestFFT() {
+  typedef ShyFFT<float, kMaxFftSize, RotationPhasor> ReferenceFFT;
+  static ReferenceFFT reference_fft;
+  static SimdFFT<kMaxFftSize> simd_fft;
+  reference_fft.Init();
+  simd_fft.Init();
+  
+  static float input[kMaxFftSize];
+  static float spectrum[kMaxFftSize];
+  static float reference_spectrum[kMaxFftSize];
+  static float output[kMaxFftSize];
+  static float reference_output[kMaxFftSize];
+  
+  for (size_t num_passes = 6;
+       (size_t(1) << num_passes) <= kMaxFftSize;
+       ++num_passes) {
+    const size_t size = 1 << num_passes;
+    for (size_t i = 0; i < size; ++i) {
+      input[i] = Random::GetFloat() * 2.0f - 1.0f;
+    }
+
+    // Compare the direct and inverse transforms with those of ShyFFT.
+    copy(&input[0], &input[size], &output[0]);
+    reference_fft.Direct(output, reference_spectrum, num_passes);
+    copy(&input[0], &input[size], &output[0]);
+    simd_fft.Direct(output, spectrum, num_passes);
+    reference_fft.Inverse(reference_spectrum, reference_output, num_passes);
+    simd_fft.Inverse(reference_spectrum, output, num_passes);
+    
+    float spectrum_error = 0.0f;
+    float output_error = 0.0f;
+    for (size_t i = 0; i < size; ++i) {
+      spectrum_error = max(
+          spectrum_error, fabsf(spectrum[i] - reference_spectrum[i]));
+      output_error = max(
+          output_error, fabsf(output[i] - reference_output[i]));
+    }
+    spectrum_error /= float(size);
+    output_error /= float(size);
+    assert(spectrum_error < 1e-5f);
+    assert(output_error < 1e-5f);
+
+    // Frames (direct + inverse transform) per second.
+    const size_t num_frames = (1 << 22) / size;
+    clock_t start = clock();
+    for (size_t i = 0; i < num_frames; ++i) {
+      reference_fft.Direct(input, reference_spectrum, num_passes);
+      reference_fft.Inverse(reference_spectrum, reference_output, num_passes);
+    }
+    float reference_time = float(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (size_t i = 0; i < num_frames; ++i) {
+      simd_fft.Direct(input, spectrum, num_passes);
+      simd_fft.Inverse(spectrum, output, num_passes);
+    }
+    float simd_time = float(clock() - start) / CLOCKS_PER_SEC;
+    printf("FFT %4d: ShyFFT %8.0f frames/s, SimdFFT %8.0f frames/s, "
+           "error %g / %g\n",
+           int(size),
+           num_frames / reference_time,
+           num_frames / simd_time,
+           spectrum_error,
+           output_error);
+  }
+}
+
+template<Resolution resolution>
+void TestAudioBufferBlocks(const char* name) {
+  const int32_t kBufferSize = 4000 + kInterpolationTail;
+  const size_t kNumBlocks = 20000;
+  
+  static int16_t memory[2][kBufferSize];
+  static int16_t tail[2][kCrossFadeSize];
+  AudioBuffer<resolution> buffer[2];
+  buffer[0].Init(memory[0], kBufferSize, tail[0]);
+  buffer[1].Init(memory[1], kBufferSize, tail[1]);
+  
+  // Writing one channel of the interleaved input by blocks or by samples,
+  // across the wrap-around point, must fill the buffers identically. The
+  // right channel ends on the last float of the input.
+  float input[kMaxBlockSize * 2];
+  for (size_t block = 0; block < 900; ++block) {
+    for (size_t i = 0; i < kMaxBlockSize * 2; ++i) {
+      input[i] = 1.2f * (Random::GetFloat() - 0.5f) * (block & 1 ? 0.1f : 2.0f);
+    }
+    // Odd sizes to move the write head to all positions.
+    size_t size = block & 2 ? kMaxBlockSize : kMaxBlockSize - (block % 7);
+    size_t channel = (block >> 2) & 1;
+    buffer[0].WriteBlock(&input[channel], size, 2);
+    for (size_t i = 0; i < size; ++i) {
+      buffer[1].Write(input[2 * i + channel]);
+    }
+  }
+  assert(buffer[0].head() == buffer[1].head());
+  assert(!memcmp(memory[0], memory[1], sizeof(memory[0])));
+  
+  // Reading by blocks must return the same samples as reading one at a time.
+  float block_read[kMaxBlockSize];
+  size_t num_errors = 0;
+  for (size_t block = 0; block < 2000; ++block) {
+    int32_t integral = Random::GetWord() % buffer[0].size();
+    int32_t phase = Random::GetWord() & 65535;
+    int32_t increment = (Random::GetWord() % (16 << 16)) + 1;
+    buffer[0].template ReadBlock<INTERPOLATION_HERMITE>(
+        integral, phase, increment, block_read, kMaxBlockSize);
+    for (size_t i = 0; i < kMaxBlockSize; ++i) {
+      int32_t p = phase + int32_t(i) * increment;
+      float x = buffer[0].ReadHermite(integral + (p >> 16), p & 65535);
+      num_errors += x != block_read[i];
+    }
+    buffer[0].template ReadBlock<INTERPOLATION_LINEAR>(
+        integral, phase, increment, block_read, kMaxBlockSize);
+    for (size_t i = 0; i < kMaxBlockSize; ++i) {
+      int32_t p = phase + int32_t(i) * increment;
+      float x = buffer[0].ReadLinear(integral + (p >> 16), p & 65535);
+      num_errors += x != block_read[i];
+    }
+    buffer[0].template ReadBlock<INTERPOLATION_ZOH>(
+        integral, phase, increment, block_read, kMaxBlockSize);
+    for (size_t i = 0; i < kMaxBlockSize; ++i) {
+      int32_t p = phase + int32_t(i) * increment;
+      float x = buffer[0].ReadZOH(integral + (p >> 16), p & 65535);
+      num_errors += x != block_read[i];
+    }
+  }
+  assert(num_errors == 0);
+
+  // Speed of a grain-like workload: record one block, play it back once at
+  // a pitch ratio of 1.5.
+  float sink = 0.0f;
+  clock_t start = clock();
+  for (size_t block = 0; block < kNumBlocks; ++block) {
+    for (size_t i = 0; i < kMaxBlockSize; ++i) {
+      buffer[1].Write(input[2 * i]);
+    }
+    int32_t phase = 0;
+    for (size_t i = 0; i < kMaxBlockSize; ++i) {
+      sink += buffer[1].ReadHermite(
+          buffer[1].head() + (phase >> 16), phase & 65535);
+      phase += 98304;
+    }
+  }
+  float sample_time = float(clock() - start) / CLOCKS_PER_SEC;
+  start = clock();
+  for (size_t block = 0; block < kNumBlocks; ++block) {
+    buffer[0].WriteBlock(input, kMaxBlockSize, 2);
+    buffer[0].template ReadBlock<INTERPOLATION_HERMITE>(
+        buffer[0].head(), 0, 98304, block_read, kMaxBlockSize);
+    sink += block_read[0];
+  }
+  float block_time = float(clock() - start) / CLOCKS_PER_SEC;
+  printf("%s: %.2fx faster by blocks (%g)\n",
+         name, sample_time / block_time, sink > 0.0f ? 1.0f : 0.0f);
+}
+
+void TestGrainDensity() {
+  const int32_t kBufferSize = 65536;
+  const size_t kNumBlocks = 10000;
+  
+  static int16_t memory[2][kBufferSize];
+  static int16_t tail[2][kCrossFadeSize];
+  AudioBuffer<RESOLUTION_16_BIT> buffer[2];
+  float input[kBlockSize * 2];
+  for (int32_t i = 0; i < 2; ++i) {
+    buffer[i].Init(memory[i], kBufferSize, tail[i]);
+  }
+  for (int32_t block = 0; block < kBufferSize / int32_t(kBlockSize); ++block) {
+    for (size_t i = 0; i < kBlockSize * 2; ++i) {
+      input[i] = Random::GetFloat() - 0.5f;
+    }
+    buffer[0].WriteFade(&input[0], kBlockSize, 2, true);
+    buffer[1].WriteFade(&input[1], kBlockSize, 2, true);
+  }
+  
+  Parameters parameters;
+  memset(&parameters, 0, sizeof(Parameters));
+  parameters.position = 0.3f;
+  parameters.size = 0.6f;
+  parameters.pitch = 3.0f;
+  parameters.stereo_spread = 0.5f;
+  parameters.granular.overlap = 1.0f;
+  parameters.granular.window_shape = 0.8f;
+  
+  // Dense clouds, with as many grains as the player can hold.
+  static GranularSamplePlayer<256> player;
+  const int32_t num_grains[] = { 64, 256 };
+  for (size_t i = 0; i < 2; ++i) {
+    player.Init(2, num_grains[i]);
+    float out[kBlockSize * 2];
+    float sink = 0.0f;
+    clock_t start = clock();
+    for (size_t block = 0; block < kNumBlocks; ++block) {
+      player.Play(buffer, parameters, out, kBlockSize);
+      sink += out[0];
+    }
+    float elapsed = float(clock() - start) / CLOCKS_PER_SEC;
+    printf("%3d grains: %.1fx real time (%g)\n",
+           int(num_grains[i]),
+           kNumBlocks * kBlockSize / (elapsed * kSampleRate),
+           sink > 0.0f ? 1.0f : 0.0f);
+  }
+}
+
+void TestGrainReference() {
+  const int32_t kBufferSize = 65536;
+  const size_t kNumBlocks = 2000;
+  
+  static int16_t memory[2][kBufferSize];
+  static int16_t tail[2][kCrossFadeSize];
+  AudioBuffer<RESOLUTION_16_BIT> buffer[2];
+  for (int32_t i = 0; i < 2; ++i) {
+    buffer[i].Init(memory[i], kBufferSize, tail[i]);
+  }
+  
+  Parameters parameters;
+  memset(&parameters, 0, sizeof(Parameters));
+  
+  // The grains are now summed in a different order: the output of the
+  // current player must stay within 1 LSB (16-bit) of the previous one, for
+  // both envelope shapes, in mono and stereo.
+  static ReferenceGranularSamplePlayer reference;
+  static GranularSamplePlayer<kMaxNumGrains> player;
+  for (int32_t num_channels = 1; num_channels <= 2; ++num_channels) {
+    reference.Init(num_channels, kMaxNumGrains);
+    player.Init(num_channels, kMaxNumGrains);
+    float input[kBlockSize * 2];
+    float reference_out[kBlockSize * 2];
+    float out[kBlockSize * 2];
+    float max_error = 0.0f;
+    float energy = 0.0f;
+    for (size_t block = 0; block < kNumBlocks; ++block) {
+      for (size_t i = 0; i < kBlockSize * 2; ++i) {
+        input[i] = Random::GetFloat() - 0.5f;
+      }
+      buffer[0].WriteFade(&input[0], kBlockSize, 2, true);
+      buffer[1].WriteFade(&input[1], kBlockSize, 2, true);
+      
+      // Sweep the parameters slowly, and change the window shape every 250
+      // blocks.
+      float t = float(block) / float(kNumBlocks);
+      parameters.position = t;
+      parameters.size = 0.2f + 0.6f * t;
+      parameters.pitch = -12.0f + 24.0f * t;
+      parameters.stereo_spread = 0.5f;
+      parameters.granular.overlap = 0.3f + 0.7f * t;
+      parameters.granular.window_shape = (block / 250) & 1 ? 0.8f : 0.2f;
+      parameters.granular.use_deterministic_seed = (block / 500) & 1;
+      parameters.trigger = block % 100 == 0;
+      
+      // Both players draw the same random numbers.
+      uint32_t seed = Random::state();
+      reference.Play(buffer, parameters, reference_out, kBlockSize);
+      Random::Seed(seed);
+      player.Play(buffer, parameters, out, kBlockSize);
+      for (size_t i = 0; i < kBlockSize * 2; ++i) {
+        float error = fabs(out[i] - reference_out[i]);
+        max_error = max(max_error, error);
+        energy += reference_out[i] * reference_out[i];
+      }
+    }
+    printf("Grain reference (%d channel%s): max error %g LSB\n",
+           num_channels, num_channels == 1 ? "" : "s",
+           max_error * 32768.0f);
+    assert(energy > 0.0f);
+    assert(max_error * 32768.0f <= 1.0f);
+  }
+}
+
+void TestCorrelator() {
+  const size_t kNumWindows = 2000;
+  const int32_t kBlockSize = kMaxWSOLASize / 32 + 2;
+  
+  static uint32_t source[kBlockSize];
+  static uint32_t destination[kBlockSize];
+  Correlator correlator[3];
+  for (size_t i = 0; i < 3; ++i) {
+    correlator[i].Init(source, destination);
+  }
+  
+  // The full search must pick the same match as the incremental search.
+  size_t num_errors = 0;
+  size_t num_coarse_errors = 0;
+  float time[3] = { 0.0f, 0.0f, 0.0f };
+  for (size_t n = 0; n < kNumWindows; ++n) {
+    int32_t size = 32 * (1 + Random::GetWord() % 52);
+    // Sign bits of low-passed noise, and of a delayed, noisier copy.
+    fill(&source[0], &source[kBlockSize], 0);
+    fill(&destination[0], &destination[kBlockSize], 0);
+    int32_t delay = Random::GetWord() % size;
+    float lp = 0.0f;
+    for (int32_t i = 0; i < 2 * size; ++i) {
+      lp += 0.2f * (Random::GetFloat() - 0.5f - lp);
+      if (lp > 0.0f) {
+        destination[i >> 5] |= 1U << (31 - (i & 0x1f));
+      }
+      int32_t j = i - delay;
+      float noise = 0.05f * (Random::GetFloat() - 0.5f);
+      if (j >= 0 && j < size && lp + noise > 0.0f) {
+        source[j >> 5] |= 1U << (31 - (j & 0x1f));
+      }
+    }
+    
+    clock_t start = clock();
+    correlator[0].StartSearch(size, 0, 65536 << 4);
+    while (!correlator[0].done()) {
+      correlator[0].EvaluateSomeCandidates();
+    }
+    time[0] += clock() - start;
+    
+    start = clock();
+    correlator[1].StartSearch(size, 0, 65536 << 4);
+    correlator[1].EvaluateAllCandidates();
+    time[1] += clock() - start;
+    
+    start = clock();
+    correlator[2].StartSearch(size, 0, 65536 << 4);
+    correlator[2].EvaluateCoarseToFine(8);
+    time[2] += clock() - start;
+    
+    assert(correlator[1].latency() == 1);
+    num_errors += correlator[0].best_match() != correlator[1].best_match();
+    num_coarse_errors += correlator[0].best_match() != \
+        correlator[2].best_match();
+  }
+  assert(num_errors == 0);
+  printf("Correlator: %.1f us/window in %d blocks, %.1f us/window at once, "
+         "%.1f us/window coarse to fine (%d misses)\n",
+         time[0] * 1e6f / CLOCKS_PER_SEC / kNumWindows,
+         int(correlator[0].latency()),
+         time[1] * 1e6f / CLOCKS_PER_SEC / kNumWindows,
+         time[2] * 1e6f / CLOCKS_PER_SEC / kNumWindows,
+         int(num_coarse_errors));
+}
+
+void TestFxEngineBlock() {
+  typedef FxEngine<16384, FORMAT_12_BIT> E;
+  typedef E::Reserve<113,
+    E::Reserve<162,
+    E::Reserve<241,
+    E::Reserve<1653,
+    E::Reserve<2038> > > > > Memory;
+  E::DelayLine<Memory, 0> ap1;
+  E::DelayLine<Memory, 1> ap2;
+  E::DelayLine<Memory, 2> ap3;
+  E::DelayLine<Memory, 3> del1;
+  E::DelayLine<Memory, 4> del2;
+  
+  static uint16_t memory[2][16384];
+  E engine[2];
+  for (size_t i = 0; i < 2; ++i) {
+    fill(&memory[i][0], &memory[i][16384], 0);
+    engine[i].Init(memory[i]);
+    engine[i].SetLFOFrequency(LFO_1, 0.5f / 32000.0f);
+    engine[i].SetLFOFrequency(LFO_2, 0.3f / 32000.0f);
+  }
+  
+  // Running the same program one sample at a time, or operation by operation
+  // on blocks of odd sizes, must give the same output.
+  const size_t kMaxSize = 37;
+  float input[kMaxSize];
+  float block_output[kMaxSize];
+  size_t num_errors = 0;
+  for (size_t n = 0; n < 4000; ++n) {
+    size_t size = 1 + (n % kMaxSize);
+    for (size_t i = 0; i < size; ++i) {
+      input[i] = Random::GetFloat() - 0.5f;
+    }
+    
+    E::BlockContext<8> c;
+    float* in = input;
+    float* out = block_output;
+    size_t remaining = size;
+    while (remaining) {
+      const size_t block = engine[0].Start(&c, remaining);
+      c.Read(in, 0.5f);
+      c.Read(ap1 TAIL, 0.625f);
+      c.WriteAllPass(ap1, -0.625f);
+      c.Read(ap2 TAIL, 0.625f);
+      c.WriteAllPass(ap2, -0.625f);
+      c.Interpolate(del2, 1200.0f, LFO_2, 80.0f, 0.5f);
+      c.Read(ap3 TAIL, 0.625f);
+      c.WriteAllPass(ap3, -0.625f);
+      c.Write(del1, 2.0f);
+      c.Interpolate(del1, 900.0f, LFO_1, 60.0f, 0.7f);
+      c.Write(del2, 1.0f);
+      c.Write(out, 0.0f);
+      in += block;
+      out += block;
+      remaining -= block;
+    }
+    
+    for (size_t i = 0; i < size; ++i) {
+      E::Context c;
+      float output;
+      engine[1].Start(&c);
+      c.Read(input[i], 0.5f);
+      c.Read(ap1 TAIL, 0.625f);
+      c.WriteAllPass(ap1, -0.625f);
+      c.Read(ap2 TAIL, 0.625f);
+      c.WriteAllPass(ap2, -0.625f);
+      c.Interpolate(del2, 1200.0f, LFO_2, 80.0f, 0.5f);
+      c.Read(ap3 TAIL, 0.625f);
+      c.WriteAllPass(ap3, -0.625f);
+      c.Write(del1, 2.0f);
+      c.Interpolate(del1, 900.0f, LFO_1, 60.0f, 0.7f);
+      c.Write(del2, 1.0f);
+      c.Write(output, 0.0f);
+      num_errors += output != block_output[i];
+    }
+  }
+  assert(num_errors == 0);
+  assert(!memcmp(memory[0], memory[1], sizeof(memory[0])));
+  printf("FxEngine: block and sample contexts match\n");
+}
+
 int main(void) {
   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
   TestDSP();
   // TestGrainSize();
+  TestFFT();
+  TestAudioBufferBlocks<RESOLUTION_16_BIT>("16-bit");
+  TestAudioBufferBlocks<RESOLUTION_8_BIT>("8-bit");
+  TestAudioBufferBlocks<RESOLUTION_8_BIT_DITHERED>("8-bit dithered");
+  TestAudioBufferBlocks<RESOLUTION_8_BIT_MU_LAW>("8-bit mu-law");
+  TestGrainDensity();
+  TestGrainReference();
+  TestFxEngineBlock();
+  TestCorrelator();
 }
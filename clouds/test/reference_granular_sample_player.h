@@ -0,0 +1,413 @@
+// Copyright 2014 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// The granular sample player as it was before the grains were stored as a
+// structure of arrays: one Grain object per grain, rendered one after the
+// other. The test checks that the current player stays within 1 LSB of it.
+
+#ifndef CLOUDS_TEST_REFERENCE_GRANULAR_SAMPLE_PLAYER_H_
+#define CLOUDS_TEST_REFERENCE_GRANULAR_SAMPLE_PLAYER_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "stmlib/dsp/atan.h"
+#include "stmlib/dsp/units.h"
+#include "stmlib/utils/random.h"
+
+#include "clouds/dsp/audio_buffer.h"
+#include "clouds/dsp/frame.h"
+#include "clouds/dsp/granular_sample_player.h"
+#include "clouds/dsp/parameters.h"
+
+#include "clouds/resources.h"
+
+namespace clouds {
+
+using namespace stmlib;
+
+class ReferenceGrain {
+ public:
+  ReferenceGrain() { }
+  ~ReferenceGrain() { }
+
+  void Init() {
+    active_ = false;
+    envelope_phase_ = 2.0f;
+  }
+
+  void Start(
+      int32_t pre_delay,
+      int32_t buffer_size,
+      int32_t start,
+      int32_t width,
+      int32_t phase_increment,
+      float window_shape,
+      float gain_l,
+      float gain_r,
+      GrainQuality recommended_quality) {
+    pre_delay_ = pre_delay;
+    width_ = width;
+    first_sample_ = (start + buffer_size) % buffer_size;
+    phase_increment_ = phase_increment;
+    phase_ = 0;
+    envelope_phase_ = 0.0f;
+    envelope_phase_increment_ = 2.0f / static_cast<float>(width);
+    if (window_shape >= 0.5f) {
+      envelope_smoothness_ = (window_shape - 0.5f) * 2.0f;
+      envelope_slope_ = 0.0f;
+    } else {
+      envelope_smoothness_ = 0.0f;
+      envelope_slope_ = 0.5f / (window_shape + 0.01f);
+    }
+    active_ = true;
+    gain_l_ = gain_l;
+    gain_r_ = gain_r;
+    recommended_quality_ = recommended_quality;
+  }
+  
+  template<bool use_lut_for_envelope, GrainQuality quality>
+  inline void RenderEnvelope(float* destination, size_t size) {
+    const float increment = envelope_phase_increment_;
+    const float smoothness = envelope_smoothness_;
+    const float slope = envelope_slope_;
+
+    float phase = envelope_phase_;
+    while (size--) {
+      float gain = phase;
+      gain = gain >= 1.0f ? 2.0f - gain : gain;
+      if (use_lut_for_envelope) {
+        if (quality == GRAIN_QUALITY_HIGH) {
+          float window = 0.0f;
+          window = stmlib::Interpolate(lut_window, gain, 4096.0f);
+          gain += smoothness * (window - gain);
+        }
+      } else {
+        if (quality >= GRAIN_QUALITY_MEDIUM) {
+          gain *= slope;
+          if (gain >= 1.0f) gain = 1.0f;
+        }
+      }
+      phase += increment;
+      if (phase >= 2.0f) {
+        *destination = -1.0f;
+        break;
+      }
+      *destination++ = gain;
+    }
+    envelope_phase_ = phase;
+  }
+  
+  template<int32_t num_channels, GrainQuality quality, Resolution resolution>
+  inline void OverlapAdd(
+      const AudioBuffer<resolution>* buffer,
+      float* destination,
+      float* envelope,
+      size_t size) {
+    if (!active_) {
+      return;
+    }
+    // Rendering is done on 32-sample long blocks. The pre-delay allows grains
+    // to start at arbitrary samples within a block, rather than at block
+    // boundaries.
+    while (pre_delay_ && size) {
+      destination += 2;
+      --size;
+      --pre_delay_;
+    }
+    
+    // Pre-render the envelope in one pass.
+    if (envelope_smoothness_ == 0.0f) {
+      RenderEnvelope<false, quality>(envelope, size);
+    } else {
+      RenderEnvelope<true, quality>(envelope, size);
+    }
+    
+    // Read the samples of the grain until the end of its envelope.
+    size_t n = 0;
+    while (n < size && envelope[n] != -1.0f) {
+      ++n;
+    }
+    if (n < size) {
+      active_ = false;
+    }
+
+    float samples[2][kMaxBlockSize];
+    for (int32_t i = 0; i < num_channels; ++i) {
+      buffer[i].template ReadBlock<InterpolationMethod(quality)>(
+          first_sample_, phase_, phase_increment_, samples[i], n);
+    }
+    phase_ += static_cast<int32_t>(n) * phase_increment_;
+
+    const float gain_l = gain_l_;
+    const float gain_r = gain_r_;
+    for (size_t i = 0; i < n; ++i) {
+      float gain = envelope[i];
+      float l = samples[0][i] * gain;
+      if (num_channels == 1) {
+        *destination++ += l * gain_l;
+        *destination++ += l * gain_r;
+      } else if (num_channels == 2) {
+        float r = samples[1][i] * gain;
+        *destination++ += l * gain_l + r * (1.0f - gain_r);
+        *destination++ += r * gain_r + l * (1.0f - gain_l);
+      }
+    }
+  }
+  
+  inline bool active() { return active_; }
+  
+  inline GrainQuality recommended_quality() const {
+    return recommended_quality_;
+  }
+
+ private:
+  int32_t first_sample_;
+  int32_t width_;
+  int32_t phase_;
+  int32_t phase_increment_;
+  int32_t pre_delay_;
+
+  float envelope_smoothness_;
+  float envelope_slope_;
+  float envelope_phase_;
+  float envelope_phase_increment_;
+
+  float gain_l_;
+  float gain_r_;
+
+  bool active_;
+  
+  GrainQuality recommended_quality_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReferenceGrain);
+};
+
+class ReferenceGranularSamplePlayer {
+ public:
+  ReferenceGranularSamplePlayer() { }
+  ~ReferenceGranularSamplePlayer() { }
+  
+  void Init(int32_t num_channels, int32_t max_num_grains) {
+    max_num_grains_ = max_num_grains;
+    num_midfi_grains_ = 3 * max_num_grains / 4;
+    gain_normalization_ = 1.0f;
+    for (int32_t i = 0; i < kMaxNumGrains; ++i) {
+      grains_[i].Init();
+    }
+    num_grains_ = 0.0f;
+    num_channels_ = num_channels;
+    grain_size_hint_ = 1024.0f;
+  }
+  
+  template<Resolution resolution>
+  void Play(
+      const AudioBuffer<resolution>* buffer,
+      const Parameters& parameters,
+      float* out, size_t size) {
+    float overlap = parameters.granular.overlap;
+    overlap = overlap * overlap * overlap;
+    float target_num_grains = max_num_grains_ * overlap;
+    float p = target_num_grains / static_cast<float>(grain_size_hint_);
+    float space_between_grains = grain_size_hint_ / target_num_grains;
+    if (parameters.granular.use_deterministic_seed) {
+      p = -1.0f;
+    } else {
+      grain_rate_phasor_ = -1000.0f;
+    }
+    
+    // Build a list of available grains.
+    int32_t num_available_grains = FillAvailableGrainsList();
+    
+    // Try to schedule new grains.
+    bool seed_trigger = parameters.trigger;
+    for (size_t t = 0; t < size; ++t) {
+      grain_rate_phasor_ += 1.0f;
+      bool seed_probabilistic = Random::GetFloat() < p
+          && target_num_grains > num_grains_;
+      bool seed_deterministic = grain_rate_phasor_ >= space_between_grains;
+      bool seed = seed_probabilistic || seed_deterministic || seed_trigger;
+      if (num_available_grains && seed) {
+        --num_available_grains;
+        int32_t index = available_grains_[num_available_grains];
+        GrainQuality quality;
+        if (num_available_grains < num_midfi_grains_) {
+          quality = GRAIN_QUALITY_MEDIUM;
+        } else {
+          quality = GRAIN_QUALITY_HIGH;
+        }
+        
+        ReferenceGrain* g = &grains_[index];
+        ScheduleGrain(
+            g,
+            parameters,
+            t,
+            buffer->size(),
+            buffer->head() - size + t,
+            quality);
+        grain_rate_phasor_ = 0.0f;
+        seed_trigger = false;
+      }
+    }
+    
+    // Overlap grains.
+    std::fill(&out[0], &out[size * 2], 0.0f);
+    float* e = envelope_buffer_;
+    for (int32_t i = 0; i < max_num_grains_; ++i) {
+      ReferenceGrain* g = &grains_[i];
+      if (g->recommended_quality() == GRAIN_QUALITY_HIGH) {
+        if (num_channels_ == 1) {
+          g->OverlapAdd<1, GRAIN_QUALITY_HIGH>(buffer, out, e, size);
+        } else {
+          g->OverlapAdd<2, GRAIN_QUALITY_HIGH>(buffer, out, e, size);
+        }
+      } else if (g->recommended_quality() == GRAIN_QUALITY_MEDIUM) {
+        if (num_channels_ == 1) {
+          g->OverlapAdd<1, GRAIN_QUALITY_MEDIUM>(buffer, out, e, size);
+        } else {
+          g->OverlapAdd<2, GRAIN_QUALITY_MEDIUM>(buffer, out, e, size);
+        }
+      } else {
+        if (num_channels_ == 1) {
+          g->OverlapAdd<1, GRAIN_QUALITY_LOW>(buffer, out, e, size);
+        } else {
+          g->OverlapAdd<2, GRAIN_QUALITY_LOW>(buffer, out, e, size);
+        }
+      }
+    }
+    
+    // Compute normalization factor.
+    int32_t active_grains = max_num_grains_ - num_available_grains;
+    SLOPE(num_grains_, static_cast<float>(active_grains), 0.9f, 0.2f);
+
+    float gain_normalization = num_grains_ > 2.0f
+        ? fast_rsqrt_carmack(num_grains_ - 1.0f)
+        : 1.0f;  
+    float window_gain = 1.0f + 2.0f * parameters.granular.window_shape;
+    CONSTRAIN(window_gain, 1.0f, 2.0f);
+    gain_normalization *= Crossfade(
+        1.0f, window_gain, parameters.granular.overlap);
+
+    // Apply gain normalization.
+    for (size_t t = 0; t < size; ++t) {
+      ONE_POLE(gain_normalization_, gain_normalization, 0.01f)
+      *out++ *= gain_normalization_;
+      *out++ *= gain_normalization_;
+    }
+  }
+  
+ private:
+  int32_t FillAvailableGrainsList() {
+    int32_t num_available_grains = 0;
+    for (int32_t i = 0; i < max_num_grains_; ++i) {
+      if (!grains_[i].active()) {
+        available_grains_[num_available_grains] = i;
+        ++num_available_grains;
+      }
+    }
+    return num_available_grains;
+  }
+  
+  void ScheduleGrain(
+      ReferenceGrain* grain,
+      const Parameters& parameters,
+      int32_t pre_delay,
+      int32_t buffer_size,
+      int32_t buffer_head,
+      GrainQuality quality) {
+    float position = parameters.position;
+    float pitch = parameters.pitch;
+    float window_shape = parameters.granular.window_shape;
+    float grain_size = Interpolate(lut_grain_size, parameters.size, 256.0f);
+    float pitch_ratio = SemitonesToRatio(pitch);
+    float inv_pitch_ratio = SemitonesToRatio(-pitch);
+    float pan = 0.5f + parameters.stereo_spread * (Random::GetFloat() - 0.5f);
+    float gain_l, gain_r;
+    if (num_channels_ == 1) {
+      gain_l = Interpolate(lut_sin, pan, 256.0f);
+      gain_r = Interpolate(lut_sin + 256, pan, 256.0f);
+    } else {
+      if (pan < 0.5f) {
+        gain_l = 1.0f;
+        gain_r = 2.0f * pan;
+      } else {
+        gain_r = 1.0f;
+        gain_l = 2.0f * (1.0f - pan);
+      }
+    }
+    
+    if (pitch_ratio > 1.0f) {
+      // The grain's play-head moves faster than the buffer record-head.
+      // we must make sure that the grain will not consume too much data.
+      // In some situations, it might be necessary to reduce the size of the
+      // grain.
+      grain_size = std::min(grain_size, buffer_size * 0.25f * inv_pitch_ratio);
+    }
+
+    float eaten_by_play_head = grain_size * pitch_ratio;
+    float eaten_by_recording_head = grain_size;
+
+    float available = 0.0;
+    available += static_cast<float>(buffer_size);
+    available -= eaten_by_play_head;
+    available -= eaten_by_recording_head;
+
+    int32_t size = static_cast<int32_t>(grain_size) & ~1;
+    int32_t start = buffer_head - static_cast<int32_t>(
+        position * available + eaten_by_play_head);
+    grain->Start(
+        pre_delay,
+        buffer_size,
+        start,
+        size,
+        static_cast<uint32_t>(pitch_ratio * 65536.0f),
+        window_shape,
+        gain_l,
+        gain_r,
+        quality);
+    ONE_POLE(grain_size_hint_, grain_size, 0.1f);
+  }
+  
+  int32_t max_num_grains_;
+  int32_t num_midfi_grains_;
+  int32_t num_channels_;
+
+  float num_grains_;
+  float gain_normalization_;
+  float grain_size_hint_;
+  float grain_rate_phasor_;
+  
+  ReferenceGrain grains_[kMaxNumGrains];
+  int32_t available_grains_[kMaxNumGrains];
+  float envelope_buffer_[kMaxBlockSize];
+  
+  DISALLOW_COPY_AND_ASSIGN(ReferenceGranularSamplePlayer);
+};
+
+}  // namespace clouds
+
+#endif  // CLOUDS_TEST_REFERENCE_GRANULAR_SAMPLE_PLAYER_H_
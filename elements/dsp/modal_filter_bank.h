@@ -0,0 +1,206 @@
+// Copyright 2014 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Bank of band-pass SVFs used for modal synthesis. The coefficients and states
+// of all modes are stored side by side (structure of arrays), so that groups
+// of 4 modes can be processed by a single SSE2 or NEON instruction.
+//
+// Without vector registers (the STM32F4), the modes are processed one by one,
+// as with the original array of stmlib::Svf. The lane-ordered scalar version
+// mimics the vector code bit for bit - as long as the compiler is not allowed
+// to fuse multiplications and additions - and is used by the tests.
+
+#ifndef ELEMENTS_DSP_MODAL_FILTER_BANK_H_
+#define ELEMENTS_DSP_MODAL_FILTER_BANK_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "stmlib/dsp/filter.h"
+
+#include "elements/dsp/simd.h"
+
+namespace elements {
+
+const size_t kModalFilterBankLanes = 4;
+
+template<size_t max_modes>
+class ModalFilterBank {
+ public:
+  ModalFilterBank() { }
+  ~ModalFilterBank() { }
+
+  void Init() {
+    STATIC_ASSERT(max_modes % kModalFilterBankLanes == 0, lanes_multiple);
+    for (size_t i = 0; i < max_modes; ++i) {
+      set_f_q<stmlib::FREQUENCY_DIRTY>(i, 0.01f, 100.0f);
+    }
+    Reset();
+  }
+
+  void Reset() {
+    std::fill(&state_1_[0], &state_1_[max_modes], 0.0f);
+    std::fill(&state_2_[0], &state_2_[max_modes], 0.0f);
+  }
+
+  // Same coefficients as stmlib::Svf::set_f_q.
+  template<stmlib::FrequencyApproximation approximation>
+  inline void set_f_q(size_t i, float f, float resonance) {
+    float g = stmlib::OnePole::tan<approximation>(f);
+    float r = 1.0f / resonance;
+    set_g_r_h(i, g, r, 1.0f / (1.0f + r * g + g * g));
+  }
+
+  inline void set_g_r_h(size_t i, float g, float r, float h) {
+    g_[i] = g;
+    r_[i] = r;
+    h_[i] = h;
+  }
+
+  inline float g(size_t i) const { return g_[i]; }
+  inline float r(size_t i) const { return r_[i]; }
+  inline float h(size_t i) const { return h_[i]; }
+
+  // Number of modes actually processed by the vector code when num_modes are
+  // requested. The gains of the extra modes must be set to 0.
+  static inline size_t padded_size(size_t num_modes) {
+    return (num_modes + kModalFilterBankLanes - 1) & \
+        ~(kModalFilterBankLanes - 1);
+  }
+
+  // Processes one sample through the bank, and computes two mixes of all the
+  // band-pass outputs, weighted by gain_a and gain_b.
+  inline void ProcessDual(
+      float in,
+      const float* gain_a,
+      const float* gain_b,
+      size_t num_modes,
+      float* out_a,
+      float* out_b) {
+#ifdef ELEMENTS_SIMD
+    ProcessDualLanes(in, gain_a, gain_b, num_modes, out_a, out_b);
+#else
+    float a = 0.0f;
+    float b = 0.0f;
+    for (size_t i = 0; i < num_modes; ++i) {
+      float s = Tick(i, in);
+      a += s * gain_a[i];
+      b += s * gain_b[i];
+    }
+    *out_a = a;
+    *out_b = b;
+#endif  // ELEMENTS_SIMD
+  }
+
+  // Same accumulation order as the vector code.
+  inline void ProcessDualScalar(
+      float in,
+      const float* gain_a,
+      const float* gain_b,
+      size_t num_modes,
+      float* out_a,
+      float* out_b) {
+    float acc_a[kModalFilterBankLanes];
+    float acc_b[kModalFilterBankLanes];
+    std::fill(&acc_a[0], &acc_a[kModalFilterBankLanes], 0.0f);
+    std::fill(&acc_b[0], &acc_b[kModalFilterBankLanes], 0.0f);
+    num_modes = padded_size(num_modes);
+    for (size_t i = 0; i < num_modes; i += kModalFilterBankLanes) {
+      for (size_t j = 0; j < kModalFilterBankLanes; ++j) {
+        float s = Tick(i + j, in);
+        acc_a[j] += gain_a[i + j] * s;
+        acc_b[j] += gain_b[i + j] * s;
+      }
+    }
+    *out_a = (acc_a[0] + acc_a[2]) + (acc_a[1] + acc_a[3]);
+    *out_b = (acc_b[0] + acc_b[2]) + (acc_b[1] + acc_b[3]);
+  }
+
+ private:
+  // Same arithmetic, in the same order, as stmlib::Svf::Process.
+  inline float Tick(size_t i, float in) {
+    float hp, bp, lp;
+    hp = (in - r_[i] * state_1_[i] - g_[i] * state_1_[i] - state_2_[i]) * h_[i];
+    bp = g_[i] * hp + state_1_[i];
+    state_1_[i] = g_[i] * hp + bp;
+    lp = g_[i] * bp + state_2_[i];
+    state_2_[i] = g_[i] * bp + lp;
+    return bp;
+  }
+
+#ifdef ELEMENTS_SIMD
+  inline LaneFloat Tick(size_t i, LaneFloat in) {
+    LaneFloat g = LoadLanes(&g_[i]);
+    LaneFloat s1 = LoadLanes(&state_1_[i]);
+    LaneFloat s2 = LoadLanes(&state_2_[i]);
+    LaneFloat hp = SubLanes(in, MulLanes(LoadLanes(&r_[i]), s1));
+    hp = SubLanes(hp, MulLanes(g, s1));
+    hp = MulLanes(SubLanes(hp, s2), LoadLanes(&h_[i]));
+    LaneFloat bp = AddLanes(MulLanes(g, hp), s1);
+    StoreLanes(&state_1_[i], AddLanes(MulLanes(g, hp), bp));
+    LaneFloat lp = AddLanes(MulLanes(g, bp), s2);
+    StoreLanes(&state_2_[i], AddLanes(MulLanes(g, bp), lp));
+    return bp;
+  }
+
+  inline void ProcessDualLanes(
+      float in,
+      const float* gain_a,
+      const float* gain_b,
+      size_t num_modes,
+      float* out_a,
+      float* out_b) {
+    LaneFloat x = SplatLanes(in);
+    LaneFloat acc_a = SplatLanes(0.0f);
+    LaneFloat acc_b = SplatLanes(0.0f);
+    num_modes = padded_size(num_modes);
+    for (size_t i = 0; i < num_modes; i += kModalFilterBankLanes) {
+      LaneFloat s = Tick(i, x);
+      acc_a = AddLanes(acc_a, MulLanes(LoadLanes(&gain_a[i]), s));
+      acc_b = AddLanes(acc_b, MulLanes(LoadLanes(&gain_b[i]), s));
+    }
+    float a[kModalFilterBankLanes];
+    float b[kModalFilterBankLanes];
+    StoreLanes(a, acc_a);
+    StoreLanes(b, acc_b);
+    *out_a = (a[0] + a[2]) + (a[1] + a[3]);
+    *out_b = (b[0] + b[2]) + (b[1] + b[3]);
+  }
+#endif  // ELEMENTS_SIMD
+
+  float g_[max_modes];
+  float r_[max_modes];
+  float h_[max_modes];
+  float state_1_[max_modes];
+  float state_2_[max_modes];
+
+  DISALLOW_COPY_AND_ASSIGN(ModalFilterBank);
+};
+
+}  // namespace elements
+
+#endif  // ELEMENTS_DSP_MODAL_FILTER_BANK_H_
@@ -28,6 +28,8 @@
 
 #include "elements/dsp/resonator.h"
 
+#include <cmath>
+
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/cosine_oscillator.h"
 
@@ -41,10 +43,16 @@ namespace elements {
 using namespace std;
 using namespace stmlib;
 
+// Changes of the geometry, brightness and damping parameters below this
+// threshold do not trigger a recomputation of the filter coefficients.
+const float kParameterTolerance = 1.0f / 4096.0f;
+
+// Relative frequency change below which the coefficients are kept - about
+// 0.17 cents.
+const float kFrequencyTolerance = 1.0e-4f;
+
 void Resonator::Init() {
-  for (size_t i = 0; i < kMaxModes; ++i) {
-    f_[i].Init();
-  }
+  f_.Init();
 
   for (size_t i = 0; i < kMaxBowedModes; ++i) {
     f_bow_[i].Init();
@@ -60,12 +68,21 @@ void Resonator::Init() {
   set_resolution(kMaxModes);
   
   bow_signal_ = 0.0f;
+  
+  // Forces a full computation of the coefficients on the first block.
+  cached_frequency_ = 0.0f;
+  cached_resolution_ = 0;
+  num_modes_ = 0;
+  num_pending_updates_ = 0;
+  
+  num_cache_lookups_ = 0;
+  num_cache_hits_ = 0;
+  num_partial_ratio_updates_ = 0;
 }
 
-size_t Resonator::ComputeFilters() {
-  ++clock_divider_;
+void Resonator::ComputePartialRatios() {
   float stiffness = Interpolate(lut_stiffness, geometry_, 256.0f);
-  float harmonic = frequency_;
+  float harmonic = 1.0f;
   float stretch_factor = 1.0f; 
   float q = 500.0f * Interpolate(
       lut_4_decades,
@@ -80,43 +97,78 @@ size_t Resonator::ComputeFilters() {
   float brightness = brightness_ * (1.0f - 0.2f * brightness_attenuation);
   float q_loss = brightness * (2.0f - brightness) * 0.85f + 0.15f;
   float q_loss_damping_rate = geometry_ * (2.0f - geometry_) * 0.1f;
-  size_t num_modes = 0;
+  for (size_t i = 0; i < min(kMaxModes, resolution_); ++i) {
+    partial_ratio_[i] = harmonic * stretch_factor;
+    partial_q_[i] = q;
+    stretch_factor += stiffness;
+    if (stiffness < 0.0f) {
+      // Make sure that the partials do not fold back into negative frequencies.
+      stiffness *= 0.93f;
+    } else {
+      // This helps adding a few extra partials in the highest frequencies.
+      stiffness *= 0.98f;
+    }
+    // This prevents the highest partials from decaying too fast.
+    q_loss += q_loss_damping_rate * (1.0f - q_loss);
+    harmonic += 1.0f;
+    q *= q_loss;
+  }
+  
+  cached_geometry_ = geometry_;
+  cached_brightness_ = brightness_;
+  cached_damping_ = damping_;
+  cached_resolution_ = resolution_;
+}
+
+size_t Resonator::ComputeFilters() {
+  ++clock_divider_;
+  ++num_cache_lookups_;
+  bool timbre_changed = resolution_ != cached_resolution_ ||
+      fabsf(geometry_ - cached_geometry_) > kParameterTolerance ||
+      fabsf(brightness_ - cached_brightness_) > kParameterTolerance ||
+      fabsf(damping_ - cached_damping_) > kParameterTolerance;
+  bool frequency_changed = fabsf(frequency_ - cached_frequency_) >
+      cached_frequency_ * kFrequencyTolerance;
+  
+  if (timbre_changed) {
+    ++num_partial_ratio_updates_;
+    ComputePartialRatios();
+    num_pending_updates_ = 2;
+  } else if (frequency_changed) {
+    num_pending_updates_ = 2;
+  } else if (!num_pending_updates_) {
+    ++num_cache_hits_;
+    return num_modes_;
+  }
+  --num_pending_updates_;
+  cached_frequency_ = frequency_;
+  
+  num_modes_ = 0;
   for (size_t i = 0; i < min(kMaxModes, resolution_); ++i) {
     // Update the first 24 modes every time (2kHz). The higher modes are
     // refreshed as a slowest rate.
     bool update = i <= 24 || ((i & 1) == (clock_divider_ & 1));
-    float partial_frequency = harmonic * stretch_factor;
+    float partial_frequency = frequency_ * partial_ratio_[i];
     if (partial_frequency >= 0.49f) {
       partial_frequency = 0.49f;
     } else {
-      num_modes = i + 1;
+      num_modes_ = i + 1;
     }
     if (update) {
-      f_[i].set_f_q<FREQUENCY_FAST>(
+      f_.set_f_q<FREQUENCY_FAST>(
+          i,
           partial_frequency,
-          1.0f + partial_frequency * q);
+          1.0f + partial_frequency * partial_q_[i]);
       if (i < kMaxBowedModes) {
         size_t period = 1.0f / partial_frequency;
         while (period >= kMaxDelayLineSize) period >>= 1;
         d_bow_[i].set_delay(period);
-        f_bow_[i].set_g_q(f_[i].g(), 1.0f + partial_frequency * 1500.0f);
+        f_bow_[i].set_g_q(f_.g(i), 1.0f + partial_frequency * 1500.0f);
       }
     }
-    stretch_factor += stiffness;
-    if (stiffness < 0.0f) {
-      // Make sure that the partials do not fold back into negative frequencies.
-      stiffness *= 0.93f;
-    } else {
-      // This helps adding a few extra partials in the highest frequencies.
-      stiffness *= 0.98f;
-    }
-    // This prevents the highest partials from decaying too fast.
-    q_loss += q_loss_damping_rate * (1.0f - q_loss);
-    harmonic += frequency_;
-    q *= q_loss;
   }
   
-  return num_modes;
+  return num_modes_;
 }
 
 void Resonator::Process(
@@ -130,6 +182,13 @@ void Resonator::Process(
   // Linearly interpolate position. This parameter is extremely sensitive to
   // zipper noise.
   float position_increment = (position_ - previous_position_) / size;
+  
+  // On SIMD builds, the bank processes modes in groups of
+  // kModalFilterBankLanes: the gains of the padding modes stay at 0.
+  float center_gain[kMaxModes];
+  float side_gain[kMaxModes];
+  fill(&center_gain[0], &center_gain[kMaxModes], 0.0f);
+  fill(&side_gain[0], &side_gain[kMaxModes], 0.0f);
   while (size--) {
     float s;
 
@@ -148,8 +207,8 @@ void Resonator::Process(
   
     // Render normal modes.
     float input = *in++ * 0.125f;
-    float sum_center = 0.0f;
-    float sum_side = 0.0f;
+    float sum_center;
+    float sum_side;
 
     // Note: For a steady sound, the correct way of simulating the effect of
     // a pickup is to use a comb filter. But it sounds very flange-y when
@@ -163,10 +222,16 @@ void Resonator::Process(
     amplitudes.Start();
     aux_amplitudes.Start();
     for (size_t i = 0; i < num_modes; i++) {
-      s = f_[i].Process<FILTER_MODE_BAND_PASS>(input);
-      sum_center += s * amplitudes.Next();
-      sum_side += s * aux_amplitudes.Next();
+      center_gain[i] = amplitudes.Next();
+      side_gain[i] = aux_amplitudes.Next();
     }
+    f_.ProcessDual(
+        input,
+        center_gain,
+        side_gain,
+        num_modes,
+        &sum_center,
+        &sum_side);
     *sides++ = sum_side - sum_center;
     
     // Render bowed modes.
@@ -35,6 +35,7 @@
 #include <algorithm>
 
 #include "elements/dsp/dsp.h"
+#include "elements/dsp/modal_filter_bank.h"
 #include "stmlib/dsp/filter.h"
 #include "stmlib/dsp/delay_line.h"
 
@@ -102,8 +103,16 @@ class Resonator {
     return x * bow;
   }
   
+  // Statistics of the filter coefficients cache.
+  inline uint32_t num_cache_lookups() const { return num_cache_lookups_; }
+  inline uint32_t num_cache_hits() const { return num_cache_hits_; }
+  inline uint32_t num_partial_ratio_updates() const {
+    return num_partial_ratio_updates_;
+  }
+  
  private:
   size_t ComputeFilters();
+  void ComputePartialRatios();
   
   float frequency_;
   float geometry_;
@@ -120,7 +129,29 @@ class Resonator {
   
   size_t resolution_;
   
-  stmlib::Svf f_[kMaxModes];
+  // Values of the parameters for which the coefficients of f_ have been
+  // computed.
+  float cached_frequency_;
+  float cached_geometry_;
+  float cached_brightness_;
+  float cached_damping_;
+  size_t cached_resolution_;
+  size_t num_modes_;
+  
+  // The higher modes are refreshed every other block, so it takes two calls
+  // to ComputeFilters before all coefficients are up to date.
+  int32_t num_pending_updates_;
+  
+  // Frequency ratio and Q factor of each partial. They do not depend on the
+  // frequency, so a change of pitch only requires a rescaling.
+  float partial_ratio_[kMaxModes];
+  float partial_q_[kMaxModes];
+  
+  uint32_t num_cache_lookups_;
+  uint32_t num_cache_hits_;
+  uint32_t num_partial_ratio_updates_;
+  
+  ModalFilterBank<kMaxModes> f_;
   stmlib::Svf f_bow_[kMaxBowedModes];
   stmlib::DelayLine<float, kMaxDelayLineSize> d_bow_[kMaxBowedModes];
   
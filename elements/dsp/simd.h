@@ -0,0 +1,153 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// 4-lane float operations, mapped to SSE2 or NEON. They are used by the
+// block version of the FxEngine context and by the modal filter bank.
+//
+// ELEMENTS_SIMD is defined when vector registers are available. Otherwise (the
+// Cortex-M4 on the module), this file is empty and the scalar code is used.
+
+#ifndef ELEMENTS_DSP_SIMD_H_
+#define ELEMENTS_DSP_SIMD_H_
+
+#include "stmlib/stmlib.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ELEMENTS_SIMD
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ELEMENTS_SIMD
+#endif
+
+#ifdef ELEMENTS_SIMD
+
+namespace elements {
+
+const size_t kNumLanes = 4;
+
+#if defined(__SSE2__)
+
+typedef __m128 LaneFloat;
+typedef __m128i LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return _mm_loadu_ps(p);
+}
+
+// Loads 4 16-bit samples, and converts them to float.
+inline LaneFloat LoadLanes(const int16_t* p) {
+  __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+  return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  _mm_storeu_ps(p, x);
+}
+
+// Stores 4 ints as 16-bit samples, with saturation.
+inline void StoreLanes(int16_t* p, LaneInt x) {
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(x, x));
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return _mm_set1_ps(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return _mm_add_ps(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return _mm_sub_ps(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return _mm_mul_ps(a, b);
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return _mm_cvttps_epi32(x);
+}
+
+// a3 a2 a1 a0
+inline LaneFloat ReverseLanes(LaneFloat a) {
+  return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+#else
+
+typedef float32x4_t LaneFloat;
+typedef int32x4_t LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return vld1q_f32(p);
+}
+
+inline LaneFloat LoadLanes(const int16_t* p) {
+  return vcvtq_f32_s32(vmovl_s16(vld1_s16(p)));
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  vst1q_f32(p, x);
+}
+
+inline void StoreLanes(int16_t* p, LaneInt x) {
+  vst1_s16(p, vqmovn_s32(x));
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return vdupq_n_f32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return vaddq_f32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return vsubq_f32(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return vmulq_f32(a, b);
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return vcvtq_s32_f32(x);
+}
+
+inline LaneFloat ReverseLanes(LaneFloat a) {
+  float32x4_t r = vrev64q_f32(a);
+  return vcombine_f32(vget_high_f32(r), vget_low_f32(r));
+}
+
+#endif
+
+}  // namespace elements
+
+#endif  // ELEMENTS_SIMD
+
+#endif  // ELEMENTS_DSP_SIMD_H_
@@ -20,9 +20,11 @@
 #include <xmmintrin.h>
 
 #include "elements/dsp/exciter.h"
+#include "elements/dsp/modal_filter_bank.h"
 #include "elements/dsp/part.h"
 #include "elements/dsp/resonator.h"
 #include "elements/dsp/voice.h"
+#include "stmlib/utils/random.h"
 
 using namespace elements;
 using namespace stmlib;
@@ -463,6 +465,38 @@ void TestEasterEgg() {
   fclose(fp);
 }
 
+void TestModalFilterBank() {
+  ModalFilterBank<kMaxModes> vectorized;
+  ModalFilterBank<kMaxModes> scalar;
+  vectorized.Init();
+  scalar.Init();
+  
+  float gain_a[kMaxModes];
+  float gain_b[kMaxModes];
+  for (size_t i = 0; i < kMaxModes; ++i) {
+    float f = 0.45f * Random::GetFloat();
+    float q = 1.0f + 500.0f * Random::GetFloat();
+    vectorized.set_f_q<FREQUENCY_FAST>(i, f, q);
+    scalar.set_f_q<FREQUENCY_FAST>(i, f, q);
+    gain_a[i] = Random::GetFloat();
+    gain_b[i] = Random::GetFloat();
+  }
+  
+  size_t mismatches = 0;
+  for (size_t i = 0; i < ::kSampleRate; ++i) {
+    float in = i % 4800 == 0 ? 1.0f : 0.0f;
+    size_t num_modes = 1 + (i / 480) % kMaxModes;
+    float v[2];
+    float s[2];
+    vectorized.ProcessDual(in, gain_a, gain_b, num_modes, &v[0], &v[1]);
+    scalar.ProcessDualScalar(in, gain_a, gain_b, num_modes, &s[0], &s[1]);
+    if (memcmp(v, s, sizeof(v))) {
+      ++mismatches;
+    }
+  }
+  printf("Modal filter bank: %zu mismatching samples\n", mismatches);
+}
+
 void TestFilterAccuracy() {
   Svf f;
   
@@ -494,6 +528,7 @@ void TestFilterAccuracy() {
 int main(void) {
   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
   // TestFilterAccuracy();
+  TestModalFilterBank();
   TestPart();
   // TestExciter();
   // TestResonator();
@@ -25,12 +25,25 @@
 // -----------------------------------------------------------------------------
 //
 // Keyframe interpolator.
+//
+// The number of channels and keyframes are template parameters, so that
+// the same code can drive many more channels on a host. Evaluations at
+// increasing (or decreasing) timestamps find their segment in constant time,
+// and the interpolation coefficients of a segment are computed only once.
 
 #ifndef FRAMES_KEYFRAMER_H_
 #define FRAMES_KEYFRAMER_H_
 
 #include "stmlib/stmlib.h"
 
+#include <algorithm>
+
+#ifndef TEST
+#include "stmlib/system/storage.h"
+#endif  // TEST
+
+#include "frames/resources.h"
+
 namespace frames {
   
 const uint8_t kNumChannels = 4;
@@ -44,7 +57,8 @@ enum EasingCurve {
   EASING_CURVE_IN_QUARTIC,
   EASING_CURVE_OUT_QUARTIC,
   EASING_CURVE_SINE,
-  EASING_CURVE_BOUNCE
+  EASING_CURVE_BOUNCE,
+  EASING_CURVE_LAST
 };
 
 struct ChannelSettings {
@@ -52,41 +66,79 @@ struct ChannelSettings {
   uint8_t response;
 };
 
-struct Keyframe {
+template<size_t num_channels>
+struct BasicKeyframe {
   uint16_t timestamp;
   uint16_t id;
-  uint16_t values[kNumChannels];
+  uint16_t values[num_channels];
 };
 
+typedef BasicKeyframe<kNumChannels> Keyframe;
+
 struct KeyframeLess {
-  bool operator()(const Keyframe& lhs, const Keyframe& rhs) {
+  template<typename K>
+  bool operator()(const K& lhs, const K& rhs) {
     return lhs.timestamp < rhs.timestamp;
   }
 };
 
-class Keyframer {
+#ifndef TEST
+extern stmlib::Storage<0x8020000, 4> storage;
+#endif  // TEST
+
+template<size_t num_channels, size_t max_num_keyframes>
+class BasicKeyframer {
  public:
-  Keyframer() { }
-  ~Keyframer() { }
+  typedef BasicKeyframe<num_channels> Keyframe;
+  
+  BasicKeyframer() { }
+  ~BasicKeyframer() { }
+  
+  void Init() {
+#ifndef TEST
+    if (!storage.ParsimoniousLoad(
+            keyframes_, SETTINGS_SIZE, &version_token_)) {
+      for (size_t i = 0; i < num_channels; ++i) {
+        settings_[i].easing_curve = EASING_CURVE_LINEAR;
+        settings_[i].response = 0;
+      }
+      extra_settings_ = 0;
+      dc_offset_frame_modulation_ = 32767;
+      Clear();
+    }
+#endif  // TEST
+    position_ = -1;
+    segment_ = -1;
+  }
   
-  void Init();
-  void Save(uint32_t extra_settings);
-  void Calibrate(int32_t dc_offset_frame_modulation);
+  void Save(uint32_t extra_settings) {
+    extra_settings_ = extra_settings;
+#ifndef TEST
+    storage.ParsimoniousSave(keyframes_, SETTINGS_SIZE, &version_token_);
+#endif  // TEST
+  }
+
+  void Calibrate(int32_t dc_offset_frame_modulation) {
+    dc_offset_frame_modulation_ = dc_offset_frame_modulation;
+#ifndef TEST
+    storage.ParsimoniousSave(keyframes_, SETTINGS_SIZE, &version_token_);
+#endif  // TEST
+  }
   
   bool AddKeyframe(uint16_t timestamp, uint16_t* values);
   bool RemoveKeyframe(uint16_t timestamp);
   
   int16_t FindNearestKeyframe(uint16_t timestamp, uint16_t tolerance);
   
-  inline void set_immediate(uint8_t channel, uint16_t value) {
+  inline void set_immediate(uint16_t channel, uint16_t value) {
     immediate_[channel] = value;
   }
   
-  inline uint16_t dac_code(uint8_t channel) const {
+  inline uint16_t dac_code(uint16_t channel) const {
     return dac_code_[channel];
   }
 
-  inline uint16_t level(uint8_t channel) const {
+  inline uint16_t level(uint16_t channel) const {
     return levels_[channel];
   }
 
@@ -99,15 +151,17 @@ class Keyframer {
   
   void Evaluate(uint16_t timestamp);
   
-  inline ChannelSettings* mutable_settings(uint8_t channel) {
+  inline ChannelSettings* mutable_settings(uint16_t channel) {
     return &settings_[channel];
   }
 
-  inline const ChannelSettings& mutable_settings(uint8_t channel) const {
+  inline const ChannelSettings& mutable_settings(uint16_t channel) const {
     return settings_[channel];
   }
   
   inline Keyframe* mutable_keyframe(uint16_t index) {
+    // The caller is about to edit the keyframe values.
+    segment_ = -1;
     return &keyframes_[index];
   }
   
@@ -117,11 +171,17 @@ class Keyframer {
   
   inline uint16_t num_keyframes() const { return num_keyframes_; }
   
-  uint16_t Easing(int32_t from, int32_t to, uint32_t scale, EasingCurve curve);
+  static inline uint16_t Easing(
+      int32_t from,
+      int32_t to,
+      uint32_t scale,
+      EasingCurve curve) {
+    return from + ((to - from) * (ShapeScale(scale, curve) >> 1) >> 15);
+  }
   
   // This creates a sample animation (between 0 to 65535 and back to 0) used
   // for animating the LED when editing the easing curve or response.
-  uint16_t SampleAnimation(uint8_t channel, uint16_t tick, bool easing);
+  uint16_t SampleAnimation(uint16_t channel, uint16_t tick, bool easing);
   
   inline int16_t position() const { return position_; }
   inline int16_t nearest_keyframe() const { return nearest_keyframe_; }
@@ -138,10 +198,31 @@ class Keyframer {
   }
   
  private:
+  static inline int32_t ShapeScale(uint32_t scale, EasingCurve curve) {
+    int32_t shaped_scale = scale;
+    if (curve == EASING_CURVE_STEP) {
+      shaped_scale = scale < 32768 ? 0 : 65535;
+    } else if (curve >= EASING_CURVE_IN_QUARTIC) {
+      const uint16_t* easing_curve = lookup_table_table[
+          curve - EASING_CURVE_IN_QUARTIC];
+      int32_t scale_a = easing_curve[scale >> 6];
+      int32_t scale_b = easing_curve[(scale >> 6) + 1];
+      shaped_scale = scale_a + (((scale_b - scale_a) >> 1) * \
+        ((scale << 10) & 0xffff) >> 15);
+    }
+    return shaped_scale;
+  }
+
   uint16_t FindKeyframe(uint16_t timestamp);
+  void LoadSegment(uint16_t position);
+  
+  inline bool IsLowerBound(uint16_t index, uint16_t timestamp) const {
+    return (index == 0 || keyframes_[index - 1].timestamp < timestamp) &&
+        (index == num_keyframes_ || keyframes_[index].timestamp >= timestamp);
+  }
    
-  Keyframe keyframes_[kMaxNumKeyframe];
-  ChannelSettings settings_[kNumChannels];
+  Keyframe keyframes_[max_num_keyframes];
+  ChannelSettings settings_[num_channels];
   uint16_t num_keyframes_;
   uint16_t id_counter_;
   uint32_t extra_settings_;
@@ -160,17 +241,251 @@ class Keyframer {
   int16_t position_;
   int16_t nearest_keyframe_;
 
-  uint16_t dac_code_[kNumChannels];
-  uint16_t levels_[kNumChannels];
-  uint16_t immediate_[kNumChannels];
+  uint16_t dac_code_[num_channels];
+  uint16_t levels_[num_channels];
+  uint16_t immediate_[num_channels];
   
   uint8_t color_[3];
   
+  // Segment for which the coefficients below have been computed, -1 when
+  // they need to be refreshed.
+  int16_t segment_;
+  uint16_t segment_start_;
+  uint32_t segment_duration_;
+  int32_t from_[num_channels];
+  int32_t delta_[num_channels];
+  
   static const uint8_t palette_[kNumPaletteEntries][3];
   
-  DISALLOW_COPY_AND_ASSIGN(Keyframer);
+  DISALLOW_COPY_AND_ASSIGN(BasicKeyframer);
+};
+
+/* static */
+template<size_t num_channels, size_t max_num_keyframes>
+const uint8_t BasicKeyframer<num_channels, max_num_keyframes>::palette_[
+    kNumPaletteEntries][3] = {
+  { 255, 0, 0 },
+  { 255, 64, 0 },
+  { 255, 255, 0 },
+  { 64, 255, 0 },
+  { 0, 255, 64 },
+  { 0, 0, 255 },
+  { 255, 0, 255 },
+  { 255, 0, 64 },
 };
 
+template<size_t num_channels, size_t max_num_keyframes>
+void BasicKeyframer<num_channels, max_num_keyframes>::Clear() {
+  Keyframe empty;
+  empty.timestamp = 0;
+  empty.id = 0;
+  std::fill(&empty.values[0], &empty.values[num_channels], 0);
+  std::fill(&keyframes_[0], &keyframes_[max_num_keyframes], empty);
+  num_keyframes_ = 0;
+  id_counter_ = 0;
+  segment_ = -1;
+}
+
+template<size_t num_channels, size_t max_num_keyframes>
+uint16_t BasicKeyframer<num_channels, max_num_keyframes>::FindKeyframe(
+    uint16_t timestamp) {
+  if (!num_keyframes_) {
+    return 0;
+  }
+  // When sweeping through the timeline, the timestamp is usually still in
+  // the segment found by the previous evaluation, or in one of its
+  // neighbours.
+  if (position_ >= 0 && position_ <= num_keyframes_) {
+    uint16_t hint = position_;
+    if (IsLowerBound(hint, timestamp)) {
+      return hint;
+    } else if (hint < num_keyframes_ && IsLowerBound(hint + 1, timestamp)) {
+      return hint + 1;
+    } else if (hint > 0 && IsLowerBound(hint - 1, timestamp)) {
+      return hint - 1;
+    }
+  }
+  Keyframe dummy;
+  dummy.timestamp = timestamp;
+  return std::lower_bound(
+      keyframes_,
+      keyframes_ + num_keyframes_,
+      dummy,
+      KeyframeLess()) - keyframes_;
+}
+
+/* static */
+template<size_t num_channels, size_t max_num_keyframes>
+uint16_t BasicKeyframer<num_channels, max_num_keyframes>::ConvertToDacCode(
+    uint16_t gain,
+    uint8_t response) {
+  // Exponential response is easy, straight to the 2164.
+  int32_t exponential = 65535 - gain;
+  
+  // Use a lookup table and interpolation to linearize the 2164
+  int32_t a = lut_vca_linear[gain >> 6];
+  int32_t b = lut_vca_linear[(gain >> 6) + 1];
+  int32_t linear = a + ((b - a) * ((gain << 10) & 0xffff) >> 16);
+  
+  // Blend linear and exponential responses.
+  uint16_t balance = lut_response_balance[response];
+  return (linear + ((exponential - linear) * balance >> 15)) >> 4;
+}
+
+template<size_t num_channels, size_t max_num_keyframes>
+uint16_t BasicKeyframer<num_channels, max_num_keyframes>::SampleAnimation(
+    uint16_t channel,
+    uint16_t tick,
+    bool easing) {
+  uint16_t sample = Easing(
+      tick > 32768 ? 65535 : 0,
+      tick > 32768 ? 0 : 65535,
+      (tick << 1) & 0xffff,
+      easing ? settings_[channel].easing_curve : EASING_CURVE_LINEAR);
+  if (!easing) {
+    int32_t linear = sample;
+    int32_t exponential = lut_exponential[sample >> 8];
+    uint16_t balance = lut_response_balance[settings_[channel].response];
+    sample = linear + ((exponential - linear) * balance >> 15);
+  }
+  return sample;
+}
+
+template<size_t num_channels, size_t max_num_keyframes>
+int16_t BasicKeyframer<num_channels, max_num_keyframes>::FindNearestKeyframe(
+    uint16_t timestamp,
+    uint16_t tolerance) {
+  if (!num_keyframes_) {
+    return -1;
+  }
+  uint16_t index = FindKeyframe(timestamp);
+  uint16_t search_start = index ? index - 1 : 0;
+  uint16_t search_end = index < num_keyframes_ - 1 ? index + 2 : num_keyframes_;
+  for (uint16_t i = search_start; i < search_end; ++i) {
+    uint16_t t = keyframes_[i].timestamp;
+    int32_t distance = static_cast<int32_t>(t) - \
+        static_cast<int32_t>(timestamp);
+    if (distance < tolerance && -distance < tolerance) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+template<size_t num_channels, size_t max_num_keyframes>
+bool BasicKeyframer<num_channels, max_num_keyframes>::AddKeyframe(
+    uint16_t timestamp,
+    uint16_t* values) {
+  if (num_keyframes_ == max_num_keyframes) {
+    return false;
+  }
+  
+  uint16_t insertion_point = FindKeyframe(timestamp);
+  if (insertion_point >= num_keyframes_ ||
+      keyframes_[insertion_point].timestamp != timestamp) {
+    for (int16_t i = num_keyframes_ - 1; i >= insertion_point; --i) {
+      keyframes_[i + 1] = keyframes_[i];
+    }
+    keyframes_[insertion_point].timestamp = timestamp;
+    keyframes_[insertion_point].id = id_counter_++;
+    ++num_keyframes_;
+  }
+  std::copy(values, values + num_channels, keyframes_[insertion_point].values);
+  segment_ = -1;
+  return true;
+}
+
+template<size_t num_channels, size_t max_num_keyframes>
+bool BasicKeyframer<num_channels, max_num_keyframes>::RemoveKeyframe(
+    uint16_t timestamp) {
+  if (!num_keyframes_) {
+    return false;
+  }
+  uint16_t splice_point = FindKeyframe(timestamp);
+  if (keyframes_[splice_point].timestamp != timestamp) {
+    return false;
+  }
+  
+  for (uint16_t i = splice_point; i < num_keyframes_ - 1; ++i) {
+    keyframes_[i] = keyframes_[i + 1];
+  }
+  --num_keyframes_;
+  segment_ = -1;
+  return true;
+}
+
+template<size_t num_channels, size_t max_num_keyframes>
+void BasicKeyframer<num_channels, max_num_keyframes>::LoadSegment(
+    uint16_t position) {
+  const Keyframe& a = keyframes_[position - 1];
+  const Keyframe& b = keyframes_[position];
+  segment_start_ = a.timestamp;
+  segment_duration_ = b.timestamp - a.timestamp;
+  for (size_t i = 0; i < num_channels; ++i) {
+    from_[i] = a.values[i];
+    delta_[i] = static_cast<int32_t>(b.values[i]) - from_[i];
+  }
+  segment_ = position;
+}
+
+template<size_t num_channels, size_t max_num_keyframes>
+void BasicKeyframer<num_channels, max_num_keyframes>::Evaluate(
+    uint16_t timestamp) {
+  if (!num_keyframes_) {
+    std::copy(immediate_, immediate_ + num_channels, levels_);
+    std::fill(color_, color_ + 3, 0xff);
+    position_ = -1;
+    nearest_keyframe_ = -1;
+  } else {
+    uint16_t position = FindKeyframe(timestamp);
+    position_ = position;
+
+    // Check for the areas before the first keyframe, and after the last
+    // keyframe.
+    if (position == 0 || position == num_keyframes_) {
+      const Keyframe& source = keyframes_[
+          position == 0 ? 0 : num_keyframes_ - 1];
+      std::copy(source.values, source.values + num_channels, levels_);
+      const uint8_t* palette = palette_[source.id & (kNumPaletteEntries - 1)];
+      std::copy(palette, palette + 3, color_);
+    } else {
+      // This is where the real interpolation takes place. The easing curves
+      // are shaped once, and shared by all the channels.
+      if (segment_ != position_) {
+        LoadSegment(position);
+      }
+      uint32_t scale = timestamp - segment_start_;
+      scale <<= 16;
+      scale /= segment_duration_;
+      int32_t shaped_scale[EASING_CURVE_LAST];
+      for (int32_t i = 0; i < EASING_CURVE_LAST; ++i) {
+        shaped_scale[i] = ShapeScale(scale, static_cast<EasingCurve>(i)) >> 1;
+      }
+      for (size_t i = 0; i < num_channels; ++i) {
+        levels_[i] = from_[i] + \
+            (delta_[i] * shaped_scale[settings_[i].easing_curve] >> 15);
+      }
+      const Keyframe& a = keyframes_[position - 1];
+      const Keyframe& b = keyframes_[position];
+      for (uint8_t i = 0; i < 3; ++i) {
+        uint8_t a_color = palette_[a.id & (kNumPaletteEntries - 1)][i];
+        uint8_t b_color = palette_[b.id & (kNumPaletteEntries - 1)][i];
+        color_[i] = a_color + ((b_color - a_color) * scale >> 16);
+      }
+    }
+    uint16_t t_this = timestamp - \
+        (position == 0 ? 0 : keyframes_[position - 1].timestamp);
+    uint16_t t_next = keyframes_[position].timestamp - timestamp;
+    nearest_keyframe_ = t_next < t_this ? position + 1 : position;
+  }
+  
+  for (size_t i = 0; i < num_channels; ++i) {
+    dac_code_[i] = ConvertToDacCode(levels_[i], settings_[i].response);
+  }
+}
+
+typedef BasicKeyframer<kNumChannels, kMaxNumKeyframe> Keyframer;
+
 }  // namespace frames
 
 #endif  // FRAMES_KEYFRAMER_H_
@@ -0,0 +1,137 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Keyframer tests.
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+#include "frames/keyframer.h"
+#include "frames/test/reference_keyframer.h"
+
+using namespace frames;
+
+template<typename K, typename R>
+void CheckSameOutput(const K& keyframer, const R& reference, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    assert(keyframer.level(i) == reference.level(i));
+    assert(keyframer.dac_code(i) == reference.dac_code(i));
+  }
+  for (uint8_t i = 0; i < 3; ++i) {
+    assert(keyframer.color(i) == reference.color(i));
+  }
+  assert(keyframer.position() == reference.position());
+  assert(keyframer.nearest_keyframe() == reference.nearest_keyframe());
+}
+
+// Runs the same evaluations and edits on the keyframer and on the reference,
+// and checks that their outputs are identical after each of them. The
+// timeline is swept forward, backward, then read at random positions, and
+// keyframes are edited, added and removed along the way.
+template<size_t num_channels, size_t max_num_keyframes>
+void TestKeyframerMatchesReference() {
+  typedef BasicKeyframer<num_channels, max_num_keyframes> K;
+  typedef ReferenceKeyframer<num_channels, max_num_keyframes> R;
+  K* keyframer = new K;
+  R* reference = new R;
+  
+  srand(num_channels);
+  keyframer->Init();
+  keyframer->Clear();
+  reference->Clear();
+  for (size_t i = 0; i < num_channels; ++i) {
+    ChannelSettings s;
+    s.easing_curve = EasingCurve(rand() % EASING_CURVE_LAST);
+    s.response = rand() % 256;
+    *keyframer->mutable_settings(i) = s;
+    *reference->mutable_settings(i) = s;
+    uint16_t immediate = rand() % 65536;
+    keyframer->set_immediate(i, immediate);
+    reference->set_immediate(i, immediate);
+  }
+  
+  // No keyframes: the immediate values go straight to the outputs.
+  keyframer->Evaluate(1000);
+  reference->Evaluate(1000);
+  CheckSameOutput(*keyframer, *reference, num_channels);
+  
+  uint16_t values[num_channels];
+  while (keyframer->num_keyframes() < max_num_keyframes) {
+    for (size_t i = 0; i < num_channels; ++i) {
+      values[i] = rand() % 65536;
+    }
+    uint16_t timestamp = rand() % 65536;
+    assert(keyframer->AddKeyframe(timestamp, values) == \
+        reference->AddKeyframe(timestamp, values));
+  }
+  
+  int num_evaluations = 0;
+  for (int pass = 0; pass < 3; ++pass) {
+    for (int32_t i = 0; i < 65536; i += 7) {
+      uint16_t timestamp = pass == 0 ? i : (pass == 1 ? 65535 - i : rand());
+      keyframer->Evaluate(timestamp);
+      reference->Evaluate(timestamp);
+      CheckSameOutput(*keyframer, *reference, num_channels);
+      assert(keyframer->FindNearestKeyframe(timestamp, 512) == \
+          reference->FindNearestKeyframe(timestamp, 512));
+      ++num_evaluations;
+      
+      if (i % 1001 == 0) {
+        // Edit the keyframe being played, as the UI does.
+        uint16_t index = keyframer->nearest_keyframe();
+        if (index < keyframer->num_keyframes()) {
+          uint16_t value = rand() % 65536;
+          keyframer->mutable_keyframe(index)->values[0] = value;
+          reference->mutable_keyframe(index)->values[0] = value;
+        }
+      } else if (i % 2003 == 0) {
+        // Remove a keyframe, and add another one elsewhere.
+        uint16_t index = rand() % keyframer->num_keyframes();
+        uint16_t timestamp = keyframer->keyframe(index).timestamp;
+        assert(keyframer->RemoveKeyframe(timestamp));
+        assert(reference->RemoveKeyframe(timestamp));
+        for (size_t j = 0; j < num_channels; ++j) {
+          values[j] = rand() % 65536;
+        }
+        timestamp = rand() % 65536;
+        assert(keyframer->AddKeyframe(timestamp, values) == \
+            reference->AddKeyframe(timestamp, values));
+      }
+    }
+  }
+  printf("Keyframer, %d channels: %d evaluations identical to the reference\n",
+         int(num_channels),
+         num_evaluations);
+  delete reference;
+  delete keyframer;
+}
+
+int main(void) {
+  TestKeyframerMatchesReference<kNumChannels, kMaxNumKeyframe>();
+  TestKeyframerMatchesReference<64, kMaxNumKeyframe>();
+  TestKeyframerMatchesReference<1024, kMaxNumKeyframe>();
+}
@@ -0,0 +1,254 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// The keyframer as it was before the segment lookup and the coefficients of
+// the current segment were cached: a binary search for each evaluation, and
+// an easing curve shaped for each channel. The test checks that the current
+// keyframer matches it bit for bit.
+
+#ifndef FRAMES_TEST_REFERENCE_KEYFRAMER_H_
+#define FRAMES_TEST_REFERENCE_KEYFRAMER_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "frames/keyframer.h"
+#include "frames/resources.h"
+
+namespace frames {
+
+template<size_t num_channels, size_t max_num_keyframes>
+class ReferenceKeyframer {
+ public:
+  typedef BasicKeyframe<num_channels> Keyframe;
+  
+  ReferenceKeyframer() { }
+  ~ReferenceKeyframer() { }
+  
+  void Clear() {
+    Keyframe empty;
+    empty.timestamp = 0;
+    empty.id = 0;
+    std::fill(&empty.values[0], &empty.values[num_channels], 0);
+    std::fill(&keyframes_[0], &keyframes_[max_num_keyframes], empty);
+    num_keyframes_ = 0;
+    id_counter_ = 0;
+  }
+  
+  bool AddKeyframe(uint16_t timestamp, uint16_t* values) {
+    if (num_keyframes_ == max_num_keyframes) {
+      return false;
+    }
+    
+    uint16_t insertion_point = FindKeyframe(timestamp);
+    if (insertion_point >= num_keyframes_ ||
+        keyframes_[insertion_point].timestamp != timestamp) {
+      for (int16_t i = num_keyframes_ - 1; i >= insertion_point; --i) {
+        keyframes_[i + 1] = keyframes_[i];
+      }
+      keyframes_[insertion_point].timestamp = timestamp;
+      keyframes_[insertion_point].id = id_counter_++;
+      ++num_keyframes_;
+    }
+    std::copy(
+        values,
+        values + num_channels,
+        keyframes_[insertion_point].values);
+    return true;
+  }
+  
+  bool RemoveKeyframe(uint16_t timestamp) {
+    if (!num_keyframes_) {
+      return false;
+    }
+    uint16_t splice_point = FindKeyframe(timestamp);
+    if (keyframes_[splice_point].timestamp != timestamp) {
+      return false;
+    }
+    
+    for (uint16_t i = splice_point; i < num_keyframes_ - 1; ++i) {
+      keyframes_[i] = keyframes_[i + 1];
+    }
+    --num_keyframes_;
+    return true;
+  }
+  
+  int16_t FindNearestKeyframe(uint16_t timestamp, uint16_t tolerance) {
+    if (!num_keyframes_) {
+      return -1;
+    }
+    uint16_t index = FindKeyframe(timestamp);
+    uint16_t search_start = index ? index - 1 : 0;
+    uint16_t search_end = index < num_keyframes_ - 1 ? \
+        index + 2 : num_keyframes_;
+    for (uint16_t i = search_start; i < search_end; ++i) {
+      uint16_t t = keyframes_[i].timestamp;
+      int32_t distance = static_cast<int32_t>(t) - \
+          static_cast<int32_t>(timestamp);
+      if (distance < tolerance && -distance < tolerance) {
+        return i;
+      }
+    }
+    return -1;
+  }
+  
+  void Evaluate(uint16_t timestamp) {
+    if (!num_keyframes_) {
+      std::copy(immediate_, immediate_ + num_channels, levels_);
+      std::fill(color_, color_ + 3, 0xff);
+      position_ = -1;
+      nearest_keyframe_ = -1;
+    } else {
+      uint16_t position = FindKeyframe(timestamp);
+      position_ = position;
+      
+      if (position == 0 || position == num_keyframes_) {
+        const Keyframe& source = keyframes_[
+            position == 0 ? 0 : num_keyframes_ - 1];
+        std::copy(source.values, source.values + num_channels, levels_);
+        const uint8_t* palette = palette_[
+            source.id & (kNumPaletteEntries - 1)];
+        std::copy(palette, palette + 3, color_);
+      } else {
+        const Keyframe& a = keyframes_[position - 1];
+        const Keyframe& b = keyframes_[position];
+        uint32_t scale = timestamp - a.timestamp;
+        scale <<= 16;
+        scale /= (b.timestamp - a.timestamp);
+        for (size_t i = 0; i < num_channels; ++i) {
+          int32_t from = a.values[i];
+          int32_t to = b.values[i];
+          levels_[i] = Easing(from, to, scale, settings_[i].easing_curve);
+        }
+        for (uint8_t i = 0; i < 3; ++i) {
+          uint8_t a_color = palette_[a.id & (kNumPaletteEntries - 1)][i];
+          uint8_t b_color = palette_[b.id & (kNumPaletteEntries - 1)][i];
+          color_[i] = a_color + ((b_color - a_color) * scale >> 16);
+        }
+      }
+      uint16_t t_this = timestamp - \
+          (position == 0 ? 0 : keyframes_[position - 1].timestamp);
+      uint16_t t_next = keyframes_[position].timestamp - timestamp;
+      nearest_keyframe_ = t_next < t_this ? position + 1 : position;
+    }
+    
+    for (size_t i = 0; i < num_channels; ++i) {
+      dac_code_[i] = BasicKeyframer<num_channels, max_num_keyframes>::
+          ConvertToDacCode(levels_[i], settings_[i].response);
+    }
+  }
+  
+  inline void set_immediate(uint16_t channel, uint16_t value) {
+    immediate_[channel] = value;
+  }
+  
+  inline ChannelSettings* mutable_settings(uint16_t channel) {
+    return &settings_[channel];
+  }
+  
+  inline Keyframe* mutable_keyframe(uint16_t index) {
+    return &keyframes_[index];
+  }
+  
+  inline uint16_t dac_code(uint16_t channel) const {
+    return dac_code_[channel];
+  }
+  inline uint16_t level(uint16_t channel) const { return levels_[channel]; }
+  inline uint8_t color(uint8_t component) const { return color_[component]; }
+  inline int16_t position() const { return position_; }
+  inline int16_t nearest_keyframe() const { return nearest_keyframe_; }
+  inline uint16_t num_keyframes() const { return num_keyframes_; }
+  
+ private:
+  uint16_t FindKeyframe(uint16_t timestamp) {
+    if (!num_keyframes_) {
+      return 0;
+    }
+    Keyframe dummy;
+    dummy.timestamp = timestamp;
+    return std::lower_bound(
+        keyframes_,
+        keyframes_ + num_keyframes_,
+        dummy,
+        KeyframeLess()) - keyframes_;
+  }
+  
+  static uint16_t Easing(
+      int32_t from,
+      int32_t to,
+      uint32_t scale,
+      EasingCurve curve) {
+    int32_t shaped_scale = scale;
+    if (curve == EASING_CURVE_STEP) {
+      shaped_scale = scale < 32768 ? 0 : 65535;
+    } else if (curve >= EASING_CURVE_IN_QUARTIC) {
+      const uint16_t* easing_curve = lookup_table_table[
+          curve - EASING_CURVE_IN_QUARTIC];
+      int32_t scale_a = easing_curve[scale >> 6];
+      int32_t scale_b = easing_curve[(scale >> 6) + 1];
+      shaped_scale = scale_a + (((scale_b - scale_a) >> 1) * \
+        ((scale << 10) & 0xffff) >> 15);
+    }
+    return from + ((to - from) * (shaped_scale >> 1) >> 15);
+  }
+  
+  Keyframe keyframes_[max_num_keyframes];
+  ChannelSettings settings_[num_channels];
+  uint16_t num_keyframes_;
+  uint16_t id_counter_;
+  
+  int16_t position_;
+  int16_t nearest_keyframe_;
+  
+  uint16_t dac_code_[num_channels];
+  uint16_t levels_[num_channels];
+  uint16_t immediate_[num_channels];
+  
+  uint8_t color_[3];
+  
+  static const uint8_t palette_[kNumPaletteEntries][3];
+  
+  DISALLOW_COPY_AND_ASSIGN(ReferenceKeyframer);
+};
+
+/* static */
+template<size_t num_channels, size_t max_num_keyframes>
+const uint8_t ReferenceKeyframer<num_channels, max_num_keyframes>::palette_[
+    kNumPaletteEntries][3] = {
+  { 255, 0, 0 },
+  { 255, 64, 0 },
+  { 255, 255, 0 },
+  { 64, 255, 0 },
+  { 0, 255, 64 },
+  { 0, 0, 255 },
+  { 255, 0, 255 },
+  { 255, 0, 64 },
+};
+
+}  // namespace frames
+
+#endif  // FRAMES_TEST_REFERENCE_KEYFRAMER_H_
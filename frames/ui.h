@@ -39,10 +39,10 @@
 #include "frames/drivers/keyframe_led.h"
 #include "frames/drivers/rgb_led.h"
 #include "frames/drivers/switches.h"
+#include "frames/keyframer.h"
 
 namespace frames {
 
-class Keyframer;
 class PolyLfo;
 
 enum SwitchIndex {
@@ -0,0 +1,187 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Work-stealing thread pool (host only).
+
+#include "host/thread_pool.h"
+
+#include <algorithm>
+
+namespace host {
+
+using namespace std;
+
+void ThreadPool::Init(int num_threads) {
+  num_threads_ = max(min(num_threads, kMaxThreads), 1);
+
+  pthread_mutex_init(&lock_, NULL);
+  pthread_cond_init(&batch_started_, NULL);
+  pthread_cond_init(&batch_done_, NULL);
+  fn_ = NULL;
+  context_ = NULL;
+  batch_ = 0;
+  num_pending_tasks_ = 0;
+  num_steals_ = 0;
+  stop_ = false;
+
+  for (int i = 0; i < num_threads_; ++i) {
+    pthread_mutex_init(&queue_[i].lock, NULL);
+    queue_[i].head = queue_[i].tail = 0;
+    worker_[i].pool = this;
+    worker_[i].index = i;
+  }
+
+  // The last worker is the thread calling Run().
+  for (int i = 0; i < num_threads_ - 1; ++i) {
+    pthread_create(&worker_[i].thread, NULL, &WorkerMain, &worker_[i]);
+  }
+}
+
+void ThreadPool::Stop() {
+  pthread_mutex_lock(&lock_);
+  stop_ = true;
+  pthread_cond_broadcast(&batch_started_);
+  pthread_mutex_unlock(&lock_);
+
+  for (int i = 0; i < num_threads_ - 1; ++i) {
+    pthread_join(worker_[i].thread, NULL);
+  }
+  for (int i = 0; i < num_threads_; ++i) {
+    pthread_mutex_destroy(&queue_[i].lock);
+  }
+  pthread_cond_destroy(&batch_done_);
+  pthread_cond_destroy(&batch_started_);
+  pthread_mutex_destroy(&lock_);
+}
+
+void ThreadPool::Run(TaskFn fn, void* context, int num_tasks) {
+  // The queues can't hold more than kMaxTasks tasks: larger batches are
+  // split into several runs.
+  for (int first = 0; first < num_tasks; first += kMaxTasks) {
+    RunBatch(fn, context, first, min(num_tasks - first, kMaxTasks));
+  }
+}
+
+void ThreadPool::RunBatch(TaskFn fn, void* context, int first, int num_tasks) {
+  // The task function must be set before any task becomes visible to a
+  // worker - which might still be looking for work from the previous batch.
+  pthread_mutex_lock(&lock_);
+  fn_ = fn;
+  context_ = context;
+  num_pending_tasks_ = num_tasks;
+  pthread_mutex_unlock(&lock_);
+
+  // Deal contiguous ranges of tasks to the workers.
+  for (int i = 0; i < num_threads_; ++i) {
+    Queue* q = &queue_[i];
+    pthread_mutex_lock(&q->lock);
+    q->head = q->tail = 0;
+    for (int task = i * num_tasks / num_threads_;
+         task < (i + 1) * num_tasks / num_threads_;
+         ++task) {
+      q->tasks[q->tail++] = first + task;
+    }
+    pthread_mutex_unlock(&q->lock);
+  }
+
+  pthread_mutex_lock(&lock_);
+  ++batch_;
+  pthread_cond_broadcast(&batch_started_);
+  pthread_mutex_unlock(&lock_);
+
+  Work(num_threads_ - 1);
+
+  pthread_mutex_lock(&lock_);
+  while (num_pending_tasks_) {
+    pthread_cond_wait(&batch_done_, &lock_);
+  }
+  pthread_mutex_unlock(&lock_);
+}
+
+/* static */
+void* ThreadPool::WorkerMain(void* w) {
+  Worker* worker = static_cast<Worker*>(w);
+  ThreadPool* pool = worker->pool;
+  int batch = 0;
+  while (true) {
+    pthread_mutex_lock(&pool->lock_);
+    while (!pool->stop_ && pool->batch_ == batch) {
+      pthread_cond_wait(&pool->batch_started_, &pool->lock_);
+    }
+    bool stop = pool->stop_;
+    batch = pool->batch_;
+    pthread_mutex_unlock(&pool->lock_);
+    if (stop) {
+      break;
+    }
+    pool->Work(worker->index);
+  }
+  return NULL;
+}
+
+bool ThreadPool::PopTask(int worker, int* task) {
+  Queue* q = &queue_[worker];
+  pthread_mutex_lock(&q->lock);
+  bool found = q->head != q->tail;
+  if (found) {
+    *task = q->tasks[--q->tail];
+  }
+  pthread_mutex_unlock(&q->lock);
+  if (found) {
+    return true;
+  }
+
+  for (int i = 1; i < num_threads_; ++i) {
+    Queue* victim = &queue_[(worker + i) % num_threads_];
+    pthread_mutex_lock(&victim->lock);
+    found = victim->head != victim->tail;
+    if (found) {
+      *task = victim->tasks[victim->head++];
+    }
+    pthread_mutex_unlock(&victim->lock);
+    if (found) {
+      pthread_mutex_lock(&lock_);
+      ++num_steals_;
+      pthread_mutex_unlock(&lock_);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Work(int worker) {
+  int task;
+  while (PopTask(worker, &task)) {
+    (*fn_)(context_, task);
+    pthread_mutex_lock(&lock_);
+    if (--num_pending_tasks_ == 0) {
+      pthread_cond_signal(&batch_done_);
+    }
+    pthread_mutex_unlock(&lock_);
+  }
+}
+
+}  // namespace host
@@ -0,0 +1,108 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Work-stealing thread pool, shared by the desktop tools of all modules
+// (plaits_render, marbles_batch...).
+//
+// Run() spreads a batch of tasks across the queues of all workers - the
+// calling thread being one of them. Each worker pops tasks from the back of
+// its own queue, and once it is empty, steals tasks from the front of the
+// queues of the other workers. Run() returns once all tasks are complete.
+
+#ifndef HOST_THREAD_POOL_H_
+#define HOST_THREAD_POOL_H_
+
+#include "stmlib/stmlib.h"
+
+#include <pthread.h>
+
+namespace host {
+
+const int kMaxThreads = 64;
+const int kMaxTasks = 4096;
+
+class ThreadPool {
+ public:
+  typedef void (*TaskFn)(void* context, int task);
+
+  ThreadPool() { }
+  ~ThreadPool() { }
+
+  // Starts num_threads - 1 threads, the calling thread being the last worker.
+  void Init(int num_threads);
+  void Stop();
+
+  // Calls fn(context, i) for i in [0, num_tasks), and waits for completion.
+  // There is no limit on num_tasks.
+  void Run(TaskFn fn, void* context, int num_tasks);
+
+  inline int num_threads() const { return num_threads_; }
+  inline int num_steals() const { return num_steals_; }
+
+ private:
+  struct Queue {
+    pthread_mutex_t lock;
+    int tasks[kMaxTasks];
+    int head;
+    int tail;
+  };
+
+  struct Worker {
+    ThreadPool* pool;
+    int index;
+    pthread_t thread;
+  };
+
+  static void* WorkerMain(void* worker);
+
+  // Runs tasks [first, first + num_tasks), num_tasks being at most kMaxTasks.
+  void RunBatch(TaskFn fn, void* context, int first, int num_tasks);
+
+  bool PopTask(int worker, int* task);
+  void Work(int worker);
+
+  int num_threads_;
+  Queue queue_[kMaxThreads];
+  Worker worker_[kMaxThreads];
+
+  // Protects everything below.
+  pthread_mutex_t lock_;
+  pthread_cond_t batch_started_;
+  pthread_cond_t batch_done_;
+
+  TaskFn fn_;
+  void* context_;
+  int batch_;
+  int num_pending_tasks_;
+  int num_steals_;
+  bool stop_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace host
+
+#endif  // HOST_THREAD_POOL_H_
@@ -0,0 +1,213 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Batch simulator for the T and X/Y sections (host only).
+
+#include "marbles/host/batch_simulator.h"
+
+#include <algorithm>
+
+#include "marbles/random/philox_generator.h"
+#include "marbles/random/random_stream.h"
+
+namespace marbles {
+
+using namespace std;
+using namespace stmlib;
+
+void SimulationSettings::Init() {
+  t_model = T_GENERATOR_MODEL_COMPLEMENTARY_BERNOULLI;
+  t_range = T_GENERATOR_RANGE_1X;
+  t_rate = 0.0f;
+  t_bias = 0.5f;
+  t_jitter = 0.0f;
+  t_deja_vu = 0.0f;
+  t_length = 8;
+  t_pulse_width_mean = 0.5f;
+  t_pulse_width_std = 0.0f;
+  
+  xy_clock_source = CLOCK_SOURCE_INTERNAL_T1_T2_T3;
+  
+  x.control_mode = CONTROL_MODE_IDENTICAL;
+  x.voltage_range = VOLTAGE_RANGE_FULL;
+  x.register_mode = false;
+  x.register_value = 0.0f;
+  x.spread = 0.5f;
+  x.bias = 0.5f;
+  x.steps = 0.5f;
+  x.deja_vu = 0.0f;
+  x.scale_index = 0;
+  x.length = 8;
+  x.ratio.p = 1;
+  x.ratio.q = 1;
+  
+  y = x;
+  y.length = 1;
+  y.ratio.q = 4;
+  
+  seed = 0;
+  stream_id = 0;
+}
+
+void EventLog::Clear() {
+  gate_time.clear();
+  gate_channel.clear();
+  gate_state.clear();
+  cv_time.clear();
+  cv_channel.clear();
+  cv_value.clear();
+}
+
+void BatchSimulator::Init(int num_threads) {
+  thread_pool_.Init(num_threads);
+  settings_ = NULL;
+  logs_ = NULL;
+  num_samples_ = 0;
+}
+
+void BatchSimulator::Stop() {
+  thread_pool_.Stop();
+}
+
+void BatchSimulator::Run(
+    const vector<SimulationSettings>& settings,
+    float duration,
+    vector<EventLog>* logs) {
+  logs->resize(settings.size());
+  if (settings.empty()) {
+    return;
+  }
+  
+  settings_ = &settings[0];
+  logs_ = &(*logs)[0];
+  num_samples_ = static_cast<size_t>(duration * kSimulationSampleRate);
+  thread_pool_.Run(&RunTask, this, settings.size());
+}
+
+/* static */
+void BatchSimulator::RunTask(void* simulator, int task) {
+  BatchSimulator* s = static_cast<BatchSimulator*>(simulator);
+  Simulate(s->settings_[task], s->num_samples_, &s->logs_[task]);
+}
+
+// Everything a run needs - too large for the stack of the worker threads.
+struct Simulation {
+  PhiloxGenerator random_generator;
+  RandomStream random_stream;
+  TGenerator t_generator;
+  XYGenerator xy_generator;
+  float ramp[4][kSimulationBlockSize];
+};
+
+/* static */
+void BatchSimulator::Simulate(
+    const SimulationSettings& settings,
+    size_t num_samples,
+    EventLog* log) {
+  Simulation* s = new Simulation;
+  
+  s->random_generator.Init(settings.seed, settings.stream_id);
+  s->random_stream.Init(&s->random_generator);
+  
+  TGenerator* t = &s->t_generator;
+  t->Init(&s->random_stream, kSimulationSampleRate);
+  t->set_model(settings.t_model);
+  t->set_range(settings.t_range);
+  t->set_rate(settings.t_rate);
+  t->set_bias(settings.t_bias);
+  t->set_jitter(settings.t_jitter);
+  t->set_deja_vu(settings.t_deja_vu);
+  t->set_length(settings.t_length);
+  t->set_pulse_width_mean(settings.t_pulse_width_mean);
+  t->set_pulse_width_std(settings.t_pulse_width_std);
+  
+  XYGenerator* xy = &s->xy_generator;
+  xy->Init(&s->random_stream, kSimulationSampleRate);
+  
+  Ramps ramps;
+  ramps.master = s->ramp[0];
+  ramps.external = s->ramp[1];
+  ramps.slave[0] = s->ramp[2];
+  ramps.slave[1] = s->ramp[3];
+  
+  GateFlags no_clock[kSimulationBlockSize];
+  fill(&no_clock[0], &no_clock[kSimulationBlockSize], GATE_FLAG_LOW);
+  
+  bool previous_gate[3] = { false, false, false };
+  float previous_cv[kNumChannels];
+  fill(&previous_cv[0], &previous_cv[kNumChannels], 0.0f);
+  
+  log->Clear();
+  for (size_t time = 0; time < num_samples; time += kSimulationBlockSize) {
+    size_t size = min(num_samples - time, kSimulationBlockSize);
+    bool gates[kSimulationBlockSize * 2];
+    float voltages[kSimulationBlockSize * kNumChannels];
+    bool t_reset = false;
+    bool xy_reset = false;
+    
+    t->Process(false, &t_reset, no_clock, ramps, gates, size);
+    xy->Process(
+        settings.xy_clock_source,
+        settings.x,
+        settings.y,
+        &xy_reset,
+        no_clock,
+        ramps,
+        voltages,
+        size);
+    
+    for (size_t i = 0; i < size; ++i) {
+      const uint32_t now = static_cast<uint32_t>(time + i);
+      const bool gate[3] = {
+        gates[i * 2],
+        ramps.master[i] < 0.5f,
+        gates[i * 2 + 1]
+      };
+      for (size_t j = 0; j < 3; ++j) {
+        if (gate[j] != previous_gate[j]) {
+          log->gate_time.push_back(now);
+          log->gate_channel.push_back(j);
+          log->gate_state.push_back(gate[j]);
+          previous_gate[j] = gate[j];
+        }
+      }
+      
+      const float* cv = &voltages[i * kNumChannels];
+      for (size_t j = 0; j < kNumChannels; ++j) {
+        if (now == 0 || cv[j] != previous_cv[j]) {
+          log->cv_time.push_back(now);
+          log->cv_channel.push_back(j);
+          log->cv_value.push_back(cv[j]);
+          previous_cv[j] = cv[j];
+        }
+      }
+    }
+  }
+  
+  delete s;
+}
+
+}  // namespace marbles
@@ -0,0 +1,148 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Batch simulator for the T and X/Y sections (host only).
+//
+// Renders a list of independent runs - each of them a T generator driving an
+// X/Y generator from its internal clock, with fixed settings and its own
+// counter-based random stream (MARBLES_BLOCK_RANDOM must be defined). The
+// runs are spread across a thread pool. Each run only depends on its
+// settings, seed and stream ID, so the logs do not depend on the number of
+// threads.
+//
+// Instead of audio, each run produces an event log, stored as columns:
+// gate transitions on T1, T2 and T3, and new values on X1, X2, X3 and Y.
+// CV values are logged when they change. Note that with steps below 0.5, the
+// outputs are smoothed and change at every sample.
+
+#ifndef MARBLES_HOST_BATCH_SIMULATOR_H_
+#define MARBLES_HOST_BATCH_SIMULATOR_H_
+
+#include "stmlib/stmlib.h"
+
+#include <vector>
+
+#include "host/thread_pool.h"
+#include "marbles/random/t_generator.h"
+#include "marbles/random/x_y_generator.h"
+
+#ifndef MARBLES_BLOCK_RANDOM
+#error "The batch simulator requires MARBLES_BLOCK_RANDOM"
+#endif  // MARBLES_BLOCK_RANDOM
+
+namespace marbles {
+
+// Same block size as the module.
+const size_t kSimulationBlockSize = 5;
+const float kSimulationSampleRate = 32000.0f;
+
+struct SimulationSettings {
+  TGeneratorModel t_model;
+  TGeneratorRange t_range;
+  float t_rate;
+  float t_bias;
+  float t_jitter;
+  float t_deja_vu;
+  int t_length;
+  float t_pulse_width_mean;
+  float t_pulse_width_std;
+  
+  ClockSource xy_clock_source;
+  GroupSettings x;
+  GroupSettings y;
+  
+  uint32_t seed;
+  uint32_t stream_id;
+  
+  // Settings of the module when powered on.
+  void Init();
+};
+
+struct EventLog {
+  enum GateChannel {
+    GATE_T1,
+    GATE_T2,
+    GATE_T3
+  };
+  
+  enum CvChannel {
+    CV_X1,
+    CV_X2,
+    CV_X3,
+    CV_Y
+  };
+  
+  // In samples.
+  std::vector<uint32_t> gate_time;
+  std::vector<uint8_t> gate_channel;
+  std::vector<uint8_t> gate_state;
+  
+  std::vector<uint32_t> cv_time;
+  std::vector<uint8_t> cv_channel;
+  std::vector<float> cv_value;
+  
+  void Clear();
+};
+
+class BatchSimulator {
+ public:
+  BatchSimulator() { }
+  ~BatchSimulator() { }
+  
+  void Init(int num_threads);
+  void Stop();
+  
+  // Renders duration seconds of each run. logs is resized to the number of
+  // runs, log i being the output of run i.
+  void Run(
+      const std::vector<SimulationSettings>& settings,
+      float duration,
+      std::vector<EventLog>* logs);
+  
+  // Renders a single run, on the calling thread.
+  static void Simulate(
+      const SimulationSettings& settings,
+      size_t num_samples,
+      EventLog* log);
+  
+  inline const host::ThreadPool& thread_pool() const { return thread_pool_; }
+
+ private:
+  static void RunTask(void* simulator, int task);
+  
+  host::ThreadPool thread_pool_;
+  
+  // State of the batch being rendered.
+  const SimulationSettings* settings_;
+  EventLog* logs_;
+  size_t num_samples_;
+  
+  DISALLOW_COPY_AND_ASSIGN(BatchSimulator);
+};
+
+}  // namespace marbles
+
+#endif  // MARBLES_HOST_BATCH_SIMULATOR_H_
@@ -0,0 +1,264 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Command line front-end for the batch simulator.
+//
+// marbles_batch sweep <out> [seconds] [threads] [seed]
+//
+//   Renders a sweep of the deja vu, length, bias, jitter and rate settings.
+//   The deja vu, length and bias settings are applied to both the T and X
+//   sections. Run i uses stream ID i: any run can be reproduced from the seed
+//   and its index. Writes the settings of each run to <out>.txt, and the event
+//   logs to <out>.bin:
+//
+//     "MRBL", number of runs (uint32)
+//     for each run: number of gate events, number of CV events (uint32)
+//     gate times (uint32), gate channels (uint8), gate states (uint8)
+//     CV times (uint32), CV channels (uint8), CV values (float)
+//
+//   Each column contains the events of all runs, one run after the other.
+//
+// marbles_batch benchmark [runs] [seconds] [threads]
+//
+//   Renders random settings with 1, 2, 4... up to threads threads (by default,
+//   the number of cores), reports the number of runs rendered per second per
+//   core, and checks that the logs do not depend on the number of threads.
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "marbles/host/batch_simulator.h"
+
+using namespace marbles;
+using namespace std;
+
+const float kDejaVuValues[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+const int kLengthValues[] = { 2, 4, 8, 16 };
+const float kBiasValues[] = { 0.1f, 0.3f, 0.5f, 0.7f, 0.9f };
+const float kJitterValues[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+const float kRateValues[] = { -12.0f, 0.0f, 12.0f };
+
+#define NUM_VALUES(x) (sizeof(x) / sizeof(x[0]))
+
+double Now() {
+  timeval t;
+  gettimeofday(&t, NULL);
+  return double(t.tv_sec) + double(t.tv_usec) * 1e-6;
+}
+
+template<typename T>
+void WriteColumn(
+    const vector<EventLog>& logs,
+    const vector<T> EventLog::* column,
+    FILE* fp) {
+  for (size_t i = 0; i < logs.size(); ++i) {
+    const vector<T>& v = logs[i].*column;
+    if (!v.empty()) {
+      fwrite(&v[0], sizeof(T), v.size(), fp);
+    }
+  }
+}
+
+bool WriteLogs(const vector<EventLog>& logs, const char* file_name) {
+  FILE* fp = fopen(file_name, "wb");
+  if (!fp) {
+    return false;
+  }
+  uint32_t num_runs = logs.size();
+  fwrite("MRBL", 1, 4, fp);
+  fwrite(&num_runs, sizeof(uint32_t), 1, fp);
+  for (size_t i = 0; i < logs.size(); ++i) {
+    uint32_t size[2] = { 
+      uint32_t(logs[i].gate_time.size()),
+      uint32_t(logs[i].cv_time.size())
+    };
+    fwrite(size, sizeof(uint32_t), 2, fp);
+  }
+  WriteColumn(logs, &EventLog::gate_time, fp);
+  WriteColumn(logs, &EventLog::gate_channel, fp);
+  WriteColumn(logs, &EventLog::gate_state, fp);
+  WriteColumn(logs, &EventLog::cv_time, fp);
+  WriteColumn(logs, &EventLog::cv_channel, fp);
+  WriteColumn(logs, &EventLog::cv_value, fp);
+  fclose(fp);
+  return true;
+}
+
+int Sweep(
+    const char* out_name,
+    float duration,
+    int num_threads,
+    uint32_t seed) {
+  vector<SimulationSettings> settings;
+  SimulationSettings s;
+  s.Init();
+  s.seed = seed;
+  for (size_t a = 0; a < NUM_VALUES(kDejaVuValues); ++a) {
+    for (size_t b = 0; b < NUM_VALUES(kLengthValues); ++b) {
+      for (size_t c = 0; c < NUM_VALUES(kBiasValues); ++c) {
+        for (size_t d = 0; d < NUM_VALUES(kJitterValues); ++d) {
+          for (size_t e = 0; e < NUM_VALUES(kRateValues); ++e) {
+            s.t_deja_vu = s.x.deja_vu = kDejaVuValues[a];
+            s.t_length = s.x.length = kLengthValues[b];
+            s.t_bias = s.x.bias = kBiasValues[c];
+            s.t_jitter = kJitterValues[d];
+            s.t_rate = kRateValues[e];
+            s.stream_id = settings.size();
+            settings.push_back(s);
+          }
+        }
+      }
+    }
+  }
+  
+  char file_name[256];
+  snprintf(file_name, sizeof(file_name), "%s.txt", out_name);
+  FILE* fp = fopen(file_name, "w");
+  if (!fp) {
+    fprintf(stderr, "Cannot open %s\n", file_name);
+    return 1;
+  }
+  fprintf(fp, "# run seed deja_vu length bias jitter rate\n");
+  for (size_t i = 0; i < settings.size(); ++i) {
+    const SimulationSettings& s = settings[i];
+    fprintf(fp, "%d %u %.2f %d %.2f %.2f %.1f\n",
+            int(i), s.seed, s.t_deja_vu, s.t_length,
+            s.t_bias, s.t_jitter, s.t_rate);
+  }
+  fclose(fp);
+  
+  BatchSimulator simulator;
+  vector<EventLog> logs;
+  simulator.Init(num_threads);
+  double start = Now();
+  simulator.Run(settings, duration, &logs);
+  double elapsed = Now() - start;
+  simulator.Stop();
+  printf(
+      "%d runs of %.1fs in %.1fs\n",
+      int(settings.size()),
+      duration,
+      elapsed);
+  
+  snprintf(file_name, sizeof(file_name), "%s.bin", out_name);
+  if (!WriteLogs(logs, file_name)) {
+    fprintf(stderr, "Cannot open %s\n", file_name);
+    return 1;
+  }
+  return 0;
+}
+
+namespace marbles {
+
+bool operator==(const EventLog& a, const EventLog& b) {
+  return a.gate_time == b.gate_time && \
+      a.gate_channel == b.gate_channel && \
+      a.gate_state == b.gate_state && \
+      a.cv_time == b.cv_time && \
+      a.cv_channel == b.cv_channel && \
+      a.cv_value == b.cv_value;
+}
+
+}  // namespace marbles
+
+float RandomValue() {
+  return float(rand() % 1000) / 999.0f;
+}
+
+int Benchmark(int num_runs, float duration, int max_threads) {
+  max_threads = max(max_threads, 1);
+  
+  vector<SimulationSettings> settings(num_runs);
+  srand(0);
+  for (int i = 0; i < num_runs; ++i) {
+    SimulationSettings* s = &settings[i];
+    s->Init();
+    s->t_model = TGeneratorModel(rand() % (T_GENERATOR_MODEL_MARKOV + 1));
+    s->t_rate = float(rand() % 48) - 24.0f;
+    s->t_bias = RandomValue();
+    s->t_jitter = RandomValue();
+    s->t_deja_vu = s->x.deja_vu = RandomValue();
+    s->t_length = s->x.length = 1 + rand() % 16;
+    s->x.spread = RandomValue();
+    s->x.bias = RandomValue();
+    s->seed = 1;
+    s->stream_id = i;
+  }
+  
+  vector<EventLog> reference;
+  vector<EventLog> logs;
+  printf("%d runs, %.1fs\n", num_runs, duration);
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    BatchSimulator simulator;
+    simulator.Init(num_threads);
+    double start = Now();
+    simulator.Run(settings, duration, &logs);
+    double elapsed = Now() - start;
+    if (num_threads == 1) {
+      reference = logs;
+    }
+    const double runs_per_second = num_runs / elapsed;
+    printf("%2d threads: %7.1f runs/s, %7.1f per core, "
+           "%5d steals, logs %s\n",
+           num_threads,
+           runs_per_second,
+           runs_per_second / num_threads,
+           simulator.thread_pool().num_steals(),
+           logs == reference ? "identical" : "DIFFERENT");
+    simulator.Stop();
+    
+    if (num_threads * 2 > max_threads && num_threads != max_threads) {
+      num_threads = max_threads / 2;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && !strcmp(argv[1], "sweep")) {
+    return Sweep(
+        argv[2],
+        argc > 3 ? float(atof(argv[3])) : 30.0f,
+        argc > 4 ? atoi(argv[4]) : int(sysconf(_SC_NPROCESSORS_ONLN)),
+        argc > 5 ? uint32_t(strtoul(argv[5], NULL, 0)) : 0);
+  } else if (argc >= 2 && !strcmp(argv[1], "benchmark")) {
+    return Benchmark(
+        argc > 2 ? atoi(argv[2]) : 256,
+        argc > 3 ? float(atof(argv[3])) : 10.0f,
+        argc > 4 ? atoi(argv[4]) : int(sysconf(_SC_NPROCESSORS_ONLN)));
+  }
+  fprintf(stderr, "Usage: %s sweep <out> [seconds] [threads] [seed]\n",
+          argv[0]);
+  fprintf(stderr, "       %s benchmark [runs] [seconds] [threads]\n",
+          argv[0]);
+  return 1;
+}
@@ -24,48 +24,31 @@
 //
 // -----------------------------------------------------------------------------
 //
-// FIR Downsampler.
+// Interface for generators producing blocks of random words, used to replace
+// the hardware RNG and its fallback in offline simulations.
 
-#ifndef PLAITS_DSP_DOWNSAMPLER_4X_DOWNSAMPLER_H_
-#define PLAITS_DSP_DOWNSAMPLER_4X_DOWNSAMPLER_H_
+#ifndef MARBLES_RANDOM_BLOCK_RANDOM_GENERATOR_H_
+#define MARBLES_RANDOM_BLOCK_RANDOM_GENERATOR_H_
 
 #include "stmlib/stmlib.h"
 
-#include "plaits/resources.h"
+namespace marbles {
 
-namespace plaits {
-  
-const size_t kOversampling = 4;
-
-class Downsampler {
+class BlockRandomGenerator {
  public:
-  Downsampler(float* state) {
-    head_ = *state;
-    tail_ = 0.0f;
-    state_ = state;
-  }
-  ~Downsampler() {
-    *state_ = head_;
-  }
-  inline void Accumulate(int i, float sample) {
-    head_ += sample * lut_4x_downsampler_fir[3 - (i & 3)];
-    tail_ += sample * lut_4x_downsampler_fir[i & 3];
-  }
+  BlockRandomGenerator() { }
+  virtual ~BlockRandomGenerator() { }
+  
+  // Writes the next size words of the sequence.
+  virtual void Fill(uint32_t* words, size_t size) = 0;
+  
+  // Skips the next num_words words of the sequence.
+  virtual void Jump(uint64_t num_words) = 0;
 
-  inline float Read() {
-    float value = head_;
-    head_ = tail_;
-    tail_ = 0.0f;
-    return value;
-  }
  private:
-  float head_;
-  float tail_;
-  float* state_;
-
-  DISALLOW_COPY_AND_ASSIGN(Downsampler);
+  DISALLOW_COPY_AND_ASSIGN(BlockRandomGenerator);
 };
 
-}  // namespace plaits
+}  // namespace marbles
 
-#endif  // PLAITS_DSP_DOWNSAMPLER_4X_DOWNSAMPLER_H_
\ No newline at end of file
+#endif  // MARBLES_RANDOM_BLOCK_RANDOM_GENERATOR_H_
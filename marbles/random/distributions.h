@@ -35,6 +35,7 @@
 
 #include "stmlib/dsp/dsp.h"
 
+#include "marbles/random/simd.h"
 #include "marbles/resources.h"
 
 namespace marbles {
@@ -99,6 +100,130 @@ inline float BetaDistributionSample(float uniform, float spread, float bias) {
   return y;
 }
 
+// Block version of the above, for a sequence of uniformly distributed samples
+// sharing the same spread and bias. The results are identical to those of
+// the scalar version. The table cell and the interpolation weights are
+// computed once per block; the choice of the tail tables is done with masks
+// instead of branches, and the table lookups are done 4 samples at a time.
+inline void BetaDistributionSample(
+    const float* uniform,
+    float spread,
+    float bias,
+    float* out,
+    size_t size) {
+  bool flip_result = bias > 0.5f;
+  if (flip_result) {
+    bias = 1.0f - bias;
+  }
+  
+  bias *= (static_cast<float>(kNumBiasValues) - 1.0f) * 2.0f;
+  spread *= (static_cast<float>(kNumRangeValues) - 1.0f);
+  
+  MAKE_INTEGRAL_FRACTIONAL(bias);
+  MAKE_INTEGRAL_FRACTIONAL(spread);
+  
+  size_t cell = bias_integral * (kNumRangeValues + 1) + spread_integral;
+  const float* x1y1_table = distributions_table[cell];
+  const float* x2y1_table = distributions_table[cell + 1];
+  const float* x1y2_table = distributions_table[cell + kNumRangeValues + 1];
+  const float* x2y2_table = distributions_table[cell + kNumRangeValues + 2];
+  
+  size_t i = 0;
+  
+#ifdef MARBLES_SIMD
+  const LaneFloat one = SplatLanes(1.0f);
+  const LaneFloat twenty = SplatLanes(20.0f);
+  const LaneFloat low_percentile = SplatLanes(0.05f);
+  const LaneFloat high_percentile = SplatLanes(0.95f);
+  const LaneFloat table_size = SplatLanes(kIcdfTableSize);
+  const LaneInt low_offset = SplatLanes(
+      static_cast<int32_t>(kIcdfTableSize + 1));
+  const LaneInt high_offset = SplatLanes(
+      static_cast<int32_t>(2 * (kIcdfTableSize + 1)));
+  const LaneFloat spread_fractional_lanes = SplatLanes(spread_fractional);
+  const LaneFloat bias_fractional_lanes = SplatLanes(bias_fractional);
+  
+  int32_t index[kNumLanes];
+  float a[4][kNumLanes];
+  float b[4][kNumLanes];
+  
+  for (; i + kNumLanes <= size; i += kNumLanes) {
+    LaneFloat u = LoadLanes(&uniform[i]);
+    if (flip_result) {
+      u = SubLanes(one, u);
+    }
+    
+    const LaneInt above_low = GreaterLanes(u, low_percentile);
+    const LaneInt below_high = GreaterLanes(high_percentile, u);
+    u = SelectLanes(
+        above_low,
+        SelectLanes(
+            below_high,
+            u,
+            MulLanes(SubLanes(u, high_percentile), twenty)),
+        MulLanes(u, twenty));
+    const LaneInt offset = AddLanes(
+        AndNotLanes(above_low, low_offset),
+        AndNotLanes(below_high, high_offset));
+    
+    u = MulLanes(u, table_size);
+    const LaneInt integral = TruncateLanes(u);
+    const LaneFloat fractional = SubLanes(u, ConvertLanes(integral));
+    StoreLanes(index, AddLanes(integral, offset));
+    
+    for (size_t j = 0; j < kNumLanes; ++j) {
+      const int32_t n = index[j];
+      a[0][j] = x1y1_table[n];
+      b[0][j] = x1y1_table[n + 1];
+      a[1][j] = x2y1_table[n];
+      b[1][j] = x2y1_table[n + 1];
+      a[2][j] = x1y2_table[n];
+      b[2][j] = x1y2_table[n + 1];
+      a[3][j] = x2y2_table[n];
+      b[3][j] = x2y2_table[n + 1];
+    }
+    
+    LaneFloat v[4];
+    for (size_t j = 0; j < 4; ++j) {
+      const LaneFloat a_j = LoadLanes(a[j]);
+      v[j] = AddLanes(
+          a_j, MulLanes(SubLanes(LoadLanes(b[j]), a_j), fractional));
+    }
+    
+    const LaneFloat y1 = AddLanes(
+        v[0], MulLanes(SubLanes(v[1], v[0]), spread_fractional_lanes));
+    const LaneFloat y2 = AddLanes(
+        v[2], MulLanes(SubLanes(v[3], v[2]), spread_fractional_lanes));
+    LaneFloat y = AddLanes(
+        y1, MulLanes(SubLanes(y2, y1), bias_fractional_lanes));
+    if (flip_result) {
+      y = SubLanes(one, y);
+    }
+    StoreLanes(&out[i], y);
+  }
+#endif  // MARBLES_SIMD
+  
+  for (; i < size; ++i) {
+    float u = flip_result ? 1.0f - uniform[i] : uniform[i];
+    size_t offset = 0;
+    if (u <= 0.05f) {
+      offset = kIcdfTableSize + 1;
+      u *= 20.0f;
+    } else if (u >= 0.95f) {
+      offset = 2 * (kIcdfTableSize + 1);
+      u = (u - 0.95f) * 20.0f;
+    }
+    float x1y1 = stmlib::Interpolate(x1y1_table + offset, u, kIcdfTableSize);
+    float x2y1 = stmlib::Interpolate(x2y1_table + offset, u, kIcdfTableSize);
+    float x1y2 = stmlib::Interpolate(x1y2_table + offset, u, kIcdfTableSize);
+    float x2y2 = stmlib::Interpolate(x2y2_table + offset, u, kIcdfTableSize);
+    float y1 = x1y1 + (x2y1 - x1y1) * spread_fractional;
+    float y2 = x1y2 + (x2y2 - x1y2) * spread_fractional;
+    float y = y1 + (y2 - y1) * bias_fractional;
+    out[i] = flip_result ? 1.0f - y : y;
+  }
+}
+
 // Pre-computed beta(3, 3) with a fatter tail.
 inline float FastBetaDistributionSample(float uniform) {
   return stmlib::Interpolate(dist_icdf_4_3, uniform, kIcdfTableSize);
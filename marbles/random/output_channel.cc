@@ -76,18 +76,31 @@ float OutputChannel::GenerateNewVoltage(RandomSequence* random_sequence) {
   if (register_mode_) {
     return 10.0f * (u - 0.5f) + register_transposition_;
   } else {
-    float degenerate_amount = 1.25f - spread_ * 25.0f;
-    float bernoulli_amount = spread_ * 25.0f - 23.75f;
-  
-    CONSTRAIN(degenerate_amount, 0.0f, 1.0f);
-    CONSTRAIN(bernoulli_amount, 0.0f, 1.0f);
+    float voltage;
+    GenerateVoltages(&u, &voltage, 1);
+    return voltage;
+  }
+}
 
-    float value = BetaDistributionSample(u, spread_, bias_);
-    float bernoulli_value = u >= (1.0f - bias_) ? 0.999999f : 0.0f;
+void OutputChannel::GenerateVoltages(
+    const float* uniform,
+    float* voltage,
+    size_t size) {
+  float degenerate_amount = 1.25f - spread_ * 25.0f;
+  float bernoulli_amount = spread_ * 25.0f - 23.75f;
+
+  CONSTRAIN(degenerate_amount, 0.0f, 1.0f);
+  CONSTRAIN(bernoulli_amount, 0.0f, 1.0f);
+  
+  BetaDistributionSample(uniform, spread_, bias_, voltage, size);
+  
+  for (size_t i = 0; i < size; ++i) {
+    float value = voltage[i];
+    float bernoulli_value = uniform[i] >= (1.0f - bias_) ? 0.999999f : 0.0f;
     
     value += degenerate_amount * (bias_ - value);
     value += bernoulli_amount * (bernoulli_value - value);
-    return scale_offset_(value);
+    voltage[i] = scale_offset_(value);
   }
 }
 
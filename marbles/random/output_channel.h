@@ -68,6 +68,10 @@ class OutputChannel {
       float* output,
       size_t size,
       size_t stride);
+  
+  // Converts a block of uniformly distributed samples into voltages, with the
+  // current spread and bias (the register mode is ignored).
+  void GenerateVoltages(const float* uniform, float* voltage, size_t size);
 
   inline void set_spread(float spread) {
     spread_ = spread;
@@ -0,0 +1,165 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Counter-based generator (Philox-4x32-10, Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3"). Word n of the sequence is a function of n,
+// the seed and the stream ID only: jumping ahead is free, and two generators
+// with different stream IDs produce independent sequences - one per thread,
+// for example. 4 counters are processed at a time.
+
+#ifndef MARBLES_RANDOM_PHILOX_GENERATOR_H_
+#define MARBLES_RANDOM_PHILOX_GENERATOR_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "marbles/random/block_random_generator.h"
+#include "marbles/random/simd.h"
+
+namespace marbles {
+
+const uint32_t kPhiloxMultiplier[2] = { 0xd2511f53, 0xcd9e8d57 };
+const uint32_t kPhiloxKeyIncrement[2] = { 0x9e3779b9, 0xbb67ae85 };
+const int kPhiloxNumRounds = 10;
+
+class PhiloxGenerator : public BlockRandomGenerator {
+ public:
+  PhiloxGenerator() { }
+  virtual ~PhiloxGenerator() { }
+  
+  inline void Init(uint32_t seed, uint32_t stream_id) {
+    key_[0] = seed;
+    key_[1] = stream_id;
+    position_ = 0;
+  }
+  
+  virtual void Fill(uint32_t* words, size_t size) {
+    uint32_t block[4];
+    
+    // Leading words, up to the next block boundary.
+    if (size && (position_ & 3)) {
+      Generate(position_ >> 2, block);
+      while (size && (position_ & 3)) {
+        *words++ = block[position_ & 3];
+        ++position_;
+        --size;
+      }
+    }
+    
+    while (size >= 4 * kNumLanes) {
+      GenerateLanes(position_ >> 2, words);
+      words += 4 * kNumLanes;
+      position_ += 4 * kNumLanes;
+      size -= 4 * kNumLanes;
+    }
+    
+    while (size) {
+      Generate(position_ >> 2, block);
+      size_t n = std::min(size, size_t(4));
+      std::copy(&block[0], &block[n], words);
+      words += n;
+      position_ += n;
+      size -= n;
+    }
+  }
+  
+  virtual void Jump(uint64_t num_words) {
+    position_ += num_words;
+  }
+  
+  inline uint64_t position() const { return position_; }
+  
+  // Generates the 4 words of a given counter value.
+  inline void Generate(uint64_t counter, uint32_t* block) const {
+    uint32_t c[4] = { uint32_t(counter), uint32_t(counter >> 32), 0, 0 };
+    uint32_t k[2] = { key_[0], key_[1] };
+    for (int round = 0; round < kPhiloxNumRounds; ++round) {
+      if (round) {
+        k[0] += kPhiloxKeyIncrement[0];
+        k[1] += kPhiloxKeyIncrement[1];
+      }
+      uint64_t p0 = uint64_t(kPhiloxMultiplier[0]) * c[0];
+      uint64_t p1 = uint64_t(kPhiloxMultiplier[1]) * c[2];
+      c[0] = uint32_t(p1 >> 32) ^ c[1] ^ k[0];
+      c[1] = uint32_t(p1);
+      c[2] = uint32_t(p0 >> 32) ^ c[3] ^ k[1];
+      c[3] = uint32_t(p0);
+    }
+    std::copy(&c[0], &c[4], block);
+  }
+  
+ private:
+  // Generates the words of kNumLanes consecutive counter values.
+  inline void GenerateLanes(uint64_t counter, uint32_t* words) const {
+    int32_t counter_low[kNumLanes];
+    int32_t counter_high[kNumLanes];
+    for (size_t i = 0; i < kNumLanes; ++i) {
+      counter_low[i] = int32_t(uint32_t(counter + i));
+      counter_high[i] = int32_t(uint32_t((counter + i) >> 32));
+    }
+    
+    LaneInt c[4] = {
+      LoadLanes(counter_low),
+      LoadLanes(counter_high),
+      SplatLanes(int32_t(0)),
+      SplatLanes(int32_t(0))
+    };
+    uint32_t k[2] = { key_[0], key_[1] };
+    for (int round = 0; round < kPhiloxNumRounds; ++round) {
+      if (round) {
+        k[0] += kPhiloxKeyIncrement[0];
+        k[1] += kPhiloxKeyIncrement[1];
+      }
+      LaneInt hi0, lo0, hi1, lo1;
+      MulWideLanes(c[0], kPhiloxMultiplier[0], &hi0, &lo0);
+      MulWideLanes(c[2], kPhiloxMultiplier[1], &hi1, &lo1);
+      c[0] = XorLanes(XorLanes(hi1, c[1]), SplatLanes(int32_t(k[0])));
+      c[1] = lo1;
+      c[2] = XorLanes(XorLanes(hi0, c[3]), SplatLanes(int32_t(k[1])));
+      c[3] = lo0;
+    }
+    
+    int32_t lanes[4][kNumLanes];
+    for (size_t i = 0; i < 4; ++i) {
+      StoreLanes(lanes[i], c[i]);
+    }
+    for (size_t i = 0; i < kNumLanes; ++i) {
+      for (size_t j = 0; j < 4; ++j) {
+        *words++ = uint32_t(lanes[j][i]);
+      }
+    }
+  }
+  
+  uint32_t key_[2];
+  uint64_t position_;
+  
+  DISALLOW_COPY_AND_ASSIGN(PhiloxGenerator);
+};
+
+}  // namespace marbles
+
+#endif  // MARBLES_RANDOM_PHILOX_GENERATOR_H_
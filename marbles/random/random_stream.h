@@ -26,6 +26,10 @@
 //
 // Stream of random values, filled from a hardware RNG, with a fallback
 // mechanism.
+//
+// Hosts can define MARBLES_BLOCK_RANDOM to read the values from a block
+// generator instead. The firmware doesn't, and keeps the stream as small and
+// as fast as it was.
 
 #ifndef MARBLES_RANDOM_RANDOM_STREAM_H_
 #define MARBLES_RANDOM_RANDOM_STREAM_H_
@@ -34,10 +38,17 @@
 
 #include "stmlib/utils/ring_buffer.h"
 
+#ifdef MARBLES_BLOCK_RANDOM
+#include "marbles/random/block_random_generator.h"
+#endif  // MARBLES_BLOCK_RANDOM
 #include "marbles/random/random_generator.h"
 
 namespace marbles {
 
+#ifdef MARBLES_BLOCK_RANDOM
+const size_t kRandomStreamBlockSize = 64;
+#endif  // MARBLES_BLOCK_RANDOM
+
 class RandomStream {
  public:
   RandomStream() { }
@@ -45,10 +56,30 @@ class RandomStream {
   
   inline void Init(RandomGenerator* fallback_generator) {
     fallback_generator_ = fallback_generator;
+#ifdef MARBLES_BLOCK_RANDOM
+    block_generator_ = NULL;
+#endif  // MARBLES_BLOCK_RANDOM
+    buffer_.Init();
+  }
+  
+#ifdef MARBLES_BLOCK_RANDOM
+  // Reads all values from a block generator instead. The values written to
+  // the stream are ignored, so that the sequence only depends on the state of
+  // the generator.
+  inline void Init(BlockRandomGenerator* block_generator) {
+    fallback_generator_ = NULL;
+    block_generator_ = block_generator;
+    block_position_ = kRandomStreamBlockSize;
     buffer_.Init();
   }
+#endif  // MARBLES_BLOCK_RANDOM
 
   inline void Write(uint32_t value) {
+#ifdef MARBLES_BLOCK_RANDOM
+    if (block_generator_) {
+      return;
+    }
+#endif  // MARBLES_BLOCK_RANDOM
     // buffer_.Swallow(1);
     // buffer_.Overwrite(value);
     if (buffer_.writable()) {
@@ -58,6 +89,15 @@ class RandomStream {
   }
   
   inline uint32_t GetWord() {
+#ifdef MARBLES_BLOCK_RANDOM
+    if (block_generator_) {
+      if (block_position_ == kRandomStreamBlockSize) {
+        block_generator_->Fill(block_, kRandomStreamBlockSize);
+        block_position_ = 0;
+      }
+      return block_[block_position_++];
+    }
+#endif  // MARBLES_BLOCK_RANDOM
     if (buffer_.readable()) {
       return buffer_.ImmediateRead();
     } else {
@@ -74,6 +114,12 @@ class RandomStream {
   stmlib::RingBuffer<uint32_t, 128> buffer_;
   RandomGenerator* fallback_generator_;
   
+#ifdef MARBLES_BLOCK_RANDOM
+  BlockRandomGenerator* block_generator_;
+  uint32_t block_[kRandomStreamBlockSize];
+  size_t block_position_;
+#endif  // MARBLES_BLOCK_RANDOM
+  
   DISALLOW_COPY_AND_ASSIGN(RandomStream);
 };
 
@@ -0,0 +1,326 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// 4-lane float and int operations, mapped to SSE2 or NEON when available.
+// The scalar fallback produces the same results as the vector versions.
+//
+// There are no gather instructions in SSE2 or NEON: table lookups are done by
+// storing the indices of the 4 lanes and loading the values one by one.
+//
+// MARBLES_SIMD is defined when the lanes map to actual vector registers.
+
+#ifndef MARBLES_RANDOM_SIMD_H_
+#define MARBLES_RANDOM_SIMD_H_
+
+#include "stmlib/stmlib.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MARBLES_SIMD
+#endif
+
+namespace marbles {
+
+const size_t kNumLanes = 4;
+
+#if defined(__SSE2__)
+
+typedef __m128 LaneFloat;
+typedef __m128i LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return _mm_loadu_ps(p);
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  _mm_storeu_ps(p, x);
+}
+
+inline void StoreLanes(int32_t* p, LaneInt x) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return _mm_set1_ps(x);
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  return _mm_set1_epi32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return _mm_add_ps(a, b);
+}
+
+inline LaneInt AddLanes(LaneInt a, LaneInt b) {
+  return _mm_add_epi32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return _mm_sub_ps(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return _mm_mul_ps(a, b);
+}
+
+// Returns x in the lanes in which the mask is not set, 0 elsewhere.
+inline LaneInt AndNotLanes(LaneInt mask, LaneInt x) {
+  return _mm_andnot_si128(mask, x);
+}
+
+inline LaneInt XorLanes(LaneInt a, LaneInt b) {
+  return _mm_xor_si128(a, b);
+}
+
+// Unsigned 32x32 -> 64-bit product of each lane by m.
+inline void MulWideLanes(LaneInt a, uint32_t m, LaneInt* hi, LaneInt* lo) {
+  const __m128i m_lanes = _mm_set1_epi32(m);
+  const __m128i even = _mm_mul_epu32(a, m_lanes);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m_lanes);
+  *lo = _mm_unpacklo_epi32(
+      _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+  *hi = _mm_unpacklo_epi32(
+      _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return _mm_cvttps_epi32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return _mm_cvtepi32_ps(x);
+}
+
+// All bits are set in the lanes in which a > b.
+inline LaneInt GreaterLanes(LaneFloat a, LaneFloat b) {
+  return _mm_castps_si128(_mm_cmpgt_ps(a, b));
+}
+
+inline LaneFloat SelectLanes(LaneInt mask, LaneFloat a, LaneFloat b) {
+  __m128 m = _mm_castsi128_ps(mask);
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+typedef float32x4_t LaneFloat;
+typedef int32x4_t LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return vld1q_f32(p);
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  return vld1q_s32(p);
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  vst1q_f32(p, x);
+}
+
+inline void StoreLanes(int32_t* p, LaneInt x) {
+  vst1q_s32(p, x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return vdupq_n_f32(x);
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  return vdupq_n_s32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return vaddq_f32(a, b);
+}
+
+inline LaneInt AddLanes(LaneInt a, LaneInt b) {
+  return vaddq_s32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return vsubq_f32(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return vmulq_f32(a, b);
+}
+
+inline LaneInt AndNotLanes(LaneInt mask, LaneInt x) {
+  return vbicq_s32(x, mask);
+}
+
+inline LaneInt XorLanes(LaneInt a, LaneInt b) {
+  return veorq_s32(a, b);
+}
+
+inline void MulWideLanes(LaneInt a, uint32_t m, LaneInt* hi, LaneInt* lo) {
+  const uint32x4_t u = vreinterpretq_u32_s32(a);
+  const uint32x2_t m_lanes = vdup_n_u32(m);
+  const uint64x2_t low_half = vmull_u32(vget_low_u32(u), m_lanes);
+  const uint64x2_t high_half = vmull_u32(vget_high_u32(u), m_lanes);
+  const uint32x4x2_t products = vuzpq_u32(
+      vreinterpretq_u32_u64(low_half),
+      vreinterpretq_u32_u64(high_half));
+  *lo = vreinterpretq_s32_u32(products.val[0]);
+  *hi = vreinterpretq_s32_u32(products.val[1]);
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return vcvtq_s32_f32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return vcvtq_f32_s32(x);
+}
+
+inline LaneInt GreaterLanes(LaneFloat a, LaneFloat b) {
+  return vreinterpretq_s32_u32(vcgtq_f32(a, b));
+}
+
+inline LaneFloat SelectLanes(LaneInt mask, LaneFloat a, LaneFloat b) {
+  return vbslq_f32(vreinterpretq_u32_s32(mask), a, b);
+}
+
+#else
+
+struct LaneFloat {
+  float x[kNumLanes];
+};
+
+struct LaneInt {
+  int32_t x[kNumLanes];
+};
+
+#define MARBLES_LANE_LOOP(type, expression) \
+  type r; \
+  for (size_t i = 0; i < kNumLanes; ++i) { \
+    r.x[i] = expression; \
+  } \
+  return r;
+
+inline LaneFloat LoadLanes(const float* p) {
+  MARBLES_LANE_LOOP(LaneFloat, p[i])
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  MARBLES_LANE_LOOP(LaneInt, p[i])
+}
+
+inline void StoreLanes(float* p, const LaneFloat& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    p[i] = x.x[i];
+  }
+}
+
+inline void StoreLanes(int32_t* p, const LaneInt& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    p[i] = x.x[i];
+  }
+}
+
+inline LaneFloat SplatLanes(float x) {
+  MARBLES_LANE_LOOP(LaneFloat, x)
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  MARBLES_LANE_LOOP(LaneInt, x)
+}
+
+inline LaneFloat AddLanes(const LaneFloat& a, const LaneFloat& b) {
+  MARBLES_LANE_LOOP(LaneFloat, a.x[i] + b.x[i])
+}
+
+inline LaneInt AddLanes(const LaneInt& a, const LaneInt& b) {
+  MARBLES_LANE_LOOP(LaneInt, int32_t(uint32_t(a.x[i]) + uint32_t(b.x[i])))
+}
+
+inline LaneFloat SubLanes(const LaneFloat& a, const LaneFloat& b) {
+  MARBLES_LANE_LOOP(LaneFloat, a.x[i] - b.x[i])
+}
+
+inline LaneFloat MulLanes(const LaneFloat& a, const LaneFloat& b) {
+  MARBLES_LANE_LOOP(LaneFloat, a.x[i] * b.x[i])
+}
+
+inline LaneInt AndNotLanes(const LaneInt& mask, const LaneInt& x) {
+  MARBLES_LANE_LOOP(LaneInt, ~mask.x[i] & x.x[i])
+}
+
+inline LaneInt XorLanes(const LaneInt& a, const LaneInt& b) {
+  MARBLES_LANE_LOOP(LaneInt, a.x[i] ^ b.x[i])
+}
+
+inline void MulWideLanes(
+    const LaneInt& a,
+    uint32_t m,
+    LaneInt* hi,
+    LaneInt* lo) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    uint64_t product = uint64_t(uint32_t(a.x[i])) * m;
+    hi->x[i] = int32_t(uint32_t(product >> 32));
+    lo->x[i] = int32_t(uint32_t(product));
+  }
+}
+
+inline LaneInt TruncateLanes(const LaneFloat& x) {
+  MARBLES_LANE_LOOP(LaneInt, static_cast<int32_t>(x.x[i]))
+}
+
+inline LaneFloat ConvertLanes(const LaneInt& x) {
+  MARBLES_LANE_LOOP(LaneFloat, static_cast<float>(x.x[i]))
+}
+
+inline LaneInt GreaterLanes(const LaneFloat& a, const LaneFloat& b) {
+  MARBLES_LANE_LOOP(LaneInt, a.x[i] > b.x[i] ? -1 : 0)
+}
+
+inline LaneFloat SelectLanes(
+    const LaneInt& mask,
+    const LaneFloat& a,
+    const LaneFloat& b) {
+  MARBLES_LANE_LOOP(LaneFloat, mask.x[i] ? a.x[i] : b.x[i])
+}
+
+#undef MARBLES_LANE_LOOP
+
+#endif
+
+}  // namespace marbles
+
+#endif  // MARBLES_RANDOM_SIMD_H_
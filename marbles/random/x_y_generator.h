@@ -128,6 +128,16 @@ class XYGenerator {
     }
   }
   
+  // Converts a block of uniformly distributed samples into voltages, with
+  // the distribution settings of the given channel.
+  void GenerateVoltages(
+      int channel,
+      const float* uniform,
+      float* voltage,
+      size_t size) {
+    output_channel_[channel].GenerateVoltages(uniform, voltage, size);
+  }
+  
  private:
   RandomSequence random_sequence_[kNumChannels];
   OutputChannel output_channel_[kNumChannels];
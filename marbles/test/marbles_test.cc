@@ -13,12 +13,17 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <cassert>
+#include <ctime>
+#include <vector>
+
 #include "marbles/cv_reader_channel.h"
 #include "marbles/note_filter.h"
 #include "marbles/ramp/ramp_divider.h"
 #include "marbles/ramp/ramp_extractor.h"
 #include "marbles/random/distributions.h"
 #include "marbles/random/output_channel.h"
+#include "marbles/random/philox_generator.h"
 #include "marbles/random/random_generator.h"
 #include "marbles/random/random_sequence.h"
 #include "marbles/random/random_stream.h"
@@ -67,6 +72,169 @@ void TestBetaDistribution() {
   fclose(fp);
 }
 
+void TestBetaDistributionBlock() {
+  const size_t kNumSamples = 1 << 16;
+  const int kNumRepetitions = 8;
+  
+  vector<float> uniform(kNumSamples);
+  vector<float> scalar(kNumSamples);
+  vector<float> block(kNumSamples);
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    uniform[i] = Random::GetFloat();
+  }
+  // Boundaries of the tail tables.
+  uniform[0] = 0.0f;
+  uniform[1] = 0.05f;
+  uniform[2] = 0.95f;
+  uniform[3] = 1.0f - 1.0f / 65536.0f;
+  
+  double scalar_time = 0.0;
+  double block_time = 0.0;
+  size_t num_errors = 0;
+  for (int i = 0; i < 9; ++i) {
+    for (int j = 0; j < 13; ++j) {
+      float bias = float(i) / 8.0f;
+      float spread = float(j) / 12.0f;
+      
+      clock_t start = clock();
+      for (int n = 0; n < kNumRepetitions; ++n) {
+        for (size_t k = 0; k < kNumSamples; ++k) {
+          scalar[k] = BetaDistributionSample(uniform[k], spread, bias);
+        }
+      }
+      scalar_time += double(clock() - start);
+      
+      start = clock();
+      for (int n = 0; n < kNumRepetitions; ++n) {
+        // Odd size to exercise the leftover samples.
+        BetaDistributionSample(
+            &uniform[0], spread, bias, &block[0], kNumSamples - 3);
+        BetaDistributionSample(
+            &uniform[kNumSamples - 3], spread, bias,
+            &block[kNumSamples - 3], 3);
+      }
+      block_time += double(clock() - start);
+      
+      for (size_t k = 0; k < kNumSamples; ++k) {
+        if (scalar[k] != block[k]) {
+          ++num_errors;
+        }
+      }
+    }
+  }
+  
+  double num_samples = 9.0 * 13.0 * kNumSamples * kNumRepetitions;
+  printf("Beta distribution: scalar %.1f Msamples/s, block %.1f Msamples/s\n",
+         num_samples / (scalar_time / CLOCKS_PER_SEC) * 1e-6,
+         num_samples / (block_time / CLOCKS_PER_SEC) * 1e-6);
+  printf("Beta distribution: %d mismatches\n", int(num_errors));
+  assert(num_errors == 0);
+}
+
+// Renders 10s of gates with a given stream of random values.
+void RenderTGeneratorGates(RandomStream* random_stream, vector<char>* gates) {
+  TGenerator generator;
+  generator.Init(random_stream, kSampleRate);
+  generator.set_model(T_GENERATOR_MODEL_COMPLEMENTARY_BERNOULLI);
+  generator.set_rate(0.0f);
+  generator.set_bias(0.3f);
+  generator.set_jitter(0.5f);
+  generator.set_deja_vu(0.25f);
+  generator.set_length(8);
+  
+  ClockGeneratorPatterns patterns(FRIENDLY_PATTERNS);
+  MasterSlaveRampGenerator ms_ramp_generator;
+  Ramps ramps = ms_ramp_generator.ramps();
+  
+  gates->clear();
+  for (size_t i = 0; i < ::kSampleRate * 10; i += kAudioBlockSize) {
+    bool gate[kAudioBlockSize * 2];
+    patterns.Render(kAudioBlockSize);
+    generator.Process(false, patterns.clock(), ramps, gate, kAudioBlockSize);
+    gates->insert(gates->end(), &gate[0], &gate[kAudioBlockSize * 2]);
+  }
+}
+
+void TestPhiloxGenerator() {
+  PhiloxGenerator philox;
+  
+  // Known answer for a null counter and key.
+  uint32_t block[4];
+  philox.Init(0, 0);
+  philox.Generate(0, block);
+  assert(block[0] == 0x6627e8d5 && block[1] == 0xe169c58d);
+  assert(block[2] == 0xbc57ac4c && block[3] == 0x9b00dbd8);
+  
+  // The sequence does not depend on how it is split into blocks, and the
+  // vectorized path matches the scalar one - including when the low word of
+  // the counter overflows.
+  const size_t kNumWords = 4096;
+  const uint64_t kStart = (uint64_t(1) << 34) - 1000;
+  vector<uint32_t> reference(kNumWords);
+  vector<uint32_t> words(kNumWords);
+  philox.Init(1, 2);
+  for (size_t i = 0; i < kNumWords; i += 4) {
+    philox.Generate((kStart + i) / 4, &reference[i]);
+  }
+  for (size_t chunk = 1; chunk <= 37; chunk += 6) {
+    philox.Init(1, 2);
+    philox.Jump(kStart);
+    for (size_t i = 0; i < kNumWords; i += chunk) {
+      philox.Fill(&words[i], min(chunk, kNumWords - i));
+    }
+    assert(words == reference);
+  }
+  philox.Init(1, 2);
+  philox.Jump(kStart + 3);
+  philox.Fill(&words[0], kNumWords - 3);
+  assert(equal(&words[0], &words[kNumWords - 3], &reference[3]));
+  
+  // A given stream ID reproduces the same musical output, other stream IDs
+  // give different outputs.
+  vector<char> gates[3];
+  const uint32_t stream_ids[3] = { 42, 42, 43 };
+  for (int i = 0; i < 3; ++i) {
+    PhiloxGenerator generator;
+    RandomStream random_stream;
+    generator.Init(0x1234, stream_ids[i]);
+    random_stream.Init(&generator);
+    RenderTGeneratorGates(&random_stream, &gates[i]);
+  }
+  assert(gates[0] == gates[1]);
+  assert(gates[0] != gates[2]);
+  
+  // Throughput.
+  const size_t kBlockSize = 256;
+  const int kNumBlocks = 200000;
+  uint32_t buffer[kBlockSize];
+  uint32_t checksum = 0;
+  
+  RandomGenerator lcg;
+  lcg.Init(1);
+  clock_t start = clock();
+  for (int n = 0; n < kNumBlocks; ++n) {
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      buffer[i] = lcg.GetWord();
+    }
+    checksum ^= buffer[n % kBlockSize];
+  }
+  double lcg_time = double(clock() - start) / CLOCKS_PER_SEC;
+  
+  philox.Init(1, 0);
+  start = clock();
+  for (int n = 0; n < kNumBlocks; ++n) {
+    philox.Fill(buffer, kBlockSize);
+    checksum ^= buffer[n % kBlockSize];
+  }
+  double philox_time = double(clock() - start) / CLOCKS_PER_SEC;
+  
+  double num_words = double(kNumBlocks) * kBlockSize;
+  printf("RNG: LCG %.0f Mwords/s, Philox %.0f Mwords/s (%08x)\n",
+         num_words / lcg_time * 1e-6,
+         num_words / philox_time * 1e-6,
+         checksum);
+}
+
 void TestQuantizer() {
   // Plot result with:
   // import numpy
@@ -1106,6 +1274,8 @@ void TestClockSourceChange() {
 int main(void) {
   // Test distributions and value processors.
   // TestBetaDistribution();
+  TestBetaDistributionBlock();
+  TestPhiloxGenerator();
   // TestQuantizer();
   // TestQuantizerNoise();
 
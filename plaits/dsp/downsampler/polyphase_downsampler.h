@@ -0,0 +1,218 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+//
+// Polyphase FIR decimator. The engine renders a whole block at factor times
+// the sample rate into a scratch buffer, and the block is decimated in one
+// pass.
+
+#ifndef PLAITS_DSP_DOWNSAMPLER_POLYPHASE_DOWNSAMPLER_H_
+#define PLAITS_DSP_DOWNSAMPLER_POLYPHASE_DOWNSAMPLER_H_
+
+#include <algorithm>
+
+#include "stmlib/stmlib.h"
+
+#include "plaits/dsp/simd.h"
+#include "plaits/resources.h"
+
+namespace plaits {
+
+// The filters are symmetric, only the first half of the coefficients is
+// stored in the resources.
+template<size_t factor>
+struct DownsamplerFir { };
+
+template<>
+struct DownsamplerFir<2> {
+  enum { kNumTaps = 2 * LUT_2X_DOWNSAMPLER_FIR_SIZE };
+  static inline const float* half() { return lut_2x_downsampler_fir; }
+};
+
+template<>
+struct DownsamplerFir<4> {
+  enum { kNumTaps = 2 * LUT_4X_DOWNSAMPLER_FIR_SIZE };
+  static inline const float* half() { return lut_4x_downsampler_fir; }
+};
+
+template<>
+struct DownsamplerFir<8> {
+  enum { kNumTaps = 2 * LUT_8X_DOWNSAMPLER_FIR_SIZE };
+  static inline const float* half() { return lut_8x_downsampler_fir; }
+};
+
+#ifdef PLAITS_SIMD
+
+// Lane-wise products of the N samples in x with the N coefficients in h,
+// summed over groups of kNumLanes.
+template<size_t N, size_t i = 0>
+struct LaneDotProduct {
+  inline LaneFloat operator()(const float* x, const float* h) const {
+    LaneDotProduct<N, i + kNumLanes> p;
+    return AddLanes(MulLanes(LoadLanes(&x[i]), LoadLanes(&h[i])), p(x, h));
+  }
+};
+
+template<size_t N>
+struct LaneDotProduct<N, N> {
+  inline LaneFloat operator()(const float* x, const float* h) const {
+    return SplatLanes(0.0f);
+  }
+};
+
+#endif  // PLAITS_SIMD
+
+template<size_t factor>
+class PolyphaseDownsampler {
+ public:
+  enum {
+    kFactor = factor,
+    kNumTaps = DownsamplerFir<factor>::kNumTaps,
+    kHistorySize = kNumTaps - factor
+  };
+
+  PolyphaseDownsampler() { }
+  ~PolyphaseDownsampler() { }
+
+  void Init() {
+    STATIC_ASSERT(kNumTaps % kNumLanes == 0, taps_not_multiple_of_lanes);
+    STATIC_ASSERT(kNumTaps % factor == 0, taps_not_multiple_of_factor);
+    const float* half = DownsamplerFir<factor>::half();
+    for (size_t i = 0; i < kNumTaps / 2; ++i) {
+      h_[i] = h_[kNumTaps - 1 - i] = half[i];
+    }
+    std::fill(&history_[0], &history_[kHistorySize], 0.0f);
+  }
+
+  // Decimates the size * factor samples of in into size samples. Each output
+  // sample is aligned with the last input sample of its group of factor
+  // samples.
+  inline void Process(const float* in, float* out, size_t size) {
+#ifdef PLAITS_SIMD
+    ProcessLanes(in, out, size);
+#else
+    ProcessScalar(in, out, size);
+#endif  // PLAITS_SIMD
+  }
+
+#ifdef PLAITS_SIMD
+  // Output samples are computed kNumLanes at a time, with the lanes running
+  // over the taps of the filter. Only differs from ProcessScalar by the order
+  // in which the products are summed.
+  inline void ProcessLanes(const float* in, float* out, size_t size) {
+    float prologue[kHistorySize + kNumTaps];
+    const size_t prologue_size = LoadPrologue(in, size, prologue);
+
+    const size_t num_vectors = size / kNumLanes;
+    for (size_t v = 0; v < num_vectors; ++v) {
+      const size_t i = v * kNumLanes;
+      LaneFloat y_0 = Convolve(window(prologue, in, i));
+      LaneFloat y_1 = Convolve(window(prologue, in, i + 1));
+      LaneFloat y_2 = Convolve(window(prologue, in, i + 2));
+      LaneFloat y_3 = Convolve(window(prologue, in, i + 3));
+      StoreLanes(&out[i], SumLanes(y_0, y_1, y_2, y_3));
+    }
+    for (size_t i = num_vectors * kNumLanes; i < size; ++i) {
+      out[i] = Dot(window(prologue, in, i));
+    }
+
+    SaveHistory(in, size, prologue, prologue_size);
+  }
+#endif  // PLAITS_SIMD
+
+  inline void ProcessScalar(const float* in, float* out, size_t size) {
+    float prologue[kHistorySize + kNumTaps];
+    const size_t prologue_size = LoadPrologue(in, size, prologue);
+    for (size_t i = 0; i < size; ++i) {
+      out[i] = Dot(window(prologue, in, i));
+    }
+    SaveHistory(in, size, prologue, prologue_size);
+  }
+
+ private:
+  // The history followed by the first input samples, for the outputs whose
+  // taps straddle the beginning of the block.
+  inline size_t LoadPrologue(
+      const float* in,
+      size_t size,
+      float* prologue) const {
+    const size_t prologue_size = std::min(size * factor, size_t(kNumTaps));
+    std::copy(&history_[0], &history_[kHistorySize], &prologue[0]);
+    std::copy(&in[0], &in[prologue_size], &prologue[kHistorySize]);
+    return prologue_size;
+  }
+
+  inline void SaveHistory(
+      const float* in,
+      size_t size,
+      const float* prologue,
+      size_t prologue_size) {
+    const size_t input_size = size * factor;
+    if (input_size >= size_t(kHistorySize)) {
+      std::copy(&in[input_size - kHistorySize], &in[input_size], &history_[0]);
+    } else {
+      std::copy(
+          &prologue[input_size],
+          &prologue[input_size + kHistorySize],
+          &history_[0]);
+    }
+  }
+
+  // The kNumTaps input samples, oldest first, from which output i is
+  // computed.
+  static inline const float* window(
+      const float* prologue,
+      const float* in,
+      size_t i) {
+    return i * factor < size_t(kHistorySize)
+        ? &prologue[i * factor]
+        : &in[i * factor - kHistorySize];
+  }
+
+  inline float Dot(const float* x) const {
+    float y = 0.0f;
+    for (size_t i = 0; i < kNumTaps; ++i) {
+      y += x[i] * h_[i];
+    }
+    return y;
+  }
+
+#ifdef PLAITS_SIMD
+  inline LaneFloat Convolve(const float* x) const {
+    LaneDotProduct<kNumTaps> p;
+    return p(x, h_);
+  }
+#endif  // PLAITS_SIMD
+
+  float h_[kNumTaps];
+  float history_[kHistorySize];
+
+  DISALLOW_COPY_AND_ASSIGN(PolyphaseDownsampler);
+};
+
+}  // namespace plaits
+
+#endif  // PLAITS_DSP_DOWNSAMPLER_POLYPHASE_DOWNSAMPLER_H_
@@ -37,10 +37,10 @@
 #include "stmlib/dsp/filter.h"
 #include "stmlib/dsp/parameter_interpolator.h"
 #include "stmlib/dsp/units.h"
-#include "stmlib/utils/random.h"
 
 #include "plaits/dsp/dsp.h"
 #include "plaits/dsp/oscillator/oscillator.h"
+#include "plaits/dsp/random.h"
 
 namespace plaits {
 
@@ -225,7 +225,7 @@ class HiHat {
       noise_clock_ += noise_f;
       if (noise_clock_ >= 1.0f) {
         noise_clock_ -= 1.0f;
-        noise_sample_ = stmlib::Random::GetFloat() - 0.5f;
+        noise_sample_ = Random::GetFloat() - 0.5f;
       }
       out[i] += noisiness * (noise_sample_ - out[i]);
     }
@@ -32,10 +32,10 @@
 
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/units.h"
-#include "stmlib/utils/random.h"
 
 #include "plaits/dsp/dsp.h"
 #include "plaits/dsp/oscillator/sine_oscillator.h"
+#include "plaits/dsp/random.h"
 
 namespace plaits {
 
@@ -76,7 +76,7 @@ class SyntheticBassDrumAttackNoise {
   }
   
   float Render() {
-    float sample = stmlib::Random::GetFloat();
+    float sample = Random::GetFloat();
     ONE_POLE(lp_, sample, 0.05f);
     ONE_POLE(hp_, lp_, 0.005f);
     return lp_ - hp_;
@@ -169,7 +169,7 @@ class SyntheticBassDrum {
         size);
     
     while (size--) {
-      ONE_POLE(phase_noise_, stmlib::Random::GetFloat() - 0.5f, 0.002f);
+      ONE_POLE(phase_noise_, Random::GetFloat() - 0.5f, 0.002f);
       
       float mix = 0.0f;
 
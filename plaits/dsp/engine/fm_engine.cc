@@ -31,7 +31,6 @@
 #include "stmlib/dsp/parameter_interpolator.h"
 
 #include "plaits/dsp/oscillator/sine_oscillator.h"
-#include "plaits/dsp/downsampler/4x_downsampler.h"
 
 namespace plaits {
 
@@ -47,6 +46,11 @@ void FMEngine::Init(BufferAllocator* allocator) {
   previous_amount_ = 0.0f;
   previous_feedback_ = 0.0f;
   previous_sample_ = 0.0f;
+  
+  carrier_downsampler_.Init();
+  sub_downsampler_.Init();
+  
+  temp_buffer_ = allocator->Allocate<float>(kMaxBlockSize * kOversampling * 2);
 }
 
 void FMEngine::Reset() {
@@ -60,8 +64,7 @@ void FMEngine::Render(
     size_t size,
     bool* already_enveloped) {
   
-  // 4x oversampling
-  const float note = parameters.note - 24.0f;
+  const float note = parameters.note - 12.0f * kOversamplingOctaves;
   
   const float ratio = Interpolate(
       lut_fm_frequency_quantizer,
@@ -73,7 +76,7 @@ void FMEngine::Render(
   CONSTRAIN(target_modulator_frequency, 0.0f, 0.5f);
 
   // Reduce the maximum FM index for high pitched notes, to prevent aliasing.
-  float hf_taming = 1.0f - (modulator_note - 72.0f) * 0.025f;
+  float hf_taming = 1.0f - (parameters.note + ratio - 96.0f) * 0.025f;
   CONSTRAIN(hf_taming, 0.0f, 1.0f);
   hf_taming *= hf_taming;
   
@@ -88,10 +91,10 @@ void FMEngine::Render(
   ParameterInterpolator feedback_modulation(
       &previous_feedback_, 2.0f * parameters.morph - 1.0f, size);
   
-  Downsampler carrier_downsampler(&carrier_fir_);
-  Downsampler sub_downsampler(&sub_fir_);
+  float* carrier_buffer = &temp_buffer_[0];
+  float* sub_buffer = &temp_buffer_[size * kOversampling];
   
-  while (size--) {
+  for (size_t i = 0; i < size * kOversampling; i += kOversampling) {
     const float max_uint32 = 4294967296.0f;
     const float amount = amount_modulation.Next();
     const float feedback = feedback_modulation.Next();
@@ -111,13 +114,13 @@ void FMEngine::Render(
       float carrier = SinePM(carrier_phase_, amount * modulator);
       float sub = SinePM(sub_phase_, amount * carrier * 0.25f);
       ONE_POLE(previous_sample_, carrier, 0.05f);
-      carrier_downsampler.Accumulate(j, carrier);
-      sub_downsampler.Accumulate(j, sub);
+      carrier_buffer[i + j] = carrier;
+      sub_buffer[i + j] = sub;
     }
-    
-    *out++ = carrier_downsampler.Read();
-    *aux++ = sub_downsampler.Read();
   }
+  
+  carrier_downsampler_.Process(carrier_buffer, out, size);
+  sub_downsampler_.Process(sub_buffer, aux, size);
 }
 
 }  // namespace plaits
@@ -29,6 +29,7 @@
 #ifndef PLAITS_DSP_ENGINE_FM_ENGINE_H_
 #define PLAITS_DSP_ENGINE_FM_ENGINE_H_
 
+#include "plaits/dsp/downsampler/polyphase_downsampler.h"
 #include "plaits/dsp/engine/engine.h"
 
 namespace plaits {
@@ -48,6 +49,10 @@ class FMEngine : public Engine {
       bool* already_enveloped);
   
  private:
+  // The operators run at 2x, 4x or 8x the sample rate.
+  static const int kOversamplingOctaves = 2;
+  static const size_t kOversampling = 1 << kOversamplingOctaves;
+
   uint32_t carrier_phase_;
   uint32_t modulator_phase_;
   uint32_t sub_phase_;
@@ -58,8 +63,10 @@ class FMEngine : public Engine {
   float previous_feedback_;
   float previous_sample_;
   
-  float sub_fir_;
-  float carrier_fir_;
+  PolyphaseDownsampler<kOversampling> carrier_downsampler_;
+  PolyphaseDownsampler<kOversampling> sub_downsampler_;
+  
+  float* temp_buffer_;
   
   DISALLOW_COPY_AND_ASSIGN(FMEngine);
 };
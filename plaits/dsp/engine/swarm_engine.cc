@@ -36,10 +36,17 @@ using namespace std;
 using namespace stmlib;
 
 void SwarmEngine::Init(BufferAllocator* allocator) {
+#ifdef PLAITS_SIMD
+  swarm_ = allocator->Allocate<SwarmLanes<kNumSwarmVoices> >(1);
+  use_lanes_ = true;
+#endif  // PLAITS_SIMD
   swarm_voice_ = allocator->Allocate<SwarmVoice>(kNumSwarmVoices);
 }
 
 void SwarmEngine::Reset() {
+#ifdef PLAITS_SIMD
+  swarm_->Init();
+#endif  // PLAITS_SIMD
   const float n = (kNumSwarmVoices - 1) / 2;
   for (int i = 0; i < kNumSwarmVoices; ++i) {
     float rank = (static_cast<float>(i) - n) / n;
@@ -65,6 +72,22 @@ void SwarmEngine::Render(
   const bool burst_mode = !(parameters.trigger & TRIGGER_UNPATCHED);
   const bool start_burst = parameters.trigger & TRIGGER_RISING_EDGE;
 
+#ifdef PLAITS_SIMD
+  if (use_lanes_) {
+    swarm_->Render(
+        f0,
+        density,
+        burst_mode,
+        start_burst,
+        spread,
+        size_ratio,
+        out,
+        aux,
+        size);
+    return;
+  }
+#endif  // PLAITS_SIMD
+
   fill(&out[0], &out[size], 0.0f);
   fill(&aux[0], &aux[size], 0.0f);
   
@@ -31,12 +31,13 @@
 
 #include "stmlib/dsp/polyblep.h"
 #include "stmlib/dsp/units.h"
-#include "stmlib/utils/random.h"
 
 #include "plaits/dsp/engine/engine.h"
 #include "plaits/dsp/oscillator/oscillator.h"
 #include "plaits/dsp/oscillator/string_synth_oscillator.h"
 #include "plaits/dsp/oscillator/sine_oscillator.h"
+#include "plaits/dsp/random.h"
+#include "plaits/dsp/simd.h"
 #include "plaits/resources.h"
 
 namespace plaits {
@@ -74,12 +75,12 @@ class GrainEnvelope {
     
     if (randomize) {
       from_ += interval_;
-      interval_ = stmlib::Random::GetFloat() - from_;
+      interval_ = Random::GetFloat() - from_;
       // Randomize the duration of the grain.
       if (burst_mode) {
-        fm_ *= 0.8f + 0.2f * stmlib::Random::GetFloat();
+        fm_ *= 0.8f + 0.2f * Random::GetFloat();
       } else {
-        fm_ = 0.5f + 1.5f * stmlib::Random::GetFloat();
+        fm_ = 0.5f + 1.5f * Random::GetFloat();
       }
     }
   }
@@ -231,6 +232,222 @@ class SwarmVoice {
   FastSineOscillator sine_;
 };
 
+#ifdef PLAITS_SIMD
+
+// The same voices, stored as structures of arrays, so that the oscillators
+// of kNumLanes voices are advanced together. The envelopes are still stepped
+// one voice at a time, at control rate, to draw the random numbers in the
+// same order. Each voice computes the same samples as a SwarmVoice, only the
+// order in which the voices are mixed differs.
+template<int num_voices>
+class SwarmLanes {
+ public:
+  SwarmLanes() { }
+  ~SwarmLanes() { }
+  
+  void Init() {
+    STATIC_ASSERT(num_voices % kNumLanes == 0, voices_not_multiple_of_lanes);
+    const float n = (num_voices - 1) / 2;
+    for (int i = 0; i < num_voices; ++i) {
+      rank_[i] = (static_cast<float>(i) - n) / n;
+      envelope_[i].Init();
+      
+      saw_phase_[i] = 0.0f;
+      saw_next_sample_[i] = 0.0f;
+      saw_frequency_[i] = 0.01f;
+      saw_gain_[i] = 0.0f;
+      
+      sine_x_[i] = 1.0f;
+      sine_y_[i] = 0.0f;
+      sine_epsilon_[i] = 0.0f;
+      sine_amplitude_[i] = 0.0f;
+    }
+  }
+  
+  // Unlike SwarmVoice::Render, writes to saw and sine instead of adding to
+  // them. size must not exceed kMaxBlockSize.
+  void Render(
+      float f0,
+      float density,
+      bool burst_mode,
+      bool start_burst,
+      float spread,
+      float size_ratio,
+      float* saw,
+      float* sine,
+      size_t size) {
+    // Per-sample increments of the interpolated parameters.
+    float saw_frequency_increment[num_voices];
+    float saw_gain_increment[num_voices];
+    float sine_epsilon_increment[num_voices];
+    float sine_amplitude_increment[num_voices];
+    
+    const float scale = 1.0f / num_voices;
+    const float control_rate = static_cast<float>(size);
+    for (int i = 0; i < num_voices; ++i) {
+      GrainEnvelope* envelope = &envelope_[i];
+      envelope->Step(density, burst_mode, start_burst);
+      const float amplitude = envelope->amplitude(size_ratio) * scale;
+      
+      const float expo_amount = envelope->frequency(size_ratio);
+      const float rank = rank_[i];
+      float f = f0 * stmlib::SemitonesToRatio(
+          48.0f * expo_amount * spread * rank);
+      
+      const float linear_amount = rank * (rank + 0.01f) * spread * 0.25f;
+      f *= 1.0f + linear_amount;
+      size_ratio *= 0.97f;
+      
+      // As in AdditiveSawOscillator::Render.
+      const float saw_frequency = f >= kMaxFrequency ? kMaxFrequency : f;
+      saw_frequency_increment[i] = (saw_frequency - saw_frequency_[i]) / \
+          control_rate;
+      saw_gain_increment[i] = (amplitude - saw_gain_[i]) / control_rate;
+      
+      // As in FastSineOscillator::Render.
+      float sine_frequency = f;
+      float sine_amplitude = amplitude;
+      if (sine_frequency >= 0.25f) {
+        sine_frequency = 0.25f;
+        sine_amplitude = 0.0f;
+      } else {
+        sine_amplitude *= 1.0f - sine_frequency * 4.0f;
+      }
+      sine_epsilon_increment[i] = (FastSineOscillator::Fast2Sin(
+          sine_frequency) - sine_epsilon_[i]) / control_rate;
+      sine_amplitude_increment[i] = (sine_amplitude - sine_amplitude_[i]) / \
+          control_rate;
+      
+      const float norm = sine_x_[i] * sine_x_[i] + sine_y_[i] * sine_y_[i];
+      if (norm <= 0.5f || norm >= 2.0f) {
+        const float correction = stmlib::fast_rsqrt_carmack(norm);
+        sine_x_[i] *= correction;
+        sine_y_[i] *= correction;
+      }
+    }
+    
+    LaneFloat saw_sum[kMaxBlockSize];
+    LaneFloat sine_sum[kMaxBlockSize];
+    const LaneFloat zero = SplatLanes(0.0f);
+    for (size_t j = 0; j < size; ++j) {
+      saw_sum[j] = zero;
+      sine_sum[j] = zero;
+    }
+    
+    for (int i = 0; i < num_voices; i += kNumLanes) {
+      RenderVoices(
+          i,
+          saw_frequency_increment,
+          saw_gain_increment,
+          sine_epsilon_increment,
+          sine_amplitude_increment,
+          saw_sum,
+          sine_sum,
+          size);
+    }
+    
+    size_t j = 0;
+    for (; j + kNumLanes <= size; j += kNumLanes) {
+      StoreLanes(&saw[j], SumLanes(
+          saw_sum[j], saw_sum[j + 1], saw_sum[j + 2], saw_sum[j + 3]));
+      StoreLanes(&sine[j], SumLanes(
+          sine_sum[j], sine_sum[j + 1], sine_sum[j + 2], sine_sum[j + 3]));
+    }
+    for (; j < size; ++j) {
+      float s[kNumLanes];
+      StoreLanes(s, SumLanes(saw_sum[j], sine_sum[j], zero, zero));
+      saw[j] = s[0];
+      sine[j] = s[1];
+    }
+  }
+  
+ private:
+  // Advances the oscillators of the kNumLanes voices starting at voice i,
+  // and adds their output to saw_sum and sine_sum.
+  inline void RenderVoices(
+      int i,
+      const float* saw_frequency_increment,
+      const float* saw_gain_increment,
+      const float* sine_epsilon_increment,
+      const float* sine_amplitude_increment,
+      LaneFloat* saw_sum,
+      LaneFloat* sine_sum,
+      size_t size) {
+    const LaneFloat zero = SplatLanes(0.0f);
+    const LaneFloat one = SplatLanes(1.0f);
+    const LaneFloat half = SplatLanes(0.5f);
+    const LaneFloat two = SplatLanes(2.0f);
+    
+    LaneFloat phase = LoadLanes(&saw_phase_[i]);
+    LaneFloat next_sample = LoadLanes(&saw_next_sample_[i]);
+    LaneFloat frequency = LoadLanes(&saw_frequency_[i]);
+    LaneFloat gain = LoadLanes(&saw_gain_[i]);
+    const LaneFloat frequency_increment = LoadLanes(
+        &saw_frequency_increment[i]);
+    const LaneFloat gain_increment = LoadLanes(&saw_gain_increment[i]);
+    
+    LaneFloat x = LoadLanes(&sine_x_[i]);
+    LaneFloat y = LoadLanes(&sine_y_[i]);
+    LaneFloat epsilon = LoadLanes(&sine_epsilon_[i]);
+    LaneFloat amplitude = LoadLanes(&sine_amplitude_[i]);
+    const LaneFloat epsilon_increment = LoadLanes(&sine_epsilon_increment[i]);
+    const LaneFloat amplitude_increment = LoadLanes(
+        &sine_amplitude_increment[i]);
+    
+    for (size_t j = 0; j < size; ++j) {
+      // The polyBLEP corrections are computed for all lanes, and only
+      // applied to the lanes whose phase has wrapped.
+      LaneFloat this_sample = next_sample;
+      frequency = AddLanes(frequency, frequency_increment);
+      phase = AddLanes(phase, frequency);
+      const LaneMask no_reset = LessLanes(phase, one);
+      phase = SubLanes(phase, SelectLanes(no_reset, zero, one));
+      const LaneFloat t = DivLanes(phase, frequency);
+      const LaneFloat t_next = SubLanes(one, t);
+      this_sample = SubLanes(this_sample, SelectLanes(
+          no_reset, zero, MulLanes(MulLanes(half, t), t)));
+      next_sample = AddLanes(SubLanes(zero, SelectLanes(
+          no_reset, zero, MulLanes(MulLanes(
+              SubLanes(zero, half), t_next), t_next))), phase);
+      gain = AddLanes(gain, gain_increment);
+      saw_sum[j] = AddLanes(saw_sum[j], MulLanes(
+          SubLanes(MulLanes(two, this_sample), one), gain));
+      
+      epsilon = AddLanes(epsilon, epsilon_increment);
+      x = AddLanes(x, MulLanes(epsilon, y));
+      y = SubLanes(y, MulLanes(epsilon, x));
+      amplitude = AddLanes(amplitude, amplitude_increment);
+      sine_sum[j] = AddLanes(sine_sum[j], MulLanes(amplitude, x));
+    }
+    
+    StoreLanes(&saw_phase_[i], phase);
+    StoreLanes(&saw_next_sample_[i], next_sample);
+    StoreLanes(&saw_frequency_[i], frequency);
+    StoreLanes(&saw_gain_[i], gain);
+    StoreLanes(&sine_x_[i], x);
+    StoreLanes(&sine_y_[i], y);
+    StoreLanes(&sine_epsilon_[i], epsilon);
+    StoreLanes(&sine_amplitude_[i], amplitude);
+  }
+  
+  float rank_[num_voices];
+  GrainEnvelope envelope_[num_voices];
+  
+  float saw_phase_[num_voices];
+  float saw_next_sample_[num_voices];
+  float saw_frequency_[num_voices];
+  float saw_gain_[num_voices];
+  
+  float sine_x_[num_voices];
+  float sine_y_[num_voices];
+  float sine_epsilon_[num_voices];
+  float sine_amplitude_[num_voices];
+  
+  DISALLOW_COPY_AND_ASSIGN(SwarmLanes);
+};
+
+#endif  // PLAITS_SIMD
+
 class SwarmEngine : public Engine {
  public:
   SwarmEngine() { }
@@ -244,8 +461,20 @@ class SwarmEngine : public Engine {
       float* aux,
       size_t size,
       bool* already_enveloped);
+
+#ifdef PLAITS_SIMD
+  // Switches between the 4-lane and scalar voices. They render the same
+  // samples, within float rounding - this is only used for testing and
+  // benchmarking. Each variant has its own state: call it before the first
+  // block.
+  inline void set_use_lanes(bool use_lanes) { use_lanes_ = use_lanes; }
+#endif  // PLAITS_SIMD
   
  private:
+#ifdef PLAITS_SIMD
+  SwarmLanes<kNumSwarmVoices>* swarm_;
+  bool use_lanes_;
+#endif  // PLAITS_SIMD
   SwarmVoice* swarm_voice_;
   
   DISALLOW_COPY_AND_ASSIGN(SwarmEngine);
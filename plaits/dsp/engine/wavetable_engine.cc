@@ -30,6 +30,7 @@
 
 #include <algorithm>
 
+#include "plaits/dsp/oscillator/sine_oscillator.h"
 #include "plaits/resources.h"
 
 namespace plaits {
@@ -45,6 +46,103 @@ const int kNumCustomWaves = 15;
 const size_t kTableSize = 128;
 const float kTableSizeF = float(kTableSize);
 
+// Level n of the mipmap keeps the harmonics up to 64 >> n, with 8 samples per
+// period of the highest harmonic (the images of the Hermite interpolator are
+// then below -50 dB), and never less than 16 samples. Each table is surrounded
+// by the same guard samples as the integrated waves (1 before, 3 after).
+const size_t kNumMipmapLevels = 7;
+const size_t kMipmapSize[kNumMipmapLevels] = {
+  512, 256, 128, 64, 32, 16, 16
+};
+const size_t kMipmapOffset[kNumMipmapLevels] = {
+  0, 516, 776, 908, 976, 1012, 1032
+};
+const size_t kMipmapStride = 1052;
+const int kNumMipmappedWaves = kNumWaves + kNumCustomWaves;
+
+void WavetableMipmaps::Build(
+    const int16_t* integrated_wave,
+    float* mipmaps) {
+  const size_t kNumHarmonics = kTableSize / 2;
+  const size_t kSineTableSize = 1 << kSineLUTBits;
+  
+  // Fourier series of the integrated wave. The Nyquist bin is dropped, since
+  // its derivative vanishes on the sampling grid.
+  float re[kNumHarmonics];
+  float im[kNumHarmonics];
+  re[0] = im[0] = 0.0f;
+  for (size_t h = 1; h < kNumHarmonics; ++h) {
+    float r = 0.0f;
+    float i = 0.0f;
+    for (size_t n = 0; n < kTableSize; ++n) {
+      const size_t index = (h * n * (kSineTableSize / kTableSize)) & \
+          (kSineTableSize - 1);
+      const float s = static_cast<float>(integrated_wave[n + 1]);
+      r += s * lut_sine[index + kSineLUTQuadrature];
+      i += s * lut_sine[index];
+    }
+    // Differentiate (w.r.t. the phase in table samples) and scale to match
+    // the output level of the differentiator.
+    const float scale = 2.0f / kTableSizeF * \
+        (2.0f * float(M_PI) * float(h) / kTableSizeF) / 1024.0f;
+    re[h] = i * scale;
+    im[h] = -r * scale;
+  }
+  
+  for (size_t level = 0; level < kNumMipmapLevels; ++level) {
+    const size_t size = kMipmapSize[level];
+    const size_t num_harmonics = min(kNumHarmonics >> level, kNumHarmonics - 1);
+    float* table = &mipmaps[kMipmapOffset[level]];
+    for (size_t m = 0; m < size; ++m) {
+      float s = 0.0f;
+      for (size_t h = 1; h <= num_harmonics; ++h) {
+        const size_t index = (h * m * (kSineTableSize / size)) & \
+            (kSineTableSize - 1);
+        s += re[h] * lut_sine[index + kSineLUTQuadrature];
+        s += im[h] * lut_sine[index];
+      }
+      table[m + 1] = s;
+    }
+    table[0] = table[size];
+    table[size + 1] = table[1];
+    table[size + 2] = table[2];
+    table[size + 3] = table[3];
+  }
+}
+
+void WavetableMipmaps::Init(BufferAllocator* allocator) {
+  tables_ = allocator->Allocate<float>(kNumMipmappedWaves * kMipmapStride);
+  user_data_ = NULL;
+  if (!tables_) {
+    return;
+  }
+  for (int w = 0; w < kNumWaves; ++w) {
+    Build(
+        wav_integrated_waves + size_t(w) * (kTableSize + 4),
+        tables_ + size_t(w) * kMipmapStride);
+  }
+}
+
+void WavetableMipmaps::LoadUserData(const uint8_t* user_data) {
+  user_data_ = user_data;
+  if (!tables_ || !user_data) {
+    return;
+  }
+  const int16_t* custom_waves = (const int16_t*)(user_data + 64);
+  for (int w = 0; w < kNumCustomWaves; ++w) {
+    Build(
+        custom_waves + size_t(w) * (kTableSize + 4),
+        tables_ + size_t(kNumWaves + w) * kMipmapStride);
+  }
+}
+
+const float* WavetableMipmaps::wave(int index) const {
+  return tables_ + size_t(index) * kMipmapStride;
+}
+
+/* static */
+const WavetableMipmaps* WavetableEngine::shared_mipmaps_ = NULL;
+
 void WavetableEngine::Init(BufferAllocator* allocator) {
   phase_ = 0.0f;
 
@@ -62,8 +160,18 @@ void WavetableEngine::Init(BufferAllocator* allocator) {
   previous_f0_ = a0;
 
   diff_out_.Init();
+  mipmap_lp_ = 0.0f;
   
-  wave_map_ = allocator->Allocate<const int16_t*>(kNumWavesPerBank);
+  wave_map_ = allocator->Allocate<const int16_t*>(
+      kNumBanks * kNumWavesPerBank);
+  
+  mipmaps_ = shared_mipmaps_ && shared_mipmaps_->ready()
+      ? shared_mipmaps_
+      : NULL;
+  mipmap_map_ = mipmaps_
+      ? allocator->Allocate<const float*>(kNumBanks * kNumWavesPerBank)
+      : NULL;
+  use_mipmaps_ = false;
 }
 
 void WavetableEngine::Reset() {
@@ -71,6 +179,7 @@ void WavetableEngine::Reset() {
 }
 
 void WavetableEngine::LoadUserData(const uint8_t* user_data) {
+  use_mipmaps_ = mipmap_map_ != NULL;
   for (int bank = 0; bank < kNumBanks; ++bank) {
     for (int wave = 0; wave < kNumWavesPerBank; ++wave) {
       int i = bank * kNumWavesPerBank + wave;
@@ -81,11 +190,18 @@ void WavetableEngine::LoadUserData(const uint8_t* user_data) {
       }
 
       const int16_t* base = wav_integrated_waves;
+      int mipmap_index = w;
       if (w >= kNumWaves) {
         base = (const int16_t*)(user_data + 64);
-        w = min(w - kNumWaves, kNumCustomWaves);
+        w = min(w - kNumWaves, kNumCustomWaves - 1);
+        mipmap_index = kNumWaves + w;
+        // The mipmaps of the custom waves have to be built from this data.
+        use_mipmaps_ = use_mipmaps_ && mipmaps_->user_data() == user_data;
       }
       wave_map_[i] = base + size_t(w) * (kTableSize + 4);
+      if (mipmap_map_) {
+        mipmap_map_[i] = mipmaps_->wave(mipmap_index);
+      }
     }
   }
 }
@@ -98,16 +214,60 @@ inline float Clamp(float x, float amount) {
   return x;
 }
 
-inline float WavetableEngine::ReadWave(
-    int x,
-    int y,
-    int z,
+template<typename T>
+inline float ReadWaves(
+    const T* const* wave_map,
+    size_t offset,
+    int x_integral,
+    float x_fractional,
+    int y_integral,
+    float y_fractional,
+    int z_integral,
+    float z_fractional,
     int phase_integral,
     float phase_fractional) {
-  return InterpolateWaveHermite(
-      wave_map_[x + y * 8 + z * kNumWavesPerBank],
-      phase_integral,
-      phase_fractional);
+  // With the quantization, the coordinates can reach 7.0, in which case the
+  // second wave has a weight of 0 - but it still has to be in the map.
+  int x0 = x_integral;
+  int x1 = min(x_integral + 1, 7);
+  int y0 = y_integral;
+  int y1 = min(y_integral + 1, 7);
+  int z0 = z_integral;
+  int z1 = min(z_integral + 1, 7);
+  
+  if (z0 >= 4) {
+    z0 = 7 - z0;
+  }
+  if (z1 >= 4) {
+    z1 = 7 - z1;
+  }
+  
+  const T* const* w0 = wave_map + z0 * kNumWavesPerBank;
+  const T* const* w1 = wave_map + z1 * kNumWavesPerBank;
+  const int p_i = phase_integral;
+  const float p_f = phase_fractional;
+  
+  float x0y0z0 = InterpolateWaveHermite(w0[x0 + y0 * 8] + offset, p_i, p_f);
+  float x1y0z0 = InterpolateWaveHermite(w0[x1 + y0 * 8] + offset, p_i, p_f);
+  float xy0z0 = x0y0z0 + (x1y0z0 - x0y0z0) * x_fractional;
+
+  float x0y1z0 = InterpolateWaveHermite(w0[x0 + y1 * 8] + offset, p_i, p_f);
+  float x1y1z0 = InterpolateWaveHermite(w0[x1 + y1 * 8] + offset, p_i, p_f);
+  float xy1z0 = x0y1z0 + (x1y1z0 - x0y1z0) * x_fractional;
+
+  float xyz0 = xy0z0 + (xy1z0 - xy0z0) * y_fractional;
+
+  float x0y0z1 = InterpolateWaveHermite(w1[x0 + y0 * 8] + offset, p_i, p_f);
+  float x1y0z1 = InterpolateWaveHermite(w1[x1 + y0 * 8] + offset, p_i, p_f);
+  float xy0z1 = x0y0z1 + (x1y0z1 - x0y0z1) * x_fractional;
+
+  float x0y1z1 = InterpolateWaveHermite(w1[x0 + y1 * 8] + offset, p_i, p_f);
+  float x1y1z1 = InterpolateWaveHermite(w1[x1 + y1 * 8] + offset, p_i, p_f);
+  float xy1z1 = x0y1z1 + (x1y1z1 - x0y1z1) * x_fractional;
+  
+  float xyz1 = xy0z1 + (xy1z1 - xy0z1) * y_fractional;
+
+  return xyz0 + (xyz1 - xyz0) * z_fractional;
 }
 
 void WavetableEngine::Render(
@@ -118,6 +278,17 @@ void WavetableEngine::Render(
     bool* already_enveloped) {
   const float f0 = NoteToFrequency(parameters.note);
   
+  // With the mipmaps, pick the octave from the highest frequency reached
+  // during this block, so that no harmonic goes above Nyquist.
+  size_t level = 0;
+  const float max_f0 = max(f0, previous_f0_);
+  while (level < kNumMipmapLevels - 1 && \
+         max_f0 * float(kTableSize >> (level + 1)) > 0.5f) {
+    ++level;
+  }
+  const float mipmap_size = float(kMipmapSize[level]);
+  const size_t mipmap_offset = kMipmapOffset[level];
+  
   ONE_POLE(x_pre_lp_, parameters.timbre * 6.9999f, 0.2f);
   ONE_POLE(y_pre_lp_, parameters.morph * 6.9999f, 0.2f);
   ONE_POLE(z_pre_lp_, parameters.harmonics * 6.9999f, 0.05f);
@@ -150,7 +321,6 @@ void WavetableEngine::Render(
   while (size--) {
     const float f0 = f0_modulation.Next();
     
-    const float gain = (1.0f / (f0 * 131072.0f)) * (0.95f - f0);
     const float cutoff = min(kTableSizeF * f0, 1.0f);
     
     ONE_POLE(x_lp_, x_modulation.Next(), lp_coefficient);
@@ -170,49 +340,36 @@ void WavetableEngine::Render(
       phase_ -= 1.0f;
     }
     
-    const float p = phase_ * kTableSizeF;
-    MAKE_INTEGRAL_FRACTIONAL(p);
-    
-    {
-      int x0 = x_integral;
-      int x1 = x_integral + 1;
-      int y0 = y_integral;
-      int y1 = y_integral + 1;
-      int z0 = z_integral;
-      int z1 = z_integral + 1;
+    float mix;
+    if (use_mipmaps_) {
+      const float p = phase_ * mipmap_size;
+      MAKE_INTEGRAL_FRACTIONAL(p);
+      mix = ReadWaves(
+          mipmap_map_, mipmap_offset,
+          x_integral, x_fractional,
+          y_integral, y_fractional,
+          z_integral, z_fractional,
+          p_integral, p_fractional);
       
-      if (z0 >= 4) {
-        z0 = 7 - z0;
-      }
-      if (z1 >= 4) {
-        z1 = 7 - z1;
-      }
+      // The same smoothing as the differentiator, to keep the timbre of the
+      // low notes unchanged.
+      ONE_POLE(mipmap_lp_, mix, cutoff);
+      mix = mipmap_lp_ * (0.95f - f0);
+    } else {
+      const float p = phase_ * kTableSizeF;
+      MAKE_INTEGRAL_FRACTIONAL(p);
+      mix = ReadWaves(
+          wave_map_, 0,
+          x_integral, x_fractional,
+          y_integral, y_fractional,
+          z_integral, z_fractional,
+          p_integral, p_fractional);
       
-      float x0y0z0 = ReadWave(x0, y0, z0, p_integral, p_fractional);
-      float x1y0z0 = ReadWave(x1, y0, z0, p_integral, p_fractional);
-      float xy0z0 = x0y0z0 + (x1y0z0 - x0y0z0) * x_fractional;
-
-      float x0y1z0 = ReadWave(x0, y1, z0, p_integral, p_fractional);
-      float x1y1z0 = ReadWave(x1, y1, z0, p_integral, p_fractional);
-      float xy1z0 = x0y1z0 + (x1y1z0 - x0y1z0) * x_fractional;
-
-      float xyz0 = xy0z0 + (xy1z0 - xy0z0) * y_fractional;
-
-      float x0y0z1 = ReadWave(x0, y0, z1, p_integral, p_fractional);
-      float x1y0z1 = ReadWave(x1, y0, z1, p_integral, p_fractional);
-      float xy0z1 = x0y0z1 + (x1y0z1 - x0y0z1) * x_fractional;
-
-      float x0y1z1 = ReadWave(x0, y1, z1, p_integral, p_fractional);
-      float x1y1z1 = ReadWave(x1, y1, z1, p_integral, p_fractional);
-      float xy1z1 = x0y1z1 + (x1y1z1 - x0y1z1) * x_fractional;
-      
-      float xyz1 = xy0z1 + (xy1z1 - xy0z1) * y_fractional;
-
-      float mix = xyz0 + (xyz1 - xyz0) * z_fractional;
+      const float gain = (1.0f / (f0 * 131072.0f)) * (0.95f - f0);
       mix = diff_out_.Process(cutoff, mix) * gain;
-      *out++ = mix;
-      *aux++ = static_cast<float>(static_cast<int>(mix * 32.0f)) / 32.0f;
     }
+    *out++ = mix;
+    *aux++ = static_cast<float>(static_cast<int>(mix * 32.0f)) / 32.0f;
   }
 }
 
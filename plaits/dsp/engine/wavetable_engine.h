@@ -34,6 +34,34 @@
 
 namespace plaits {
 
+// Band-limited, already differentiated versions of each wave - one table per
+// octave. About 870kB, so only a host has room for it. It is built once,
+// outside of the audio thread, and shared by all the wavetable engines.
+class WavetableMipmaps {
+ public:
+  WavetableMipmaps() { }
+  ~WavetableMipmaps() { }
+  
+  // Allocates the tables and builds those of the built-in waves (about 10ms).
+  void Init(stmlib::BufferAllocator* allocator);
+  
+  // Builds the tables of the custom waves. To be called when the user data
+  // changes, while no engine is rendering.
+  void LoadUserData(const uint8_t* user_data);
+  
+  inline bool ready() const { return tables_ != NULL; }
+  inline const uint8_t* user_data() const { return user_data_; }
+  const float* wave(int index) const;
+  
+ private:
+  void Build(const int16_t* integrated_wave, float* mipmaps);
+  
+  float* tables_;
+  const uint8_t* user_data_;
+  
+  DISALLOW_COPY_AND_ASSIGN(WavetableMipmaps);
+};
+
 class WavetableEngine : public Engine {
  public:
   WavetableEngine() { }
@@ -48,9 +76,19 @@ class WavetableEngine : public Engine {
       size_t size,
       bool* already_enveloped);
   
+  // Makes the engines initialized after this call read their waves from
+  // the given mipmaps instead of using the differentiator.
+  static inline void set_mipmaps(const WavetableMipmaps* mipmaps) {
+    shared_mipmaps_ = mipmaps;
+  }
+  
+  // True when the waves are read from the mipmaps. The custom waves only
+  // have mipmaps if the user data was also loaded in the WavetableMipmaps.
+  inline bool has_mipmaps() const { return use_mipmaps_; }
+  
  private:
-  float ReadWave(int x, int y, int z, int phase_i, float phase_f);
-   
+  static const WavetableMipmaps* shared_mipmaps_;
+  
   float phase_;
   
   float x_pre_lp_;
@@ -70,6 +108,13 @@ class WavetableEngine : public Engine {
   // This allows all waveforms to be reshuffled by the user to create new maps.
   const int16_t** wave_map_;
   
+  // Same map, pointing to the mipmaps of each wave. Only allocated when a
+  // host has built the mipmaps; the firmware keeps using the differentiator.
+  const WavetableMipmaps* mipmaps_;
+  const float** mipmap_map_;
+  bool use_mipmaps_;
+  float mipmap_lp_;
+  
   Differentiator diff_out_;
   
   DISALLOW_COPY_AND_ASSIGN(WavetableEngine);
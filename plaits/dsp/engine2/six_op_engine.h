@@ -100,6 +100,12 @@ class SixOpEngine : public Engine {
       
   void LoadBank(int bank);
   
+#ifdef FM_FUSED_RENDERERS
+  inline void set_use_fused_renderers(bool use_fused_renderers) {
+    algorithms_.set_use_fused_renderers(use_fused_renderers);
+  }
+#endif  // FM_FUSED_RENDERERS
+  
  private:
   stmlib::HysteresisQuantizer2 patch_index_quantizer_;
   fm::Algorithms<6> algorithms_;
@@ -0,0 +1,278 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Pool of engines shared by several voices.
+//
+// Only compiled for hosts using PLAITS_ENGINE_POOL - the module itself
+// statically allocates all its engines.
+
+#ifdef PLAITS_ENGINE_POOL
+
+#include "plaits/dsp/engine_pool.h"
+
+#include <new>
+
+#include "stmlib/utils/buffer_allocator.h"
+
+#include "plaits/dsp/engine/additive_engine.h"
+#include "plaits/dsp/engine/bass_drum_engine.h"
+#include "plaits/dsp/engine/chord_engine.h"
+#include "plaits/dsp/engine/fm_engine.h"
+#include "plaits/dsp/engine/grain_engine.h"
+#include "plaits/dsp/engine/hi_hat_engine.h"
+#include "plaits/dsp/engine/modal_engine.h"
+#include "plaits/dsp/engine/noise_engine.h"
+#include "plaits/dsp/engine/particle_engine.h"
+#include "plaits/dsp/engine/snare_drum_engine.h"
+#include "plaits/dsp/engine/speech_engine.h"
+#include "plaits/dsp/engine/string_engine.h"
+#include "plaits/dsp/engine/swarm_engine.h"
+#include "plaits/dsp/engine/virtual_analog_engine.h"
+#include "plaits/dsp/engine/waveshaping_engine.h"
+#include "plaits/dsp/engine/wavetable_engine.h"
+
+#include "plaits/dsp/engine2/chiptune_engine.h"
+#include "plaits/dsp/engine2/phase_distortion_engine.h"
+#include "plaits/dsp/engine2/six_op_engine.h"
+#include "plaits/dsp/engine2/string_machine_engine.h"
+#include "plaits/dsp/engine2/virtual_analog_vcf_engine.h"
+#include "plaits/dsp/engine2/wave_terrain_engine.h"
+
+namespace plaits {
+
+using namespace std;
+using namespace stmlib;
+
+// Engine objects are aligned on 16 bytes boundaries for SSE/NEON code.
+const size_t kEngineAlignment = 16;
+
+template<typename T>
+Engine* ConstructEngine(void* storage) {
+  return new(storage) T;
+}
+
+#define ENGINE_TYPE(T) { sizeof(T), &ConstructEngine<T> }
+
+// Same order as in Voice::Init().
+/* static */
+const EnginePool::EngineType EnginePool::engine_types_[kNumEngineTypes] = {
+  ENGINE_TYPE(VirtualAnalogVCFEngine),
+  ENGINE_TYPE(PhaseDistortionEngine),
+  ENGINE_TYPE(SixOpEngine),
+  ENGINE_TYPE(SixOpEngine),
+  ENGINE_TYPE(SixOpEngine),
+  ENGINE_TYPE(WaveTerrainEngine),
+  ENGINE_TYPE(StringMachineEngine),
+  ENGINE_TYPE(ChiptuneEngine),
+
+  ENGINE_TYPE(VirtualAnalogEngine),
+  ENGINE_TYPE(WaveshapingEngine),
+  ENGINE_TYPE(FMEngine),
+  ENGINE_TYPE(GrainEngine),
+  ENGINE_TYPE(AdditiveEngine),
+  ENGINE_TYPE(WavetableEngine),
+  ENGINE_TYPE(ChordEngine),
+  ENGINE_TYPE(SpeechEngine),
+
+  ENGINE_TYPE(SwarmEngine),
+  ENGINE_TYPE(NoiseEngine),
+  ENGINE_TYPE(ParticleEngine),
+  ENGINE_TYPE(StringEngine),
+  ENGINE_TYPE(ModalEngine),
+  ENGINE_TYPE(BassDrumEngine),
+  ENGINE_TYPE(SnareDrumEngine),
+  ENGINE_TYPE(HiHatEngine),
+};
+
+#undef ENGINE_TYPE
+
+/* static */
+size_t EnginePool::object_size() {
+  size_t size = 0;
+  for (int i = 0; i < kNumEngineTypes; ++i) {
+    size = max(size, engine_types_[i].size);
+  }
+  return (size + kEngineAlignment - 1) & ~(kEngineAlignment - 1);
+}
+
+/* static */
+size_t EnginePool::arena_size(int num_slots) {
+  return num_slots * (object_size() + kEngineRamSize) + kEngineAlignment - 1;
+}
+
+void EnginePool::Init(void* arena, size_t size) {
+  object_size_ = object_size();
+  slot_size_ = object_size_ + kEngineRamSize;
+
+  uint8_t* storage = static_cast<uint8_t*>(arena);
+  uint8_t* aligned_storage = reinterpret_cast<uint8_t*>(
+      (reinterpret_cast<uintptr_t>(storage) + kEngineAlignment - 1) & \
+          ~(kEngineAlignment - 1));
+  size -= min(size, size_t(aligned_storage - storage));
+
+  num_slots_ = min(int(size / slot_size_), kMaxEnginePoolSlots);
+  for (int i = 0; i < num_slots_; ++i) {
+    Slot* s = &slots_[i];
+    s->storage = aligned_storage + i * slot_size_;
+    s->engine = NULL;
+    s->owner = NULL;
+    s->engine_index = -1;
+    s->active = false;
+    s->last_used = 0;
+  }
+
+  clock_ = 0;
+  idle_timeout_ = static_cast<uint32_t>(4.0f * kSampleRate / kBlockSize);
+  max_engines_per_owner_ = kMaxEnginePoolSlots;
+  pthread_mutex_init(&lock_, NULL);
+
+  num_live_engines_ = 0;
+  peak_live_engines_ = 0;
+  num_constructions_ = 0;
+  num_evictions_ = 0;
+}
+
+int EnginePool::Acquire(const void* owner, int engine_index) {
+  if (engine_index < 0 || engine_index >= kNumEngineTypes) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&lock_);
+
+  // Look for an engine already constructed for this owner, a free slot, or,
+  // as a last resort, the least recently used inactive engine - of this
+  // owner if it already holds its share of the pool.
+  int free_slot = -1;
+  int lru_slot = -1;
+  int owner_lru_slot = -1;
+  int num_owner_engines = 0;
+  for (int i = 0; i < num_slots_; ++i) {
+    Slot* s = &slots_[i];
+    if (!s->engine) {
+      if (free_slot == -1) {
+        free_slot = i;
+      }
+      continue;
+    }
+    if (s->owner == owner) {
+      if (s->engine_index == engine_index) {
+        s->active = true;
+        s->last_used = clock_;
+        pthread_mutex_unlock(&lock_);
+        return i;
+      }
+      ++num_owner_engines;
+    }
+    if (s->active) {
+      continue;
+    }
+    const uint32_t age = clock_ - s->last_used;
+    if (lru_slot == -1 || age > clock_ - slots_[lru_slot].last_used) {
+      lru_slot = i;
+    }
+    if (s->owner == owner && (owner_lru_slot == -1 || \
+        age > clock_ - slots_[owner_lru_slot].last_used)) {
+      owner_lru_slot = i;
+    }
+  }
+
+  int slot = free_slot;
+  if (num_owner_engines >= max_engines_per_owner_) {
+    slot = owner_lru_slot;
+  } else if (slot == -1) {
+    slot = lru_slot;
+  }
+  if (slot == -1) {
+    pthread_mutex_unlock(&lock_);
+    return -1;
+  }
+  if (slots_[slot].engine) {
+    Evict(slot);
+  }
+
+  // Some engines expect their RAM to be cleared - like it is at boot time on
+  // the module.
+  Slot* s = &slots_[slot];
+  fill(&s->storage[0], &s->storage[slot_size_], 0);
+  s->engine = (*engine_types_[engine_index].construct)(s->storage);
+  BufferAllocator allocator(s->storage + object_size_, kEngineRamSize);
+  s->engine->Init(&allocator);
+  s->owner = owner;
+  s->engine_index = engine_index;
+  s->active = true;
+  s->last_used = clock_;
+
+  ++num_constructions_;
+  ++num_live_engines_;
+  peak_live_engines_ = max(peak_live_engines_, num_live_engines_);
+  pthread_mutex_unlock(&lock_);
+  return slot;
+}
+
+void EnginePool::Release(int slot) {
+  pthread_mutex_lock(&lock_);
+  slots_[slot].active = false;
+  slots_[slot].last_used = clock_;
+  pthread_mutex_unlock(&lock_);
+}
+
+void EnginePool::Tick() {
+  pthread_mutex_lock(&lock_);
+  ++clock_;
+  for (int i = 0; i < num_slots_; ++i) {
+    Slot* s = &slots_[i];
+    if (s->active) {
+      s->last_used = clock_;
+    } else if (s->engine && clock_ - s->last_used > idle_timeout_) {
+      Evict(i);
+    }
+  }
+  pthread_mutex_unlock(&lock_);
+}
+
+void EnginePool::Evict(int slot) {
+  Slot* s = &slots_[slot];
+  s->engine = NULL;
+  s->owner = NULL;
+  s->engine_index = -1;
+  s->active = false;
+  ++num_evictions_;
+  --num_live_engines_;
+}
+
+size_t EnginePool::bytes_in_use(const void* owner) const {
+  size_t bytes = 0;
+  for (int i = 0; i < num_slots_; ++i) {
+    if (slots_[i].engine && slots_[i].owner == owner) {
+      bytes += slot_size_;
+    }
+  }
+  return bytes;
+}
+
+}  // namespace plaits
+
+#endif  // PLAITS_ENGINE_POOL
@@ -0,0 +1,156 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Pool of engines shared by several voices (for software hosts running many
+// voices). Instead of having each voice hold an instance of all engines, an
+// engine is constructed in a slot of a shared arena the first time a voice
+// selects it. Once released by its voice, the engine stays in its slot - so
+// that switching back to it is cheap - until it has been idle for too long, or
+// until its slot is needed by another engine.
+//
+// Each slot holds the engine object and the RAM it allocates during Init().
+// Engines do not own any other resource, so evicting an engine simply consists
+// in recycling its slot.
+//
+// Voices rendered by different threads can share a pool: Acquire(), Release()
+// and Tick() are serialized by a lock.
+
+#ifndef PLAITS_DSP_ENGINE_POOL_H_
+#define PLAITS_DSP_ENGINE_POOL_H_
+
+#include "stmlib/stmlib.h"
+
+#include <pthread.h>
+
+#include "plaits/dsp/engine/engine.h"
+
+namespace plaits {
+
+const int kMaxEnginePoolSlots = 256;
+const int kNumEngineTypes = 24;
+
+// Size of the RAM block allocated to each engine (same as on the hardware).
+const size_t kEngineRamSize = 16384;
+
+class EnginePool {
+ public:
+  EnginePool() { }
+  ~EnginePool() { }
+
+  // Size of the arena needed to hold num_slots engines, including the
+  // padding required to align it.
+  static size_t arena_size(int num_slots);
+
+  void Init(void* arena, size_t size);
+
+  // Returns the slot holding the engine engine_index for this owner -
+  // constructing the engine if necessary. Returns -1 if all slots are in use.
+  // The slot is marked as active and won't be evicted until released.
+  int Acquire(const void* owner, int engine_index);
+  void Release(int slot);
+
+  // Advances the pool clock by one block, and evicts the engines that have not
+  // been used for more than idle_timeout blocks.
+  void Tick();
+
+  inline Engine* engine(int slot) const {
+    return slots_[slot].engine;
+  }
+
+  inline int engine_index(int slot) const {
+    return slots_[slot].engine_index;
+  }
+
+  inline void set_idle_timeout(uint32_t idle_timeout) {
+    idle_timeout_ = idle_timeout;
+  }
+
+  // Once an owner holds this many engines, it recycles the slot of its least
+  // recently used inactive engine rather than taking a slot from the other
+  // owners. With 2 engines per owner (the one playing, and the one being
+  // faded out) and 2 slots per owner, Acquire() never fails, and which
+  // engines get evicted doesn't depend on the order in which the owners call
+  // it.
+  inline void set_max_engines_per_owner(int max_engines_per_owner) {
+    max_engines_per_owner_ = max_engines_per_owner;
+  }
+
+  // Statistics.
+  inline int num_slots() const { return num_slots_; }
+  inline size_t slot_size() const { return slot_size_; }
+  inline int num_live_engines() const { return num_live_engines_; }
+  inline int peak_live_engines() const { return peak_live_engines_; }
+  inline int num_constructions() const { return num_constructions_; }
+  inline int num_evictions() const { return num_evictions_; }
+  inline size_t bytes_in_use() const {
+    return num_live_engines_ * slot_size_;
+  }
+  size_t bytes_in_use(const void* owner) const;
+
+ private:
+  struct EngineType {
+    size_t size;
+    Engine* (*construct)(void* storage);
+  };
+
+  struct Slot {
+    uint8_t* storage;
+    Engine* engine;
+    const void* owner;
+    int engine_index;
+    bool active;
+    uint32_t last_used;
+  };
+
+  // Size of the largest engine object, rounded up to the alignment.
+  static size_t object_size();
+
+  void Evict(int slot);
+
+  Slot slots_[kMaxEnginePoolSlots];
+  int num_slots_;
+  size_t slot_size_;
+  size_t object_size_;
+
+  uint32_t clock_;
+  uint32_t idle_timeout_;
+  int max_engines_per_owner_;
+
+  pthread_mutex_t lock_;
+
+  int num_live_engines_;
+  int peak_live_engines_;
+  int num_constructions_;
+  int num_evictions_;
+
+  static const EngineType engine_types_[kNumEngineTypes];
+
+  DISALLOW_COPY_AND_ASSIGN(EnginePool);
+};
+
+}  // namespace plaits
+
+#endif  // PLAITS_DSP_ENGINE_POOL_H_
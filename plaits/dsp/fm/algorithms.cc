@@ -452,6 +452,42 @@ const Algorithms<6>::RendererSpecs Algorithms<6>::renderers_[] = {
   { 0, 0, 0, NULL}
 };
 
+#ifdef FM_FUSED_RENDERERS
+
+#define FUSED_RENDERER(n, algorithm) &RenderFusedAlgorithm<n, algorithm>
+
+/* static */
+template<>
+const RenderFn Algorithms<4>::fused_renderers_[8] = {
+  FUSED_RENDERER(4, 0), FUSED_RENDERER(4, 1),
+  FUSED_RENDERER(4, 2), FUSED_RENDERER(4, 3),
+  FUSED_RENDERER(4, 4), FUSED_RENDERER(4, 5),
+  FUSED_RENDERER(4, 6), FUSED_RENDERER(4, 7)
+};
+
+/* static */
+template<>
+const RenderFn Algorithms<6>::fused_renderers_[32] = {
+  FUSED_RENDERER(6, 0), FUSED_RENDERER(6, 1),
+  FUSED_RENDERER(6, 2), FUSED_RENDERER(6, 3),
+  FUSED_RENDERER(6, 4), FUSED_RENDERER(6, 5),
+  FUSED_RENDERER(6, 6), FUSED_RENDERER(6, 7),
+  FUSED_RENDERER(6, 8), FUSED_RENDERER(6, 9),
+  FUSED_RENDERER(6, 10), FUSED_RENDERER(6, 11),
+  FUSED_RENDERER(6, 12), FUSED_RENDERER(6, 13),
+  FUSED_RENDERER(6, 14), FUSED_RENDERER(6, 15),
+  FUSED_RENDERER(6, 16), FUSED_RENDERER(6, 17),
+  FUSED_RENDERER(6, 18), FUSED_RENDERER(6, 19),
+  FUSED_RENDERER(6, 20), FUSED_RENDERER(6, 21),
+  FUSED_RENDERER(6, 22), FUSED_RENDERER(6, 23),
+  FUSED_RENDERER(6, 24), FUSED_RENDERER(6, 25),
+  FUSED_RENDERER(6, 26), FUSED_RENDERER(6, 27),
+  FUSED_RENDERER(6, 28), FUSED_RENDERER(6, 29),
+  FUSED_RENDERER(6, 30), FUSED_RENDERER(6, 31)
+};
+
+#endif  // FM_FUSED_RENDERERS
+
 }  // namespace fm
   
 }  // namespace plaits
@@ -35,6 +35,14 @@
 
 #include <algorithm>
 
+// When enabled, every algorithm is also compiled into a fused renderer, which
+// evaluates all operators in a single loop: the modulation signals between
+// operators stay in registers instead of going through the block buffers.
+// This costs a lot of code space (one renderer per algorithm), so it is
+// disabled by default. Even when compiled in, the fused renderers are only
+// used after a call to set_use_fused_renderers(true).
+// #define FM_FUSED_RENDERERS
+
 namespace plaits {
 
 namespace fm {
@@ -89,6 +97,9 @@ class Algorithms {
     for (int i = 0; i < NUM_ALGORITHMS; ++i) {
       Compile(i);
     }
+#ifdef FM_FUSED_RENDERERS
+    use_fused_renderers_ = false;
+#endif  // FM_FUSED_RENDERERS
   }
   
   inline const RenderCall& render_call(int algorithm, int op) const {
@@ -99,6 +110,26 @@ class Algorithms {
     return opcodes_[algorithm][op] & DESTINATION_MASK;
   }
   
+  static inline uint8_t opcode(int algorithm, int op) {
+    return opcodes_[algorithm][op];
+  }
+  
+  // Returns a renderer for the entire algorithm, or NULL if the algorithm
+  // has to be rendered through the sequence of render calls.
+  inline RenderFn fused_render_fn(int algorithm) const {
+#ifdef FM_FUSED_RENDERERS
+    return use_fused_renderers_ ? fused_renderers_[algorithm] : NULL;
+#else
+    return NULL;
+#endif  // FM_FUSED_RENDERERS
+  }
+  
+#ifdef FM_FUSED_RENDERERS
+  inline void set_use_fused_renderers(bool use_fused_renderers) {
+    use_fused_renderers_ = use_fused_renderers;
+  }
+#endif  // FM_FUSED_RENDERERS
+  
  private:
   struct RendererSpecs {
     int n;
@@ -192,9 +223,118 @@ class Algorithms {
   static const uint8_t opcodes_[NUM_ALGORITHMS][num_operators];
   static const RendererSpecs renderers_[];
   
+#ifdef FM_FUSED_RENDERERS
+  bool use_fused_renderers_;
+  static const RenderFn fused_renderers_[NUM_ALGORITHMS];
+#endif  // FM_FUSED_RENDERERS
+  
   DISALLOW_COPY_AND_ASSIGN(Algorithms);
 };
 
+#ifdef FM_FUSED_RENDERERS
+
+template<int num_operators>
+struct FusedRendererState {
+  uint32_t frequency[num_operators];
+  uint32_t phase[num_operators];
+  float amplitude[num_operators];
+  float amplitude_increment[num_operators];
+  float previous_0;
+  float previous_1;
+  float fb_scale;
+};
+
+// Renders one sample of operator op. The 4 "buses" play the role of the
+// buffers used by the render calls: bus[0] is the output, and bus[3] is
+// never read (a modulation source of 3 denotes the feedback path).
+//
+// The opcode is a compile-time constant when the renderer is instantiated
+// in the same translation unit as the opcodes table, so all the branches
+// below are resolved at compile time.
+template<int num_operators, int algorithm, int op>
+struct FusedOperator {
+  static inline void Render(FusedRendererState<num_operators>* s, float* bus) {
+    typedef Algorithms<num_operators> A;
+    const uint8_t opcode = A::opcode(algorithm, op);
+    const int source = (opcode & A::SOURCE_MASK) >> 4;
+    const int destination = opcode & A::DESTINATION_MASK;
+    
+    float pm = 0.0f;
+    if ((opcode & A::SOURCE_MASK) == A::SOURCE_FEEDBACK) {
+      pm = (s->previous_0 + s->previous_1) * s->fb_scale;
+    } else if (source) {
+      pm = bus[source];
+    }
+    s->phase[op] += s->frequency[op];
+    pm = SinePM(s->phase[op], pm) * s->amplitude[op];
+    s->amplitude[op] += s->amplitude_increment[op];
+    if (opcode & A::FEEDBACK_SOURCE_FLAG) {
+      s->previous_1 = s->previous_0;
+      s->previous_0 = pm;
+    }
+    if (opcode & A::ADDITIVE_FLAG) {
+      bus[destination] += pm;
+    } else {
+      bus[destination] = pm;
+    }
+    FusedOperator<num_operators, algorithm, op + 1>::Render(s, bus);
+  }
+};
+
+template<int num_operators, int algorithm>
+struct FusedOperator<num_operators, algorithm, num_operators> {
+  static inline void Render(FusedRendererState<num_operators>* s, float* bus) {
+  }
+};
+
+// Same output, bit for bit, as the sequence of render calls compiled for
+// this algorithm - but in a single pass. The modulation argument is unused.
+template<int num_operators, int algorithm>
+void RenderFusedAlgorithm(
+    Operator* ops,
+    const float* f,
+    const float* a,
+    float* fb_state,
+    int fb_amount,
+    const float* modulation,
+    float* out,
+    size_t size) {
+  FusedRendererState<num_operators> s;
+  
+  const float scale = 1.0f / float(size);
+  for (int i = 0; i < num_operators; ++i) {
+    s.frequency[i] = static_cast<uint32_t>(
+        std::min(f[i], 0.5f) * 4294967296.0f);
+    s.phase[i] = ops[i].phase;
+    s.amplitude[i] = ops[i].amplitude;
+    s.amplitude_increment[i] = (std::min(a[i], 4.0f) - s.amplitude[i]) * scale;
+  }
+  s.previous_0 = fb_state[0];
+  s.previous_1 = fb_state[1];
+  s.fb_scale = fb_amount ? float(1 << fb_amount) / 512.0f : 0.0f;
+
+  while (size--) {
+    float bus[4] = { *out, 0.0f, 0.0f, 0.0f };
+    FusedOperator<num_operators, algorithm, 0>::Render(&s, bus);
+    *out++ = bus[0];
+  }
+  
+  for (int i = 0; i < num_operators; ++i) {
+    ops[i].phase = s.phase[i];
+    ops[i].amplitude = s.amplitude[i];
+  }
+  fb_state[0] = s.previous_0;
+  fb_state[1] = s.previous_1;
+}
+
+/* static */
+template<> const RenderFn Algorithms<4>::fused_renderers_[];
+
+/* static */
+template<> const RenderFn Algorithms<6>::fused_renderers_[];
+
+#endif  // FM_FUSED_RENDERERS
+
 /* static */
 template<> const uint8_t Algorithms<4>::opcodes_[][4];  // From DX100
 
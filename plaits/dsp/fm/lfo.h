@@ -30,11 +30,11 @@
 #define PLAITS_DSP_FM_LFO_H_
 
 #include "stmlib/stmlib.h"
-#include "stmlib/utils/random.h"
 
 #include "plaits/dsp/fm/dx_units.h"
 #include "plaits/dsp/fm/patch.h"
 #include "plaits/dsp/oscillator/sine_oscillator.h"
+#include "plaits/dsp/random.h"
 
 namespace plaits {
 
@@ -99,7 +99,7 @@ class Lfo {
     phase_ += scale * frequency_;
     if (phase_ >= 1.0f) {
       phase_ -= 1.0f;
-      random_value_ = stmlib::Random::GetFloat();
+      random_value_ = Random::GetFloat();
     }
     value_ = value();
     
@@ -115,7 +115,7 @@ class Lfo {
     phase_ = phase_fractional;
     if (phase_integral != phase_integral_) {
       phase_integral_ = phase_integral;
-      random_value_ = stmlib::Random::GetFloat();
+      random_value_ = Random::GetFloat();
     }
     value_ = value();
     
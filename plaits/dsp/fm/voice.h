@@ -152,13 +152,59 @@ class Voice {
       const Parameters& parameters,
       float* buffers[4],
       size_t size) {
+    float f[num_operators];
+    float a[num_operators];
+    if (!ComputeFrequenciesAndAmplitudes(parameters, size, f, a)) {
+      return;
+    }
+    
+    RenderFn fused_render_fn = algorithms_->fused_render_fn(
+        patch_->algorithm);
+    if (fused_render_fn) {
+      (*fused_render_fn)(
+          &operator_[0],
+          &f[0],
+          &a[0],
+          feedback_state_,
+          patch_->feedback,
+          NULL,
+          buffers[0],
+          size);
+      return;
+    }
+    
+    for (int i = 0; i < num_operators; ) {
+      const typename Algorithms<num_operators>::RenderCall& call = \
+          algorithms_->render_call(patch_->algorithm, i);
+      (*call.render_fn)(
+          &operator_[i],
+          &f[i],
+          &a[i],
+          feedback_state_,
+          patch_->feedback,
+          buffers[call.input_index],
+          buffers[call.output_index],
+          size);
+      i += call.n;
+    }
+  }
+  
+ private:
+  // Updates the envelopes, and computes the frequency and amplitude reached
+  // by each operator at the end of the block. Returns false if the voice
+  // should not be rendered during this block.
+  inline bool ComputeFrequenciesAndAmplitudes(
+      const Parameters& parameters,
+      size_t size,
+      float* f,
+      float* a) {
     if (Setup()) {
       // This prevents a CPU overrun, since there is not enough CPU to perform
       // both a patch setup and a full render in the time alloted for
       // a render. As a drawback, this causes a 0.5ms blank before a new
       // patch starts playing. But this is a clean blank, as opposed to a
       // glitchy overrun.
-      return;
+      return false;
     }
     
     const float envelope_rate = float(size);
@@ -198,8 +244,6 @@ class Voice {
     }
 
     // Compute frequencies and amplitudes.
-    float f[num_operators];
-    float a[num_operators];
     for (int i = 0; i < num_operators; ++i) {
       const Patch::Operator& op = patch_->op[i];
       
@@ -236,24 +280,9 @@ class Voice {
       a[i] = Pow2Fast<2>(-14.0f + level * level_mod);
 #endif  // FAST_LINEAR_AMPLITUDE_MODULATION
     }
-    
-    for (int i = 0; i < num_operators; ) {
-      const typename Algorithms<num_operators>::RenderCall& call = \
-          algorithms_->render_call(patch_->algorithm, i);
-      (*call.render_fn)(
-          &operator_[i],
-          &f[i],
-          &a[i],
-          feedback_state_,
-          patch_->feedback,
-          buffers[call.input_index],
-          buffers[call.output_index],
-          size);
-      i += call.n;
-    }
+    return true;
   }
   
- private:
   const Algorithms<num_operators>* algorithms_;
   float sample_rate_;
   float one_hz_;
@@ -278,6 +307,8 @@ class Voice {
   
   bool dirty_;
   
+  template<int n> friend class VoiceLanes;
+  
   DISALLOW_COPY_AND_ASSIGN(Voice);
 };
 
@@ -0,0 +1,213 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Renders up to 4 DX7 voices sharing the same algorithm in parallel: each
+// voice occupies one lane of a SIMD register, so that a single evaluation of
+// the phase-modulated sine serves all voices.
+//
+// Each lane produces the same output, bit for bit, as Voice::Render - as long
+// as the compiler is not allowed to fuse multiplications and additions, and
+// the modulation index stays within the +/- 32 range of SinePM.
+
+#ifndef PLAITS_DSP_FM_VOICE_LANES_H_
+#define PLAITS_DSP_FM_VOICE_LANES_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "plaits/dsp/fm/algorithms.h"
+#include "plaits/dsp/fm/voice.h"
+#include "plaits/dsp/oscillator/sine_oscillator.h"
+#include "plaits/dsp/simd.h"
+
+namespace plaits {
+
+namespace fm {
+
+const int kNumVoiceLanes = kNumLanes;
+
+template<int num_operators>
+class VoiceLanes {
+ public:
+  typedef typename Voice<num_operators>::Parameters Parameters;
+
+  // Renders num_voices (at most kNumVoiceLanes) voices. All the voices must
+  // use the same algorithm. Like Voice::Render, the output of each voice is
+  // added to the content of its buffer, out[i].
+  static void Render(
+      Voice<num_operators>* const* voices,
+      const Parameters* parameters,
+      float* const* out,
+      int num_voices,
+      size_t size) {
+    uint32_t frequency[num_operators][kNumVoiceLanes];
+    uint32_t phase[num_operators][kNumVoiceLanes];
+    float amplitude[num_operators][kNumVoiceLanes];
+    float amplitude_increment[num_operators][kNumVoiceLanes];
+    float previous_0[kNumVoiceLanes];
+    float previous_1[kNumVoiceLanes];
+    float fb_scale[kNumVoiceLanes];
+    float* lane_out[kNumVoiceLanes];
+
+    const float scale = 1.0f / float(size);
+    int algorithm = -1;
+    for (int lane = 0; lane < kNumVoiceLanes; ++lane) {
+      Voice<num_operators>* voice = lane < num_voices ? voices[lane] : NULL;
+      float f[num_operators];
+      float a[num_operators];
+      if (!voice || !voice->ComputeFrequenciesAndAmplitudes(
+              parameters[lane], size, f, a)) {
+        // Unused lane - render silence.
+        for (int i = 0; i < num_operators; ++i) {
+          frequency[i][lane] = phase[i][lane] = 0;
+          amplitude[i][lane] = amplitude_increment[i][lane] = 0.0f;
+        }
+        previous_0[lane] = previous_1[lane] = fb_scale[lane] = 0.0f;
+        lane_out[lane] = NULL;
+        continue;
+      }
+
+      for (int i = 0; i < num_operators; ++i) {
+        const Operator& op = voice->operator_[i];
+        frequency[i][lane] = static_cast<uint32_t>(
+            std::min(f[i], 0.5f) * 4294967296.0f);
+        phase[i][lane] = op.phase;
+        amplitude[i][lane] = op.amplitude;
+        amplitude_increment[i][lane] = \
+            (std::min(a[i], 4.0f) - op.amplitude) * scale;
+      }
+      const int fb_amount = voice->patch_->feedback;
+      previous_0[lane] = voice->feedback_state_[0];
+      previous_1[lane] = voice->feedback_state_[1];
+      fb_scale[lane] = fb_amount ? float(1 << fb_amount) / 512.0f : 0.0f;
+      lane_out[lane] = out[lane];
+      algorithm = voice->patch_->algorithm;
+    }
+
+    if (algorithm == -1) {
+      return;
+    }
+
+    typedef Algorithms<num_operators> A;
+    int source[num_operators];
+    int destination[num_operators];
+    bool additive[num_operators];
+    bool feedback_source[num_operators];
+    for (int i = 0; i < num_operators; ++i) {
+      const uint8_t opcode = A::opcode(algorithm, i);
+      source[i] = (opcode & A::SOURCE_MASK) >> 4;
+      destination[i] = opcode & A::DESTINATION_MASK;
+      additive[i] = opcode & A::ADDITIVE_FLAG;
+      feedback_source[i] = opcode & A::FEEDBACK_SOURCE_FLAG;
+    }
+
+    LaneUint32 frequency_lanes[num_operators];
+    LaneUint32 phase_lanes[num_operators];
+    LaneFloat amplitude_lanes[num_operators];
+    LaneFloat amplitude_increment_lanes[num_operators];
+    for (int i = 0; i < num_operators; ++i) {
+      frequency_lanes[i] = LoadLanes(frequency[i]);
+      phase_lanes[i] = LoadLanes(phase[i]);
+      amplitude_lanes[i] = LoadLanes(amplitude[i]);
+      amplitude_increment_lanes[i] = LoadLanes(amplitude_increment[i]);
+    }
+    LaneFloat previous_0_lanes = LoadLanes(previous_0);
+    LaneFloat previous_1_lanes = LoadLanes(previous_1);
+    const LaneFloat fb_scale_lanes = LoadLanes(fb_scale);
+    const LaneFloat zero = SplatLanes(0.0f);
+
+    for (size_t j = 0; j < size; ++j) {
+      float sample[kNumVoiceLanes];
+      for (int lane = 0; lane < kNumVoiceLanes; ++lane) {
+        sample[lane] = lane_out[lane] ? lane_out[lane][j] : 0.0f;
+      }
+
+      LaneFloat bus[4];
+      bus[0] = LoadLanes(sample);
+      bus[1] = bus[2] = bus[3] = zero;
+
+      for (int i = 0; i < num_operators; ++i) {
+        LaneFloat pm = zero;
+        if (source[i] == 3) {
+          pm = MulLanes(
+              AddLanes(previous_0_lanes, previous_1_lanes),
+              fb_scale_lanes);
+        } else if (source[i]) {
+          pm = bus[source[i]];
+        }
+        phase_lanes[i] = AddLanes(phase_lanes[i], frequency_lanes[i]);
+        pm = MulLanes(SinePMLanes(phase_lanes[i], pm), amplitude_lanes[i]);
+        amplitude_lanes[i] = AddLanes(
+            amplitude_lanes[i],
+            amplitude_increment_lanes[i]);
+        if (feedback_source[i]) {
+          previous_1_lanes = previous_0_lanes;
+          previous_0_lanes = pm;
+        }
+        bus[destination[i]] = additive[i]
+            ? AddLanes(bus[destination[i]], pm)
+            : pm;
+      }
+
+      StoreLanes(sample, bus[0]);
+      for (int lane = 0; lane < kNumVoiceLanes; ++lane) {
+        if (lane_out[lane]) {
+          lane_out[lane][j] = sample[lane];
+        }
+      }
+    }
+
+    for (int i = 0; i < num_operators; ++i) {
+      StoreLanes(phase[i], phase_lanes[i]);
+      StoreLanes(amplitude[i], amplitude_lanes[i]);
+    }
+    StoreLanes(previous_0, previous_0_lanes);
+    StoreLanes(previous_1, previous_1_lanes);
+
+    for (int lane = 0; lane < num_voices; ++lane) {
+      if (!lane_out[lane]) {
+        continue;
+      }
+      Voice<num_operators>* voice = voices[lane];
+      for (int i = 0; i < num_operators; ++i) {
+        voice->operator_[i].phase = phase[i][lane];
+        voice->operator_[i].amplitude = amplitude[i][lane];
+      }
+      voice->feedback_state_[0] = previous_0[lane];
+      voice->feedback_state_[1] = previous_1[lane];
+    }
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(VoiceLanes);
+};
+
+}  // namespace fm
+
+}  // namespace plaits
+
+#endif  // PLAITS_DSP_FM_VOICE_LANES_H_
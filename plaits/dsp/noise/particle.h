@@ -31,7 +31,8 @@
 
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/filter.h"
-#include "stmlib/utils/random.h"
+
+#include "plaits/dsp/random.h"
 
 namespace plaits {
 
@@ -55,7 +56,7 @@ class Particle {
       float* out,
       float* aux,
       size_t size) {
-    float u = stmlib::Random::GetFloat();
+    float u = Random::GetFloat();
     if (sync) {
       u = density;
     }
@@ -65,7 +66,7 @@ class Particle {
       if (u <= density) {
         s = u * gain;
         if (can_radomize_frequency) {
-          const float u = 2.0f * stmlib::Random::GetFloat() - 1.0f;
+          const float u = 2.0f * Random::GetFloat() - 1.0f;
           const float f = std::min(
               stmlib::SemitonesToRatio(spread * u) * frequency,
               0.25f);
@@ -77,7 +78,7 @@ class Particle {
       }
       *aux++ += s;
       *out++ += filter_.Process<stmlib::FILTER_MODE_BAND_PASS>(pre_gain_ * s);
-      u = stmlib::Random::GetFloat();
+      u = Random::GetFloat();
     }
   }
  
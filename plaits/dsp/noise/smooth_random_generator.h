@@ -30,7 +30,8 @@
 #define PLAITS_DSP_NOISE_SMOOTH_RANDOM_GENERATOR_H_
 
 #include "stmlib/stmlib.h"
-#include "stmlib/utils/random.h"
+
+#include "plaits/dsp/random.h"
 
 namespace plaits {
 
@@ -50,7 +51,7 @@ class SmoothRandomGenerator {
     if (phase_ >= 1.0f) {
       phase_ -= 1.0f;
       from_ += interval_;
-      interval_ = stmlib::Random::GetFloat() * 2.0f - 1.0f - from_;
+      interval_ = Random::GetFloat() * 2.0f - 1.0f - from_;
     }
     float t = phase_ * phase_ * (3.0f - 2.0f * phase_);
     return from_ + interval_ * t;
@@ -35,6 +35,7 @@
 #include "stmlib/dsp/parameter_interpolator.h"
 
 #include "plaits/dsp/oscillator/sine_oscillator.h"
+#include "plaits/dsp/simd.h"
 
 namespace plaits {
 
@@ -58,6 +59,77 @@ class HarmonicOscillator {
       const float* amplitudes,
       float* out,
       size_t size) {
+#ifdef PLAITS_SIMD
+    if (size % kNumLanes == 0) {
+      RenderLanes<first_harmonic_index>(frequency, amplitudes, out, size);
+      return;
+    }
+#endif  // PLAITS_SIMD
+    RenderScalar<first_harmonic_index>(frequency, amplitudes, out, size);
+  }
+
+#ifdef PLAITS_SIMD
+  // Runs the recurrence for kNumLanes consecutive samples at once, each lane
+  // with its own phase. Up to 3 vectors of samples are rendered together, so
+  // that the recurrences of several vectors can be interleaved. size must be
+  // a multiple of kNumLanes. The output matches the one of RenderScalar,
+  // except for the rounding of the amplitude ramps.
+  template<int first_harmonic_index>
+  void RenderLanes(
+      float frequency,
+      const float* amplitudes,
+      float* out,
+      size_t size) {
+    if (frequency >= 0.5f) {
+      frequency = 0.5f;
+    }
+    
+    stmlib::ParameterInterpolator fm(&frequency_, frequency, size);
+    
+    // Amplitude of each harmonic for the next kNumLanes samples, and its
+    // increment over kNumLanes samples.
+    LaneFloat amplitude[num_harmonics];
+    LaneFloat amplitude_step[num_harmonics];
+    for (int i = 0; i < num_harmonics; ++i) {
+      float f = frequency * static_cast<float>(first_harmonic_index + i);
+      if (f >= 0.5f) {
+        f = 0.5f;
+      }
+      const float target = amplitudes[i] * (1.0f - f * 2.0f);
+      const float increment = (target - amplitude_[i]) /
+          static_cast<float>(size);
+      const float a = amplitude_[i];
+      amplitude[i] = SetLanes(
+          a + increment,
+          a + 2.0f * increment,
+          a + 3.0f * increment,
+          a + 4.0f * increment);
+      amplitude_step[i] = SplatLanes(increment * kNumLanes);
+      amplitude_[i] = target;
+    }
+    
+    while (size >= 3 * kNumLanes) {
+      RenderVectors<first_harmonic_index, 3>(
+          &fm, amplitude, amplitude_step, out);
+      out += 3 * kNumLanes;
+      size -= 3 * kNumLanes;
+    }
+    if (size == 2 * kNumLanes) {
+      RenderVectors<first_harmonic_index, 2>(
+          &fm, amplitude, amplitude_step, out);
+    } else if (size == kNumLanes) {
+      RenderVectors<first_harmonic_index, 1>(
+          &fm, amplitude, amplitude_step, out);
+    }
+  }
+#endif  // PLAITS_SIMD
+
+  template<int first_harmonic_index>
+  void RenderScalar(
+      float frequency,
+      const float* amplitudes,
+      float* out,
+      size_t size) {
     if (frequency >= 0.5f) {
       frequency = 0.5f;
     }
@@ -105,6 +177,99 @@ class HarmonicOscillator {
   }
 
  private:
+#ifdef PLAITS_SIMD
+  // State of the recurrence for a vector of kNumLanes samples.
+  struct Recurrence {
+    LaneFloat two_x;
+    LaneFloat previous;
+    LaneFloat current;
+    LaneFloat sum;
+  };
+  
+  template<int first_harmonic_index>
+  inline void Start(stmlib::ParameterInterpolator* fm, Recurrence* r) {
+    float two_x[kNumLanes];
+    float previous[kNumLanes];
+    float current[kNumLanes];
+    for (size_t lane = 0; lane < kNumLanes; ++lane) {
+      phase_ += fm->Next();
+      if (phase_ >= 1.0f) {
+        phase_ -= 1.0f;
+      }
+      two_x[lane] = 2.0f * SineNoWrap(phase_);
+      if (first_harmonic_index == 1) {
+        previous[lane] = 1.0f;
+        current[lane] = two_x[lane] * 0.5f;
+      } else {
+        const float k = first_harmonic_index;
+        previous[lane] = Sine(phase_ * (k - 1.0f) + 0.25f);
+        current[lane] = Sine(phase_ * k);
+      }
+    }
+    r->two_x = SetLanes(two_x[0], two_x[1], two_x[2], two_x[3]);
+    r->previous = SetLanes(previous[0], previous[1], previous[2], previous[3]);
+    r->current = SetLanes(current[0], current[1], current[2], current[3]);
+    r->sum = SplatLanes(0.0f);
+  }
+  
+  static inline void Step(Recurrence* r, LaneFloat amplitude) {
+    r->sum = AddLanes(r->sum, MulLanes(amplitude, r->current));
+    LaneFloat temp = r->current;
+    r->current = SubLanes(MulLanes(r->two_x, r->current), r->previous);
+    r->previous = temp;
+  }
+  
+  template<int first_harmonic_index>
+  static inline void Finish(const Recurrence& r, float* out) {
+    if (first_harmonic_index == 1) {
+      StoreLanes(out, r.sum);
+    } else {
+      StoreLanes(out, AddLanes(LoadLanes(out), r.sum));
+    }
+  }
+  
+  // The state of the recurrences is only accessed with constant indices, so
+  // that it can be kept in registers.
+  template<int first_harmonic_index, int num_vectors>
+  inline void RenderVectors(
+      stmlib::ParameterInterpolator* fm,
+      LaneFloat* amplitude,
+      const LaneFloat* amplitude_step,
+      float* out) {
+    Recurrence r[3];
+    Start<first_harmonic_index>(fm, &r[0]);
+    if (num_vectors > 1) {
+      Start<first_harmonic_index>(fm, &r[1]);
+    }
+    if (num_vectors > 2) {
+      Start<first_harmonic_index>(fm, &r[2]);
+    }
+    
+    for (int i = 0; i < num_harmonics; ++i) {
+      const LaneFloat step = amplitude_step[i];
+      LaneFloat a = amplitude[i];
+      Step(&r[0], a);
+      if (num_vectors > 1) {
+        a = AddLanes(a, step);
+        Step(&r[1], a);
+      }
+      if (num_vectors > 2) {
+        a = AddLanes(a, step);
+        Step(&r[2], a);
+      }
+      amplitude[i] = AddLanes(a, step);
+    }
+    
+    Finish<first_harmonic_index>(r[0], &out[0]);
+    if (num_vectors > 1) {
+      Finish<first_harmonic_index>(r[1], &out[kNumLanes]);
+    }
+    if (num_vectors > 2) {
+      Finish<first_harmonic_index>(r[2], &out[2 * kNumLanes]);
+    }
+  }
+#endif  // PLAITS_SIMD
+
   // Oscillator state.
   float phase_;
 
@@ -36,6 +36,7 @@
 #include "stmlib/dsp/parameter_interpolator.h"
 #include "stmlib/dsp/rsqrt.h"
 
+#include "plaits/dsp/simd.h"
 #include "plaits/resources.h"
 
 namespace plaits {
@@ -70,6 +71,84 @@ inline float SinePM(uint32_t phase, float pm) {
   return a + (b - a) * fractional;
 }
 
+// SinePM, evaluated on 4 lanes. Same result as SinePM on each lane.
+#if defined(__SSE2__)
+
+inline LaneFloat SinePMLanes(LaneUint32 phase, LaneFloat pm) {
+  const __m128 offset = _mm_set1_ps(32.0f);
+  const __m128 scale = _mm_set1_ps(4294967296.0f / 64.0f);
+  const __m128 wrap = _mm_set1_ps(2147483648.0f);
+
+  // Only the 26 LSBs of the integral part of x are used, so x can be wrapped
+  // by 2^31 to fit in the range of the (signed) conversion instruction.
+  __m128 x = _mm_mul_ps(_mm_add_ps(pm, offset), scale);
+  x = _mm_sub_ps(x, _mm_and_ps(_mm_cmpge_ps(x, wrap), wrap));
+  phase = _mm_add_epi32(phase, _mm_slli_epi32(_mm_cvttps_epi32(x), 6));
+
+  uint32_t integral[kNumLanes];
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(integral),
+      _mm_srli_epi32(phase, 32 - kSineLUTBits));
+
+  // Unsigned to float conversion, in two exact halves.
+  __m128i fractional_u32 = _mm_slli_epi32(phase, kSineLUTBits);
+  __m128 fractional = _mm_add_ps(
+      _mm_mul_ps(
+          _mm_cvtepi32_ps(_mm_srli_epi32(fractional_u32, 16)),
+          _mm_set1_ps(65536.0f)),
+      _mm_cvtepi32_ps(_mm_and_si128(fractional_u32, _mm_set1_epi32(0xffff))));
+  fractional = _mm_mul_ps(fractional, _mm_set1_ps(1.0f / 4294967296.0f));
+
+  __m128 a = _mm_set_ps(
+      lut_sine[integral[3]],
+      lut_sine[integral[2]],
+      lut_sine[integral[1]],
+      lut_sine[integral[0]]);
+  __m128 b = _mm_set_ps(
+      lut_sine[integral[3] + 1],
+      lut_sine[integral[2] + 1],
+      lut_sine[integral[1] + 1],
+      lut_sine[integral[0] + 1]);
+  return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fractional));
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+inline LaneFloat SinePMLanes(LaneUint32 phase, LaneFloat pm) {
+  float32x4_t x = vmulq_f32(
+      vaddq_f32(pm, vdupq_n_f32(32.0f)),
+      vdupq_n_f32(4294967296.0f / 64.0f));
+  phase = vaddq_u32(phase, vshlq_n_u32(vcvtq_u32_f32(x), 6));
+
+  uint32_t integral[kNumLanes];
+  vst1q_u32(integral, vshrq_n_u32(phase, 32 - kSineLUTBits));
+  float32x4_t fractional = vmulq_f32(
+      vcvtq_f32_u32(vshlq_n_u32(phase, kSineLUTBits)),
+      vdupq_n_f32(1.0f / 4294967296.0f));
+
+  float a_lanes[kNumLanes];
+  float b_lanes[kNumLanes];
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    a_lanes[i] = lut_sine[integral[i]];
+    b_lanes[i] = lut_sine[integral[i] + 1];
+  }
+  float32x4_t a = vld1q_f32(a_lanes);
+  float32x4_t b = vld1q_f32(b_lanes);
+  return vaddq_f32(a, vmulq_f32(vsubq_f32(b, a), fractional));
+}
+
+#else
+
+inline LaneFloat SinePMLanes(const LaneUint32& phase, const LaneFloat& pm) {
+  LaneFloat r;
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    r.x[i] = SinePM(phase.x[i], pm.x[i]);
+  }
+  return r;
+}
+
+#endif  // __SSE2__, __ARM_NEON
+
 // Direct lookup without interpolation.
 inline float SineRaw(uint32_t phase) {
   return lut_sine[phase >> (32 - kSineLUTBits)];
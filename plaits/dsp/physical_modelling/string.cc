@@ -33,9 +33,9 @@
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/parameter_interpolator.h"
 #include "stmlib/dsp/units.h"
-#include "stmlib/utils/random.h"
 
 #include "plaits/dsp/dsp.h"
+#include "plaits/dsp/random.h"
 #include "plaits/resources.h"
 
 namespace plaits {
@@ -31,9 +31,9 @@
 #include <algorithm>
 
 #include "stmlib/dsp/units.h"
-#include "stmlib/utils/random.h"
 
 #include "plaits/dsp/noise/dust.h"
+#include "plaits/dsp/random.h"
 
 namespace plaits {
 
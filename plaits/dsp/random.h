@@ -0,0 +1,83 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+//
+// -----------------------------------------------------------------------------
+//
+// Random number generator used by the DSP code.
+//
+// On the module, this is stmlib's generator, whose state is global. Hosts
+// rendering several voices in parallel threads define
+// PLAITS_THREAD_LOCAL_RANDOM: each thread then has its own state, which they
+// can save and restore around the rendering of each voice, so that the output
+// of a voice does not depend on how the voices are scheduled.
+
+#ifndef PLAITS_DSP_RANDOM_H_
+#define PLAITS_DSP_RANDOM_H_
+
+#include "stmlib/stmlib.h"
+
+#include "stmlib/utils/random.h"
+
+namespace plaits {
+
+#ifdef PLAITS_THREAD_LOCAL_RANDOM
+
+class Random {
+ public:
+  static inline uint32_t state() { return mutable_state(); }
+
+  static inline void Seed(uint32_t seed) { mutable_state() = seed; }
+
+  // Same sequence as stmlib::Random.
+  static inline uint32_t GetWord() {
+    uint32_t& s = mutable_state();
+    s = s * 1664525L + 1013904223L;
+    return s;
+  }
+
+  static inline int16_t GetSample() {
+    return static_cast<int16_t>(GetWord() >> 16);
+  }
+
+  static inline float GetFloat() {
+    return static_cast<float>(GetWord()) / 4294967296.0f;
+  }
+
+ private:
+  static inline uint32_t& mutable_state() {
+    static __thread uint32_t state = 0x21;
+    return state;
+  }
+};
+
+#else
+
+typedef stmlib::Random Random;
+
+#endif  // PLAITS_THREAD_LOCAL_RANDOM
+
+}  // namespace plaits
+
+#endif  // PLAITS_DSP_RANDOM_H_
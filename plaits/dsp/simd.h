@@ -0,0 +1,303 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// 4-lane float (and unsigned integer) operations, mapped to SSE2 or NEON when
+// available. The scalar fallback produces the same results as the vector
+// versions.
+//
+// PLAITS_SIMD is defined when the lanes map to actual vector registers. The
+// firmware doesn't define it, and keeps using the scalar code paths.
+
+#ifndef PLAITS_DSP_SIMD_H_
+#define PLAITS_DSP_SIMD_H_
+
+#include "stmlib/stmlib.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PLAITS_SIMD
+#endif
+
+namespace plaits {
+
+const size_t kNumLanes = 4;
+
+#if defined(__SSE2__)
+
+typedef __m128 LaneFloat;
+typedef __m128i LaneUint32;
+typedef __m128 LaneMask;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return _mm_loadu_ps(p);
+}
+
+inline LaneUint32 LoadLanes(const uint32_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  _mm_storeu_ps(p, x);
+}
+
+inline void StoreLanes(uint32_t* p, LaneUint32 x) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return _mm_set1_ps(x);
+}
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  return _mm_setr_ps(a, b, c, d);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return _mm_add_ps(a, b);
+}
+
+inline LaneUint32 AddLanes(LaneUint32 a, LaneUint32 b) {
+  return _mm_add_epi32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return _mm_sub_ps(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return _mm_mul_ps(a, b);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+  return _mm_div_ps(a, b);
+}
+
+inline LaneMask LessLanes(LaneFloat a, LaneFloat b) {
+  return _mm_cmplt_ps(a, b);
+}
+
+inline LaneFloat SelectLanes(LaneMask mask, LaneFloat a, LaneFloat b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Lane i of the result is the sum of the lanes of the i-th argument.
+inline LaneFloat SumLanes(LaneFloat a, LaneFloat b, LaneFloat c, LaneFloat d) {
+  _MM_TRANSPOSE4_PS(a, b, c, d);
+  return _mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d));
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+typedef float32x4_t LaneFloat;
+typedef uint32x4_t LaneUint32;
+typedef uint32x4_t LaneMask;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return vld1q_f32(p);
+}
+
+inline LaneUint32 LoadLanes(const uint32_t* p) {
+  return vld1q_u32(p);
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  vst1q_f32(p, x);
+}
+
+inline void StoreLanes(uint32_t* p, LaneUint32 x) {
+  vst1q_u32(p, x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return vdupq_n_f32(x);
+}
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  const float x[kNumLanes] = { a, b, c, d };
+  return vld1q_f32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return vaddq_f32(a, b);
+}
+
+inline LaneUint32 AddLanes(LaneUint32 a, LaneUint32 b) {
+  return vaddq_u32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return vsubq_f32(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return vmulq_f32(a, b);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  // No division on ARMv7 NEON: refine the reciprocal estimate twice. The
+  // result can differ from the scalar code in the last bit.
+  float32x4_t r = vrecpeq_f32(b);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+#endif  // __aarch64__
+}
+
+inline LaneMask LessLanes(LaneFloat a, LaneFloat b) {
+  return vcltq_f32(a, b);
+}
+
+inline LaneFloat SelectLanes(LaneMask mask, LaneFloat a, LaneFloat b) {
+  return vbslq_f32(mask, a, b);
+}
+
+inline LaneFloat SumLanes(LaneFloat a, LaneFloat b, LaneFloat c, LaneFloat d) {
+  float32x4x2_t ab = vtrnq_f32(a, b);
+  float32x4x2_t cd = vtrnq_f32(c, d);
+  float32x4_t ab_sum = vaddq_f32(ab.val[0], ab.val[1]);
+  float32x4_t cd_sum = vaddq_f32(cd.val[0], cd.val[1]);
+  return vaddq_f32(
+      vcombine_f32(vget_low_f32(ab_sum), vget_low_f32(cd_sum)),
+      vcombine_f32(vget_high_f32(ab_sum), vget_high_f32(cd_sum)));
+}
+
+#else
+
+struct LaneFloat {
+  float x[kNumLanes];
+};
+
+struct LaneUint32 {
+  uint32_t x[kNumLanes];
+};
+
+struct LaneMask {
+  bool x[kNumLanes];
+};
+
+#define PLAITS_LANE_LOOP(expression) \
+  LaneFloat r; \
+  for (size_t i = 0; i < kNumLanes; ++i) { \
+    r.x[i] = expression; \
+  } \
+  return r;
+
+inline LaneFloat LoadLanes(const float* p) {
+  PLAITS_LANE_LOOP(p[i])
+}
+
+inline void StoreLanes(float* p, const LaneFloat& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    p[i] = x.x[i];
+  }
+}
+
+inline LaneFloat SplatLanes(float x) {
+  PLAITS_LANE_LOOP(x)
+}
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  const float x[kNumLanes] = { a, b, c, d };
+  return LoadLanes(x);
+}
+
+inline LaneFloat AddLanes(const LaneFloat& a, const LaneFloat& b) {
+  PLAITS_LANE_LOOP(a.x[i] + b.x[i])
+}
+
+inline LaneFloat SubLanes(const LaneFloat& a, const LaneFloat& b) {
+  PLAITS_LANE_LOOP(a.x[i] - b.x[i])
+}
+
+inline LaneFloat MulLanes(const LaneFloat& a, const LaneFloat& b) {
+  PLAITS_LANE_LOOP(a.x[i] * b.x[i])
+}
+
+inline LaneFloat DivLanes(const LaneFloat& a, const LaneFloat& b) {
+  PLAITS_LANE_LOOP(a.x[i] / b.x[i])
+}
+
+inline LaneFloat SelectLanes(
+    const LaneMask& mask,
+    const LaneFloat& a,
+    const LaneFloat& b) {
+  PLAITS_LANE_LOOP(mask.x[i] ? a.x[i] : b.x[i])
+}
+
+inline LaneFloat SumLanes(
+    const LaneFloat& a,
+    const LaneFloat& b,
+    const LaneFloat& c,
+    const LaneFloat& d) {
+  const LaneFloat* v[kNumLanes] = { &a, &b, &c, &d };
+  PLAITS_LANE_LOOP((v[i]->x[0] + v[i]->x[1]) + (v[i]->x[2] + v[i]->x[3]))
+}
+
+#undef PLAITS_LANE_LOOP
+
+inline LaneMask LessLanes(const LaneFloat& a, const LaneFloat& b) {
+  LaneMask r;
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    r.x[i] = a.x[i] < b.x[i];
+  }
+  return r;
+}
+
+inline LaneUint32 LoadLanes(const uint32_t* p) {
+  LaneUint32 r;
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    r.x[i] = p[i];
+  }
+  return r;
+}
+
+inline void StoreLanes(uint32_t* p, const LaneUint32& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    p[i] = x.x[i];
+  }
+}
+
+inline LaneUint32 AddLanes(const LaneUint32& a, const LaneUint32& b) {
+  LaneUint32 r;
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    r.x[i] = a.x[i] + b.x[i];
+  }
+  return r;
+}
+
+#endif  // __SSE2__, __ARM_NEON
+
+}  // namespace plaits
+
+#endif  // PLAITS_DSP_SIMD_H_
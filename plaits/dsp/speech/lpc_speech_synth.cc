@@ -30,9 +30,8 @@
 
 #include <algorithm>
 
-#include "stmlib/utils/random.h"
-
 #include "plaits/dsp/oscillator/oscillator.h"
+#include "plaits/dsp/random.h"
 #include "plaits/resources.h"
 
 namespace plaits {
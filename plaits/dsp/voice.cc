@@ -34,35 +34,93 @@ namespace plaits {
 using namespace std;
 using namespace stmlib;
 
-void Voice::Init(BufferAllocator* allocator) {
-  engines_.Init();
+// Output gains (a negative value indicates that a limiter must be used), and
+// whether the engine renders a signal that already has an envelope.
+const PostProcessingSettings engine_settings[kMaxEngines] = {
+  { 1.0f, 1.0f, false },  // Virtual analog VCF
+  { 0.7f, 0.7f, false },  // Phase distortion
+  { 1.0f, 1.0f, true },  // 6-op FM (bank 1)
+  { 1.0f, 1.0f, true },  // 6-op FM (bank 2)
+  { 1.0f, 1.0f, true },  // 6-op FM (bank 3)
+  { 0.7f, 0.7f, false },  // Wave terrain
+  { 0.8f, 0.8f, false },  // String machine
+  { 0.5f, 0.5f, false },  // Chiptune
+  
+  { 0.8f, 0.8f, false },  // Virtual analog
+  { 0.7f, 0.6f, false },  // Waveshaping
+  { 0.6f, 0.6f, false },  // 2-op FM
+  { 0.7f, 0.6f, false },  // Grain
+  { 0.8f, 0.8f, false },  // Additive
+  { 0.6f, 0.6f, false },  // Wavetable
+  { 0.8f, 0.8f, false },  // Chord
+  { -0.7f, 0.8f, false },  // Speech
+  
+  { -3.0f, 1.0f, false },  // Swarm
+  { -1.0f, -1.0f, false },  // Noise
+  { -2.0f, 1.0f, false },  // Particle
+  { -1.0f, 0.8f, true },  // String
+  { -1.0f, 0.8f, true },  // Modal
+  { 0.8f, 0.8f, true },  // Bass drum
+  { 0.8f, 0.8f, true },  // Snare drum
+  { 0.8f, 0.8f, true },  // Hi-hat
+};
+
+#ifdef PLAITS_ENGINE_POOL
+
+// Duration of the cross-fade between the previous and new engine.
+const float kEngineCrossfadeDuration = 0.005f;
+
+void Voice::Init(EnginePool* engine_pool) {
+  engine_pool_ = engine_pool;
+  engine_slot_ = -1;
+  previous_engine_slot_ = -1;
+  crossfade_ = 0.0f;
+  
+  engine_quantizer_.Init(kMaxEngines, 0.05f, true);
+  InitState();
+}
+
+#else
 
-  engines_.RegisterInstance(&virtual_analog_vcf_engine_, false, 1.0f, 1.0f);
-  engines_.RegisterInstance(&phase_distortion_engine_, false, 0.7f, 0.7f);
-  engines_.RegisterInstance(&six_op_engine_, true, 1.0f, 1.0f);
-  engines_.RegisterInstance(&six_op_engine_, true, 1.0f, 1.0f);
-  engines_.RegisterInstance(&six_op_engine_, true, 1.0f, 1.0f);
-  engines_.RegisterInstance(&wave_terrain_engine_, false, 0.7f, 0.7f);
-  engines_.RegisterInstance(&string_machine_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&chiptune_engine_, false, 0.5f, 0.5f);
+void Voice::Init(BufferAllocator* allocator) {
+  Engine* engines[kMaxEngines] = {
+    &virtual_analog_vcf_engine_,
+    &phase_distortion_engine_,
+    &six_op_engine_,
+    &six_op_engine_,
+    &six_op_engine_,
+    &wave_terrain_engine_,
+    &string_machine_engine_,
+    &chiptune_engine_,
+    
+    &virtual_analog_engine_,
+    &waveshaping_engine_,
+    &fm_engine_,
+    &grain_engine_,
+    &additive_engine_,
+    &wavetable_engine_,
+    &chord_engine_,
+    &speech_engine_,
+    
+    &swarm_engine_,
+    &noise_engine_,
+    &particle_engine_,
+    &string_engine_,
+    &modal_engine_,
+    &bass_drum_engine_,
+    &snare_drum_engine_,
+    &hi_hat_engine_
+  };
   
-  engines_.RegisterInstance(&virtual_analog_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&waveshaping_engine_, false, 0.7f, 0.6f);
-  engines_.RegisterInstance(&fm_engine_, false, 0.6f, 0.6f);
-  engines_.RegisterInstance(&grain_engine_, false, 0.7f, 0.6f);
-  engines_.RegisterInstance(&additive_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&wavetable_engine_, false, 0.6f, 0.6f);
-  engines_.RegisterInstance(&chord_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&speech_engine_, false, -0.7f, 0.8f);
-
-  engines_.RegisterInstance(&swarm_engine_, false, -3.0f, 1.0f);
-  engines_.RegisterInstance(&noise_engine_, false, -1.0f, -1.0f);
-  engines_.RegisterInstance(&particle_engine_, false, -2.0f, 1.0f);
-  engines_.RegisterInstance(&string_engine_, true, -1.0f, 0.8f);
-  engines_.RegisterInstance(&modal_engine_, true, -1.0f, 0.8f);
-  engines_.RegisterInstance(&bass_drum_engine_, true, 0.8f, 0.8f);
-  engines_.RegisterInstance(&snare_drum_engine_, true, 0.8f, 0.8f);
-  engines_.RegisterInstance(&hi_hat_engine_, true, 0.8f, 0.8f);
+  engines_.Init();
+  for (int i = 0; i < kMaxEngines; ++i) {
+    const PostProcessingSettings& s = engine_settings[i];
+    engines_.RegisterInstance(
+        engines[i],
+        s.already_enveloped,
+        s.out_gain,
+        s.aux_gain);
+  }
   
   for (int i = 0; i < engines_.size(); ++i) {
     // All engines will share the same RAM space.
@@ -71,12 +129,26 @@ void Voice::Init(BufferAllocator* allocator) {
   }
   
   engine_quantizer_.Init(engines_.size(), 0.05f, true);
+  InitState();
+}
+
+#endif  // PLAITS_ENGINE_POOL
+
+void Voice::InitState() {
   previous_engine_index_ = -1;
   reload_user_data_ = false;
   engine_cv_ = 0.0f;
   
+#ifdef PLAITS_ENGINE_POOL
+  for (int i = 0; i < 2; ++i) {
+    post_processors_[i][0].Init();
+    post_processors_[i][1].Init();
+  }
+  post_processors_index_ = 0;
+#else
   out_post_processor_.Init();
   aux_post_processor_.Init();
+#endif  // PLAITS_ENGINE_POOL
 
   decay_envelope_.Init();
   lpg_envelope_.Init();
@@ -87,6 +159,87 @@ void Voice::Init(BufferAllocator* allocator) {
   trigger_delay_.Init(trigger_delay_line_);
 }
 
+#ifdef PLAITS_ENGINE_POOL
+
+bool Voice::SwitchEngine(int engine_index, bool* resumed) {
+  // Only two engines can be mixed: a third one has to wait for the end of the
+  // cross-fade, rather than cutting off the engine being faded out.
+  if (previous_engine_slot_ != -1 &&
+      engine_pool_->engine_index(previous_engine_slot_) != engine_index) {
+    return false;
+  }
+  
+  int slot = engine_pool_->Acquire(this, engine_index);
+  if (slot == -1) {
+    return false;
+  }
+  
+  post_processors_index_ ^= 1;
+  *resumed = slot == previous_engine_slot_;
+  if (*resumed) {
+    // Back to the engine we were fading out from, and to its post-processors.
+    // It is still playing, so it must not be reset.
+    previous_engine_slot_ = engine_slot_;
+    crossfade_ = 1.0f - crossfade_;
+  } else {
+    previous_engine_slot_ = engine_slot_;
+    crossfade_ = previous_engine_slot_ != -1 ? 1.0f : 0.0f;
+    post_processors_[post_processors_index_][0].Init();
+    post_processors_[post_processors_index_][1].Init();
+  }
+  engine_slot_ = slot;
+  engine_pool_->engine(slot)->post_processing_settings = \
+      engine_settings[engine_index];
+  return true;
+}
+
+void Voice::RenderCrossfade(
+    Engine* previous,
+    bool lpg_bypass,
+    Frame* frames,
+    size_t size) {
+  // The previous engine goes through its own post-processing chain, with its
+  // own gain and LPG bypass decision, before being mixed with the new one.
+  ChannelPostProcessor* pp = post_processors_[post_processors_index_ ^ 1];
+  const PostProcessingSettings& pp_s = previous->post_processing_settings;
+  pp[0].Process(
+      pp_s.out_gain,
+      lpg_bypass,
+      lpg_envelope_.gain(),
+      lpg_envelope_.frequency(),
+      lpg_envelope_.hf_bleed(),
+      previous_out_buffer_,
+      &previous_frames_[0].out,
+      size,
+      2);
+  pp[1].Process(
+      pp_s.aux_gain,
+      lpg_bypass,
+      lpg_envelope_.gain(),
+      lpg_envelope_.frequency(),
+      lpg_envelope_.hf_bleed(),
+      previous_aux_buffer_,
+      &previous_frames_[0].aux,
+      size,
+      2);
+  
+  const float decrement = 1.0f / (kEngineCrossfadeDuration * kSampleRate);
+  for (size_t i = 0; i < size; ++i) {
+    crossfade_ = max(crossfade_ - decrement, 0.0f);
+    frames[i].out += static_cast<short>(
+        crossfade_ * float(previous_frames_[i].out - frames[i].out));
+    frames[i].aux += static_cast<short>(
+        crossfade_ * float(previous_frames_[i].aux - frames[i].aux));
+  }
+  
+  if (crossfade_ == 0.0f) {
+    engine_pool_->Release(previous_engine_slot_);
+    previous_engine_slot_ = -1;
+  }
+}
+
+#endif  // PLAITS_ENGINE_POOL
+
 void Voice::Render(
     const Patch& patch,
     const Modulations& modulations,
@@ -123,9 +276,38 @@ void Voice::Render(
       patch.engine,
       engine_cv_);
   
+#ifdef PLAITS_ENGINE_POOL
+  bool reset_engine = reload_user_data_;
+  if (engine_index != previous_engine_index_) {
+    bool resumed = false;
+    if (SwitchEngine(engine_index, &resumed)) {
+      reset_engine = reset_engine || !resumed;
+    } else {
+      // The pool is full, or a cross-fade is in progress: keep playing the
+      // current engine, and try again on the next block.
+      engine_index = previous_engine_index_;
+    }
+  }
+  if (engine_index == -1) {
+    for (size_t i = 0; i < size; ++i) {
+      frames[i].out = frames[i].aux = 0;
+    }
+    return;
+  }
+  Engine* e = engine_pool_->engine(engine_slot_);
+  ChannelPostProcessor& out_post_processor = \
+      post_processors_[post_processors_index_][0];
+  ChannelPostProcessor& aux_post_processor = \
+      post_processors_[post_processors_index_][1];
+#else
+  bool reset_engine = engine_index != previous_engine_index_ || \
+      reload_user_data_;
   Engine* e = engines_.get(engine_index);
+  ChannelPostProcessor& out_post_processor = out_post_processor_;
+  ChannelPostProcessor& aux_post_processor = aux_post_processor_;
+#endif  // PLAITS_ENGINE_POOL
   
-  if (engine_index != previous_engine_index_ || reload_user_data_) {
+  if (reset_engine) {
     UserData user_data;
     const uint8_t* data = user_data.ptr(engine_index);
     if (!data && engine_index >= 2 && engine_index <= 4) {
@@ -134,10 +316,10 @@ void Voice::Render(
     e->LoadUserData(data);
     e->Reset();
 
-    out_post_processor_.Reset();
-    previous_engine_index_ = engine_index;
-    reload_user_data_ = false;
+    out_post_processor.Reset();
   }
+  previous_engine_index_ = engine_index;
+  reload_user_data_ = false;
   EngineParameters p;
 
   bool rising_edge = trigger_state_ && !previous_trigger_state;
@@ -173,10 +355,11 @@ void Voice::Render(
   if (engine_index == 15) {
     internal_envelope_amplitude = 2.0f - p.harmonics * 6.0f;
     CONSTRAIN(internal_envelope_amplitude, 0.0f, 1.0f);
-    speech_engine_.set_prosody_amount(
+    SpeechEngine* speech_engine = static_cast<SpeechEngine*>(e);
+    speech_engine->set_prosody_amount(
         !modulations.trigger_patched || modulations.frequency_patched ?
             0.0f : patch.frequency_modulation_amount);
-    speech_engine_.set_speed( 
+    speech_engine->set_speed(
         !modulations.trigger_patched || modulations.morph_patched ?
             0.0f : patch.morph_modulation_amount);
   } else if (engine_index == 7) {
@@ -184,9 +367,11 @@ void Voice::Render(
       // Disable internal envelope on TIMBRE, and enable the envelope generator
       // built into the chiptune engine.
       internal_envelope_amplitude_timbre = 0.0f;
-      chiptune_engine_.set_envelope_shape(patch.timbre_modulation_amount);
+      static_cast<ChiptuneEngine*>(e)->set_envelope_shape(
+          patch.timbre_modulation_amount);
     } else {
-      chiptune_engine_.set_envelope_shape(ChiptuneEngine::NO_ENVELOPE);
+      static_cast<ChiptuneEngine*>(e)->set_envelope_shape(
+          ChiptuneEngine::NO_ENVELOPE);
     }
   }
   
@@ -229,9 +414,29 @@ void Voice::Render(
   
   bool lpg_bypass = already_enveloped || \
       (!modulations.level_patched && !modulations.trigger_patched);
+  bool use_lpg = !lpg_bypass;
+
+#ifdef PLAITS_ENGINE_POOL
+  Engine* previous = NULL;
+  bool previous_lpg_bypass = true;
+  if (previous_engine_slot_ != -1) {
+    previous = engine_pool_->engine(previous_engine_slot_);
+    bool previous_already_enveloped = \
+        previous->post_processing_settings.already_enveloped;
+    previous->Render(
+        p,
+        previous_out_buffer_,
+        previous_aux_buffer_,
+        size,
+        &previous_already_enveloped);
+    previous_lpg_bypass = previous_already_enveloped || \
+        (!modulations.level_patched && !modulations.trigger_patched);
+    use_lpg = use_lpg || !previous_lpg_bypass;
+  }
+#endif  // PLAITS_ENGINE_POOL
   
   // Compute LPG parameters.
-  if (!lpg_bypass) {
+  if (use_lpg) {
     const float hf = patch.lpg_colour;
     const float decay_tail = (20.0f * kBlockSize) / kSampleRate *
         SemitonesToRatio(-72.0f * patch.decay + 12.0f * hf) - short_decay;
@@ -246,7 +451,7 @@ void Voice::Render(
     lpg_envelope_.Init();
   }
   
-  out_post_processor_.Process(
+  out_post_processor.Process(
       pp_s.out_gain,
       lpg_bypass,
       lpg_envelope_.gain(),
@@ -257,7 +462,7 @@ void Voice::Render(
       size,
       2);
 
-  aux_post_processor_.Process(
+  aux_post_processor.Process(
       pp_s.aux_gain,
       lpg_bypass,
       lpg_envelope_.gain(),
@@ -267,6 +472,12 @@ void Voice::Render(
       &frames->aux,
       size,
       2);
+
+#ifdef PLAITS_ENGINE_POOL
+  if (previous) {
+    RenderCrossfade(previous, previous_lpg_bypass, frames, size);
+  }
+#endif  // PLAITS_ENGINE_POOL
 }
   
 }  // namespace plaits
@@ -60,10 +60,17 @@
 #include "plaits/dsp/engine2/virtual_analog_vcf_engine.h"
 #include "plaits/dsp/engine2/wave_terrain_engine.h"
 
+#include "plaits/dsp/engine_pool.h"
 #include "plaits/dsp/envelope.h"
 
 #include "plaits/dsp/fx/low_pass_gate.h"
 
+// When enabled, the voice does not hold its own instance of each engine.
+// Instead, engines are constructed on demand in an EnginePool shared by all
+// voices, and the voice cross-fades between the old and new engines when the
+// model is changed. This is meant for software hosts running many voices.
+// #define PLAITS_ENGINE_POOL
+
 namespace plaits {
 
 const int kMaxEngines = 24;
@@ -166,7 +173,16 @@ class Voice {
     short aux;
   };
   
+#ifdef PLAITS_ENGINE_POOL
+  void Init(EnginePool* engine_pool);
+  
+  // Memory used by the voice, including the engines it holds in the pool.
+  inline size_t memory_usage() const {
+    return sizeof(*this) + engine_pool_->bytes_in_use(this);
+  }
+#else
   void Init(stmlib::BufferAllocator* allocator);
+#endif  // PLAITS_ENGINE_POOL
   void ReloadUserData() {
     reload_user_data_ = true;
   }
@@ -179,6 +195,16 @@ class Voice {
     
  private:
   void ComputeDecayParameters(const Patch& settings);
+  void InitState();
+
+#ifdef PLAITS_ENGINE_POOL
+  bool SwitchEngine(int engine_index, bool* resumed);
+  void RenderCrossfade(
+      Engine* previous,
+      bool lpg_bypass,
+      Frame* frames,
+      size_t size);
+#endif  // PLAITS_ENGINE_POOL
   
   inline float ApplyModulations(
       float base_value,
@@ -202,6 +228,16 @@ class Voice {
     return value;
   }
 
+#ifdef PLAITS_ENGINE_POOL
+  EnginePool* engine_pool_;
+  int engine_slot_;
+  int previous_engine_slot_;
+  float crossfade_;
+  
+  float previous_out_buffer_[kMaxBlockSize];
+  float previous_aux_buffer_[kMaxBlockSize];
+  Frame previous_frames_[kMaxBlockSize];
+#else
   VirtualAnalogEngine virtual_analog_engine_;
   WaveshapingEngine waveshaping_engine_;
   FMEngine fm_engine_;
@@ -227,6 +263,9 @@ class Voice {
   StringMachineEngine string_machine_engine_;
   ChiptuneEngine chiptune_engine_;
 
+  EngineRegistry<kMaxEngines> engines_;
+#endif  // PLAITS_ENGINE_POOL
+
   stmlib::HysteresisQuantizer2 engine_quantizer_;
   
   bool reload_user_data_;
@@ -242,10 +281,16 @@ class Voice {
   float trigger_delay_line_[kMaxTriggerDelay];
   DelayLine<float, kMaxTriggerDelay> trigger_delay_;
   
+#ifdef PLAITS_ENGINE_POOL
+  // The engine being faded out keeps its own post-processors (and thus its
+  // own limiter and LPG state). The two pairs swap roles on each engine
+  // change.
+  ChannelPostProcessor post_processors_[2][2];
+  int post_processors_index_;
+#else
   ChannelPostProcessor out_post_processor_;
   ChannelPostProcessor aux_post_processor_;
-  
-  EngineRegistry<kMaxEngines> engines_;
+#endif  // PLAITS_ENGINE_POOL
   
   float out_buffer_[kMaxBlockSize];
   float aux_buffer_[kMaxBlockSize];
@@ -0,0 +1,357 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Command line front-end for the render server.
+//
+// plaits_render render <events> <out.wav> [voices] [threads] [gain]
+//
+//   Renders a text file of events. Each line is:
+//
+//     <time in seconds> <voice> patch <field> <value>
+//     <time in seconds> <voice> mod <field> <value>
+//
+//   Where field is the name of a member of the Patch or Modulations structs.
+//   Each event updates the patch or modulations of the voice from that time
+//   onwards. Lines starting with # are ignored, the other lines can be in any
+//   order. The rendering stops 2s after the last event.
+//
+// plaits_render benchmark [voices] [seconds] [threads]
+//
+//   Renders random patches with 1, 2, 4... up to threads threads (by default,
+//   the number of cores), reports the number of voices that can be rendered in
+//   real time per core, and checks that the output does not depend on the
+//   number of threads. The pool scales linearly when the figure per core stays
+//   constant.
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "stmlib/test/wav_writer.h"
+
+#include "plaits/host/render_server.h"
+
+using namespace plaits;
+using namespace std;
+using namespace stmlib;
+
+const size_t kRenderBlockSize = 480;
+const float kTailDuration = 2.0f;
+
+enum FieldType {
+  FIELD_TYPE_FLOAT,
+  FIELD_TYPE_INT,
+  FIELD_TYPE_BOOL
+};
+
+struct Field {
+  const char* name;
+  size_t offset;
+  FieldType type;
+};
+
+#define FLOAT_FIELD(s, f) { #f, offsetof(s, f), FIELD_TYPE_FLOAT }
+#define INT_FIELD(s, f) { #f, offsetof(s, f), FIELD_TYPE_INT }
+#define BOOL_FIELD(s, f) { #f, offsetof(s, f), FIELD_TYPE_BOOL }
+
+const Field patch_fields[] = {
+  FLOAT_FIELD(Patch, note),
+  FLOAT_FIELD(Patch, harmonics),
+  FLOAT_FIELD(Patch, timbre),
+  FLOAT_FIELD(Patch, morph),
+  FLOAT_FIELD(Patch, frequency_modulation_amount),
+  FLOAT_FIELD(Patch, timbre_modulation_amount),
+  FLOAT_FIELD(Patch, morph_modulation_amount),
+  INT_FIELD(Patch, engine),
+  FLOAT_FIELD(Patch, decay),
+  FLOAT_FIELD(Patch, lpg_colour),
+  { NULL, 0, FIELD_TYPE_FLOAT }
+};
+
+const Field modulations_fields[] = {
+  FLOAT_FIELD(Modulations, engine),
+  FLOAT_FIELD(Modulations, note),
+  FLOAT_FIELD(Modulations, frequency),
+  FLOAT_FIELD(Modulations, harmonics),
+  FLOAT_FIELD(Modulations, timbre),
+  FLOAT_FIELD(Modulations, morph),
+  FLOAT_FIELD(Modulations, trigger),
+  FLOAT_FIELD(Modulations, level),
+  BOOL_FIELD(Modulations, frequency_patched),
+  BOOL_FIELD(Modulations, timbre_patched),
+  BOOL_FIELD(Modulations, morph_patched),
+  BOOL_FIELD(Modulations, trigger_patched),
+  BOOL_FIELD(Modulations, level_patched),
+  { NULL, 0, FIELD_TYPE_FLOAT }
+};
+
+bool SetField(const Field* fields, void* s, const char* name, float value) {
+  for (; fields->name; ++fields) {
+    if (!strcmp(fields->name, name)) {
+      uint8_t* p = static_cast<uint8_t*>(s) + fields->offset;
+      switch (fields->type) {
+        case FIELD_TYPE_FLOAT:
+          *reinterpret_cast<float*>(p) = value;
+          break;
+        
+        case FIELD_TYPE_INT:
+          *reinterpret_cast<int*>(p) = static_cast<int>(value);
+          break;
+        
+        case FIELD_TYPE_BOOL:
+          *reinterpret_cast<bool*>(p) = value != 0.0f;
+          break;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+double Now() {
+  timeval t;
+  gettimeofday(&t, NULL);
+  return double(t.tv_sec) + double(t.tv_usec) * 1e-6;
+}
+
+// A line of the events file.
+struct Line {
+  float time;
+  int voice;
+  char target[16];
+  char field[64];
+  float value;
+  int line_number;
+};
+
+bool CompareLines(const Line& a, const Line& b) {
+  return a.time < b.time || (a.time == b.time && a.voice < b.voice);
+}
+
+void InitEvent(Event* e, int voice) {
+  memset(e, 0, sizeof(Event));
+  e->voice = voice;
+  e->patch.note = 48.0f;
+  e->patch.harmonics = 0.5f;
+  e->patch.timbre = 0.5f;
+  e->patch.morph = 0.5f;
+  e->patch.decay = 0.5f;
+  e->patch.lpg_colour = 0.5f;
+}
+
+int Render(
+    const char* events_file_name,
+    const char* wav_file_name,
+    int num_voices,
+    int num_threads,
+    float gain) {
+  FILE* fp = fopen(events_file_name, "r");
+  if (!fp) {
+    fprintf(stderr, "Cannot open %s\n", events_file_name);
+    return 1;
+  }
+
+  // The lines of the file do not have to be in chronological order: parse
+  // them all, then sort them by time - keeping the file order for the lines
+  // sharing the same time.
+  vector<Line> lines;
+  char text[256];
+  int line_number = 0;
+  while (fgets(text, sizeof(text), fp)) {
+    ++line_number;
+    Line l;
+    if (text[0] == '#' || text[0] == '\n') {
+      continue;
+    }
+    if (sscanf(text, "%f %d %15s %63s %f",
+               &l.time, &l.voice, l.target, l.field, &l.value) != 5 ||
+        l.voice < 0 || l.voice >= num_voices) {
+      fprintf(stderr, "Line %d: syntax error\n", line_number);
+      continue;
+    }
+    l.line_number = line_number;
+    lines.push_back(l);
+  }
+  fclose(fp);
+  stable_sort(lines.begin(), lines.end(), CompareLines);
+
+  // Current state of each voice, updated as the events are applied.
+  vector<Event> state(num_voices);
+  for (int i = 0; i < num_voices; ++i) {
+    InitEvent(&state[i], i);
+  }
+
+  RenderServer server;
+  server.Init(num_voices, num_threads);
+
+  float duration = 0.0f;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    const Line& l = lines[i];
+    Event* e = &state[l.voice];
+    bool valid = false;
+    if (!strcmp(l.target, "patch")) {
+      e->type = Event::PATCH;
+      valid = SetField(patch_fields, &e->patch, l.field, l.value);
+    } else if (!strcmp(l.target, "mod")) {
+      e->type = Event::MODULATIONS;
+      valid = SetField(modulations_fields, &e->modulations, l.field, l.value);
+    }
+    if (!valid) {
+      fprintf(stderr, "Line %d: unknown field %s %s\n",
+              l.line_number, l.target, l.field);
+      continue;
+    }
+    e->time = static_cast<uint32_t>(l.time * kSampleRate);
+    server.Schedule(*e);
+    duration = max(duration, l.time);
+  }
+
+  duration += kTailDuration;
+  WavWriter wav_writer(2, kSampleRate, static_cast<size_t>(ceilf(duration)));
+  if (!wav_writer.Open(wav_file_name)) {
+    fprintf(stderr, "Cannot open %s\n", wav_file_name);
+    server.Stop();
+    return 1;
+  }
+
+  float out[kRenderBlockSize];
+  float aux[kRenderBlockSize];
+  while (!wav_writer.done()) {
+    size_t size = server.Render(out, aux, kRenderBlockSize);
+    for (size_t i = 0; i < size; ++i) {
+      out[i] *= gain;
+      aux[i] *= gain;
+    }
+    wav_writer.Write(out, aux, size);
+  }
+  server.Stop();
+  return 0;
+}
+
+// Random patches, on all engines.
+void ScheduleBenchmarkEvents(RenderServer* server, float duration) {
+  srand(0);
+  for (int i = 0; i < server->num_voices(); ++i) {
+    Event e;
+    InitEvent(&e, i);
+    e.type = Event::PATCH;
+    e.patch.engine = i % kMaxEngines;
+    e.patch.note = 36.0f + float(rand() % 36);
+    e.patch.harmonics = float(rand() % 100) / 100.0f;
+    e.patch.timbre = float(rand() % 100) / 100.0f;
+    e.patch.morph = float(rand() % 100) / 100.0f;
+    server->Schedule(e);
+
+    e.type = Event::MODULATIONS;
+    e.modulations.trigger_patched = true;
+    for (float t = 0.0f; t < duration; t += 0.25f) {
+      e.time = static_cast<uint32_t>(t * kSampleRate);
+      e.modulations.trigger = 1.0f;
+      server->Schedule(e);
+      e.time += kSampleRate / 100;
+      e.modulations.trigger = 0.0f;
+      server->Schedule(e);
+    }
+  }
+}
+
+int Benchmark(int num_voices, float duration, int max_threads) {
+  max_threads = max(max_threads, 1);
+  const size_t num_blocks = static_cast<size_t>(
+      duration * kSampleRate / kRenderBlockSize);
+
+  vector<float> reference(num_blocks * kRenderBlockSize);
+  vector<float> mix(num_blocks * kRenderBlockSize);
+  float out[kRenderBlockSize];
+  float aux[kRenderBlockSize];
+
+  printf("%d voices, %.1fs\n", num_voices, duration);
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    RenderServer server;
+    server.Init(num_voices, num_threads);
+    ScheduleBenchmarkEvents(&server, duration);
+
+    double start = Now();
+    for (size_t i = 0; i < num_blocks; ++i) {
+      server.Render(out, aux, kRenderBlockSize);
+      copy(&out[0], &out[kRenderBlockSize], &mix[i * kRenderBlockSize]);
+    }
+    double elapsed = Now() - start;
+    if (num_threads == 1) {
+      reference = mix;
+    }
+    const double realtime_voices = num_voices * duration / elapsed;
+    printf("%2d threads: %6.1f voices in real time, %5.1f per core, "
+           "%5d steals, output %s\n",
+           num_threads,
+           realtime_voices,
+           realtime_voices / num_threads,
+           server.thread_pool().num_steals(),
+           mix == reference ? "identical" : "DIFFERENT");
+    if (num_threads == 1) {
+      const EnginePool& pool = server.engine_pool();
+      printf("            %6.1f kB of engines per voice at most, "
+             "%d evictions\n",
+             double(pool.peak_live_engines() * pool.slot_size()) / \
+                 double(num_voices * 1024),
+             pool.num_evictions());
+    }
+    server.Stop();
+
+    if (num_threads * 2 > max_threads && num_threads != max_threads) {
+      num_threads = max_threads / 2;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 4 && !strcmp(argv[1], "render")) {
+    return Render(
+        argv[2],
+        argv[3],
+        argc > 4 ? atoi(argv[4]) : 8,
+        argc > 5 ? atoi(argv[5]) : int(sysconf(_SC_NPROCESSORS_ONLN)),
+        argc > 6 ? float(atof(argv[6])) : 0.25f);
+  } else if (argc >= 2 && !strcmp(argv[1], "benchmark")) {
+    return Benchmark(
+        argc > 2 ? atoi(argv[2]) : 64,
+        argc > 3 ? float(atof(argv[3])) : 5.0f,
+        argc > 4 ? atoi(argv[4]) : int(sysconf(_SC_NPROCESSORS_ONLN)));
+  }
+  fprintf(stderr, "Usage: %s render <events> <out.wav> "
+          "[voices] [threads] [gain]\n", argv[0]);
+  fprintf(stderr, "       %s benchmark [voices] [seconds] [threads]\n",
+          argv[0]);
+  return 1;
+}
@@ -0,0 +1,188 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Polyphonic 6-operator FM synth (host only).
+
+#include "plaits/host/poly_fm.h"
+
+#include <algorithm>
+
+namespace plaits {
+
+using namespace std;
+
+void PolyFM::Init(int num_voices, float sample_rate) {
+  algorithms_.Init();
+
+  num_voices_ = min(num_voices, kMaxNumPolyFMVoices);
+  for (int i = 0; i < num_voices_; ++i) {
+    voice_[i].Init(&algorithms_, sample_rate);
+    lfo_[i].Init(sample_rate);
+
+    fm::Voice<6>::Parameters* p = &parameters_[i];
+    p->sustain = false;
+    p->gate = false;
+    p->note = 48.0f;
+    p->velocity = 0.5f;
+    p->brightness = 0.5f;
+    p->envelope_control = 0.5f;
+    p->pitch_mod = 0.0f;
+    p->amp_mod = 0.0f;
+    patch_index_[i] = -1;
+  }
+
+  brightness_ = 0.5f;
+  envelope_control_ = 0.5f;
+  use_lanes_ = true;
+}
+
+void PolyFM::LoadBank(const uint8_t* sysex) {
+  for (int i = 0; i < kNumPolyFMPatches; ++i) {
+    patches_[i].Unpack(sysex + i * fm::Patch::SYX_SIZE);
+  }
+  for (int i = 0; i < num_voices_; ++i) {
+    parameters_[i].gate = false;
+    patch_index_[i] = -1;
+  }
+}
+
+void PolyFM::NoteOn(int voice, int patch, float note, float velocity) {
+  if (voice < 0 || voice >= num_voices_) {
+    return;
+  }
+  if (patch != patch_index_[voice]) {
+    patch_index_[voice] = patch;
+    voice_[voice].SetPatch(&patches_[patch]);
+    lfo_[voice].Set(patches_[patch].modulations);
+  }
+  lfo_[voice].Reset();
+  parameters_[voice].gate = true;
+  parameters_[voice].note = note;
+  parameters_[voice].velocity = velocity;
+}
+
+void PolyFM::NoteOff(int voice) {
+  if (voice < 0 || voice >= num_voices_) {
+    return;
+  }
+  parameters_[voice].gate = false;
+}
+
+void PolyFM::Render(float* out, size_t size) {
+  while (size) {
+    size_t block_size = min(size, kMaxBlockSize);
+    RenderBlock(out, block_size);
+    out += block_size;
+    size -= block_size;
+  }
+}
+
+void PolyFM::RenderBlock(float* out, size_t size) {
+  const int kNumAlgorithms = 32;
+  int num_voices_per_algorithm[kNumAlgorithms + 1];
+  fill(
+      &num_voices_per_algorithm[0],
+      &num_voices_per_algorithm[kNumAlgorithms + 1],
+      0);
+
+  for (int i = 0; i < num_voices_; ++i) {
+    fill(&voice_out_[i][0], &voice_out_[i][size], 0.0f);
+    if (patch_index_[i] == -1) {
+      continue;
+    }
+
+    fm::Voice<6>::Parameters* p = &parameters_[i];
+    lfo_[i].Step(float(size));
+    p->brightness = brightness_;
+    p->envelope_control = envelope_control_;
+    p->pitch_mod = lfo_[i].pitch_mod();
+    p->amp_mod = lfo_[i].amp_mod();
+
+    if (use_lanes_) {
+      ++num_voices_per_algorithm[patches_[patch_index_[i]].algorithm + 1];
+    } else {
+      RenderVoice(i, size);
+    }
+  }
+
+  if (use_lanes_) {
+    // Sort the voices by algorithm, then render them by groups of up to
+    // kNumVoiceLanes voices sharing the same algorithm. The lanes cost
+    // about as much as 3 voices rendered one after the other, so smaller
+    // groups are rendered one voice at a time.
+    int order[kMaxNumPolyFMVoices];
+    for (int i = 1; i <= kNumAlgorithms; ++i) {
+      num_voices_per_algorithm[i] += num_voices_per_algorithm[i - 1];
+    }
+    for (int i = 0; i < num_voices_; ++i) {
+      if (patch_index_[i] != -1) {
+        const int algorithm = patches_[patch_index_[i]].algorithm;
+        order[num_voices_per_algorithm[algorithm]++] = i;
+      }
+    }
+
+    const int num_active_voices = num_voices_per_algorithm[kNumAlgorithms];
+    int group[fm::kNumVoiceLanes];
+    int group_size = 0;
+    for (int i = 0; i < num_active_voices; ++i) {
+      const int algorithm = patches_[patch_index_[order[i]]].algorithm;
+      group[group_size++] = order[i];
+      const bool last = i == num_active_voices - 1 ||
+          patches_[patch_index_[order[i + 1]]].algorithm != algorithm;
+      if (!last && group_size != fm::kNumVoiceLanes) {
+        continue;
+      }
+
+      if (group_size >= kMinNumPolyFMLanes) {
+        fm::Voice<6>* voices[fm::kNumVoiceLanes];
+        fm::Voice<6>::Parameters parameters[fm::kNumVoiceLanes];
+        float* voice_out[fm::kNumVoiceLanes];
+        for (int j = 0; j < group_size; ++j) {
+          voices[j] = &voice_[group[j]];
+          parameters[j] = parameters_[group[j]];
+          voice_out[j] = voice_out_[group[j]];
+        }
+        fm::VoiceLanes<6>::Render(
+            voices, parameters, voice_out, group_size, size);
+      } else {
+        for (int j = 0; j < group_size; ++j) {
+          RenderVoice(group[j], size);
+        }
+      }
+      group_size = 0;
+    }
+  }
+
+  // Mix the voices, always in the same order.
+  fill(&out[0], &out[size], 0.0f);
+  for (int i = 0; i < num_voices_; ++i) {
+    for (size_t j = 0; j < size; ++j) {
+      out[j] += voice_out_[i][j];
+    }
+  }
+}
+
+}  // namespace plaits
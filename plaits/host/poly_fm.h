@@ -0,0 +1,117 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Polyphonic 6-operator FM synth (host only).
+//
+// Plays the patches of a DX7 bank on many fm::Voice<6>, without going through
+// SixOpEngine and its 2 voices. At each block, the voices are grouped by
+// algorithm, and each group is rendered kNumVoiceLanes voices at a time by
+// fm::VoiceLanes. The output is the same, bit for bit, as when the voices are
+// rendered one after the other.
+//
+// Voice allocation is left to the caller.
+
+#ifndef PLAITS_HOST_POLY_FM_H_
+#define PLAITS_HOST_POLY_FM_H_
+
+#include "stmlib/stmlib.h"
+
+#include "plaits/dsp/dsp.h"
+#include "plaits/dsp/fm/algorithms.h"
+#include "plaits/dsp/fm/lfo.h"
+#include "plaits/dsp/fm/patch.h"
+#include "plaits/dsp/fm/voice.h"
+#include "plaits/dsp/fm/voice_lanes.h"
+
+namespace plaits {
+
+const int kMaxNumPolyFMVoices = 64;
+const int kNumPolyFMPatches = 32;
+
+// Smallest group of voices rendered by fm::VoiceLanes.
+const int kMinNumPolyFMLanes = 3;
+
+class PolyFM {
+ public:
+  PolyFM() { }
+  ~PolyFM() { }
+
+  void Init(int num_voices, float sample_rate);
+
+  // Loads a bank of 32 patches, in the DX7 SysEx format (without header).
+  void LoadBank(const uint8_t* sysex);
+
+  void NoteOn(int voice, int patch, float note, float velocity);
+  void NoteOff(int voice);
+
+  // Writes the sum of all voices.
+  void Render(float* out, size_t size);
+
+  inline void set_brightness(float brightness) {
+    brightness_ = brightness;
+  }
+
+  inline void set_envelope_control(float envelope_control) {
+    envelope_control_ = envelope_control;
+  }
+
+  inline void set_use_lanes(bool use_lanes) {
+    use_lanes_ = use_lanes;
+  }
+
+  inline int num_voices() const { return num_voices_; }
+
+ private:
+  void RenderBlock(float* out, size_t size);
+
+  inline void RenderVoice(int voice, size_t size) {
+    float* buffers[4] = {
+        voice_out_[voice], temp_, temp_ + size, temp_ + size };
+    voice_[voice].Render(parameters_[voice], buffers, size);
+  }
+
+  fm::Algorithms<6> algorithms_;
+  fm::Patch patches_[kNumPolyFMPatches];
+
+  int num_voices_;
+  fm::Voice<6> voice_[kMaxNumPolyFMVoices];
+  fm::Voice<6>::Parameters parameters_[kMaxNumPolyFMVoices];
+  fm::Lfo lfo_[kMaxNumPolyFMVoices];
+  int patch_index_[kMaxNumPolyFMVoices];
+
+  float voice_out_[kMaxNumPolyFMVoices][kMaxBlockSize];
+  float temp_[kMaxBlockSize * 2];
+
+  float brightness_;
+  float envelope_control_;
+  bool use_lanes_;
+
+  DISALLOW_COPY_AND_ASSIGN(PolyFM);
+};
+
+}  // namespace plaits
+
+#endif  // PLAITS_HOST_POLY_FM_H_
@@ -0,0 +1,147 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Headless multi-voice renderer (host only).
+
+#include "plaits/host/render_server.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace plaits {
+
+using namespace std;
+
+void RenderServer::Init(int num_voices, int num_threads) {
+  num_voices_ = num_voices;
+  voice_state_ = new VoiceState[num_voices];
+
+  // With at most 2 engines per voice, a voice never has to wait for an
+  // engine, and the engines evicted from the pool do not depend on the order
+  // in which the threads render the voices.
+  const size_t arena_size = EnginePool::arena_size(2 * num_voices);
+  engine_pool_arena_ = new char[arena_size];
+  engine_pool_.Init(engine_pool_arena_, arena_size);
+  engine_pool_.set_max_engines_per_owner(2);
+
+  for (int i = 0; i < num_voices; ++i) {
+    VoiceState* s = &voice_state_[i];
+    s->voice = new Voice;
+    s->voice->Init(&engine_pool_);
+
+    s->patch.note = 48.0f;
+    s->patch.harmonics = 0.5f;
+    s->patch.timbre = 0.5f;
+    s->patch.morph = 0.5f;
+    s->patch.frequency_modulation_amount = 0.0f;
+    s->patch.timbre_modulation_amount = 0.0f;
+    s->patch.morph_modulation_amount = 0.0f;
+    s->patch.engine = 0;
+    s->patch.decay = 0.5f;
+    s->patch.lpg_colour = 0.5f;
+    memset(&s->modulations, 0, sizeof(Modulations));
+    s->next_event = 0;
+    s->random_state = 0x21 + 2654435761U * uint32_t(i);
+  }
+
+  thread_pool_.Init(num_threads);
+  time_ = 0;
+  render_size_ = 0;
+}
+
+void RenderServer::Stop() {
+  thread_pool_.Stop();
+  for (int i = 0; i < num_voices_; ++i) {
+    delete voice_state_[i].voice;
+  }
+  delete[] voice_state_;
+  delete[] engine_pool_arena_;
+}
+
+void RenderServer::Schedule(const Event& event) {
+  if (event.voice >= 0 && event.voice < num_voices_) {
+    voice_state_[event.voice].events.push_back(event);
+  }
+}
+
+/* static */
+void RenderServer::RenderVoice(void* server, int voice) {
+  RenderServer* r = static_cast<RenderServer*>(server);
+  VoiceState* s = &r->voice_state_[voice];
+
+  // The random number generator state is thread-local: carry the state of
+  // this voice over to whichever thread is rendering it.
+  Random::Seed(s->random_state);
+  uint32_t time = r->time_;
+  for (size_t i = 0; i < r->render_size_; i += kBlockSize) {
+    while (s->next_event < s->events.size() && \
+           s->events[s->next_event].time <= time) {
+      const Event& e = s->events[s->next_event++];
+      if (e.type == Event::PATCH) {
+        s->patch = e.patch;
+      } else {
+        s->modulations = e.modulations;
+      }
+    }
+    s->voice->Render(s->patch, s->modulations, &s->frames[i], kBlockSize);
+    time += kBlockSize;
+  }
+  s->random_state = Random::state();
+}
+
+size_t RenderServer::Render(float* out, float* aux, size_t size) {
+  size -= size % kBlockSize;
+  for (size_t i = 0; i < size; i += kRenderChunkSize) {
+    RenderChunk(&out[i], &aux[i], min(size - i, kRenderChunkSize));
+  }
+  return size;
+}
+
+void RenderServer::RenderChunk(float* out, float* aux, size_t size) {
+  render_size_ = size;
+  thread_pool_.Run(&RenderVoice, this, num_voices_);
+
+  // The pool clock only advances between chunks, so that the engines
+  // released during a chunk get the same timestamp whichever thread released
+  // them.
+  for (size_t i = 0; i < size; i += kBlockSize) {
+    engine_pool_.Tick();
+  }
+
+  // Mix the voices, always in the same order.
+  fill(&out[0], &out[size], 0.0f);
+  fill(&aux[0], &aux[size], 0.0f);
+  for (int i = 0; i < num_voices_; ++i) {
+    const Voice::Frame* frames = voice_state_[i].frames;
+    for (size_t j = 0; j < size; ++j) {
+      out[j] += static_cast<float>(frames[j].out) / 32768.0f;
+      aux[j] += static_cast<float>(frames[j].aux) / 32768.0f;
+    }
+  }
+  time_ += size;
+}
+
+}  // namespace plaits
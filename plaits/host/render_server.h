@@ -0,0 +1,130 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Headless multi-voice renderer (host only).
+//
+// Owns a set of independent voices, each of them driven by a stream of
+// timestamped Patch and Modulations events. The voices are rendered in
+// parallel by a thread pool, each voice into its own buffer, and are then
+// mixed in a fixed order. Each voice has its own random number generator
+// state (PLAITS_THREAD_LOCAL_RANDOM must be defined), so the output does not
+// depend on the number of threads or on how the voices were scheduled.
+//
+// The voices construct their engines in a shared pool (PLAITS_ENGINE_POOL must
+// be defined), with room for 2 engines per voice: the one playing, and the one
+// being faded out after an engine change.
+
+#ifndef PLAITS_HOST_RENDER_SERVER_H_
+#define PLAITS_HOST_RENDER_SERVER_H_
+
+#include "stmlib/stmlib.h"
+
+#include <vector>
+
+#include "host/thread_pool.h"
+#include "plaits/dsp/engine_pool.h"
+#include "plaits/dsp/random.h"
+#include "plaits/dsp/voice.h"
+
+#ifndef PLAITS_THREAD_LOCAL_RANDOM
+#error "The render server requires PLAITS_THREAD_LOCAL_RANDOM"
+#endif  // PLAITS_THREAD_LOCAL_RANDOM
+
+#ifndef PLAITS_ENGINE_POOL
+#error "The render server requires PLAITS_ENGINE_POOL"
+#endif  // PLAITS_ENGINE_POOL
+
+namespace plaits {
+
+// Longer requests to RenderServer::Render are split into chunks of this size,
+// which must be a multiple of kBlockSize.
+const size_t kRenderChunkSize = 341 * kBlockSize;
+
+struct Event {
+  enum Type {
+    PATCH,
+    MODULATIONS
+  };
+
+  // In samples. Events are applied at the first block boundary at or after
+  // this time, so they are accurate to kBlockSize samples.
+  uint32_t time;
+  int voice;
+  Type type;
+  Patch patch;
+  Modulations modulations;
+};
+
+class RenderServer {
+ public:
+  RenderServer() { }
+  ~RenderServer() { }
+
+  void Init(int num_voices, int num_threads);
+  void Stop();
+
+  // The events of a given voice must be scheduled in chronological order.
+  void Schedule(const Event& event);
+
+  // Writes the sum of the OUT and AUX signals of all voices. Only whole blocks
+  // are rendered: returns the number of frames written, which is size rounded
+  // down to a multiple of kBlockSize.
+  size_t Render(float* out, float* aux, size_t size);
+
+  inline int num_voices() const { return num_voices_; }
+  inline const host::ThreadPool& thread_pool() const { return thread_pool_; }
+  inline const EnginePool& engine_pool() const { return engine_pool_; }
+  inline uint32_t time() const { return time_; }
+
+ private:
+  struct VoiceState {
+    Voice* voice;
+    Patch patch;
+    Modulations modulations;
+    std::vector<Event> events;
+    size_t next_event;
+    uint32_t random_state;
+    Voice::Frame frames[kRenderChunkSize];
+  };
+
+  static void RenderVoice(void* server, int voice);
+  void RenderChunk(float* out, float* aux, size_t size);
+
+  host::ThreadPool thread_pool_;
+  EnginePool engine_pool_;
+  char* engine_pool_arena_;
+  int num_voices_;
+  VoiceState* voice_state_;
+
+  uint32_t time_;
+  size_t render_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(RenderServer);
+};
+
+}  // namespace plaits
+
+#endif  // PLAITS_HOST_RENDER_SERVER_H_
@@ -3669,6 +3669,13 @@ const float lut_svf_shift[] = {
 const float lut_4x_downsampler_fir[] = {
    2.442415000e-02,  9.297315000e-02,  1.671293800e-01,  2.154733200e-01,
 };
+const float lut_2x_downsampler_fir[] = {
+  -4.588798175e-03, -1.282321979e-02,  1.162765028e-01,  4.011355152e-01,
+};
+const float lut_8x_downsampler_fir[] = {
+   3.714489278e-04,  3.052893617e-03,  1.156493842e-02,  3.008598067e-02,
+   6.052311478e-02,  9.919481384e-02,  1.361850198e-01,  1.590217900e-01,
+};
 
 
 const float* const lookup_table_table[] = {
@@ -3679,6 +3686,8 @@ const float* const lookup_table_table[] = {
   lut_stiffness,
   lut_svf_shift,
   lut_4x_downsampler_fir,
+  lut_2x_downsampler_fir,
+  lut_8x_downsampler_fir,
 };
 
 const int16_t lut_ws_inverse_tan[] = {
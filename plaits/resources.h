@@ -64,6 +64,8 @@ extern const float lut_fold_2[];
 extern const float lut_stiffness[];
 extern const float lut_svf_shift[];
 extern const float lut_4x_downsampler_fir[];
+extern const float lut_2x_downsampler_fir[];
+extern const float lut_8x_downsampler_fir[];
 extern const int16_t lut_ws_inverse_tan[];
 extern const int16_t lut_ws_inverse_sin[];
 extern const int16_t lut_ws_linear[];
@@ -91,6 +93,10 @@ extern const int16_t wav_integrated_waves[];
 #define LUT_SVF_SHIFT_SIZE 257
 #define LUT_4X_DOWNSAMPLER_FIR 6
 #define LUT_4X_DOWNSAMPLER_FIR_SIZE 4
+#define LUT_2X_DOWNSAMPLER_FIR 7
+#define LUT_2X_DOWNSAMPLER_FIR_SIZE 4
+#define LUT_8X_DOWNSAMPLER_FIR 8
+#define LUT_8X_DOWNSAMPLER_FIR_SIZE 8
 #define LUT_WS_INVERSE_TAN 0
 #define LUT_WS_INVERSE_TAN_SIZE 257
 #define LUT_WS_INVERSE_SIN 1
@@ -219,9 +219,19 @@ lookup_tables_i8 += [('lpc_excitation_pulse', numpy.round(pulse_upsampled * 127)
 
 
 """----------------------------------------------------------------------------
-Filter coefficients for a 4x downsampler
+Filter coefficients for the 2x, 4x and 8x downsamplers. The filters are
+symmetric, only the first half is stored.
 ----------------------------------------------------------------------------"""
 
 downsampler_fir = [0.02442415, 0.09297315, 0.16712938, 0.21547332]
 lookup_tables += [('4x_downsampler_fir', downsampler_fir)]
 
+def make_downsampler_fir(ratio, num_taps, cutoff=0.9):
+  t = numpy.arange(num_taps) - (num_taps - 1) / 2.0
+  fir = numpy.sinc(cutoff * t / ratio) * numpy.blackman(num_taps + 2)[1:-1]
+  fir /= fir.sum()
+  return fir[:num_taps / 2]
+
+lookup_tables += [('2x_downsampler_fir', make_downsampler_fir(2, 8))]
+lookup_tables += [('8x_downsampler_fir', make_downsampler_fir(8, 16))]
+
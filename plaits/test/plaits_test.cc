@@ -14,12 +14,24 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <vector>
+
+#ifdef __SSE__
 #include <xmmintrin.h>
+#endif  // __SSE__
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define BENCHMARK_HAS_CYCLE_COUNTER
+#endif  // __i386__ || __x86_64__
 
+#include "plaits/dsp/downsampler/polyphase_downsampler.h"
 #include "plaits/dsp/dsp.h"
 
 #include "plaits/dsp/engine/additive_engine.h"
@@ -45,6 +57,8 @@
 #include "plaits/dsp/engine2/virtual_analog_vcf_engine.h"
 #include "plaits/dsp/engine2/wave_terrain_engine.h"
 
+#include "plaits/dsp/fm/voice_lanes.h"
+
 #include "plaits/dsp/fx/sample_rate_reducer.h"
 
 #include "plaits/dsp/oscillator/formant_oscillator.h"
@@ -62,6 +76,8 @@
 
 #include "plaits/dsp/voice.h"
 
+#include "plaits/host/poly_fm.h"
+
 #include "plaits/user_data.h"
 #include "plaits/user_data_receiver.h"
 
@@ -71,6 +87,22 @@ using namespace std;
 using namespace stmlib;
 using namespace plaits;
 
+// Cycle counter used by the cycles per sample reports. On hosts without one,
+// CPU time in nanoseconds is reported instead.
+#ifdef BENCHMARK_HAS_CYCLE_COUNTER
+const char* const kCycleUnit = "cycles";
+
+inline uint64_t ReadCycleCounter() {
+  return __rdtsc();
+}
+#else
+const char* const kCycleUnit = "ns";
+
+inline uint64_t ReadCycleCounter() {
+  return uint64_t(double(clock()) * 1e9 / CLOCKS_PER_SEC);
+}
+#endif  // BENCHMARK_HAS_CYCLE_COUNTER
+
 const size_t kAudioBlockSize = 24;
 
 char ram_block[16 * 1024];
@@ -173,6 +205,65 @@ void TestHarmonicOscillator() {
   }
 }
 
+#ifdef PLAITS_SIMD
+
+template<int num_harmonics, int first_harmonic_index>
+float CompareHarmonicOscillatorLanes(double* elapsed) {
+  HarmonicOscillator<num_harmonics> lanes;
+  HarmonicOscillator<num_harmonics> scalar;
+  lanes.Init();
+  scalar.Init();
+  
+  const size_t kNumBlocks = 4 * kSampleRate / kBlockSize;
+  float amplitudes[num_harmonics];
+  float max_error = 0.0f;
+  for (size_t block = 0; block < kNumBlocks; ++block) {
+    // Amplitudes change every 16 blocks, the pitch sweeps over 7 octaves.
+    if (block % 16 == 0) {
+      for (int i = 0; i < num_harmonics; ++i) {
+        amplitudes[i] = plaits::Random::GetFloat() / float(i + 1);
+      }
+    }
+    float f0 = 0.0002f * powf(2.0f, 7.0f * float(block) / float(kNumBlocks));
+    float lanes_out[kBlockSize];
+    float scalar_out[kBlockSize];
+    fill(&lanes_out[0], &lanes_out[kBlockSize], 0.1f);
+    fill(&scalar_out[0], &scalar_out[kBlockSize], 0.1f);
+
+    clock_t start = clock();
+    lanes.template RenderLanes<first_harmonic_index>(
+        f0, amplitudes, lanes_out, kBlockSize);
+    elapsed[0] += double(clock() - start);
+    
+    start = clock();
+    scalar.template RenderScalar<first_harmonic_index>(
+        f0, amplitudes, scalar_out, kBlockSize);
+    elapsed[1] += double(clock() - start);
+    
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      max_error = max(max_error, fabsf(lanes_out[i] - scalar_out[i]));
+    }
+  }
+  return max_error;
+}
+
+void TestHarmonicOscillatorLanes() {
+  // The lanes only differ by the rounding of the amplitude ramps.
+  double elapsed[2] = { 0.0, 0.0 };
+  float max_error = 0.0f;
+  max_error = max(
+      max_error, CompareHarmonicOscillatorLanes<12, 1>(elapsed));
+  max_error = max(
+      max_error, CompareHarmonicOscillatorLanes<12, 13>(elapsed));
+  max_error = max(
+      max_error, CompareHarmonicOscillatorLanes<64, 1>(elapsed));
+  assert(max_error < 1e-5f);
+  printf("Harmonic oscillator lanes: %.2fx speed-up, max error %g\n",
+         elapsed[1] / elapsed[0], max_error);
+}
+
+#endif  // PLAITS_SIMD
+
 void TestWavetableOscillator() {
   WavWriter wav_writer(1, kSampleRate, 20);
   wav_writer.Open("plaits_wavetable_oscillator.wav");
@@ -691,6 +782,80 @@ void TestSwarmEngine() {
   }
 }
 
+#ifdef PLAITS_SIMD
+
+void TestSwarmEngineLanes() {
+  const size_t kNumBlocks = 20000;
+  
+  // Mostly full blocks, with a few odd sizes, and a burst every 100 blocks
+  // in the second half.
+  vector<size_t> sizes(kNumBlocks);
+  vector<EngineParameters> parameters(kNumBlocks);
+  size_t total_size = 0;
+  for (size_t block = 0; block < kNumBlocks; ++block) {
+    const float t = float(block) / float(kNumBlocks);
+    sizes[block] = block % 8 ? kBlockSize : 1 + block % kMaxBlockSize;
+    total_size += sizes[block];
+    EngineParameters* p = &parameters[block];
+    p->note = 36.0f + 48.0f * t;
+    p->timbre = 0.5f + 0.5f * sinf(t * 13.0f);
+    p->morph = 0.5f + 0.5f * sinf(t * 7.0f);
+    p->harmonics = 0.5f + 0.5f * sinf(t * 5.0f);
+    p->accent = 0.8f;
+    if (block < kNumBlocks / 2) {
+      p->trigger = TRIGGER_UNPATCHED;
+    } else {
+      p->trigger = block % 100 == 0 ? TRIGGER_RISING_EDGE : TRIGGER_LOW;
+    }
+  }
+  
+  vector<float> out[2];
+  vector<float> aux[2];
+  double elapsed[2];
+  for (int i = 0; i < 2; ++i) {
+    out[i].resize(total_size);
+    aux[i].resize(total_size);
+  }
+  
+  // Both variants draw the same random numbers in the same order. The second
+  // engine renders its voices one at a time, as on the module.
+  const uint32_t seed = plaits::Random::state();
+  
+  SwarmEngine e[2];
+  for (int variant = 0; variant < 2; ++variant) {
+    BufferAllocator allocator(ram_block + variant * 8192, 8192);
+    e[variant].Init(&allocator);
+    e[variant].set_use_lanes(variant == 0);
+    e[variant].Reset();
+  }
+  for (int variant = 0; variant < 2; ++variant) {
+    plaits::Random::Seed(seed);
+    clock_t start = clock();
+    for (size_t block = 0, i = 0; block < kNumBlocks; i += sizes[block++]) {
+      bool already_enveloped;
+      e[variant].Render(
+          parameters[block],
+          &out[variant][i],
+          &aux[variant][i],
+          sizes[block],
+          &already_enveloped);
+    }
+    elapsed[variant] = double(clock() - start);
+  }
+  
+  // Only the order in which the voices are mixed differs.
+  float max_error = 0.0f;
+  for (size_t i = 0; i < total_size; ++i) {
+    max_error = max(max_error, fabsf(out[0][i] - out[1][i]));
+    max_error = max(max_error, fabsf(aux[0][i] - aux[1][i]));
+  }
+  assert(max_error < 1e-6f);
+  printf("Swarm engine lanes: %.2fx speed-up, max error %g\n",
+         elapsed[1] / elapsed[0], max_error);
+}
+
+#endif  // PLAITS_SIMD
+
 void TestVirtualAnalogEngine() {
   WavWriter wav_writer(2, kSampleRate, 80);
   wav_writer.Open("plaits_virtual_analog_engine.wav");
@@ -881,6 +1046,148 @@ void TestWavetableEngine() {
   }
 }
 
+void TestWavetableEngineMipmaps() {
+  // The band-limited mipmaps are built once, and shared by all the engines.
+  // Compares them with the differentiator used on the module: output level,
+  // aliasing (energy outside of the harmonics of f0) and render time.
+  static char mipmaps_ram_block[1024 * 1024];
+  static WavetableMipmaps wavetable_mipmaps;
+  const float notes[] = { 36.0f, 60.0f, 84.0f, 96.0f, 108.0f, 120.0f };
+  const size_t kNumPeriods = 256;
+  
+  BufferAllocator mipmaps_allocator(
+      mipmaps_ram_block,
+      sizeof(mipmaps_ram_block));
+  clock_t build_start = clock();
+  wavetable_mipmaps.Init(&mipmaps_allocator);
+  wavetable_mipmaps.LoadUserData(NULL);
+  printf(
+      "Wavetable mipmaps built in %.1f ms\n",
+      double(clock() - build_start) / CLOCKS_PER_SEC * 1e3);
+  
+  // The custom waves only use the mipmaps built from the same user data: a
+  // map of 64 waves followed by the 15 custom waves.
+  uint8_t user_data[4096];
+  for (size_t i = 0; i < sizeof(user_data); ++i) {
+    user_data[i] = i < 64 ? 192 + i % 16 : i * 7;
+  }
+  WavetableEngine::set_mipmaps(&wavetable_mipmaps);
+  {
+    BufferAllocator allocator(ram_block, 16384);
+    WavetableEngine e;
+    e.Init(&allocator);
+    e.LoadUserData(NULL);
+    assert(e.has_mipmaps());
+    e.LoadUserData(user_data);
+    assert(!e.has_mipmaps());
+    wavetable_mipmaps.LoadUserData(user_data);
+    e.LoadUserData(user_data);
+    assert(e.has_mipmaps());
+    wavetable_mipmaps.LoadUserData(NULL);
+  }
+  
+  printf("Wavetable engine (differentiator / mipmaps)\n");
+  for (size_t i = 0; i < sizeof(notes) / sizeof(float); ++i) {
+    double rms[2];
+    double aliasing[2];
+    double elapsed[2];
+    for (int mipmaps = 0; mipmaps < 2; ++mipmaps) {
+      // Same arena as on the module: the engine only stores pointers to the
+      // shared tables.
+      WavetableEngine::set_mipmaps(mipmaps ? &wavetable_mipmaps : NULL);
+      BufferAllocator allocator(ram_block, 16384);
+      WavetableEngine e;
+      e.Init(&allocator);
+      e.Reset();
+      e.LoadUserData(NULL);
+      if (e.has_mipmaps() != bool(mipmaps)) {
+        printf("Unexpected mipmap allocation\n");
+        return;
+      }
+      
+      EngineParameters p;
+      p.trigger = TRIGGER_LOW;
+      p.note = notes[i];
+      p.timbre = 0.3f;
+      p.morph = 0.55f;
+      p.harmonics = 0.4f;
+      
+      float out[kAudioBlockSize];
+      float aux[kAudioBlockSize];
+      bool already_enveloped;
+      
+      // One second to settle the parameters, which is also timed.
+      const size_t kNumBlocks = size_t(kSampleRate) / kAudioBlockSize;
+      clock_t start = clock();
+      for (size_t j = 0; j < kNumBlocks; ++j) {
+        e.Render(p, out, aux, kAudioBlockSize, &already_enveloped);
+      }
+      elapsed[mipmaps] = double(clock() - start) / CLOCKS_PER_SEC * 1e9 / \
+          double(kNumBlocks * kAudioBlockSize);
+      
+      // The phase accumulator is a float, so the actual frequency slightly
+      // differs from f0 - which would otherwise show up as aliasing.
+      const float f0_float = NoteToFrequency(notes[i]);
+      float phase = 0.0f;
+      int num_wraps = 0;
+      for (size_t j = 0; j < size_t(kSampleRate); ++j) {
+        phase += f0_float;
+        if (phase >= 1.0f) {
+          phase -= 1.0f;
+          ++num_wraps;
+        }
+      }
+      const double f0 = (double(num_wraps) + phase) / double(kSampleRate);
+      const size_t n = size_t(double(kNumPeriods) / f0 + 0.5);
+      vector<float> y(n + kAudioBlockSize);
+      for (size_t j = 0; j < n; j += kAudioBlockSize) {
+        e.Render(p, &y[j], aux, kAudioBlockSize, &already_enveloped);
+      }
+      
+      // Blackman-Harris window, so that the small residual error on f0 and
+      // the leakage of the harmonics stay well below the aliasing.
+      double total = 0.0;
+      double sum_w = 0.0;
+      double sum_w2 = 0.0;
+      vector<double> w(n);
+      for (size_t j = 0; j < n; ++j) {
+        const double t = 2.0 * M_PI * double(j) / double(n);
+        w[j] = 0.35875 - 0.48829 * cos(t) + 0.14128 * cos(2.0 * t) - \
+            0.01168 * cos(3.0 * t);
+        sum_w += w[j];
+        sum_w2 += w[j] * w[j];
+        total += w[j] * w[j] * y[j] * y[j];
+      }
+      double harmonics = 0.0;
+      for (size_t h = 0; h * f0 < 0.5; ++h) {
+        const double omega = 2.0 * M_PI * double(h) * f0;
+        const double c = cos(omega);
+        const double s = sin(omega);
+        double re = 1.0;
+        double im = 0.0;
+        double sum_re = 0.0;
+        double sum_im = 0.0;
+        for (size_t j = 0; j < n; ++j) {
+          sum_re += w[j] * y[j] * re;
+          sum_im += w[j] * y[j] * im;
+          const double t = re * c - im * s;
+          im = re * s + im * c;
+          re = t;
+        }
+        harmonics += (h ? 2.0 : 1.0) * sum_w2 / (sum_w * sum_w) * \
+            (sum_re * sum_re + sum_im * sum_im);
+      }
+      rms[mipmaps] = sqrt(total / sum_w2);
+      aliasing[mipmaps] = 10.0 * log10(
+          max((total - harmonics) / total, 1e-12));
+    }
+    printf("  note %3.0f: rms %.3f / %.3f, ", notes[i], rms[0], rms[1]);
+    printf("aliasing %6.1f / %6.1f dB, ", aliasing[0], aliasing[1]);
+    printf("%.1f / %.1f ns/sample\n", elapsed[0], elapsed[1]);
+  }
+  WavetableEngine::set_mipmaps(NULL);
+}
+
 void TestWaveTerrainEngine() {
   WavWriter wav_writer(2, kSampleRate, 80);
   wav_writer.Open("plaits_wave_terrain_engine.wav");
@@ -972,6 +1279,92 @@ void TestSampleRateReducer() {
   } 
 }
 
+// The scalar code computes the same sums, in the same order, as the
+// per-sample 4x downsampler the FM engine used to run.
+void TestPolyphaseDownsamplerReference() {
+  PolyphaseDownsampler<4> downsampler;
+  downsampler.Init();
+  
+  float head = 0.0f;
+  size_t num_mismatches = 0;
+  for (size_t block = 0; block < 1000; ++block) {
+    const size_t size = 1 + block % kMaxBlockSize;
+    float in[kMaxBlockSize * 4];
+    float out[kMaxBlockSize];
+    for (size_t i = 0; i < size * 4; ++i) {
+      in[i] = plaits::Random::GetFloat() * 2.0f - 1.0f;
+    }
+    downsampler.ProcessScalar(in, out, size);
+    for (size_t i = 0; i < size; ++i) {
+      float tail = 0.0f;
+      for (size_t j = 0; j < 4; ++j) {
+        head += in[i * 4 + j] * lut_4x_downsampler_fir[3 - j];
+        tail += in[i * 4 + j] * lut_4x_downsampler_fir[j];
+      }
+      num_mismatches += out[i] != head;
+      head = tail;
+    }
+  }
+  assert(num_mismatches == 0);
+}
+
+#ifdef PLAITS_SIMD
+
+template<size_t factor>
+float ComparePolyphaseDownsamplerLanes(double* elapsed) {
+  PolyphaseDownsampler<factor> lanes;
+  PolyphaseDownsampler<factor> scalar;
+  lanes.Init();
+  scalar.Init();
+  
+  // Mostly full blocks, with a few odd sizes. Each variant runs on the whole
+  // signal at once, since a single block is too short to be timed.
+  const size_t kNumBlocks = 10000;
+  vector<size_t> sizes(kNumBlocks);
+  size_t total_size = 0;
+  for (size_t block = 0; block < kNumBlocks; ++block) {
+    sizes[block] = block % 8 ? kBlockSize : 1 + block % kMaxBlockSize;
+    total_size += sizes[block];
+  }
+  vector<float> in(total_size * factor);
+  vector<float> lanes_out(total_size);
+  vector<float> scalar_out(total_size);
+  for (size_t i = 0; i < in.size(); ++i) {
+    in[i] = plaits::Random::GetFloat() * 2.0f - 1.0f;
+  }
+  
+  clock_t start = clock();
+  for (size_t block = 0, i = 0; block < kNumBlocks; i += sizes[block++]) {
+    lanes.ProcessLanes(&in[i * factor], &lanes_out[i], sizes[block]);
+  }
+  elapsed[0] += double(clock() - start);
+  
+  start = clock();
+  for (size_t block = 0, i = 0; block < kNumBlocks; i += sizes[block++]) {
+    scalar.ProcessScalar(&in[i * factor], &scalar_out[i], sizes[block]);
+  }
+  elapsed[1] += double(clock() - start);
+  
+  float max_error = 0.0f;
+  for (size_t i = 0; i < total_size; ++i) {
+    max_error = max(max_error, fabsf(lanes_out[i] - scalar_out[i]));
+  }
+  return max_error;
+}
+
+void TestPolyphaseDownsamplerLanes() {
+  double elapsed[2] = { 0.0, 0.0 };
+  float max_error = 0.0f;
+  max_error = max(max_error, ComparePolyphaseDownsamplerLanes<2>(elapsed));
+  max_error = max(max_error, ComparePolyphaseDownsamplerLanes<4>(elapsed));
+  max_error = max(max_error, ComparePolyphaseDownsamplerLanes<8>(elapsed));
+  assert(max_error < 1e-6f);
+  printf("Polyphase downsampler lanes: %.2fx speed-up, max error %g\n",
+         elapsed[1] / elapsed[0], max_error);
+}
+
+#endif  // PLAITS_SIMD
+
 void TestBassDrumEngine() {
   WavWriter wav_writer(2, kSampleRate, 80);
   wav_writer.Open("plaits_bass_drum_engine.wav");
@@ -1063,14 +1456,31 @@ void TestHiHatEngine() {
   }
 }
 
+// The voice tests use statically allocated engines, or engines from a pool
+// when PLAITS_ENGINE_POOL is defined.
+void InitVoice(Voice* voice) {
+#ifdef PLAITS_ENGINE_POOL
+  static EnginePool pool;
+  static char* arena = NULL;
+  static size_t arena_size = 0;
+  if (!arena) {
+    arena_size = EnginePool::arena_size(4);
+    arena = new char[arena_size];
+  }
+  pool.Init(arena, arena_size);
+  voice->Init(&pool);
+#else
+  BufferAllocator allocator(ram_block, 16384);
+  voice->Init(&allocator);
+#endif  // PLAITS_ENGINE_POOL
+}
+
 void TestVoice() {
   WavWriter wav_writer(2, kSampleRate, 200);
   wav_writer.Open("plaits_voice.wav");
   
-  BufferAllocator allocator(ram_block, 16384);
   Voice v;
-  
-  v.Init(&allocator);
+  InitVoice(&v);
   
   Patch patch;
   Modulations modulations;
@@ -1113,10 +1523,8 @@ void TestFMGlitch() {
   WavWriter wav_writer(2, kSampleRate, 200);
   wav_writer.Open("plaits_fm_glitch.wav");
   
-  BufferAllocator allocator(ram_block, 16384);
   Voice v;
-
-  v.Init(&allocator);
+  InitVoice(&v);
   
   Patch patch;
   Modulations modulations;
@@ -1159,10 +1567,8 @@ void TestLPGAttackDecay() {
   WavWriter wav_writer(2, kSampleRate, 20);
   wav_writer.Open("plaits_lpg_attack_decay.wav");
   
-  BufferAllocator allocator(ram_block, 16384);
   Voice v;
-
-  v.Init(&allocator);
+  InitVoice(&v);
   
   Patch patch;
   Modulations modulations;
@@ -1213,10 +1619,8 @@ void TestLimiterGlitch() {
   WavWriter wav_writer(2, kSampleRate, 50);
   wav_writer.Open("plaits_limiter_glitch.wav");
   
-  BufferAllocator allocator(ram_block, 16384);
   Voice v;
-
-  v.Init(&allocator);
+  InitVoice(&v);
   
   Patch patch;
   Modulations modulations;
@@ -1289,8 +1693,447 @@ void TestSixOpEngine() {
   }
 }
 
+#ifdef FM_FUSED_RENDERERS
+
+void TestSixOpEngineFusedRenderers() {
+  // Renders every patch of the first bank (and thus most algorithms) twice:
+  // through the compiled render calls, and through the fused renderers.
+  // Both should be bit-identical.
+  const size_t kNumBlocks = kSampleRate / kAudioBlockSize;
+  const size_t kNumPatches = 32;
+  const size_t kNumSamples = kNumPatches * kNumBlocks * kAudioBlockSize;
+  
+  float* rendered[2];
+  double cycles_per_sample[2];
+  for (int fused = 0; fused < 2; ++fused) {
+    // The engine doesn't clear its accumulation buffer, so start both runs
+    // from the same memory contents.
+    std::fill(&ram_block[0], &ram_block[16384], 0);
+    BufferAllocator allocator(ram_block, 16384);
+    SixOpEngine e;
+    e.Init(&allocator);
+    e.Reset();
+    e.LoadUserData(fm_patches_table[0]);
+    e.set_use_fused_renderers(fused);
+    
+    EngineParameters p;
+    p.note = 48.0f;
+    p.accent = 0.8f;
+    p.timbre = 0.5f;
+    p.morph = 0.5f;
+    
+    rendered[fused] = new float[kNumSamples];
+    float* out = rendered[fused];
+    uint64_t start = ReadCycleCounter();
+    for (size_t patch = 0; patch < kNumPatches; ++patch) {
+      p.harmonics = (float(patch) + 0.5f) / float(kNumPatches) / 1.02f;
+      for (size_t i = 0; i < kNumBlocks; ++i) {
+        float aux[kAudioBlockSize];
+        p.trigger = i < kNumBlocks / 2 ? TRIGGER_HIGH : TRIGGER_LOW;
+        p.trigger |= i == 0 ? TRIGGER_RISING_EDGE : TRIGGER_LOW;
+        bool already_enveloped;
+        e.Render(p, out, aux, kAudioBlockSize, &already_enveloped);
+        out += kAudioBlockSize;
+      }
+    }
+    cycles_per_sample[fused] = double(ReadCycleCounter() - start) / \
+        double(kNumSamples);
+  }
+  
+  size_t num_mismatches = 0;
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    num_mismatches += rendered[0][i] != rendered[1][i];
+  }
+  printf("Six op engine: %.1f (render calls) vs %.1f (fused) %s/sample, ",
+         cycles_per_sample[0], cycles_per_sample[1], kCycleUnit);
+  printf("%.2fx speed-up, %d mismatches\n",
+         cycles_per_sample[0] / cycles_per_sample[1], int(num_mismatches));
+  
+  delete[] rendered[0];
+  delete[] rendered[1];
+}
+
+#endif  // FM_FUSED_RENDERERS
+
+void TestFMVoiceLanes() {
+  // Plays each patch of the first bank on 4 voices with different notes,
+  // velocities and gate durations, rendered in parallel by VoiceLanes, and
+  // compares each lane with the output of a scalar fm::Voice.
+  const size_t kNumBlocks = kSampleRate / kAudioBlockSize;
+  const size_t kNumPatches = 32;
+  
+  fm::Algorithms<6> algorithms;
+  algorithms.Init();
+  fm::Patch patches[kNumPatches];
+  for (size_t i = 0; i < kNumPatches; ++i) {
+    patches[i].Unpack(fm_patches_table[0] + i * fm::Patch::SYX_SIZE);
+  }
+
+  fm::Voice<6> lane_voice[fm::kNumVoiceLanes];
+  fm::Voice<6> scalar_voice[fm::kNumVoiceLanes];
+  fm::Voice<6>::Parameters parameters[fm::kNumVoiceLanes];
+  fm::Voice<6>* lane_voice_ptr[fm::kNumVoiceLanes];
+  for (int i = 0; i < fm::kNumVoiceLanes; ++i) {
+    lane_voice[i].Init(&algorithms, kSampleRate);
+    scalar_voice[i].Init(&algorithms, kSampleRate);
+    lane_voice_ptr[i] = &lane_voice[i];
+    parameters[i].sustain = false;
+    parameters[i].note = 36.0f + 7.0f * float(i);
+    parameters[i].velocity = 0.4f + 0.2f * float(i);
+    parameters[i].brightness = 0.5f;
+    parameters[i].envelope_control = 0.5f;
+    parameters[i].pitch_mod = 0.0f;
+    parameters[i].amp_mod = 0.0f;
+  }
+  
+  size_t num_mismatches = 0;
+  float max_error = 0.0f;
+  double elapsed[2] = { 0.0, 0.0 };
+  for (size_t patch = 0; patch < kNumPatches; ++patch) {
+    for (int i = 0; i < fm::kNumVoiceLanes; ++i) {
+      lane_voice[i].SetPatch(&patches[patch]);
+      scalar_voice[i].SetPatch(&patches[patch]);
+    }
+    for (size_t block = 0; block < kNumBlocks; ++block) {
+      float lane_out[fm::kNumVoiceLanes][kAudioBlockSize];
+      float scalar_out[fm::kNumVoiceLanes][kAudioBlockSize * 4];
+      float* lane_out_ptr[fm::kNumVoiceLanes];
+      for (int i = 0; i < fm::kNumVoiceLanes; ++i) {
+        parameters[i].gate = block < kNumBlocks * (i + 1) / 5;
+        parameters[i].brightness = float(block) / float(kNumBlocks);
+        fill(&lane_out[i][0], &lane_out[i][kAudioBlockSize], 0.0f);
+        fill(&scalar_out[i][0], &scalar_out[i][kAudioBlockSize], 0.0f);
+        lane_out_ptr[i] = lane_out[i];
+      }
+      
+      clock_t start = clock();
+      fm::VoiceLanes<6>::Render(
+          lane_voice_ptr, parameters, lane_out_ptr,
+          fm::kNumVoiceLanes, kAudioBlockSize);
+      elapsed[0] += double(clock() - start);
+      
+      start = clock();
+      for (int i = 0; i < fm::kNumVoiceLanes; ++i) {
+        scalar_voice[i].Render(parameters[i], scalar_out[i], kAudioBlockSize);
+      }
+      elapsed[1] += double(clock() - start);
+      
+      for (int i = 0; i < fm::kNumVoiceLanes; ++i) {
+        for (size_t j = 0; j < kAudioBlockSize; ++j) {
+          float error = fabsf(lane_out[i][j] - scalar_out[i][j]);
+          num_mismatches += error != 0.0f;
+          max_error = max(max_error, error);
+        }
+      }
+    }
+  }
+  printf("FM voice lanes: %.2fx speed-up, %d mismatches (max error %g)\n",
+         elapsed[1] / elapsed[0], int(num_mismatches), max_error);
+  assert(num_mismatches == 0);
+}
+
+void TestPolyFM() {
+  // Plays the first patch of the first bank on 16 voices, with a different
+  // patch - and algorithm - every 4 notes, and checks that rendering the
+  // voices in SIMD lanes, grouped by algorithm, doesn't change the output.
+  const int kNumVoices = 16;
+  const size_t kNumSamples = kAudioBlockSize * 2048;
+  const size_t kNotePeriod = kAudioBlockSize * 32;
+  static float out[2][kNumSamples];
+  
+  const uint32_t seed = plaits::Random::state();
+  double elapsed[2] = { 0.0, 0.0 };
+  for (int run = 0; run < 2; ++run) {
+    PolyFM* poly = new PolyFM;
+    poly->Init(kNumVoices, kSampleRate);
+    poly->LoadBank(fm_patches_table[0]);
+    poly->set_use_lanes(run == 0);
+    plaits::Random::Seed(seed);
+    for (size_t i = 0; i < kNumSamples; i += kAudioBlockSize) {
+      if (i % kNotePeriod == 0) {
+        const int note = i / kNotePeriod;
+        const int voice = note % kNumVoices;
+        poly->NoteOff(voice);
+        poly->NoteOn(
+            voice,
+            note % 4 ? 0 : (note * 7) % kNumPolyFMPatches,
+            36.0f + float((note * 5) % 36),
+            0.3f + 0.1f * float(note % 7));
+      }
+      poly->set_brightness(float(i) / float(kNumSamples));
+      clock_t start = clock();
+      poly->Render(&out[run][i], kAudioBlockSize);
+      elapsed[run] += double(clock() - start);
+    }
+    delete poly;
+  }
+  
+  size_t num_mismatches = 0;
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    num_mismatches += out[0][i] != out[1][i];
+  }
+  printf("Poly FM: %.2fx speed-up with lanes, %d mismatches\n",
+         elapsed[1] / elapsed[0], int(num_mismatches));
+  assert(num_mismatches == 0);
+}
+
+#ifdef PLAITS_ENGINE_POOL
+
+void TestEngineCrossfade() {
+  // A self-enveloped engine (bass drum) is replaced by an engine going
+  // through the LPG (virtual analog) while the kick is still ringing. At the
+  // beginning of the cross-fade, the output must match the one of a voice
+  // still playing the bass drum, which is not passed through the LPG.
+  const size_t kSwitchBlock = kSampleRate / 10 / kBlockSize;
+  
+  Patch patch;
+  patch.note = 36.0f;
+  patch.harmonics = 0.5f;
+  patch.timbre = 0.5f;
+  patch.morph = 0.5f;
+  patch.frequency_modulation_amount = 0.0f;
+  patch.timbre_modulation_amount = 0.0f;
+  patch.morph_modulation_amount = 0.0f;
+  patch.decay = 0.5f;
+  patch.lpg_colour = 0.5f;
+  
+  Modulations modulations;
+  memset(&modulations, 0, sizeof(modulations));
+  modulations.trigger_patched = true;
+  
+  Voice::Frame frames[2][kBlockSize];
+  for (int run = 0; run < 2; ++run) {
+    Voice v;
+    InitVoice(&v);
+    for (size_t block = 0; block <= kSwitchBlock; ++block) {
+      patch.engine = run == 1 && block == kSwitchBlock ? 8 : 21;
+      modulations.trigger = block < 10 ? 1.0f : 0.0f;
+      v.Render(patch, modulations, frames[run], kBlockSize);
+    }
+  }
+  
+  // The new engine contributes at most 1/240th of full scale per sample.
+  int max_deviation = 0;
+  int bound = 0;
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    int deviation = abs(frames[1][i].out - frames[0][i].out);
+    max_deviation = max(max_deviation, deviation);
+    bound = max(bound, int(65536.0f * float(i + 1) / 240.0f) + 1);
+  }
+  printf("Engine crossfade: level %d, deviation %d (bound %d): %s\n",
+         int(frames[0][0].out), max_deviation, bound,
+         max_deviation <= bound ? "OK" : "FAIL");
+  assert(max_deviation <= bound);
+}
+
+void TestEngineCrossfadeInterrupted() {
+  // A switch from virtual analog to waveshaping is followed, before the end
+  // of the 240 samples cross-fade, by a switch to FM. The FM engine must only
+  // come in once the virtual analog one has been faded out: until then, the
+  // output is the same as the one of a voice staying on waveshaping. It must
+  // then come in gradually.
+  const size_t kSwitchBlock = 100;
+  const size_t kInterruptBlock = kSwitchBlock + 2;
+  const size_t kNumBlocks = kSwitchBlock + 60;
+  
+  Patch patch;
+  patch.note = 48.0f;
+  patch.harmonics = 0.5f;
+  patch.timbre = 0.5f;
+  patch.morph = 0.5f;
+  patch.frequency_modulation_amount = 0.0f;
+  patch.timbre_modulation_amount = 0.0f;
+  patch.morph_modulation_amount = 0.0f;
+  patch.decay = 0.5f;
+  patch.lpg_colour = 0.5f;
+  
+  Modulations modulations;
+  memset(&modulations, 0, sizeof(modulations));
+  
+  static Voice::Frame frames[2][kNumBlocks * kBlockSize];
+  for (int run = 0; run < 2; ++run) {
+    Voice v;
+    InitVoice(&v);
+    for (size_t block = 0; block < kNumBlocks; ++block) {
+      patch.engine = block < kSwitchBlock ? 8 : 9;
+      if (run == 1 && block >= kInterruptBlock) {
+        patch.engine = 10;
+      }
+      v.Render(
+          patch,
+          modulations,
+          &frames[run][block * kBlockSize],
+          kBlockSize);
+    }
+  }
+  
+  size_t first_difference = kNumBlocks * kBlockSize;
+  for (size_t i = kNumBlocks * kBlockSize; i-- > 0; ) {
+    if (frames[0][i].out != frames[1][i].out ||
+        frames[0][i].aux != frames[1][i].aux) {
+      first_difference = i;
+    }
+  }
+  const size_t fade_end = kSwitchBlock * kBlockSize + 240;
+  assert(first_difference >= fade_end);
+  assert(first_difference < kNumBlocks * kBlockSize);
+  
+  // From there on, the FM engine contributes at most 1/240th of full scale
+  // more per sample.
+  int max_excess = 0;
+  for (size_t i = first_difference; i < kNumBlocks * kBlockSize; ++i) {
+    int bound = int(65536.0f * float(i - first_difference + 1) / 240.0f) + 1;
+    int deviation = max(
+        abs(frames[1][i].out - frames[0][i].out),
+        abs(frames[1][i].aux - frames[0][i].aux));
+    max_excess = max(max_excess, deviation - bound);
+  }
+  printf("Engine crossfade interrupted: third engine after %d samples, "
+         "excess deviation %d: %s\n",
+         int(first_difference - kSwitchBlock * kBlockSize),
+         max_excess,
+         max_excess <= 0 ? "OK" : "FAIL");
+  assert(max_excess <= 0);
+}
+
+void TestEngineCrossfadeReversed() {
+  // A voice playing the modal engine switches to waveshaping, then back to
+  // the modal engine one block later. The modal engine is still playing while
+  // it is being faded out, so it must resume without being reset: its output
+  // deviates from the one of a voice staying on the modal engine only by the
+  // small share of waveshaping mixed in, and is identical once the cross-fade
+  // is over.
+  const size_t kSwitchBlock = 100;
+  const size_t kReverseBlock = kSwitchBlock + 1;
+  const size_t kNumBlocks = kSwitchBlock + 60;
+  
+  Patch patch;
+  patch.note = 48.0f;
+  patch.harmonics = 0.5f;
+  patch.timbre = 0.5f;
+  patch.morph = 0.5f;
+  patch.frequency_modulation_amount = 0.0f;
+  patch.timbre_modulation_amount = 0.0f;
+  patch.morph_modulation_amount = 0.0f;
+  patch.decay = 0.5f;
+  patch.lpg_colour = 0.5f;
+  
+  Modulations modulations;
+  memset(&modulations, 0, sizeof(modulations));
+  
+  // The modal engine uses random numbers: both runs must see the same ones.
+  const uint32_t seed = plaits::Random::state();
+  static Voice::Frame frames[2][kNumBlocks * kBlockSize];
+  for (int run = 0; run < 2; ++run) {
+    plaits::Random::Seed(seed);
+    Voice v;
+    InitVoice(&v);
+    for (size_t block = 0; block < kNumBlocks; ++block) {
+      patch.engine = run == 1 && block == kSwitchBlock ? 9 : 20;
+      v.Render(
+          patch,
+          modulations,
+          &frames[run][block * kBlockSize],
+          kBlockSize);
+    }
+  }
+  
+  // Waveshaping is mixed in for at most two blocks, with a weight which
+  // never exceeds kBlockSize / 240.
+  const int bound = int(65536.0f * float(kBlockSize) / 240.0f) + 1;
+  const size_t fade_end = (kReverseBlock + 2) * kBlockSize;
+  int max_deviation = 0;
+  size_t num_mismatches = 0;
+  for (size_t i = kSwitchBlock * kBlockSize;
+       i < kNumBlocks * kBlockSize;
+       ++i) {
+    int deviation = max(
+        abs(frames[1][i].out - frames[0][i].out),
+        abs(frames[1][i].aux - frames[0][i].aux));
+    max_deviation = max(max_deviation, deviation);
+    if (i >= fade_end && deviation) {
+      ++num_mismatches;
+    }
+  }
+  printf("Engine crossfade reversed: deviation %d (bound %d), "
+         "%d mismatches after the fade: %s\n",
+         max_deviation, bound, int(num_mismatches),
+         max_deviation <= bound && num_mismatches == 0 ? "OK" : "FAIL");
+  assert(max_deviation <= bound);
+  assert(num_mismatches == 0);
+}
+
+void TestEnginePool() {
+  // 8 voices, each of them switching to a different model every 0.25s, share
+  // a pool with room for only 12 engines.
+  const int kNumVoices = 8;
+  const int kNumSlots = 12;
+  const size_t kNumBlocks = 8 * kSampleRate / kBlockSize;
+  const size_t kBlocksPerModel = kSampleRate / kBlockSize / 4;
+  
+  WavWriter wav_writer(2, kSampleRate, 8);
+  wav_writer.Open("plaits_engine_pool.wav");
+
+  EnginePool pool;
+  const size_t arena_size = EnginePool::arena_size(kNumSlots);
+  char* arena = new char[arena_size];
+  pool.Init(arena, arena_size);
+  pool.set_idle_timeout(kBlocksPerModel * 2);
+  
+  Voice* voices = new Voice[kNumVoices];
+  Patch patch[kNumVoices];
+  Modulations modulations;
+  memset(&modulations, 0, sizeof(modulations));
+  for (int i = 0; i < kNumVoices; ++i) {
+    voices[i].Init(&pool);
+    patch[i].note = 48.0f + float(i);
+    patch[i].harmonics = 0.5f;
+    patch[i].timbre = 0.5f;
+    patch[i].morph = 0.5f;
+    patch[i].frequency_modulation_amount = 0.0f;
+    patch[i].timbre_modulation_amount = 0.0f;
+    patch[i].morph_modulation_amount = 0.0f;
+    patch[i].decay = 0.5f;
+    patch[i].lpg_colour = 0.5f;
+  }
+  
+  size_t max_memory_usage = 0;
+  for (size_t block = 0; block < kNumBlocks; ++block) {
+    Voice::Frame frames[kNumVoices][kBlockSize];
+    for (int i = 0; i < kNumVoices; ++i) {
+      patch[i].engine = (i * 3 + block / kBlocksPerModel) % kMaxEngines;
+      voices[i].Render(patch[i], modulations, frames[i], kBlockSize);
+      max_memory_usage = max(max_memory_usage, voices[i].memory_usage());
+    }
+    pool.Tick();
+    
+    float out[kBlockSize];
+    float aux[kBlockSize];
+    for (size_t j = 0; j < kBlockSize; ++j) {
+      out[j] = frames[0][j].out / 32768.0f;
+      aux[j] = frames[0][j].aux / 32768.0f;
+    }
+    wav_writer.Write(out, aux, kBlockSize);
+  }
+  
+  printf("Engine pool: %d slots of %d bytes, %d live engines (peak %d)\n",
+         pool.num_slots(), int(pool.slot_size()),
+         pool.num_live_engines(), pool.peak_live_engines());
+  printf("Engine pool: %d constructions, %d evictions\n",
+         pool.num_constructions(), pool.num_evictions());
+  printf("Engine pool: %d bytes per voice at most\n",
+         int(max_memory_usage));
+  
+  delete[] voices;
+  delete[] arena;
+}
+
+#endif  // PLAITS_ENGINE_POOL
+
 int main(void) {
+#ifdef __SSE__
   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#endif  // __SSE__
   // TestFormantOscillator();
   // TestGrainletOscillator();
   // TestOscillator();
@@ -1336,4 +2179,22 @@ int main(void) {
   
   // TestLPGAttackDecay();
   TestSixOpEngine();
+  TestFMVoiceLanes();
+  TestPolyFM();
+  TestWavetableEngineMipmaps();
+  TestPolyphaseDownsamplerReference();
+#ifdef PLAITS_SIMD
+  TestHarmonicOscillatorLanes();
+  TestPolyphaseDownsamplerLanes();
+  TestSwarmEngineLanes();
+#endif  // PLAITS_SIMD
+#ifdef PLAITS_ENGINE_POOL
+  TestEnginePool();
+  TestEngineCrossfade();
+  TestEngineCrossfadeInterrupted();
+  TestEngineCrossfadeReversed();
+#endif  // PLAITS_ENGINE_POOL
+#ifdef FM_FUSED_RENDERERS
+  TestSixOpEngineFusedRenderers();
+#endif  // FM_FUSED_RENDERERS
 }
@@ -36,6 +36,8 @@
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/cosine_oscillator.h"
 
+#include "rings/dsp/simd.h"
+
 namespace rings {
 
 #define TAIL , -1
@@ -66,6 +68,22 @@ struct DataType<FORMAT_12_BIT> {
     return static_cast<uint16_t>(
         stmlib::Clip16(static_cast<int32_t>(value * 4096.0f)));
   }
+
+#ifdef RINGS_SIMD
+  // Lane versions. The delay memory is addressed backwards: the lanes hold
+  // in[0], in[-1], in[-2] and in[-3].
+  static inline LaneFloat Decompress(const T* in) {
+    return ReverseLanes(MulLanes(
+        LoadLanes(reinterpret_cast<const int16_t*>(in - 3)),
+        SplatLanes(1.0f / 4096.0f)));
+  }
+  
+  static inline void Compress(LaneFloat value, T* out) {
+    StoreLanes(
+        reinterpret_cast<int16_t*>(out - 3),
+        TruncateLanes(MulLanes(ReverseLanes(value), SplatLanes(4096.0f))));
+  }
+#endif  // RINGS_SIMD
 };
 
 template<>
@@ -80,6 +98,20 @@ struct DataType<FORMAT_16_BIT> {
     return static_cast<uint16_t>(
         stmlib::Clip16(static_cast<int32_t>(value * 32768.0f)));
   }
+
+#ifdef RINGS_SIMD
+  static inline LaneFloat Decompress(const T* in) {
+    return ReverseLanes(MulLanes(
+        LoadLanes(reinterpret_cast<const int16_t*>(in - 3)),
+        SplatLanes(1.0f / 32768.0f)));
+  }
+  
+  static inline void Compress(LaneFloat value, T* out) {
+    StoreLanes(
+        reinterpret_cast<int16_t*>(out - 3),
+        TruncateLanes(MulLanes(ReverseLanes(value), SplatLanes(32768.0f))));
+  }
+#endif  // RINGS_SIMD
 };
 
 template<>
@@ -93,6 +125,16 @@ struct DataType<FORMAT_32_BIT> {
   static inline T Compress(float value) {
     return value;
   }
+
+#ifdef RINGS_SIMD
+  static inline LaneFloat Decompress(const T* in) {
+    return ReverseLanes(LoadLanes(in - 3));
+  }
+  
+  static inline void Compress(LaneFloat value, T* out) {
+    StoreLanes(out - 3, ReverseLanes(value));
+  }
+#endif  // RINGS_SIMD
 };
 
 template<
@@ -262,6 +304,271 @@ class FxEngine {
     DISALLOW_COPY_AND_ASSIGN(Context);
   };
   
+  // Same as Context, but each operation is applied to a block of samples
+  // before moving to the next one. The results are the same as long as no tap
+  // reads a sample written less than block_size samples before by an
+  // operation coming later in the program; or a sample that is going to be
+  // overwritten less than block_size samples later by an operation coming
+  // earlier in the program (a modulated tap reaching the memory of the next
+  // delay line, for example).
+  template<size_t block_size>
+  class BlockContext {
+   friend class FxEngine;
+   public:
+    BlockContext() { }
+    ~BlockContext() { }
+    
+    enum {
+#ifdef RINGS_SIMD
+      max_size = block_size
+#else
+      // Without vector registers, nothing is gained by working on blocks:
+      // process one sample at a time and keep everything in registers.
+      max_size = 1
+#endif  // RINGS_SIMD
+    };
+    
+    inline void Load(const float* value) {
+      std::copy(&value[0], &value[num_samples()], &accumulator_[0]);
+    }
+
+    // Takes a non-const pointer so that arrays do not bind to the delay line
+    // version of Read() below.
+    inline void Read(float* value, float scale) {
+      Accumulate(value, scale);
+    }
+
+    inline void Read(const float* value) {
+      Accumulate(value, 1.0f);
+    }
+
+    inline void Write(float* value) {
+      std::copy(&accumulator_[0], &accumulator_[num_samples()], &value[0]);
+    }
+
+    inline void Write(float* value, float scale) {
+      Write(value);
+      Scale(scale);
+    }
+    
+    template<typename D>
+    inline void Write(D& d, int32_t offset, float scale) {
+      STATIC_ASSERT(D::base + D::length <= size, delay_memory_full);
+      if (offset == -1) {
+        offset = D::length - 1;
+      }
+      Store(write_ptr_ + D::base + offset, scale, false);
+    }
+    
+    template<typename D>
+    inline void Write(D& d, float scale) {
+      Write(d, 0, scale);
+    }
+
+    template<typename D>
+    inline void WriteAllPass(D& d, int32_t offset, float scale) {
+      STATIC_ASSERT(D::base + D::length <= size, delay_memory_full);
+      if (offset == -1) {
+        offset = D::length - 1;
+      }
+      Store(write_ptr_ + D::base + offset, scale, true);
+    }
+    
+    template<typename D>
+    inline void WriteAllPass(D& d, float scale) {
+      WriteAllPass(d, 0, scale);
+    }
+    
+    template<typename D>
+    inline void Read(D& d, int32_t offset, float scale) {
+      STATIC_ASSERT(D::base + D::length <= size, delay_memory_full);
+      if (offset == -1) {
+        offset = D::length - 1;
+      }
+      Fetch(write_ptr_ + D::base + offset, scale);
+    }
+    
+    template<typename D>
+    inline void Read(D& d, float scale) {
+      Read(d, 0, scale);
+    }
+    
+    inline void Lp(float& state, float coefficient) {
+      for (size_t i = 0; i < num_samples(); ++i) {
+        state += coefficient * (accumulator_[i] - state);
+        accumulator_[i] = state;
+      }
+    }
+
+    inline void Hp(float& state, float coefficient) {
+      for (size_t i = 0; i < num_samples(); ++i) {
+        state += coefficient * (accumulator_[i] - state);
+        accumulator_[i] -= state;
+      }
+    }
+    
+    template<typename D>
+    inline void Interpolate(D& d, float offset, float scale) {
+      STATIC_ASSERT(D::base + D::length <= size, delay_memory_full);
+      MAKE_INTEGRAL_FRACTIONAL(offset);
+      float b[max_size];
+      Fetch(write_ptr_ + offset_integral + D::base, previous_read_);
+      Fetch(write_ptr_ + offset_integral + D::base + 1, b);
+      for (size_t i = 0; i < num_samples(); ++i) {
+        float a = previous_read_[i];
+        previous_read_[i] = a + (b[i] - a) * offset_fractional;
+      }
+      Accumulate(previous_read_, scale);
+    }
+    
+    template<typename D>
+    inline void Interpolate(D& d, const float* offset, const float* scale) {
+      STATIC_ASSERT(D::base + D::length <= size, delay_memory_full);
+      for (size_t i = 0; i < num_samples(); ++i) {
+        InterpolateSample<D>(i, offset[i], scale[i]);
+      }
+    }
+    
+    template<typename D>
+    inline void Interpolate(
+        D& d, float offset, LFOIndex index, float amplitude, float scale) {
+      STATIC_ASSERT(D::base + D::length <= size, delay_memory_full);
+      const float* lfo_value = lfo_value_[index];
+      for (size_t i = 0; i < num_samples(); ++i) {
+        InterpolateSample<D>(i, offset + amplitude * lfo_value[i], scale);
+      }
+    }
+    
+   private:
+    inline size_t num_samples() const {
+      return max_size == 1 ? 1 : size_;
+    }
+    
+    // accumulator += in * scale
+    inline void Accumulate(const float* in, float scale) {
+      size_t i = 0;
+#ifdef RINGS_SIMD
+      const LaneFloat scale_lanes = SplatLanes(scale);
+      for (; i + kNumLanes <= num_samples(); i += kNumLanes) {
+        StoreLanes(&accumulator_[i], AddLanes(
+            LoadLanes(&accumulator_[i]),
+            MulLanes(LoadLanes(&in[i]), scale_lanes)));
+      }
+#endif  // RINGS_SIMD
+      for (; i < num_samples(); ++i) {
+        accumulator_[i] += in[i] * scale;
+      }
+    }
+    
+    // accumulator *= scale
+    inline void Scale(float scale) {
+      size_t i = 0;
+#ifdef RINGS_SIMD
+      const LaneFloat scale_lanes = SplatLanes(scale);
+      for (; i + kNumLanes <= num_samples(); i += kNumLanes) {
+        StoreLanes(&accumulator_[i], MulLanes(
+            LoadLanes(&accumulator_[i]), scale_lanes));
+      }
+#endif  // RINGS_SIMD
+      for (; i < num_samples(); ++i) {
+        accumulator_[i] *= scale;
+      }
+    }
+    
+    template<typename D>
+    inline void InterpolateSample(size_t i, float offset, float scale) {
+      MAKE_INTEGRAL_FRACTIONAL(offset);
+      const int32_t position = write_ptr_ - static_cast<int32_t>(i) + \
+          offset_integral + D::base;
+      float a = DataType<format>::Decompress(buffer_[position & MASK]);
+      float b = DataType<format>::Decompress(buffer_[(position + 1) & MASK]);
+      float x = a + (b - a) * offset_fractional;
+      previous_read_[i] = x;
+      accumulator_[i] += x * scale;
+    }
+    
+    // Reads the samples at position, position - 1, ... into out.
+    inline void Fetch(int32_t position, float* out) {
+      position &= MASK;
+      size_t i = 0;
+#ifdef RINGS_SIMD
+      if (position >= static_cast<int32_t>(num_samples()) - 1) {
+        for (; i + kNumLanes <= num_samples(); i += kNumLanes) {
+          StoreLanes(&out[i], DataType<format>::Decompress(
+              &buffer_[position - static_cast<int32_t>(i)]));
+        }
+      }
+#endif  // RINGS_SIMD
+      for (; i < num_samples(); ++i) {
+        out[i] = DataType<format>::Decompress(
+            buffer_[(position - static_cast<int32_t>(i)) & MASK]);
+      }
+    }
+    
+    // Same as above, into the previous read, which is also accumulated.
+    inline void Fetch(int32_t position, float scale) {
+      position &= MASK;
+      size_t i = 0;
+#ifdef RINGS_SIMD
+      if (position >= static_cast<int32_t>(num_samples()) - 1) {
+        const LaneFloat scale_lanes = SplatLanes(scale);
+        for (; i + kNumLanes <= num_samples(); i += kNumLanes) {
+          LaneFloat x = DataType<format>::Decompress(
+              &buffer_[position - static_cast<int32_t>(i)]);
+          StoreLanes(&previous_read_[i], x);
+          StoreLanes(&accumulator_[i], AddLanes(
+              LoadLanes(&accumulator_[i]), MulLanes(x, scale_lanes)));
+        }
+      }
+#endif  // RINGS_SIMD
+      for (; i < num_samples(); ++i) {
+        float x = DataType<format>::Decompress(
+            buffer_[(position - static_cast<int32_t>(i)) & MASK]);
+        previous_read_[i] = x;
+        accumulator_[i] += x * scale;
+      }
+    }
+    
+    // Writes the accumulator at position, position - 1, ... then scales it
+    // (and adds the previous read for an allpass).
+    inline void Store(int32_t position, float scale, bool all_pass) {
+      position &= MASK;
+      size_t i = 0;
+#ifdef RINGS_SIMD
+      if (position >= static_cast<int32_t>(num_samples()) - 1) {
+        const LaneFloat scale_lanes = SplatLanes(scale);
+        for (; i + kNumLanes <= num_samples(); i += kNumLanes) {
+          LaneFloat x = LoadLanes(&accumulator_[i]);
+          DataType<format>::Compress(
+              x, &buffer_[position - static_cast<int32_t>(i)]);
+          x = MulLanes(x, scale_lanes);
+          if (all_pass) {
+            x = AddLanes(x, LoadLanes(&previous_read_[i]));
+          }
+          StoreLanes(&accumulator_[i], x);
+        }
+      }
+#endif  // RINGS_SIMD
+      for (; i < num_samples(); ++i) {
+        buffer_[(position - static_cast<int32_t>(i)) & MASK] = \
+            DataType<format>::Compress(accumulator_[i]);
+        accumulator_[i] *= scale;
+        if (all_pass) {
+          accumulator_[i] += previous_read_[i];
+        }
+      }
+    }
+    
+    float accumulator_[max_size];
+    float previous_read_[max_size];
+    float lfo_value_[2][max_size];
+    T* buffer_;
+    int32_t write_ptr_;
+    size_t size_;
+
+    DISALLOW_COPY_AND_ASSIGN(BlockContext);
+  };
+  
   inline void SetLFOFrequency(LFOIndex index, float frequency) {
     lfo_[index].template Init<stmlib::COSINE_OSCILLATOR_APPROXIMATE>(frequency * 32.0f);
   }
@@ -284,6 +591,34 @@ class FxEngine {
     }
   }
   
+  // Starts processing a block of up to num_samples samples, and returns the
+  // number of samples actually covered by the context.
+  template<size_t block_size>
+  inline size_t Start(BlockContext<block_size>* c, size_t num_samples) {
+    const size_t block = std::min(
+        num_samples,
+        static_cast<size_t>(BlockContext<block_size>::max_size));
+    c->size_ = block;
+    c->buffer_ = buffer_;
+    c->write_ptr_ = write_ptr_ - 1;
+    std::fill(&c->accumulator_[0], &c->accumulator_[block], 0.0f);
+    std::fill(&c->previous_read_[0], &c->previous_read_[block], 0.0f);
+    for (size_t i = 0; i < block; ++i) {
+      --write_ptr_;
+      if (write_ptr_ < 0) {
+        write_ptr_ += size;
+      }
+      if ((write_ptr_ & 31) == 0) {
+        c->lfo_value_[0][i] = lfo_[0].Next();
+        c->lfo_value_[1][i] = lfo_[1].Next();
+      } else {
+        c->lfo_value_[0][i] = lfo_[0].value();
+        c->lfo_value_[1][i] = lfo_[1].value();
+      }
+    }
+    return block;
+  }
+  
  private:
   enum {
     MASK = size - 1
@@ -31,6 +31,7 @@
 
 #include "stmlib/stmlib.h"
 
+#include "rings/dsp/dsp.h"
 #include "rings/dsp/fx/fx_engine.h"
 
 namespace rings {
@@ -73,7 +74,9 @@ class Reverb {
     E::DelayLine<Memory, 7> dap2a;
     E::DelayLine<Memory, 8> dap2b;
     E::DelayLine<Memory, 9> del2;
-    E::Context c;
+
+    // All the delay lines are longer than a block.
+    E::BlockContext<kMaxBlockSize> c;
 
     const float kap = diffusion_;
     const float klp = lp_;
@@ -84,16 +87,21 @@ class Reverb {
     float lp_1 = lp_decay_1_;
     float lp_2 = lp_decay_2_;
 
-    while (size--) {
-      float wet;
-      float apout = 0.0f;
-      engine_.Start(&c);
+    while (size) {
+      float input[kMaxBlockSize];
+      float apout[kMaxBlockSize];
+      float wet[kMaxBlockSize];
+      const size_t block = engine_.Start(&c, size);
+      
+      for (size_t i = 0; i < block; ++i) {
+        input[i] = left[i] + right[i];
+      }
       
       // Smear AP1 inside the loop.
       //c.Interpolate(ap1, 10.0f, LFO_1, 80.0f, 1.0f);
       //c.Write(ap1, 100, 0.0f);
       
-      c.Read(*left + *right, gain);
+      c.Read(input, gain);
 
       // Diffuse through 4 allpasses.
       c.Read(ap1 TAIL, kap);
@@ -117,7 +125,9 @@ class Reverb {
       c.Write(del1, 2.0f);
       c.Write(wet, 0.0f);
 
-      *left += (wet - *left) * amount;
+      for (size_t i = 0; i < block; ++i) {
+        left[i] += (wet[i] - left[i]) * amount;
+      }
 
       c.Load(apout);
       c.Interpolate(del1, 4460.0f, LFO_1, 40.0f, krt);
@@ -129,10 +139,13 @@ class Reverb {
       c.Write(del2, 2.0f);
       c.Write(wet, 0.0f);
 
-      *right += (wet - *right) * amount;
+      for (size_t i = 0; i < block; ++i) {
+        right[i] += (wet[i] - right[i]) * amount;
+      }
       
-      ++left;
-      ++right;
+      left += block;
+      right += block;
+      size -= block;
     }
     
     lp_decay_1_ = lp_1;
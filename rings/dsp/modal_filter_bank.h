@@ -0,0 +1,194 @@
+// Copyright 2015 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Bank of band-pass SVFs used for modal synthesis. The coefficients and states
+// of all modes are stored side by side (structure of arrays), so that groups
+// of 4 modes can be processed by a single SSE2 or NEON instruction.
+//
+// Without vector registers (the STM32F4), the modes are processed one by one,
+// as with the original array of stmlib::Svf. The lane-ordered scalar version
+// mimics the vector code bit for bit - as long as the compiler is not allowed
+// to fuse multiplications and additions - and is used by the tests.
+
+#ifndef RINGS_DSP_MODAL_FILTER_BANK_H_
+#define RINGS_DSP_MODAL_FILTER_BANK_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "stmlib/dsp/filter.h"
+
+#include "rings/dsp/simd.h"
+
+namespace rings {
+
+const size_t kModalFilterBankLanes = 4;
+
+template<size_t max_modes>
+class ModalFilterBank {
+ public:
+  ModalFilterBank() { }
+  ~ModalFilterBank() { }
+
+  void Init() {
+    STATIC_ASSERT(max_modes % kModalFilterBankLanes == 0, lanes_multiple);
+    for (size_t i = 0; i < max_modes; ++i) {
+      set_f_q<stmlib::FREQUENCY_DIRTY>(i, 0.01f, 100.0f);
+    }
+    Reset();
+  }
+
+  void Reset() {
+    std::fill(&state_1_[0], &state_1_[max_modes], 0.0f);
+    std::fill(&state_2_[0], &state_2_[max_modes], 0.0f);
+  }
+
+  // Same coefficients as stmlib::Svf::set_f_q.
+  template<stmlib::FrequencyApproximation approximation>
+  inline void set_f_q(size_t i, float f, float resonance) {
+    float g = stmlib::OnePole::tan<approximation>(f);
+    float r = 1.0f / resonance;
+    set_g_r_h(i, g, r, 1.0f / (1.0f + r * g + g * g));
+  }
+
+  inline void set_g_r_h(size_t i, float g, float r, float h) {
+    g_[i] = g;
+    r_[i] = r;
+    h_[i] = h;
+  }
+
+  inline float g(size_t i) const { return g_[i]; }
+  inline float r(size_t i) const { return r_[i]; }
+  inline float h(size_t i) const { return h_[i]; }
+
+  // Number of modes actually processed by the vector code when num_modes are
+  // requested. The gains of the extra modes must be set to 0.
+  static inline size_t padded_size(size_t num_modes) {
+    return (num_modes + kModalFilterBankLanes - 1) & \
+        ~(kModalFilterBankLanes - 1);
+  }
+
+  // Processes one sample through the bank. The band-pass outputs of even
+  // modes (0, 2, 4...) are weighted by gain and summed into odd; the outputs
+  // of odd modes (1, 3, 5...) are summed into even. num_modes must be even.
+  inline void ProcessOddEven(
+      float in,
+      const float* gain,
+      size_t num_modes,
+      float* odd,
+      float* even) {
+#ifdef RINGS_SIMD
+    ProcessOddEvenLanes(in, gain, num_modes, odd, even);
+#else
+    float o = 0.0f;
+    float e = 0.0f;
+    for (size_t i = 0; i < num_modes; i += 2) {
+      o += gain[i] * Tick(i, in);
+      e += gain[i + 1] * Tick(i + 1, in);
+    }
+    *odd = o;
+    *even = e;
+#endif  // RINGS_SIMD
+  }
+
+  // Same accumulation order as the vector code.
+  inline void ProcessOddEvenScalar(
+      float in,
+      const float* gain,
+      size_t num_modes,
+      float* odd,
+      float* even) {
+    float acc[kModalFilterBankLanes];
+    std::fill(&acc[0], &acc[kModalFilterBankLanes], 0.0f);
+    num_modes = padded_size(num_modes);
+    for (size_t i = 0; i < num_modes; i += kModalFilterBankLanes) {
+      for (size_t j = 0; j < kModalFilterBankLanes; ++j) {
+        acc[j] += gain[i + j] * Tick(i + j, in);
+      }
+    }
+    *odd = acc[0] + acc[2];
+    *even = acc[1] + acc[3];
+  }
+
+ private:
+  // Same arithmetic, in the same order, as stmlib::Svf::Process.
+  inline float Tick(size_t i, float in) {
+    float hp, bp, lp;
+    hp = (in - r_[i] * state_1_[i] - g_[i] * state_1_[i] - state_2_[i]) * h_[i];
+    bp = g_[i] * hp + state_1_[i];
+    state_1_[i] = g_[i] * hp + bp;
+    lp = g_[i] * bp + state_2_[i];
+    state_2_[i] = g_[i] * bp + lp;
+    return bp;
+  }
+
+#ifdef RINGS_SIMD
+  inline LaneFloat Tick(size_t i, LaneFloat in) {
+    LaneFloat g = LoadLanes(&g_[i]);
+    LaneFloat s1 = LoadLanes(&state_1_[i]);
+    LaneFloat s2 = LoadLanes(&state_2_[i]);
+    LaneFloat hp = SubLanes(in, MulLanes(LoadLanes(&r_[i]), s1));
+    hp = SubLanes(hp, MulLanes(g, s1));
+    hp = MulLanes(SubLanes(hp, s2), LoadLanes(&h_[i]));
+    LaneFloat bp = AddLanes(MulLanes(g, hp), s1);
+    StoreLanes(&state_1_[i], AddLanes(MulLanes(g, hp), bp));
+    LaneFloat lp = AddLanes(MulLanes(g, bp), s2);
+    StoreLanes(&state_2_[i], AddLanes(MulLanes(g, bp), lp));
+    return bp;
+  }
+
+  inline void ProcessOddEvenLanes(
+      float in,
+      const float* gain,
+      size_t num_modes,
+      float* odd,
+      float* even) {
+    LaneFloat x = SplatLanes(in);
+    LaneFloat acc = SplatLanes(0.0f);
+    num_modes = padded_size(num_modes);
+    for (size_t i = 0; i < num_modes; i += kModalFilterBankLanes) {
+      acc = AddLanes(acc, MulLanes(LoadLanes(&gain[i]), Tick(i, x)));
+    }
+    float lanes[kModalFilterBankLanes];
+    StoreLanes(lanes, acc);
+    *odd = lanes[0] + lanes[2];
+    *even = lanes[1] + lanes[3];
+  }
+#endif  // RINGS_SIMD
+
+  float g_[max_modes];
+  float r_[max_modes];
+  float h_[max_modes];
+  float state_1_[max_modes];
+  float state_2_[max_modes];
+
+  DISALLOW_COPY_AND_ASSIGN(ModalFilterBank);
+};
+
+}  // namespace rings
+
+#endif  // RINGS_DSP_MODAL_FILTER_BANK_H_
@@ -28,6 +28,8 @@
 
 #include "rings/dsp/resonator.h"
 
+#include <cmath>
+
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/cosine_oscillator.h"
 #include "stmlib/dsp/parameter_interpolator.h"
@@ -39,10 +41,17 @@ namespace rings {
 using namespace std;
 using namespace stmlib;
 
+// Changes of the structure, brightness and damping parameters below this
+// threshold (the resolution of the ADC) do not trigger a recomputation of the
+// filter coefficients.
+const float kParameterTolerance = 1.0f / 4096.0f;
+
+// Relative frequency change below which the coefficients are kept - about
+// 0.17 cents.
+const float kFrequencyTolerance = 1.0e-4f;
+
 void Resonator::Init() {
-  for (int32_t i = 0; i < kMaxModes; ++i) {
-    f_[i].Init();
-  }
+  f_.Init();
 
   set_frequency(220.0f / kSampleRate);
   set_structure(0.25f);
@@ -51,11 +60,20 @@ void Resonator::Init() {
   set_position(0.999f);
   previous_position_ = 0.0f;
   set_resolution(kMaxModes);
+  
+  // Forces a full computation of the coefficients on the first block.
+  cached_frequency_ = 0.0f;
+  cached_resolution_ = -1;
+  num_modes_ = 0;
+  
+  num_cache_lookups_ = 0;
+  num_cache_hits_ = 0;
+  num_partial_ratio_updates_ = 0;
 }
 
-int32_t Resonator::ComputeFilters() {
+void Resonator::ComputePartialRatios() {
   float stiffness = Interpolate(lut_stiffness, structure_, 256.0f);
-  float harmonic = frequency_;
+  float harmonic = 1.0f;
   float stretch_factor = 1.0f; 
   float q = 500.0f * Interpolate(
       lut_4_decades,
@@ -70,17 +88,9 @@ int32_t Resonator::ComputeFilters() {
   float brightness = brightness_ * (1.0f - 0.2f * brightness_attenuation);
   float q_loss = brightness * (2.0f - brightness) * 0.85f + 0.15f;
   float q_loss_damping_rate = structure_ * (2.0f - structure_) * 0.1f;
-  int32_t num_modes = 0;
   for (int32_t i = 0; i < min(kMaxModes, resolution_); ++i) {
-    float partial_frequency = harmonic * stretch_factor;
-    if (partial_frequency >= 0.49f) {
-      partial_frequency = 0.49f;
-    } else {
-      num_modes = i + 1;
-    }
-    f_[i].set_f_q<FREQUENCY_FAST>(
-        partial_frequency,
-        1.0f + partial_frequency * q);
+    partial_ratio_[i] = harmonic * stretch_factor;
+    partial_q_[i] = q;
     stretch_factor += stiffness;
     if (stiffness < 0.0f) {
       // Make sure that the partials do not fold back into negative frequencies.
@@ -91,31 +101,68 @@ int32_t Resonator::ComputeFilters() {
     }
     // This prevents the highest partials from decaying too fast.
     q_loss += q_loss_damping_rate * (1.0f - q_loss);
-    harmonic += frequency_;
+    harmonic += 1.0f;
     q *= q_loss;
   }
   
-  return num_modes;
+  cached_structure_ = structure_;
+  cached_brightness_ = brightness_;
+  cached_damping_ = damping_;
+  cached_resolution_ = resolution_;
+}
+
+int32_t Resonator::ComputeFilters() {
+  ++num_cache_lookups_;
+  bool timbre_changed = resolution_ != cached_resolution_ ||
+      fabsf(structure_ - cached_structure_) > kParameterTolerance ||
+      fabsf(brightness_ - cached_brightness_) > kParameterTolerance ||
+      fabsf(damping_ - cached_damping_) > kParameterTolerance;
+  bool frequency_changed = fabsf(frequency_ - cached_frequency_) >
+      cached_frequency_ * kFrequencyTolerance;
+  
+  if (timbre_changed) {
+    ++num_partial_ratio_updates_;
+    ComputePartialRatios();
+  } else if (!frequency_changed) {
+    ++num_cache_hits_;
+    return num_modes_;
+  }
+  
+  num_modes_ = 0;
+  for (int32_t i = 0; i < min(kMaxModes, resolution_); ++i) {
+    float partial_frequency = frequency_ * partial_ratio_[i];
+    if (partial_frequency >= 0.49f) {
+      partial_frequency = 0.49f;
+    } else {
+      num_modes_ = i + 1;
+    }
+    f_.set_f_q<FREQUENCY_FAST>(
+        i,
+        partial_frequency,
+        1.0f + partial_frequency * partial_q_[i]);
+  }
+  cached_frequency_ = frequency_;
+  return num_modes_;
 }
 
 void Resonator::Process(const float* in, float* out, float* aux, size_t size) {
   int32_t num_modes = ComputeFilters();
   
+  // Modes are rendered in pairs. On SIMD builds, the bank processes them in
+  // groups of kModalFilterBankLanes: the gains of the padding modes stay at 0.
+  int32_t num_weighted_modes = num_modes + (num_modes & 1);
+  float gain[kMaxModes];
+  fill(&gain[0], &gain[kMaxModes], 0.0f);
+
   ParameterInterpolator position(&previous_position_, position_, size);
   while (size--) {
     CosineOscillator amplitudes;
     amplitudes.Init<COSINE_OSCILLATOR_APPROXIMATE>(position.Next());
-    
-    float input = *in++ * 0.125f;
-    float odd = 0.0f;
-    float even = 0.0f;
     amplitudes.Start();
-    for (int32_t i = 0; i < num_modes;) {
-      odd += amplitudes.Next() * f_[i++].Process<FILTER_MODE_BAND_PASS>(input);
-      even += amplitudes.Next() * f_[i++].Process<FILTER_MODE_BAND_PASS>(input);
+    for (int32_t i = 0; i < num_weighted_modes; ++i) {
+      gain[i] = amplitudes.Next();
     }
-    *out++ = odd;
-    *aux++ = even;
+    f_.ProcessOddEven(*in++ * 0.125f, gain, num_weighted_modes, out++, aux++);
   }
 }
 
@@ -34,6 +34,7 @@
 #include <algorithm>
 
 #include "rings/dsp/dsp.h"
+#include "rings/dsp/modal_filter_bank.h"
 #include "stmlib/dsp/filter.h"
 #include "stmlib/dsp/delay_line.h"
 
@@ -78,8 +79,17 @@ class Resonator {
     resolution_ = std::min(resolution, kMaxModes);
   }
   
+  // Statistics of the filter coefficients cache.
+  inline uint32_t num_cache_lookups() const { return num_cache_lookups_; }
+  inline uint32_t num_cache_hits() const { return num_cache_hits_; }
+  inline uint32_t num_partial_ratio_updates() const {
+    return num_partial_ratio_updates_;
+  }
+  
  private:
   int32_t ComputeFilters();
+  void ComputePartialRatios();
+  
   float frequency_;
   float structure_;
   float brightness_;
@@ -89,7 +99,25 @@ class Resonator {
   
   int32_t resolution_;
   
-  stmlib::Svf f_[kMaxModes];
+  // Values of the parameters for which the coefficients of f_ have been
+  // computed.
+  float cached_frequency_;
+  float cached_structure_;
+  float cached_brightness_;
+  float cached_damping_;
+  int32_t cached_resolution_;
+  int32_t num_modes_;
+  
+  // Frequency ratio and Q factor of each partial. They do not depend on the
+  // frequency, so a change of pitch only requires a rescaling.
+  float partial_ratio_[kMaxModes];
+  float partial_q_[kMaxModes];
+  
+  uint32_t num_cache_lookups_;
+  uint32_t num_cache_hits_;
+  uint32_t num_partial_ratio_updates_;
+  
+  ModalFilterBank<kMaxModes> f_;
   
   DISALLOW_COPY_AND_ASSIGN(Resonator);
 };
@@ -19,7 +19,9 @@
 #include <cstdlib>
 #include <xmmintrin.h>
 
+#include "rings/dsp/modal_filter_bank.h"
 #include "rings/dsp/part.h"
+#include "rings/dsp/resonator.h"
 #include "rings/dsp/onset_detector.h"
 #include "rings/dsp/string_synth_part.h"
 #include "rings/dsp/string_synth_oscillator.h"
@@ -94,6 +96,70 @@ void TestModal() {
   }
 }
 
+void TestModalFilterBank() {
+  ModalFilterBank<kMaxModes> vectorized;
+  ModalFilterBank<kMaxModes> scalar;
+  vectorized.Init();
+  scalar.Init();
+  
+  float gain[kMaxModes];
+  for (int32_t i = 0; i < kMaxModes; ++i) {
+    float f = 0.45f * Random::GetFloat();
+    float q = 1.0f + 500.0f * Random::GetFloat();
+    vectorized.set_f_q<FREQUENCY_FAST>(i, f, q);
+    scalar.set_f_q<FREQUENCY_FAST>(i, f, q);
+    gain[i] = Random::GetFloat();
+  }
+  
+  size_t mismatches = 0;
+  for (size_t i = 0; i < ::kSampleRate; ++i) {
+    float in = i % 4800 == 0 ? 1.0f : 0.0f;
+    size_t num_modes = 1 + (i / 480) % kMaxModes;
+    float v[2];
+    float s[2];
+    vectorized.ProcessOddEven(in, gain, num_modes, &v[0], &v[1]);
+    scalar.ProcessOddEvenScalar(in, gain, num_modes, &s[0], &s[1]);
+    if (memcmp(v, s, sizeof(v))) {
+      ++mismatches;
+    }
+  }
+  printf("Modal filter bank: %zu mismatching samples\n", mismatches);
+}
+
+void TestResonatorCache() {
+  Resonator resonator;
+  resonator.Init();
+  resonator.set_structure(0.25f);
+  resonator.set_brightness(0.3f);
+  resonator.set_damping(0.95f);
+  resonator.set_position(0.75f);
+  
+  // 4s of held note, 4s of vibrato, 4s of structure sweep.
+  const uint32_t kSectionDuration = ::kSampleRate * 4;
+  for (uint32_t i = 0; i < kSectionDuration * 3; i += kAudioBlockSize) {
+    float in[kAudioBlockSize];
+    float out[kAudioBlockSize];
+    float aux[kAudioBlockSize];
+    fill(&in[0], &in[kAudioBlockSize], 0.0f);
+    in[0] = i % ::kSampleRate == 0 ? 1.0f : 0.0f;
+    
+    float note = 57.0f;
+    if (i >= kSectionDuration && i < 2 * kSectionDuration) {
+      note += 0.3f * sinf(2.0f * M_PI * 5.0f * i / ::kSampleRate);
+    } else if (i >= 2 * kSectionDuration) {
+      resonator.set_structure(float(i - 2 * kSectionDuration) /
+          kSectionDuration);
+    }
+    resonator.set_frequency(a3 * SemitonesToRatio(note - 69.0f));
+    resonator.Process(in, out, aux, kAudioBlockSize);
+  }
+  printf(
+      "Resonator cache: %u lookups, %.1f%% hits, %u partial ratio updates\n",
+      resonator.num_cache_lookups(),
+      100.0f * resonator.num_cache_hits() / resonator.num_cache_lookups(),
+      resonator.num_partial_ratio_updates());
+}
+
 void TestString() {
   WavWriter wav_writer(2, ::kSampleRate, 20);
   wav_writer.Open("rings_string.wav");
@@ -559,6 +625,8 @@ void TestStringSynthPart() {
 int main(void) {
   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
   TestNoteFilter();
+  TestModalFilterBank();
+  TestResonatorCache();
   TestModal();
   TestString();
   // TestFM();
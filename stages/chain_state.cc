@@ -45,12 +45,16 @@ const uint32_t kUnpatchedInputDelay = 2000;
 const int32_t kLongPressDuration = 800;
 const int32_t kVeryLongPressDuration = 3000;
 
-void ChainState::Init(SerialLink* left, SerialLink* right) {
+void ChainState::Init(
+    SerialLink* left,
+    SerialLink* right,
+    SegmentPool* segment_pool) {
   index_ = 0;
   size_ = 1;
   
   left_ = left;
   right_ = right;
+  segment_pool_ = segment_pool;
   
   STATIC_ASSERT(sizeof(Packet) == kPacketSize, BAD_PACKET_SIZE);
   
@@ -237,6 +241,12 @@ void ChainState::Configure(SegmentGenerator* segment_generator) {
   num_internal_bindings_ = 0;
   num_bindings_ = 0;
   
+  // The local generators can extend up to the end of the chain.
+  size_t num_channels = last_channel - local_channel_index(0);
+  if (num_channels != segment_pool_->num_parameters()) {
+    segment_pool_->Allocate(segment_generator, kNumChannels, num_channels);
+  }
+  
   segment::Configuration configuration[kMaxNumChannels];
   
   for (size_t i = 0; i < kNumChannels; ++i) {
@@ -33,6 +33,7 @@
 
 #include "stages/io_buffer.h"
 #include "stages/segment_generator.h"
+#include "stages/segment_pool.h"
 
 namespace stages {
 
@@ -50,7 +51,7 @@ class ChainState {
   
   typedef uint8_t ChannelBitmask;
   
-  void Init(SerialLink* left, SerialLink* right);
+  void Init(SerialLink* left, SerialLink* right, SegmentPool* segment_pool);
   void Update(
       const IOBuffer::Block& block,
       Settings* settings,
@@ -229,6 +230,7 @@ class ChainState {
   
   SerialLink* left_;
   SerialLink* right_;
+  SegmentPool* segment_pool_;
   
   ChannelState channel_state_[kMaxNumChannels];
   bool dirty_[kMaxNumChannels];
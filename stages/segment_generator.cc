@@ -85,12 +85,12 @@ void SegmentGenerator::Init(stmlib::HysteresisQuantizer2* step_quantizer) {
   s.if_rising = 0;
   s.if_falling = 0;
   s.if_complete = 0;
-  fill(&segments_[0], &segments_[kMaxNumSegments + 1], s);
+  fill(&segments_[0], &segments_[max_num_segments_ + 1], s);
   
   Parameters p;
   p.primary = 0.0f;
   p.secondary = 0.0f;
-  fill(&parameters_[0], &parameters_[kMaxNumSegments], p);
+  fill(&parameters_[0], &parameters_[max_num_segments_], p);
   
   ramp_extractor_.Init(
       kSampleRate,
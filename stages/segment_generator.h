@@ -42,10 +42,8 @@ namespace stages {
 
 const float kSampleRate = 31250.0f;
 
-// Each segment generator can handle up to 36 segments. That's a bit of a waste
-// of RAM because the 6 generators running on a module will never have to deal
-// with 36 segments each. But it was a bit too much to have a shared pool of
-// pre-allocated Segments shared by all SegmentGenerators!
+// A chain of segments can span up to 36 channels. The segments and parameters
+// of all the generators of a module are stored in a shared SegmentPool.
 const int kMaxNumSegments = 36;
 
 const size_t kMaxDelay = 576;
@@ -110,8 +108,20 @@ class SegmentGenerator {
     Init(NULL);
   }
   
+  // The storage must have been set before.
   void Init(stmlib::HysteresisQuantizer2* step_quantizer);
   
+  // Room for max_num_segments parameters, and for as many segments plus a
+  // sentinel.
+  inline void set_storage(
+      Segment* segments,
+      segment::Parameters* parameters,
+      int max_num_segments) {
+    segments_ = segments;
+    parameters_ = parameters;
+    max_num_segments_ = max_num_segments;
+  }
+  
   typedef void (SegmentGenerator::*ProcessFn)(
       const stmlib::GateFlags* gate_flags, Output* out, size_t size);
   
@@ -121,6 +131,7 @@ class SegmentGenerator {
     return active_segment_ == 0;
   }
   
+  // num_segments is at most max_num_segments().
   void Configure(
       bool has_trigger,
       const segment::Configuration* segment_configuration,
@@ -156,6 +167,10 @@ class SegmentGenerator {
   inline int num_segments() {
     return num_segments_;
   }
+  
+  inline int max_num_segments() const {
+    return max_num_segments_;
+  }
 
  private:
   // Process function for the general case.
@@ -209,8 +224,9 @@ class SegmentGenerator {
   tides::RampExtractor ramp_extractor_;
   stmlib::HysteresisQuantizer2 function_quantizer_;
   
-  Segment segments_[kMaxNumSegments + 1];  // There's a sentinel!
-  segment::Parameters parameters_[kMaxNumSegments];
+  Segment* segments_;  // There's a sentinel!
+  segment::Parameters* parameters_;
+  int max_num_segments_;
   
   DelayLine16Bits<kMaxDelay> delay_line_;
   stmlib::DelayLine<stmlib::GateFlags, 128> gate_delay_;
@@ -0,0 +1,98 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Storage for the segments and parameters of the generators of a module.
+//
+// Generator i handles the segments of channels i, i + 1, ... of the chain,
+// and the ranges of channels handled by two generators never overlap. So
+// generator i can use the parameters from slot i, and the segments from slot
+// 2 * i (there's one sentinel per generator). These positions do not depend
+// on the patch - only the number of channels from the first channel of the
+// module to the end of the chain does.
+//
+// The storage is not sized per topology: every module statically reserves
+// room for the longest chain - 36 parameters and 42 segments, instead of
+// 6 x 36 parameters and 6 x 37 segments before. A lone module uses 12 of
+// these segments, but the other 30 stay reserved. ChainState::Configure()
+// calls Allocate() when the chain changes, which only decides which part of
+// the storage the generators address; no memory is freed or reused.
+
+#ifndef STAGES_SEGMENT_POOL_H_
+#define STAGES_SEGMENT_POOL_H_
+
+#include "stmlib/stmlib.h"
+
+#include "stages/io_buffer.h"
+#include "stages/segment_generator.h"
+
+namespace stages {
+
+class SegmentPool {
+ public:
+  SegmentPool() { }
+  ~SegmentPool() { }
+  
+  void Init() {
+    num_segments_ = 0;
+    num_parameters_ = 0;
+  }
+  
+  // Gives their storage to num_generators generators, when num_channels
+  // channels (including the first channel of the module) remain until the end
+  // of the chain - at most kMaxNumSegments. The generators are not reset, and
+  // keep their segments: this can be called again when the chain changes.
+  void Allocate(
+      SegmentGenerator* segment_generator,
+      size_t num_generators,
+      size_t num_channels) {
+    num_parameters_ = num_channels;
+    num_segments_ = num_channels + num_generators;
+    for (size_t i = 0; i < num_generators; ++i) {
+      segment_generator[i].set_storage(
+          &segments_[2 * i],
+          &parameters_[i],
+          num_channels - i);
+    }
+  }
+  
+  // Segments (including the sentinels) and parameters addressed by the
+  // generators in the current topology - not the storage reserved.
+  inline size_t num_segments() const { return num_segments_; }
+  inline size_t num_parameters() const { return num_parameters_; }
+  
+ private:
+  SegmentGenerator::Segment segments_[kMaxNumSegments + kNumChannels];
+  segment::Parameters parameters_[kMaxNumSegments];
+  
+  size_t num_segments_;
+  size_t num_parameters_;
+  
+  DISALLOW_COPY_AND_ASSIGN(SegmentPool);
+};
+
+}  // namespace stages
+
+#endif  // STAGES_SEGMENT_POOL_H_
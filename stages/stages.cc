@@ -39,6 +39,7 @@
 #include "stages/oscillator.h"
 #include "stages/resources.h"
 #include "stages/segment_generator.h"
+#include "stages/segment_pool.h"
 #include "stages/settings.h"
 #include "stages/ui.h"
 
@@ -57,6 +58,7 @@ GateFlags no_gate[kBlockSize];
 GateInputs gate_inputs;
 HysteresisQuantizer2 note_quantizer[kNumChannels + kMaxNumSegments];
 SegmentGenerator segment_generator[kNumChannels];
+SegmentPool segment_pool;
 Oscillator oscillator[kNumChannels];
 IOBuffer io_buffer;
 SerialLink left_link;
@@ -239,6 +241,9 @@ void Init() {
   for (size_t i = 0; i < kNumChannels + kMaxNumSegments; ++i) {
     note_quantizer[i].Init(13, 0.03f, false);
   }
+  // Until the chain is discovered, the module is on its own.
+  segment_pool.Init();
+  segment_pool.Allocate(segment_generator, kNumChannels, kNumChannels);
   for (size_t i = 0; i < kNumChannels; ++i) {
     segment_generator[i].Init(&note_quantizer[i]);
     oscillator[i].Init();
@@ -253,7 +258,7 @@ void Init() {
     factory_test.Start(&settings, &cv_reader, &gate_inputs, &ui);
     ui.set_factory_test(true);
   } else {
-    chain_state.Init(&left_link, &right_link);
+    chain_state.Init(&left_link, &right_link, &segment_pool);
   }
   
   sys.StartTimers();
@@ -23,6 +23,7 @@
 #include "stmlib/utils/gate_flags.h"
 
 #include "stages/segment_generator.h"
+#include "stages/segment_pool.h"
 
 namespace stages {
 
@@ -90,6 +91,8 @@ class PulseGenerator {
 class SegmentGeneratorTest {
  public:
    SegmentGeneratorTest() {
+    segment_pool_.Init();
+    segment_pool_.Allocate(&segment_generator_, 1, kMaxNumSegments);
     segment_generator_.Init();
   }
   ~SegmentGeneratorTest() { }
@@ -144,6 +147,7 @@ class SegmentGeneratorTest {
   
  private:
   SegmentGenerator segment_generator_;
+  SegmentPool segment_pool_;
   PulseGenerator pulse_generator_;
   vector<SegmentParameters> segment_parameters_;
   
@@ -13,12 +13,15 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
 
+#include "stages/segment_pool.h"
 #include "stages/test/fixtures.h"
+#include "stmlib/utils/random.h"
 
 using namespace stages;
 using namespace stmlib;
@@ -193,6 +196,132 @@ void TestAudioOscillator() {
   t.Render("stages_audio_oscillator.wav", ::kSampleRate);
 }
 
+// Renders the local generators of a module, for a given patch: patched[i] is
+// true if the gate input of the i-th channel of the chain (starting from the
+// first channel of the module) is patched. The generators either share a
+// pool, or have one pool each.
+void RenderPatch(
+    const vector<bool>& patched,
+    const vector<GateFlags>& gate,
+    bool shared_pool,
+    vector<float>* out) {
+  const size_t num_channels = patched.size();
+  SegmentGenerator generator[kNumChannels];
+  SegmentPool pool[kNumChannels];
+  if (shared_pool) {
+    pool[0].Init();
+    pool[0].Allocate(generator, kNumChannels, num_channels);
+  } else {
+    for (size_t i = 0; i < kNumChannels; ++i) {
+      pool[i].Init();
+      pool[i].Allocate(&generator[i], 1, num_channels - i);
+    }
+  }
+  for (size_t i = 0; i < kNumChannels; ++i) {
+    generator[i].Init();
+  }
+  
+  // Same logic as in ChainState::Configure.
+  srand(0);
+  int last_patched_channel = -1;
+  for (size_t i = 0; i < kNumChannels; ++i) {
+    segment::Configuration c[kMaxNumSegments];
+    if (!patched[i]) {
+      if (last_patched_channel != -1) {
+        generator[i].ConfigureSlave(i - last_patched_channel);
+      } else {
+        c[0].type = segment::Type(rand() % 3);
+        c[0].loop = rand() % 2;
+        generator[i].ConfigureSingleSegment(false, c[0]);
+      }
+      continue;
+    }
+    last_patched_channel = i;
+    int num_segments = 0;
+    do {
+      c[num_segments].type = segment::Type(rand() % 3);
+      c[num_segments].loop = (rand() % 4) == 0;
+      ++num_segments;
+    } while (i + num_segments < num_channels && !patched[i + num_segments]);
+    generator[i].Configure(true, c, num_segments);
+  }
+  
+  out->clear();
+  Random::Seed(0);
+  for (size_t n = 0; n < gate.size(); n += kBlockSize) {
+    for (size_t i = 0; i < kNumChannels; ++i) {
+      for (int j = 0; j < generator[i].num_segments(); ++j) {
+        generator[i].set_segment_parameters(
+            j,
+            float((i * 7 + j * 3) % 10) / 10.0f,
+            float((i * 3 + j * 5) % 10) / 10.0f);
+      }
+      SegmentGenerator::Output o[kBlockSize];
+      generator[i].Process(&gate[n], o, kBlockSize);
+      for (size_t j = 0; j < kBlockSize; ++j) {
+        out->push_back(o[j].value);
+      }
+    }
+  }
+}
+
+void TestSegmentPool() {
+  // The pool is statically sized for the longest chain, which takes less
+  // room than 6 generators reserving 36 segments each, as before. Only the
+  // part reaching the end of the chain is in use.
+  const size_t worst_case = kNumChannels * (
+      (kMaxNumSegments + 1) * sizeof(SegmentGenerator::Segment) + 
+      kMaxNumSegments * sizeof(segment::Parameters));
+  assert(sizeof(SegmentPool) < worst_case);
+  SegmentGenerator generator[kNumChannels];
+  SegmentPool pool;
+  pool.Init();
+  for (size_t size = 1; size <= 6; ++size) {
+    for (size_t index = 0; index < size; ++index) {
+      size_t num_channels = (size - index) * kNumChannels;
+      pool.Allocate(generator, kNumChannels, num_channels);
+      assert(pool.num_parameters() == num_channels);
+      assert(pool.num_segments() == num_channels + kNumChannels);
+      for (size_t i = 0; i < kNumChannels; ++i) {
+        assert(generator[i].max_num_segments() == int(num_channels - i));
+      }
+    }
+  }
+  pool.Allocate(generator, kNumChannels, kNumChannels);
+  printf("Segment pool: %d bytes (%d before), segments in use: %d for a "
+         "single module, ",
+         int(sizeof(SegmentPool)),
+         int(worst_case),
+         int(pool.num_segments()));
+  pool.Allocate(generator, kNumChannels, kMaxNumSegments);
+  printf("%d for the first module of a chain of 6\n",
+         int(pool.num_segments()));
+  
+  // The generators sharing a pool never step on each other: their outputs
+  // are the same as with separate pools, for every patch of the local
+  // channels, and a chain extending further right.
+  PulseGenerator pulses;
+  pulses.CreateTestPattern();
+  vector<GateFlags> gate(kBlockSize * 2000);
+  pulses.Render(&gate[0], gate.size());
+  
+  for (size_t num_channels = kNumChannels;
+       num_channels <= size_t(kMaxNumSegments);
+       num_channels += 15) {
+    for (int mask = 0; mask < (1 << kNumChannels); ++mask) {
+      vector<bool> patched(num_channels, false);
+      for (size_t i = 0; i < kNumChannels; ++i) {
+        patched[i] = mask & (1 << i);
+      }
+      vector<float> shared;
+      vector<float> separate;
+      RenderPatch(patched, gate, true, &shared);
+      RenderPatch(patched, gate, false, &separate);
+      assert(shared == separate);
+    }
+  }
+}
+
 int main(void) {
   TestADSR();
   TestTwoStepSequence();
@@ -207,4 +336,5 @@ int main(void) {
   TestZero();
   TestClockedSampleAndHold();
   TestAudioOscillator();
+  TestSegmentPool();
 }
@@ -37,6 +37,7 @@
 #include "tides2/ramp_generator.h"
 #include "tides2/ramp_shaper.h"
 #include "tides2/resources.h"
+#include "tides2/simd.h"
 
 namespace tides {
 
@@ -72,6 +73,25 @@ class Filter {
     }
   }
   
+#ifdef TIDES_SIMD
+  // Process() for 4 channels, one in each lane.
+  inline void ProcessLanes(const float* f, float* in_out, size_t size) {
+    STATIC_ASSERT(num_channels == kNumLanes, lanes_and_channels_mismatch);
+    const LaneFloat coefficient = LoadLanes(f);
+    LaneFloat lp_1 = LoadLanes(lp_1_);
+    LaneFloat lp_2 = LoadLanes(lp_2_);
+    while (size--) {
+      lp_1 = AddLanes(lp_1, MulLanes(
+          coefficient, SubLanes(LoadLanes(in_out), lp_1)));
+      lp_2 = AddLanes(lp_2, MulLanes(coefficient, SubLanes(lp_1, lp_2)));
+      StoreLanes(in_out, lp_2);
+      in_out += num_channels;
+    }
+    StoreLanes(lp_1_, lp_1);
+    StoreLanes(lp_2_, lp_2);
+  }
+#endif  // TIDES_SIMD
+  
  private:
   float lp_1_[num_channels];
   float lp_2_[num_channels];
@@ -112,6 +132,10 @@ class PolySlopeGenerator {
     
     ratio_index_quantizer_.Init(21, 0.05f, false);
     
+#ifdef TIDES_SIMD
+    use_lanes_ = true;
+#endif  // TIDES_SIMD
+    
     // Force template instantiation for all combinations of settings.
     INSTANTIATE(RAMP_MODE_AD, OUTPUT_MODE_GATES, RANGE_CONTROL);
     INSTANTIATE(RAMP_MODE_AD, OUTPUT_MODE_GATES, RANGE_AUDIO);
@@ -141,6 +165,14 @@ class PolySlopeGenerator {
     INSTANTIATE_RAM(RAMP_MODE_LOOPING, OUTPUT_MODE_FREQUENCY, RANGE_AUDIO);
   }
   
+#ifdef TIDES_SIMD
+  // Switches between the 4-lane and scalar code. They render the same
+  // samples - this is only used for testing and benchmarking.
+  void set_use_lanes(bool use_lanes) {
+    use_lanes_ = use_lanes;
+  }
+#endif  // TIDES_SIMD
+  
   typedef void (PolySlopeGenerator::*RenderFn)(
       float frequency, float pw, float shape, float smoothness, float shift,
       const stmlib::GateFlags* gate_flags, const float* ramp,
@@ -207,6 +239,10 @@ class PolySlopeGenerator {
       }
       if (output_mode == OUTPUT_MODE_GATES) {
         filter_.Process<1>(f, &out[0].channel[0], size);
+#ifdef TIDES_SIMD
+      } else if (use_lanes_) {
+        filter_.ProcessLanes(f, &out[0].channel[0], size);
+#endif  // TIDES_SIMD
       } else {
         filter_.Process<num_channels>(f, &out[0].channel[0], size);
       }
@@ -311,6 +347,12 @@ class PolySlopeGenerator {
         const float slope = Fold<ramp_mode>(shaped, fold) * \
               (shift < 0.0f ? -1.0f : + 1.0f);
         const float channel_index = fabsf(shift * 5.1f);
+#ifdef TIDES_SIMD
+        if (use_lanes_) {
+          Amplitude<range>(slope, channel_index, out[i].channel);
+          continue;
+        }
+#endif  // TIDES_SIMD
         for (size_t j = 0; j < num_channels; ++j) {
           const float channel = static_cast<float>(j + 1);
           const float gain = std::max(
@@ -319,6 +361,28 @@ class PolySlopeGenerator {
           out[i].channel[j] = slope * gain * (equal_pow ? (2.0f - gain) : 1.0f);
         }
       } else if (output_mode == OUTPUT_MODE_SLOPE_PHASE) {
+#ifdef TIDES_SIMD
+        if (use_lanes_) {
+          const bool spread = ramp_mode == RAMP_MODE_AR;
+          const LaneFloat index = SetLanes(0.0f, 1.0f, 2.0f, 3.0f);
+          RenderLanes<ramp_mode, range>(
+              spread ? Phases() : SplatLanes(ramp_generator_.phase(0)),
+              MulLanes(index, SplatLanes(
+                  range == RANGE_AUDIO ? -step : -partial_step)),
+              spread
+                  ? Frequencies()
+                  : SplatLanes(ramp_generator_.frequency(0)),
+              ramp_mode == RAMP_MODE_AD
+                  ? AddLanes(SplatLanes(pw), MulLanes(
+                      SplatLanes(pw_increment), index))
+                  : SplatLanes(pw),
+              shape_table,
+              shape_fractional,
+              fold,
+              out[i].channel);
+          continue;
+        }
+#endif  // TIDES_SIMD
         float phase_shift = 0.0f;
         for (size_t j = 0; j < num_channels; ++j) {
           size_t source = ramp_mode == RAMP_MODE_AR ? j : 0;
@@ -335,6 +399,20 @@ class PolySlopeGenerator {
           phase_shift -= range == RANGE_AUDIO ? step : partial_step;
         }
       } else if (output_mode == OUTPUT_MODE_FREQUENCY) {
+#ifdef TIDES_SIMD
+        if (use_lanes_) {
+          RenderLanes<ramp_mode, range>(
+              Phases(),
+              SplatLanes(0.0f),
+              Frequencies(),
+              SplatLanes(pw),
+              shape_table,
+              shape_fractional,
+              fold,
+              out[i].channel);
+          continue;
+        }
+#endif  // TIDES_SIMD
         for (size_t j = 0; j < num_channels; ++j) {
           out[i].channel[j] = Fold<ramp_mode>(
               ramp_waveshaper_[j].Shape<ramp_mode>(
@@ -366,6 +444,108 @@ class PolySlopeGenerator {
         frequency, pw, shape, smoothness, shift, gate_flags, ramp, out, size);
   }
   
+#ifdef TIDES_SIMD
+  inline LaneFloat Phases() const {
+    return SetLanes(
+        ramp_generator_.phase(0),
+        ramp_generator_.phase(1),
+        ramp_generator_.phase(2),
+        ramp_generator_.phase(3));
+  }
+  
+  inline LaneFloat Frequencies() const {
+    return SetLanes(
+        ramp_generator_.frequency(0),
+        ramp_generator_.frequency(1),
+        ramp_generator_.frequency(2),
+        ramp_generator_.frequency(3));
+  }
+  
+  // Slope, shape and fold for the 4 channels, one in each lane. Only the
+  // band-limited slope (which has a branch on the discontinuity) is computed
+  // one channel at a time.
+  template<RampMode ramp_mode, Range range>
+  inline void RenderLanes(
+      LaneFloat phase,
+      LaneFloat phase_shift,
+      LaneFloat frequency,
+      LaneFloat pw,
+      const int16_t* shape_table,
+      float shape_fractional,
+      float fold,
+      float* out) {
+    LaneFloat slope;
+    if (ramp_mode == RAMP_MODE_LOOPING && range == RANGE_AUDIO) {
+      float p[num_channels], s[num_channels], f[num_channels], w[num_channels];
+      StoreLanes(p, phase);
+      StoreLanes(s, phase_shift);
+      StoreLanes(f, frequency);
+      StoreLanes(w, pw);
+      slope = SetLanes(
+          ramp_shaper_[0].Slope<ramp_mode, range>(p[0], s[0], f[0], w[0]),
+          ramp_shaper_[1].Slope<ramp_mode, range>(p[1], s[1], f[1], w[1]),
+          ramp_shaper_[2].Slope<ramp_mode, range>(p[2], s[2], f[2], w[2]),
+          ramp_shaper_[3].Slope<ramp_mode, range>(p[3], s[3], f[3], w[3]));
+    } else if (ramp_mode == RAMP_MODE_AR) {
+      slope = phase;
+    } else {
+      slope = RampShaper::SkewedRamp(
+          ramp_shaper_,
+          phase,
+          ramp_mode == RAMP_MODE_LOOPING,
+          phase_shift,
+          frequency,
+          pw);
+    }
+    StoreLanes(out, Fold<ramp_mode>(RampWaveshaper::Shape<ramp_mode>(
+        ramp_waveshaper_, slope, shape_table, shape_fractional), fold));
+  }
+  
+  template<RampMode ramp_mode>
+  inline LaneFloat Fold(LaneFloat unipolar, float fold_amount) {
+    const bool looping = ramp_mode == RAMP_MODE_LOOPING;
+    const LaneFloat x = looping
+        ? SubLanes(MulLanes(SplatLanes(2.0f), unipolar), SplatLanes(1.0f))
+        : unipolar;
+    const LaneFloat amount = SplatLanes(fold_amount);
+    LaneFloat folded = SplatLanes(0.0f);
+    if (fold_amount > 0.0f) {
+      const LaneFloat index = MulLanes(looping
+          ? AddLanes(SplatLanes(0.5f), MulLanes(
+              x, SplatLanes(0.03f + 0.46f * fold_amount)))
+          : MulLanes(x, amount), SplatLanes(1024.0f));
+      const LaneInt index_integral = TruncateLanes(index);
+      const LaneFloat index_fractional = SubLanes(
+          index, ConvertLanes(index_integral));
+      LaneFloat a, b;
+      GatherLanes(
+          looping ? lut_bipolar_fold : lut_unipolar_fold,
+          index_integral,
+          &a,
+          &b);
+      folded = AddLanes(a, MulLanes(SubLanes(b, a), index_fractional));
+    }
+    return MulLanes(
+        SplatLanes(looping ? 5.0f : 8.0f),
+        AddLanes(x, MulLanes(SubLanes(folded, x), amount)));
+  }
+  
+  template<Range range>
+  inline void Amplitude(float slope, float channel_index, float* out) {
+    const LaneFloat zero = SplatLanes(0.0f);
+    const LaneFloat one = SplatLanes(1.0f);
+    const LaneFloat channel = SetLanes(1.0f, 2.0f, 3.0f, 4.0f);
+    LaneFloat gain = SubLanes(one, AbsLanes(SubLanes(
+        channel, SplatLanes(channel_index))));
+    gain = SelectLanes(LessLanes(gain, zero), zero, gain);
+    LaneFloat s = MulLanes(SplatLanes(slope), gain);
+    if (range == RANGE_AUDIO) {
+      s = MulLanes(s, SubLanes(SplatLanes(2.0f), gain));
+    }
+    StoreLanes(out, s);
+  }
+#endif  // TIDES_SIMD
+  
   template<RampMode ramp_mode>
   inline float Fold(float unipolar, float fold_amount) {
     if (ramp_mode == RAMP_MODE_LOOPING) {
@@ -415,6 +595,10 @@ class PolySlopeGenerator {
   RampWaveshaper ramp_waveshaper_[num_channels];
   Filter<num_channels> filter_;
   
+#ifdef TIDES_SIMD
+  bool use_lanes_;
+#endif  // TIDES_SIMD
+  
   static Ratio audio_ratio_table_[21][num_channels];
   static Ratio control_ratio_table_[21][num_channels];
   static RenderFn render_fn_table_[RAMP_MODE_LAST][OUTPUT_MODE_LAST][
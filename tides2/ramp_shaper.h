@@ -35,6 +35,7 @@
 #include "stmlib/dsp/polyblep.h"
 
 #include "tides2/ramp_generator.h"
+#include "tides2/simd.h"
 
 namespace tides {
 
@@ -98,6 +99,55 @@ class RampShaper {
     }
   }
   
+#ifdef TIDES_SIMD
+  // SkewedRamp() computed for 4 channels at once.
+  static inline LaneFloat SkewedRamp(
+      RampShaper* shaper,
+      LaneFloat phase,
+      bool shifted,
+      LaneFloat phase_shift,
+      LaneFloat frequency,
+      LaneFloat pw) {
+    const LaneFloat zero = SplatLanes(0.0f);
+    const LaneFloat half = SplatLanes(0.5f);
+    const LaneFloat one = SplatLanes(1.0f);
+    if (shifted) {
+      const LaneFloat previous_phase_shift = SetLanes(
+          shaper[0].previous_phase_shift_,
+          shaper[1].previous_phase_shift_,
+          shaper[2].previous_phase_shift_,
+          shaper[3].previous_phase_shift_);
+      const LaneInt mask = NotEqualLanes(phase_shift, zero);
+      phase = SelectLanes(mask, AddLanes(phase, phase_shift), phase);
+      frequency = SelectLanes(
+          mask,
+          AddLanes(frequency, SubLanes(phase_shift, previous_phase_shift)),
+          frequency);
+      phase = SelectLanes(
+          GreaterEqualLanes(phase, one), SubLanes(phase, one), phase);
+      phase = SelectLanes(LessLanes(phase, zero), AddLanes(phase, one), phase);
+      
+      float p[kNumLanes];
+      StoreLanes(p, SelectLanes(mask, phase_shift, previous_phase_shift));
+      for (size_t i = 0; i < kNumLanes; ++i) {
+        shaper[i].previous_phase_shift_ = p[i];
+      }
+    }
+    
+    const LaneFloat pw_min = MulLanes(AbsLanes(frequency), SplatLanes(2.0f));
+    const LaneFloat pw_max = SubLanes(one, pw_min);
+    LaneFloat w = SelectLanes(GreaterLanes(pw, pw_max), pw_max, pw);
+    w = SelectLanes(LessLanes(pw, pw_min), pw_min, w);
+    
+    const LaneFloat slope_up = DivLanes(half, w);
+    const LaneFloat slope_down = DivLanes(half, SubLanes(one, w));
+    return SelectLanes(
+        LessLanes(phase, w),
+        MulLanes(phase, slope_up),
+        AddLanes(MulLanes(SubLanes(phase, w), slope_down), half));
+  }
+#endif  // TIDES_SIMD
+  
   template<RampMode ramp_mode, Range range>
   inline float EOA(float phase, float frequency, float pw) {
     if (ramp_mode == RAMP_MODE_LOOPING && range == RANGE_AUDIO) {
@@ -228,30 +278,75 @@ class RampWaveshaper {
     float y = y0 + (y1 - y0) * ws_index_fractional;
     float output = x + (y - x) * shape_fractional;
     
+    return ramp_mode == RAMP_MODE_AR ? Breakpoint(input, output) : output;
+  }
+  
+#ifdef TIDES_SIMD
+  // Shape() computed for 4 channels at once.
+  template<RampMode ramp_mode>
+  static inline LaneFloat Shape(
+      RampWaveshaper* waveshaper,
+      LaneFloat input,
+      const int16_t* shape,
+      float shape_fractional) {
+    const LaneFloat ws_index = MulLanes(SplatLanes(1024.0f), input);
+    LaneInt ws_index_integral = TruncateLanes(ws_index);
+    const LaneFloat ws_index_fractional = SubLanes(
+        ws_index, ConvertLanes(ws_index_integral));
+    ws_index_integral = AndLanes(ws_index_integral, SplatLanes(1023));
+    
+    LaneFloat x0, x1, y0, y1;
+    GatherLanes(shape, ws_index_integral, &x0, &x1);
+    GatherLanes(shape + 1025, ws_index_integral, &y0, &y1);
+    
+    const LaneFloat scale = SplatLanes(1.0f / 32768.0f);
+    x0 = MulLanes(x0, scale);
+    x1 = MulLanes(x1, scale);
+    y0 = MulLanes(y0, scale);
+    y1 = MulLanes(y1, scale);
+    const LaneFloat x = AddLanes(
+        x0, MulLanes(SubLanes(x1, x0), ws_index_fractional));
+    const LaneFloat y = AddLanes(
+        y0, MulLanes(SubLanes(y1, y0), ws_index_fractional));
+    const LaneFloat output = AddLanes(
+        x, MulLanes(SubLanes(y, x), SplatLanes(shape_fractional)));
+    
     if (ramp_mode != RAMP_MODE_AR) {
       return output;
     } else {
-      if (previous_input_ <= 0.5f && input > 0.5f) {
-        breakpoint_ = previous_output_;
-      } else if (previous_input_ > 0.5f && input < 0.5f) {
-        breakpoint_ = previous_output_;
-      } else if (input == 1.0f) {
-        breakpoint_ = 1.0f;
-      } else if (input == 0.5f) {
-        breakpoint_ = 0.0f;
+      float u[kNumLanes];
+      float o[kNumLanes];
+      StoreLanes(u, input);
+      StoreLanes(o, output);
+      for (size_t i = 0; i < kNumLanes; ++i) {
+        o[i] = waveshaper[i].Breakpoint(u[i], o[i]);
       }
-      if (input <= 0.5f) {
-        output = breakpoint_ + (1.0f - breakpoint_) * output;
-      } else {
-        output = breakpoint_ * output;
-      }
-      previous_input_ = input;
-      previous_output_ = output;
-      return output;
+      return LoadLanes(o);
     }
   }
+#endif  // TIDES_SIMD
   
  private:
+  inline float Breakpoint(float input, float output) {
+    if (previous_input_ <= 0.5f && input > 0.5f) {
+      breakpoint_ = previous_output_;
+    } else if (previous_input_ > 0.5f && input < 0.5f) {
+      breakpoint_ = previous_output_;
+    } else if (input == 1.0f) {
+      breakpoint_ = 1.0f;
+    } else if (input == 0.5f) {
+      breakpoint_ = 0.0f;
+    }
+    if (input <= 0.5f) {
+      output = breakpoint_ + (1.0f - breakpoint_) * output;
+    } else {
+      output = breakpoint_ * output;
+    }
+    previous_input_ = input;
+    previous_output_ = output;
+    return output;
+  }
+  
   float previous_input_;
   float previous_output_;
   float breakpoint_;
@@ -0,0 +1,263 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// 4-lane float and int operations, mapped to SSE2 or NEON. The 4 channels of
+// the poly slope generator are processed in the 4 lanes.
+//
+// There are no gather instructions in SSE2 or NEON: table lookups load the
+// 4 values one by one and insert them into the lanes.
+//
+// TIDES_SIMD is defined when vector registers are available. Otherwise (the
+// Cortex-M4 on the module), this file is empty and the scalar code is used.
+
+#ifndef TIDES_SIMD_H_
+#define TIDES_SIMD_H_
+
+#include "stmlib/stmlib.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TIDES_SIMD
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TIDES_SIMD
+#endif
+
+#ifdef TIDES_SIMD
+
+namespace tides {
+
+const size_t kNumLanes = 4;
+
+#if defined(__SSE2__)
+
+typedef __m128 LaneFloat;
+typedef __m128i LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return _mm_loadu_ps(p);
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  _mm_storeu_ps(p, x);
+}
+
+inline void StoreLanes(int32_t* p, LaneInt x) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+}
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  return _mm_setr_ps(a, b, c, d);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return _mm_set1_ps(x);
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  return _mm_set1_epi32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return _mm_add_ps(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return _mm_sub_ps(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return _mm_mul_ps(a, b);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+  return _mm_div_ps(a, b);
+}
+
+inline LaneFloat AbsLanes(LaneFloat x) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+inline LaneInt AndLanes(LaneInt a, LaneInt b) {
+  return _mm_and_si128(a, b);
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return _mm_cvttps_epi32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return _mm_cvtepi32_ps(x);
+}
+
+// All bits are set in the lanes in which a < b.
+inline LaneInt LessLanes(LaneFloat a, LaneFloat b) {
+  return _mm_castps_si128(_mm_cmplt_ps(a, b));
+}
+
+// All bits are set in the lanes in which a > b.
+inline LaneInt GreaterLanes(LaneFloat a, LaneFloat b) {
+  return _mm_castps_si128(_mm_cmpgt_ps(a, b));
+}
+
+// All bits are set in the lanes in which a >= b.
+inline LaneInt GreaterEqualLanes(LaneFloat a, LaneFloat b) {
+  return _mm_castps_si128(_mm_cmpge_ps(a, b));
+}
+
+// All bits are set in the lanes in which a != b.
+inline LaneInt NotEqualLanes(LaneFloat a, LaneFloat b) {
+  return _mm_castps_si128(_mm_cmpneq_ps(a, b));
+}
+
+inline LaneFloat SelectLanes(LaneInt mask, LaneFloat a, LaneFloat b) {
+  __m128 m = _mm_castsi128_ps(mask);
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+#else
+
+typedef float32x4_t LaneFloat;
+typedef int32x4_t LaneInt;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return vld1q_f32(p);
+}
+
+inline LaneInt LoadLanes(const int32_t* p) {
+  return vld1q_s32(p);
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  vst1q_f32(p, x);
+}
+
+inline void StoreLanes(int32_t* p, LaneInt x) {
+  vst1q_s32(p, x);
+}
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  const float x[4] = { a, b, c, d };
+  return vld1q_f32(x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return vdupq_n_f32(x);
+}
+
+inline LaneInt SplatLanes(int32_t x) {
+  return vdupq_n_s32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return vaddq_f32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return vsubq_f32(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return vmulq_f32(a, b);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  // No division on ARMv7 NEON: refine the reciprocal estimate twice. The
+  // result can differ from the scalar code in the last bit.
+  float32x4_t r = vrecpeq_f32(b);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+#endif  // __aarch64__
+}
+
+inline LaneFloat AbsLanes(LaneFloat x) {
+  return vabsq_f32(x);
+}
+
+inline LaneInt AndLanes(LaneInt a, LaneInt b) {
+  return vandq_s32(a, b);
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return vcvtq_s32_f32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return vcvtq_f32_s32(x);
+}
+
+inline LaneInt LessLanes(LaneFloat a, LaneFloat b) {
+  return vreinterpretq_s32_u32(vcltq_f32(a, b));
+}
+
+inline LaneInt GreaterLanes(LaneFloat a, LaneFloat b) {
+  return vreinterpretq_s32_u32(vcgtq_f32(a, b));
+}
+
+inline LaneInt GreaterEqualLanes(LaneFloat a, LaneFloat b) {
+  return vreinterpretq_s32_u32(vcgeq_f32(a, b));
+}
+
+inline LaneInt NotEqualLanes(LaneFloat a, LaneFloat b) {
+  return vreinterpretq_s32_u32(vmvnq_u32(vceqq_f32(a, b)));
+}
+
+inline LaneFloat SelectLanes(LaneInt mask, LaneFloat a, LaneFloat b) {
+  return vbslq_f32(vreinterpretq_u32_s32(mask), a, b);
+}
+
+#endif
+
+// Looks up table[index[i]] and table[index[i] + 1] for each lane.
+template<typename T>
+inline void GatherLanes(
+    const T* table,
+    LaneInt index,
+    LaneFloat* a,
+    LaneFloat* b) {
+  int32_t i[kNumLanes];
+  StoreLanes(i, index);
+  const T* t0 = &table[i[0]];
+  const T* t1 = &table[i[1]];
+  const T* t2 = &table[i[2]];
+  const T* t3 = &table[i[3]];
+  *a = SetLanes(t0[0], t1[0], t2[0], t3[0]);
+  *b = SetLanes(t0[1], t1[1], t2[1], t3[1]);
+}
+
+}  // namespace tides
+
+#endif  // TIDES_SIMD
+
+#endif  // TIDES_SIMD_H_
@@ -13,11 +13,13 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <cassert>
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <xmmintrin.h>
 
 #include "tides2/poly_slope_generator.h"
@@ -334,8 +336,106 @@ void TestPLL() {
   }
 }
 
+void TestLanes() {
+#ifdef TIDES_SIMD
+  const char* range_name[] = { "control", "audio" };
+  float time[2] = { 0.0f, 0.0f };
+  const size_t kNumBenchmarkBlocks = 20000;
+  
+  for (int ramp_source = 0; ramp_source < 2; ++ramp_source) {
+    for (int ramp_mode = 0; ramp_mode < RAMP_MODE_LAST; ++ramp_mode) {
+      for (int output_mode = 0; output_mode < OUTPUT_MODE_LAST; ++output_mode) {
+        for (int range = 0; range < RANGE_LAST; ++range) {
+          PolySlopeGenerator poly_slope[2];
+          PolySlopeGenerator::OutputSample out[2][kBlockSize];
+          size_t mismatches = 0;
+          for (int lanes = 0; lanes < 2; ++lanes) {
+            poly_slope[lanes].Init();
+            poly_slope[lanes].set_use_lanes(lanes == 1);
+          }
+          
+          PulseGenerator pulses;
+          pulses.AddPulses(kSampleRate / 10, 2000, 20);
+          float phase = 0.0f;
+          size_t num_samples = kSampleRate * 2;
+          for (size_t i = 0; i < num_samples; i += kBlockSize) {
+            GateFlags gate_flags[kBlockSize];
+            float ramp[kBlockSize];
+            pulses.Render(gate_flags, kBlockSize);
+            
+            // Sweep all parameters, going through both the filter (smoothness
+            // below 0.5) and the wavefolder (smoothness above 0.5).
+            const float t = float(i) / float(num_samples);
+            const float f0 = (range == RANGE_AUDIO ? 220.0f : 3.0f) / \
+                kSampleRate;
+            const float pw = 0.5f + 0.5f * sinf(t * 13.0f);
+            const float shape = 0.5f + 0.5f * sinf(t * 7.0f);
+            const float smoothness = 0.5f + 0.5f * sinf(t * 5.0f);
+            const float shift = 0.5f + 0.5f * sinf(t * 3.0f);
+            for (size_t j = 0; j < kBlockSize; ++j) {
+              ramp[j] = phase;
+              phase += f0;
+              if (phase >= 1.0f) {
+                phase -= 1.0f;
+              }
+            }
+            if (ramp_source == 1) {
+              fill(&gate_flags[0], &gate_flags[kBlockSize], GATE_FLAG_LOW);
+            }
+            
+            for (int lanes = 0; lanes < 2; ++lanes) {
+              poly_slope[lanes].Render(
+                  RampMode(ramp_mode),
+                  OutputMode(output_mode),
+                  Range(range),
+                  f0, pw, shape, smoothness, shift,
+                  gate_flags,
+                  ramp_source == 1 ? ramp : NULL,
+                  out[lanes],
+                  kBlockSize);
+            }
+            mismatches += memcmp(out[0], out[1], sizeof(out[0])) ? 1 : 0;
+          }
+          if (mismatches) {
+            printf(
+                "Lanes: %s %s %s %s: %d blocks differ\n",
+                ramp_source_name[ramp_source],
+                ramp_mode_name[ramp_mode],
+                output_mode_name[output_mode],
+                range_name[range],
+                int(mismatches));
+          }
+          assert(mismatches == 0);
+          
+          // Benchmark with static settings.
+          for (int lanes = 0; lanes < 2; ++lanes) {
+            GateFlags no_gate[kBlockSize];
+            fill(&no_gate[0], &no_gate[kBlockSize], GATE_FLAG_LOW);
+            clock_t start = clock();
+            for (size_t i = 0; i < kNumBenchmarkBlocks; ++i) {
+              poly_slope[lanes].Render(
+                  RampMode(ramp_mode),
+                  OutputMode(output_mode),
+                  Range(range),
+                  0.001f, 0.3f, 0.7f, 0.8f, 0.9f,
+                  no_gate,
+                  NULL,
+                  out[lanes],
+                  kBlockSize);
+            }
+            time[lanes] += float(clock() - start) / CLOCKS_PER_SEC;
+          }
+        }
+      }
+    }
+  }
+  printf("Lanes: scalar %.3fs, 4 lanes %.3fs\n", time[0], time[1]);
+#endif  // TIDES_SIMD
+}
+
 int main(void) {
   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+  TestLanes();
   TestRampGenerator();
   TestPolySlopeGenerator();
   TestModeChangeCrash();
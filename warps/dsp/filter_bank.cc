@@ -96,14 +96,121 @@ void FilterBank::Init(float sample_rate) {
     b.delay_line.Init(delay_ptr, compensation / b.decimation_factor);
     delay_ptr += b.delay_line.size();
   }
+  
+#ifdef WARPS_SIMD
+  InitBandPassGroups();
+#endif  // WARPS_SIMD
 }
 
+#ifdef WARPS_SIMD
+
+void FilterBank::InitBandPassGroups() {
+  num_band_pass_groups_ = 0;
+  BandPassGroup* g = NULL;
+  for (int32_t i = 1; i < kNumBands - 1; ++i) {
+    if (!g || g->num_bands == int32_t(kNumLanes) ||
+        band_[g->first_band].group != band_[i].group) {
+      g = &band_pass_group_[num_band_pass_groups_++];
+      g->first_band = i;
+      g->num_bands = 0;
+      
+      // Unused lanes have a cutoff of 0 and never leave their initial state.
+      for (int32_t pass = 0; pass < 2; ++pass) {
+        fill(&g->f[pass][0], &g->f[pass][kNumLanes], 0.0f);
+        fill(&g->fq[pass][0], &g->fq[pass][kNumLanes], 0.0f);
+        fill(&g->lp[pass][0], &g->lp[pass][kNumLanes], 0.0f);
+        fill(&g->bp[pass][0], &g->bp[pass][kNumLanes], 0.0f);
+        fill(&g->x[pass][0], &g->x[pass][kNumLanes], 0.0f);
+      }
+      fill(&g->post_gain[0], &g->post_gain[kNumLanes], 0.0f);
+    }
+    
+    const float* coefficients = filter_bank_table[i];
+    int32_t lane = g->num_bands++;
+    for (int32_t pass = 0; pass < 2; ++pass) {
+      g->f[pass][lane] = coefficients[pass * 2 + 3];
+      g->fq[pass][lane] = coefficients[pass * 2 + 4];
+    }
+    g->post_gain[lane] = coefficients[2];
+  }
+}
+
+void FilterBank::AnalyzeBandPassGroup(
+    BandPassGroup* g,
+    const float* in,
+    size_t size) {
+  float* out[kNumLanes];
+  for (int32_t i = 0; i < int32_t(kNumLanes); ++i) {
+    out[i] = i < g->num_bands ? band_[g->first_band + i].samples : unused_lane_;
+  }
+  
+  const LaneFloat zero = SplatLanes(0.0f);
+  const LaneFloat f_0 = LoadLanes(g->f[0]);
+  const LaneFloat fq_0 = LoadLanes(g->fq[0]);
+  const LaneFloat minus_f_0 = SubLanes(zero, f_0);
+  const LaneFloat minus_fq_0 = SubLanes(zero, fq_0);
+  const LaneFloat f_1 = LoadLanes(g->f[1]);
+  const LaneFloat fq_1 = LoadLanes(g->fq[1]);
+  const LaneFloat minus_f_1 = SubLanes(zero, f_1);
+  const LaneFloat minus_fq_1 = SubLanes(zero, fq_1);
+  const LaneFloat post_gain = LoadLanes(g->post_gain);
+  
+  LaneFloat lp_0 = LoadLanes(g->lp[0]);
+  LaneFloat bp_0 = LoadLanes(g->bp[0]);
+  LaneFloat x_0 = LoadLanes(g->x[0]);
+  LaneFloat lp_1 = LoadLanes(g->lp[1]);
+  LaneFloat bp_1 = LoadLanes(g->bp[1]);
+  LaneFloat x_1 = LoadLanes(g->x[1]);
+  
+  for (size_t i = 0; i < size; ++i) {
+    // Both passes are run sample by sample, in band-pass normalized mode.
+    LaneFloat s = SplatLanes(in[i]);
+    lp_0 = AddLanes(lp_0, MulLanes(f_0, bp_0));
+    bp_0 = AddLanes(bp_0, AddLanes(
+        SubLanes(MulLanes(minus_fq_0, bp_0), MulLanes(f_0, lp_0)),
+        MulLanes(f_0, s)));
+    bp_0 = AddLanes(bp_0, x_0);
+    x_0 = MulLanes(minus_f_0, s);
+    s = MulLanes(bp_0, fq_0);
+    
+    lp_1 = AddLanes(lp_1, MulLanes(f_1, bp_1));
+    bp_1 = AddLanes(bp_1, AddLanes(
+        SubLanes(MulLanes(minus_fq_1, bp_1), MulLanes(f_1, lp_1)),
+        MulLanes(f_1, s)));
+    bp_1 = AddLanes(bp_1, x_1);
+    x_1 = MulLanes(minus_f_1, s);
+    s = MulLanes(MulLanes(bp_1, fq_1), post_gain);
+    
+    float y[kNumLanes];
+    StoreLanes(y, s);
+    out[0][i] = y[0];
+    out[1][i] = y[1];
+    out[2][i] = y[2];
+    out[3][i] = y[3];
+  }
+  
+  StoreLanes(g->lp[0], lp_0);
+  StoreLanes(g->bp[0], bp_0);
+  StoreLanes(g->x[0], x_0);
+  StoreLanes(g->lp[1], lp_1);
+  StoreLanes(g->bp[1], bp_1);
+  StoreLanes(g->x[1], x_1);
+}
+
+#endif  // WARPS_SIMD
+
 void FilterBank::Analyze(const float* in, size_t size) {
   mid_src_down_.Process(in, tmp_[0], size);
   low_src_down_.Process(tmp_[0], tmp_[1], size / kMidFactor);
   
   const float* sources[3] = { tmp_[1], tmp_[0], in };
   for (int32_t i = 0; i < kNumBands; ++i) {
+#ifdef WARPS_SIMD
+    // The band-pass bands are processed below, 4 at a time.
+    if (i != 0 && i != kNumBands - 1) {
+      continue;
+    }
+#endif  // WARPS_SIMD
     Band& b = band_[i];
     const size_t band_size = size / b.decimation_factor;
     const float* input = sources[b.group];
@@ -129,6 +236,14 @@ void FilterBank::Analyze(const float* in, size_t size) {
       output[i] *= gain;
     }
   }
+  
+#ifdef WARPS_SIMD
+  for (int32_t i = 0; i < num_band_pass_groups_; ++i) {
+    BandPassGroup* g = &band_pass_group_[i];
+    const Band& b = band_[g->first_band];
+    AnalyzeBandPassGroup(g, sources[b.group], size / b.decimation_factor);
+  }
+#endif  // WARPS_SIMD
 }
 
 void FilterBank::Synthesize(float* out, size_t size) {
@@ -35,6 +35,7 @@
 #include "stmlib/dsp/filter.h"
 
 #include "warps/dsp/sample_rate_converter.h"
+#include "warps/dsp/simd.h"
 #include "warps/resources.h"
 
 namespace warps {
@@ -45,6 +46,7 @@ const int32_t kMidFactor = 3;
 const int32_t kDelayLineSize = 6144;
 const int32_t kMaxFilterBankBlockSize = 96;
 const int32_t kSampleMemorySize = kMaxFilterBankBlockSize * kNumBands / 2;
+const int32_t kMaxNumBandPassGroups = kNumBands / kNumLanes + 3;
 
 class PooledDelayLine {
  public:
@@ -62,7 +64,9 @@ class PooledDelayLine {
   
   float ReadWrite(float value) {
     delay_line_[head_] = value;
-    head_ = (head_ + 1) % size_;
+    if (++head_ == size_) {
+      head_ = 0;
+    }
     return delay_line_[head_];
   };
   
@@ -85,6 +89,20 @@ struct Band {
   int32_t delay;
 };
 
+// Up to 4 band-pass bands with the same sample rate, filtered in parallel.
+// Same filters as stmlib::CrossoverSvf, with the state of each pass stored
+// lane by lane.
+struct BandPassGroup {
+  int32_t first_band;
+  int32_t num_bands;
+  float f[2][kNumLanes];
+  float fq[2][kNumLanes];
+  float lp[2][kNumLanes];
+  float bp[2][kNumLanes];
+  float x[2][kNumLanes];
+  float post_gain[kNumLanes];
+};
+
 class FilterBank {
  public:
   FilterBank() { }
@@ -97,6 +115,14 @@ class FilterBank {
   }
   
  private:
+#ifdef WARPS_SIMD
+  void InitBandPassGroups();
+  void AnalyzeBandPassGroup(
+      BandPassGroup* group,
+      const float* in,
+      size_t size);
+#endif  // WARPS_SIMD
+  
   SampleRateConverter<SRC_DOWN, kMidFactor, 36> mid_src_down_;
   SampleRateConverter<SRC_UP, kMidFactor, 36> mid_src_up_;
   SampleRateConverter<SRC_DOWN, kLowFactor, 48> low_src_down_;
@@ -108,6 +134,12 @@ class FilterBank {
   
   Band band_[kNumBands + 1];
   
+#ifdef WARPS_SIMD
+  BandPassGroup band_pass_group_[kMaxNumBandPassGroups];
+  int32_t num_band_pass_groups_;
+  float unused_lane_[kMaxFilterBankBlockSize];
+#endif  // WARPS_SIMD
+  
   DISALLOW_COPY_AND_ASSIGN(FilterBank);
 };
 
@@ -43,6 +43,9 @@ using namespace stmlib;
 void Modulator::Init(float sample_rate) {
   bypass_ = false;
   easter_egg_ = false;
+#ifdef WARPS_SIMD
+  use_lanes_ = true;
+#endif  // WARPS_SIMD
   
   for (int32_t i = 0; i < 2; ++i) {
     amplifier_[i].Init();
@@ -286,8 +289,16 @@ void Modulator::Process(ShortFrame* input, ShortFrame* output, size_t size) {
   }
   
   if (vocoder_amount < 0.5f) {
-    src_up_[0].Process(carrier, oversampled_carrier, size);
-    src_up_[1].Process(modulator, oversampled_modulator, size);
+#ifdef WARPS_SIMD
+    if (!use_lanes_) {
+      src_up_[0].ProcessScalar(carrier, oversampled_carrier, size);
+      src_up_[1].ProcessScalar(modulator, oversampled_modulator, size);
+    } else
+#endif  // WARPS_SIMD
+    {
+      src_up_[0].Process(carrier, oversampled_carrier, size);
+      src_up_[1].Process(modulator, oversampled_modulator, size);
+    }
     
     float algorithm = min(parameters_.modulation_algorithm * 8.0f, 5.999f);
     float previous_algorithm = min(
@@ -300,7 +311,13 @@ void Modulator::Process(ShortFrame* input, ShortFrame* output, size_t size) {
       previous_algorithm_fractional = algorithm_fractional;
     }
 
-    (this->*xmod_table_[algorithm_integral])(
+    XmodFn xmod_fn = xmod_table_[algorithm_integral];
+#ifdef WARPS_SIMD
+    if (use_lanes_ && (size * kOversampling) % kNumLanes == 0) {
+      xmod_fn = xmod_lanes_table_[algorithm_integral];
+    }
+#endif  // WARPS_SIMD
+    (this->*xmod_fn)(
         previous_algorithm_fractional,
         algorithm_fractional,
         previous_parameters_.skewed_modulation_parameter(),
@@ -310,7 +327,15 @@ void Modulator::Process(ShortFrame* input, ShortFrame* output, size_t size) {
         oversampled_output,
         size * kOversampling);
 
-    src_down_.Process(oversampled_output, main_output, size * kOversampling);
+#ifdef WARPS_SIMD
+    if (!use_lanes_) {
+      src_down_.ProcessScalar(
+          oversampled_output, main_output, size * kOversampling);
+    } else
+#endif  // WARPS_SIMD
+    {
+      src_down_.Process(oversampled_output, main_output, size * kOversampling);
+    }
   } else {
     float release_time = 4.0f * (parameters_.modulation_algorithm - 0.75f);
     CONSTRAIN(release_time, 0.0f, 1.0f);
@@ -445,4 +470,167 @@ Modulator::XmodFn Modulator::xmod_table_[] = {
   &Modulator::ProcessXmod<ALGORITHM_COMPARATOR, ALGORITHM_NOP>,
 };
 
+#ifdef WARPS_SIMD
+
+// Same as stmlib's Interpolate, one table lookup per lane.
+static inline LaneFloat InterpolateLanes(
+    const float* table,
+    LaneFloat index,
+    float size) {
+  index = MulLanes(index, SplatLanes(size));
+  const LaneFloat integral = ConvertLanes(TruncateLanes(index));
+  const LaneFloat fractional = SubLanes(index, integral);
+  
+  float i[kNumLanes];
+  StoreLanes(i, integral);
+  const float* t_0 = table + static_cast<int32_t>(i[0]);
+  const float* t_1 = table + static_cast<int32_t>(i[1]);
+  const float* t_2 = table + static_cast<int32_t>(i[2]);
+  const float* t_3 = table + static_cast<int32_t>(i[3]);
+  const LaneFloat a = SetLanes(t_0[0], t_1[0], t_2[0], t_3[0]);
+  const LaneFloat b = SetLanes(t_0[1], t_1[1], t_2[1], t_3[1]);
+  return AddLanes(a, MulLanes(SubLanes(b, a), fractional));
+}
+
+/* static */
+inline LaneFloat Modulator::DiodeLanes(LaneFloat x) {
+  const LaneFloat sign = SelectLanes(
+      GreaterLanes(x, SplatLanes(0.0f)),
+      SplatLanes(1.0f),
+      SplatLanes(-1.0f));
+  LaneFloat dead_zone = SubLanes(AbsLanes(x), SplatLanes(0.667f));
+  dead_zone = AddLanes(dead_zone, AbsLanes(dead_zone));
+  dead_zone = MulLanes(dead_zone, dead_zone);
+  return MulLanes(
+      MulLanes(SplatLanes(0.04324765822726063f), dead_zone),
+      sign);
+}
+
+/* static */
+template<>
+inline LaneFloat Modulator::XmodLanes<ALGORITHM_XFADE>(
+    LaneFloat x_1, LaneFloat x_2, LaneFloat parameter) {
+  LaneFloat fade_in = InterpolateLanes(lut_xfade_in, parameter, 256.0f);
+  LaneFloat fade_out = InterpolateLanes(lut_xfade_out, parameter, 256.0f);
+  return AddLanes(MulLanes(x_1, fade_in), MulLanes(x_2, fade_out));
+}
+
+/* static */
+template<>
+inline LaneFloat Modulator::XmodLanes<ALGORITHM_FOLD>(
+    LaneFloat x_1, LaneFloat x_2, LaneFloat parameter) {
+  LaneFloat sum = AddLanes(x_1, x_2);
+  sum = AddLanes(sum, MulLanes(MulLanes(x_1, x_2), SplatLanes(0.25f)));
+  sum = MulLanes(sum, AddLanes(SplatLanes(0.02f), parameter));
+  const float kScale = 2048.0f / ((1.0f + 1.0f + 0.25f) * 1.02f);
+  return InterpolateLanes(lut_bipolar_fold + 2048, sum, kScale);
+}
+
+/* static */
+template<>
+inline LaneFloat Modulator::XmodLanes<ALGORITHM_ANALOG_RING_MODULATION>(
+    LaneFloat modulator, LaneFloat carrier, LaneFloat parameter) {
+  carrier = AddLanes(carrier, carrier);
+  LaneFloat ring = AddLanes(
+      DiodeLanes(AddLanes(modulator, carrier)),
+      DiodeLanes(SubLanes(modulator, carrier)));
+  ring = MulLanes(
+      ring,
+      AddLanes(SplatLanes(4.0f), MulLanes(parameter, SplatLanes(24.0f))));
+  
+  // SoftLimit.
+  const LaneFloat ring_squared = MulLanes(ring, ring);
+  return DivLanes(
+      MulLanes(ring, AddLanes(SplatLanes(27.0f), ring_squared)),
+      AddLanes(
+          SplatLanes(27.0f),
+          MulLanes(MulLanes(SplatLanes(9.0f), ring), ring)));
+}
+
+/* static */
+template<>
+inline LaneFloat Modulator::XmodLanes<ALGORITHM_DIGITAL_RING_MODULATION>(
+    LaneFloat x_1, LaneFloat x_2, LaneFloat parameter) {
+  LaneFloat ring = MulLanes(MulLanes(SplatLanes(4.0f), x_1), x_2);
+  ring = MulLanes(
+      ring,
+      AddLanes(SplatLanes(1.0f), MulLanes(parameter, SplatLanes(8.0f))));
+  return DivLanes(ring, AddLanes(SplatLanes(1.0f), AbsLanes(ring)));
+}
+
+/* static */
+template<>
+inline LaneFloat Modulator::XmodLanes<ALGORITHM_XOR>(
+    LaneFloat x_1, LaneFloat x_2, LaneFloat parameter) {
+  // Clipping before the conversion gives the same result as Clip16, and
+  // keeps out-of-range values away from the conversion instructions.
+  const LaneFloat scale = SplatLanes(32768.0f);
+  const LaneFloat min = SplatLanes(-32768.0f);
+  const LaneFloat max = SplatLanes(32767.0f);
+  LaneInt x_1_short = TruncateLanes(
+      MinLanes(MaxLanes(MulLanes(x_1, scale), min), max));
+  LaneInt x_2_short = TruncateLanes(
+      MinLanes(MaxLanes(MulLanes(x_2, scale), min), max));
+  LaneFloat mod = MulLanes(
+      ConvertLanes(XorLanes(x_1_short, x_2_short)),
+      SplatLanes(1.0f / 32768.0f));
+  LaneFloat sum = MulLanes(AddLanes(x_1, x_2), SplatLanes(0.7f));
+  return AddLanes(sum, MulLanes(SubLanes(mod, sum), parameter));
+}
+
+/* static */
+template<>
+inline LaneFloat Modulator::XmodLanes<ALGORITHM_COMPARATOR>(
+    LaneFloat modulator, LaneFloat carrier, LaneFloat parameter) {
+  LaneFloat x = MulLanes(parameter, SplatLanes(2.995f));
+  LaneFloat x_fractional = SubLanes(x, ConvertLanes(TruncateLanes(x)));
+  
+  const LaneFloat abs_modulator = AbsLanes(modulator);
+  const LaneFloat abs_carrier = AbsLanes(carrier);
+  const LaneMask modulator_louder = GreaterLanes(abs_modulator, abs_carrier);
+  
+  LaneFloat direct = SelectLanes(
+      LessLanes(modulator, carrier), modulator, carrier);
+  LaneFloat window = SelectLanes(modulator_louder, modulator, carrier);
+  LaneFloat window_2 = SelectLanes(
+      modulator_louder,
+      abs_modulator,
+      SubLanes(SplatLanes(0.0f), abs_carrier));
+  LaneFloat threshold = SelectLanes(
+      GreaterLanes(carrier, SplatLanes(0.05f)), carrier, modulator);
+  
+  // Picks sequence[x_integral] and sequence[x_integral + 1] from
+  // { direct, threshold, window, window_2 }.
+  const LaneMask first = LessLanes(x, SplatLanes(1.0f));
+  const LaneMask second = LessLanes(x, SplatLanes(2.0f));
+  LaneFloat a = SelectLanes(
+      first, direct, SelectLanes(second, threshold, window));
+  LaneFloat b = SelectLanes(
+      first, threshold, SelectLanes(second, window, window_2));
+  
+  return AddLanes(a, MulLanes(SubLanes(b, a), x_fractional));
+}
+
+/* static */
+template<>
+inline LaneFloat Modulator::XmodLanes<ALGORITHM_NOP>(
+    LaneFloat modulator, LaneFloat carrier, LaneFloat parameter) {
+  return modulator;
+}
+
+/* static */
+Modulator::XmodFn Modulator::xmod_lanes_table_[] = {
+  &Modulator::ProcessXmodLanes<ALGORITHM_XFADE, ALGORITHM_FOLD>,
+  &Modulator::ProcessXmodLanes<
+      ALGORITHM_FOLD, ALGORITHM_ANALOG_RING_MODULATION>,
+  &Modulator::ProcessXmodLanes<
+      ALGORITHM_ANALOG_RING_MODULATION, ALGORITHM_DIGITAL_RING_MODULATION>,
+  &Modulator::ProcessXmodLanes<
+      ALGORITHM_DIGITAL_RING_MODULATION, ALGORITHM_XOR>,
+  &Modulator::ProcessXmodLanes<ALGORITHM_XOR, ALGORITHM_COMPARATOR>,
+  &Modulator::ProcessXmodLanes<ALGORITHM_COMPARATOR, ALGORITHM_NOP>,
+};
+
+#endif  // WARPS_SIMD
+
 }  // namespace warps
@@ -38,6 +38,7 @@
 #include "warps/dsp/quadrature_oscillator.h"
 #include "warps/dsp/quadrature_transform.h"
 #include "warps/dsp/sample_rate_converter.h"
+#include "warps/dsp/simd.h"
 #include "warps/dsp/vocoder.h"
 #include "warps/resources.h"
 
@@ -151,6 +152,22 @@ class Modulator {
 
   inline bool easter_egg() const { return easter_egg_; }
   inline void set_easter_egg(bool easter_egg) { easter_egg_ = easter_egg; }
+
+#ifdef WARPS_SIMD
+  // Switches between the 4-lane and scalar cross-modulation and sample rate
+  // conversion code. They render the same samples, within float rounding -
+  // this is only used for testing and benchmarking. The converters keep
+  // their history in a different layout in each mode, so it is cleared when
+  // the mode changes.
+  inline void set_use_lanes(bool use_lanes) {
+    if (use_lanes != use_lanes_) {
+      src_up_[0].Init();
+      src_up_[1].Init();
+      src_down_.Init();
+    }
+    use_lanes_ = use_lanes;
+  }
+#endif  // WARPS_SIMD
   
  private:
   template<XmodAlgorithm algorithm_1, XmodAlgorithm algorithm_2>
@@ -200,6 +217,56 @@ class Modulator {
     }
   }
   
+#ifdef WARPS_SIMD
+  // Renders kNumLanes consecutive samples at a time. size must be a multiple
+  // of kNumLanes.
+  template<XmodAlgorithm algorithm_1, XmodAlgorithm algorithm_2>
+  void ProcessXmodLanes(
+      float balance,
+      float balance_end,
+      float parameter,
+      float parameter_end,
+      const float* in_1,
+      const float* in_2,
+      float* out,
+      size_t size) {
+    float step = 1.0f / static_cast<float>(size);
+    float parameter_increment = (parameter_end - parameter) * step;
+    float balance_increment = (balance_end - balance) * step;
+    
+    for (size_t i = 0; i < size; i += kNumLanes) {
+      // The ramps are accumulated exactly like in the scalar code: some
+      // algorithms are steep enough to make the rounding errors of a
+      // vectorized ramp audible in the difference between the two paths.
+      const float p_0 = parameter;
+      const float p_1 = p_0 + parameter_increment;
+      const float p_2 = p_1 + parameter_increment;
+      const float p_3 = p_2 + parameter_increment;
+      parameter = p_3 + parameter_increment;
+      const float b_0 = balance;
+      const float b_1 = b_0 + balance_increment;
+      const float b_2 = b_1 + balance_increment;
+      const float b_3 = b_2 + balance_increment;
+      balance = b_3 + balance_increment;
+      
+      const LaneFloat parameter_lanes = SetLanes(p_0, p_1, p_2, p_3);
+      const LaneFloat balance_lanes = SetLanes(b_0, b_1, b_2, b_3);
+      const LaneFloat x_1 = LoadLanes(&in_1[i]);
+      const LaneFloat x_2 = LoadLanes(&in_2[i]);
+      LaneFloat a = XmodLanes<algorithm_1>(x_1, x_2, parameter_lanes);
+      LaneFloat b = XmodLanes<algorithm_2>(x_1, x_2, parameter_lanes);
+      StoreLanes(
+          &out[i],
+          AddLanes(a, MulLanes(SubLanes(b, a), balance_lanes)));
+    }
+  }
+  
+  template<XmodAlgorithm algorithm>
+  static LaneFloat XmodLanes(LaneFloat x_1, LaneFloat x_2, LaneFloat parameter);
+  
+  static LaneFloat DiodeLanes(LaneFloat x);
+#endif  // WARPS_SIMD
+  
   template<XmodAlgorithm algorithm>
   static float Xmod(float x_1, float x_2, float parameter);
   
@@ -207,6 +274,9 @@ class Modulator {
   
   bool bypass_;
   bool easter_egg_;
+#ifdef WARPS_SIMD
+  bool use_lanes_;
+#endif  // WARPS_SIMD
   
   Parameters parameters_;
   Parameters previous_parameters_;
@@ -229,6 +299,9 @@ class Modulator {
   float feedback_sample_;
   
   static XmodFn xmod_table_[];
+#ifdef WARPS_SIMD
+  static XmodFn xmod_lanes_table_[];
+#endif  // WARPS_SIMD
   
   DISALLOW_COPY_AND_ASSIGN(Modulator);
 };
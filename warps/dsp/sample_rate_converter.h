@@ -33,6 +33,8 @@
 
 #include <algorithm>
 
+#include "warps/dsp/simd.h"
+
 namespace warps {
 
 enum SampleRateConversionDirection {
@@ -154,6 +156,74 @@ struct PolyphaseStage<K, mirror, 0> {
   inline void operator()(float* &y, const T& x, const IR& h) const { }
 };
 
+#ifdef WARPS_SIMD
+
+// Copies the first half of a symmetric impulse response into a table, and
+// mirrors it.
+template<typename IR, int32_t remaining, int32_t i = 0>
+struct ImpulseResponseCopier {
+  inline void operator()(const IR& h, float* destination) const {
+    destination[i] = h.template Read<i>();
+    ImpulseResponseCopier<IR, remaining - 1, i + 1> c;
+    c(h, destination);
+  }
+};
+
+template<typename IR, int32_t i>
+struct ImpulseResponseCopier<IR, 0, i> {
+  inline void operator()(const IR& h, float* destination) const { }
+};
+
+template<int32_t size, typename IR>
+inline void CopyImpulseResponse(const IR& h, float* destination) {
+  ImpulseResponseCopier<IR, size / 2> c;
+  c(h, destination);
+  for (int32_t i = 0; i < size / 2; ++i) {
+    destination[size - 1 - i] = destination[i];
+  }
+}
+
+// Adds the products of the input samples x[0], x[-1]... x[-(M - 1)] with M
+// rows of kNumLanes coefficients to each of the V accumulators y.
+template<int32_t V, int32_t M, int32_t m = 0>
+struct LaneAccumulator {
+  inline void operator()(const float* x, const float* h, LaneFloat* y) const {
+    const LaneFloat x_m = SplatLanes(x[-m]);
+    for (int32_t v = 0; v < V; ++v) {
+      y[v] = AddLanes(
+          y[v],
+          MulLanes(x_m, LoadLanes(&h[(v * M + m) * kNumLanes])));
+    }
+    LaneAccumulator<V, M, m + 1> a;
+    a(x, h, y);
+  }
+};
+
+template<int32_t V, int32_t M>
+struct LaneAccumulator<V, M, M> {
+  inline void operator()(const float* x, const float* h, LaneFloat* y) const {
+  }
+};
+
+// Lane-wise products of the N samples in x with the N coefficients in h,
+// summed over groups of kNumLanes.
+template<int32_t N, int32_t i = 0>
+struct LaneDotProduct {
+  inline LaneFloat operator()(const float* x, const float* h) const {
+    LaneDotProduct<N, i + 4> p;
+    return AddLanes(MulLanes(LoadLanes(&x[i]), LoadLanes(&h[i])), p(x, h));
+  }
+};
+
+template<int32_t N>
+struct LaneDotProduct<N, N> {
+  inline LaneFloat operator()(const float* x, const float* h) const {
+    return SplatLanes(0.0f);
+  }
+};
+
+#endif  // WARPS_SIMD
+
 template<
     SampleRateConversionDirection direction,
     int32_t ratio,
@@ -167,6 +237,20 @@ class SampleRateConverter<SRC_UP, ratio, filter_size> {
     N = filter_size / ratio,
     K = ratio
   };
+
+#ifdef WARPS_SIMD
+  enum {
+    // Number of input samples from which an integral number of vectors of
+    // output samples is rendered.
+    kGroupInputs = K % 4 == 0 ? 1 : (K % 2 == 0 ? 2 : 4),
+    kGroupVectors = K * kGroupInputs / 4,
+    // Number of input samples read for a group.
+    kGroupTaps = N + kGroupInputs - 1,
+    // Groups which can't be rendered without reading the history.
+    kPrologueSize =
+        (kGroupTaps + kGroupInputs - 1) / kGroupInputs * kGroupInputs
+  };
+#endif  // WARPS_SIMD
  
  public:
   SampleRateConverter() { }
@@ -174,11 +258,78 @@ class SampleRateConverter<SRC_UP, ratio, filter_size> {
 
   inline void Init() {
     std::fill(&x_[0], &x_[N], 0);
+#ifdef WARPS_SIMD
+    STATIC_ASSERT(kGroupVectors * 4 == K * kGroupInputs, bad_group_size);
+
+    // The zero-stuffed input is never materialized: in a group, each output
+    // sample is a dot product of the group's input samples with one phase
+    // of the polyphase filter, shifted by the position of the output in the
+    // group, and padded with zeros. These padded phases are stored here,
+    // ordered so that a vector of consecutive output samples is obtained by
+    // accumulating the input samples multiplied by a row of coefficients.
+    float h[filter_size];
+    CopyImpulseResponse<filter_size>(
+        SRC_FIR<SRC_UP, ratio, filter_size>(), h);
+    for (int32_t v = 0; v < kGroupVectors; ++v) {
+      for (int32_t m = 0; m < kGroupTaps; ++m) {
+        for (size_t lane = 0; lane < kNumLanes; ++lane) {
+          int32_t output = v * 4 + lane;
+          int32_t tap = m - (kGroupInputs - 1 - output / K);
+          h_lanes_[v][m][lane] = tap >= 0 && tap < N
+              ? h[output % K + tap * K]
+              : 0.0f;
+        }
+      }
+    }
+#endif  // WARPS_SIMD
   };
 
   inline int32_t delay() const { return filter_size / ratio / 2; }
 
   inline void Process(const float* in, float* out, size_t input_size) {
+#ifdef WARPS_SIMD
+    // When the ratio is a multiple of 4, a group is a single vector, and its
+    // accumulation a single chain of dependent additions: the unrolled scalar
+    // code is faster.
+    if (K % 4 != 0 && input_size % kGroupInputs == 0) {
+      ProcessLanes(in, out, input_size);
+      return;
+    }
+#endif  // WARPS_SIMD
+    ProcessScalar(in, out, input_size);
+  }
+
+#ifdef WARPS_SIMD
+  inline void ProcessLanes(const float* in, float* out, size_t input_size) {
+    // The first groups read a copy of the history followed by the first
+    // input samples; the next ones read the input buffer directly.
+    float prologue[N + kPrologueSize];
+    const size_t prologue_size = std::min(input_size, size_t(kPrologueSize));
+    for (int32_t i = 0; i < N; ++i) {
+      prologue[i] = x_[N - 1 - i];
+    }
+    std::copy(&in[0], &in[prologue_size], &prologue[N]);
+
+    size_t i = 0;
+    for (; i < prologue_size; i += kGroupInputs) {
+      RenderGroup(&prologue[N + i + kGroupInputs - 1], out);
+      out += K * kGroupInputs;
+    }
+    for (; i < input_size; i += kGroupInputs) {
+      RenderGroup(&in[i + kGroupInputs - 1], out);
+      out += K * kGroupInputs;
+    }
+
+    // Same layout as the history saved by the scalar code, most recent
+    // sample first.
+    for (int32_t j = N - 1; j >= 0; --j) {
+      int32_t source = static_cast<int32_t>(input_size) - 1 - j;
+      x_[j] = source >= 0 ? in[source] : x_[j - input_size];
+    }
+  }
+#endif  // WARPS_SIMD
+
+  inline void ProcessScalar(const float* in, float* out, size_t input_size) {
     SRC_FIR<SRC_UP, ratio, filter_size> ir;
     FilterState<N> x;
     x.Load(x_);
@@ -191,6 +342,23 @@ class SampleRateConverter<SRC_UP, ratio, filter_size> {
   }
   
  private:
+#ifdef WARPS_SIMD
+  // x points to the most recent input sample of the group.
+  inline void RenderGroup(const float* x, float* out) const {
+    LaneFloat y[kGroupVectors];
+    for (int32_t v = 0; v < kGroupVectors; ++v) {
+      y[v] = SplatLanes(0.0f);
+    }
+    LaneAccumulator<kGroupVectors, kGroupTaps> accumulator;
+    accumulator(x, &h_lanes_[0][0][0], y);
+    for (int32_t v = 0; v < kGroupVectors; ++v) {
+      StoreLanes(out + v * kNumLanes, y[v]);
+    }
+  }
+
+  float h_lanes_[kGroupVectors][kGroupTaps][kNumLanes];
+#endif  // WARPS_SIMD
+
   float x_[N];
 
   DISALLOW_COPY_AND_ASSIGN(SampleRateConverter);
@@ -211,11 +379,72 @@ class SampleRateConverter<SRC_DOWN, ratio, filter_size> {
   inline void Init() {
     std::fill(&x_[0], &x_[2 * N], 0);
     x_ptr_ = &x_[N - 1];
+#ifdef WARPS_SIMD
+    STATIC_ASSERT(N % 4 == 0, filter_size_not_multiple_of_lanes);
+    CopyImpulseResponse<filter_size>(
+        SRC_FIR<SRC_DOWN, ratio, filter_size>(), h_);
+#endif  // WARPS_SIMD
   };
 
   inline int32_t delay() const { return filter_size / 2; }
 
+  // The vectorized code keeps the history in a different layout: an
+  // instance must be used with either Process or ProcessScalar, not both.
   inline void Process(const float* in, float* out, size_t input_size) {
+#ifdef WARPS_SIMD
+    ProcessLanes(in, out, input_size);
+#else
+    ProcessScalar(in, out, input_size);
+#endif  // WARPS_SIMD
+  }
+
+#ifdef WARPS_SIMD
+  // Output samples are computed kNumLanes at a time, with the lanes running
+  // over the taps of the filter. Each output is aligned with the last input
+  // sample of its group of ratio samples, like in the circular buffer
+  // variant below.
+  inline void ProcessLanes(const float* in, float* out, size_t input_size) {
+    if ((input_size % ratio) != 0) {
+      return;
+    }
+
+    // The history (N - 1 samples, oldest first) followed by the first input
+    // samples, for the outputs which straddle the beginning of the block.
+    float prologue[2 * N - 1];
+    const size_t prologue_size = std::min(input_size, size_t(N));
+    std::copy(&x_[0], &x_[N - 1], &prologue[0]);
+    std::copy(&in[0], &in[prologue_size], &prologue[N - 1]);
+
+    const size_t output_size = input_size / ratio;
+    const size_t vectorized_size = output_size & ~(kNumLanes - 1);
+    size_t i = 0;
+    for (; i < vectorized_size; i += kNumLanes) {
+      LaneFloat y_0 = Convolve(window(prologue, prologue_size, in, i));
+      LaneFloat y_1 = Convolve(window(prologue, prologue_size, in, i + 1));
+      LaneFloat y_2 = Convolve(window(prologue, prologue_size, in, i + 2));
+      LaneFloat y_3 = Convolve(window(prologue, prologue_size, in, i + 3));
+      StoreLanes(&out[i], SumLanes(y_0, y_1, y_2, y_3));
+    }
+    for (; i < output_size; ++i) {
+      const LaneFloat zero = SplatLanes(0.0f);
+      float y[kNumLanes];
+      StoreLanes(y, SumLanes(
+          Convolve(window(prologue, prologue_size, in, i)), zero, zero, zero));
+      out[i] = y[0];
+    }
+
+    if (input_size >= size_t(N - 1)) {
+      std::copy(&in[input_size - N + 1], &in[input_size], &x_[0]);
+    } else {
+      std::copy(
+          &prologue[input_size],
+          &prologue[input_size + N - 1],
+          &x_[0]);
+    }
+  }
+#endif  // WARPS_SIMD
+
+  inline void ProcessScalar(const float* in, float* out, size_t input_size) {
     // When downsampling, the number of input samples must be a multiple
     // of the downsampling ratio.
     if ((input_size % ratio) != 0) {
@@ -275,6 +504,27 @@ class SampleRateConverter<SRC_DOWN, ratio, filter_size> {
   }
  
  private:
+#ifdef WARPS_SIMD
+  // Returns the oldest of the N input samples read by the i-th output.
+  inline const float* window(
+      const float* prologue,
+      size_t prologue_size,
+      const float* in,
+      size_t i) const {
+    const size_t end = (i + 1) * ratio;
+    return end <= prologue_size ? &prologue[end - 1] : &in[end - N];
+  }
+
+  // Since the impulse response is symmetric, the taps can be applied in the
+  // order of the samples.
+  inline LaneFloat Convolve(const float* x) const {
+    LaneDotProduct<N> dot_product;
+    return dot_product(x, h_);
+  }
+
+  float h_[N];
+#endif  // WARPS_SIMD
+
   float x_[2 * N];
   float* x_ptr_;
 
@@ -0,0 +1,351 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// 4-lane float operations, mapped to SSE2 or NEON when available. The scalar
+// fallback produces the same results as the vector versions.
+//
+// WARPS_SIMD is defined when the lanes map to actual vector registers.
+
+#ifndef WARPS_DSP_SIMD_H_
+#define WARPS_DSP_SIMD_H_
+
+#include "stmlib/stmlib.h"
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define WARPS_SIMD
+#endif
+
+namespace warps {
+
+const size_t kNumLanes = 4;
+
+#if defined(__SSE2__)
+
+typedef __m128 LaneFloat;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return _mm_loadu_ps(p);
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  _mm_storeu_ps(p, x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return _mm_set1_ps(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return _mm_add_ps(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return _mm_sub_ps(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return _mm_mul_ps(a, b);
+}
+
+typedef __m128 LaneMask;
+typedef __m128i LaneInt;
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  return _mm_setr_ps(a, b, c, d);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+  return _mm_div_ps(a, b);
+}
+
+inline LaneFloat AbsLanes(LaneFloat x) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+inline LaneFloat MinLanes(LaneFloat a, LaneFloat b) {
+  return _mm_min_ps(a, b);
+}
+
+inline LaneFloat MaxLanes(LaneFloat a, LaneFloat b) {
+  return _mm_max_ps(a, b);
+}
+
+inline LaneMask LessLanes(LaneFloat a, LaneFloat b) {
+  return _mm_cmplt_ps(a, b);
+}
+
+inline LaneMask GreaterLanes(LaneFloat a, LaneFloat b) {
+  return _mm_cmpgt_ps(a, b);
+}
+
+inline LaneFloat SelectLanes(LaneMask mask, LaneFloat a, LaneFloat b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return _mm_cvttps_epi32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return _mm_cvtepi32_ps(x);
+}
+
+inline LaneInt XorLanes(LaneInt a, LaneInt b) {
+  return _mm_xor_si128(a, b);
+}
+
+// Lane i of the result is the sum of the lanes of the i-th argument.
+inline LaneFloat SumLanes(LaneFloat a, LaneFloat b, LaneFloat c, LaneFloat d) {
+  _MM_TRANSPOSE4_PS(a, b, c, d);
+  return _mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d));
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+typedef float32x4_t LaneFloat;
+
+inline LaneFloat LoadLanes(const float* p) {
+  return vld1q_f32(p);
+}
+
+inline void StoreLanes(float* p, LaneFloat x) {
+  vst1q_f32(p, x);
+}
+
+inline LaneFloat SplatLanes(float x) {
+  return vdupq_n_f32(x);
+}
+
+inline LaneFloat AddLanes(LaneFloat a, LaneFloat b) {
+  return vaddq_f32(a, b);
+}
+
+inline LaneFloat SubLanes(LaneFloat a, LaneFloat b) {
+  return vsubq_f32(a, b);
+}
+
+inline LaneFloat MulLanes(LaneFloat a, LaneFloat b) {
+  return vmulq_f32(a, b);
+}
+
+typedef uint32x4_t LaneMask;
+typedef int32x4_t LaneInt;
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  const float x[kNumLanes] = { a, b, c, d };
+  return vld1q_f32(x);
+}
+
+inline LaneFloat DivLanes(LaneFloat a, LaneFloat b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  // No division on ARMv7 NEON: refine the reciprocal estimate twice. The
+  // result can differ from the scalar code in the last bit.
+  float32x4_t r = vrecpeq_f32(b);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+#endif  // __aarch64__
+}
+
+inline LaneFloat AbsLanes(LaneFloat x) {
+  return vabsq_f32(x);
+}
+
+inline LaneFloat MinLanes(LaneFloat a, LaneFloat b) {
+  return vminq_f32(a, b);
+}
+
+inline LaneFloat MaxLanes(LaneFloat a, LaneFloat b) {
+  return vmaxq_f32(a, b);
+}
+
+inline LaneMask LessLanes(LaneFloat a, LaneFloat b) {
+  return vcltq_f32(a, b);
+}
+
+inline LaneMask GreaterLanes(LaneFloat a, LaneFloat b) {
+  return vcgtq_f32(a, b);
+}
+
+inline LaneFloat SelectLanes(LaneMask mask, LaneFloat a, LaneFloat b) {
+  return vbslq_f32(mask, a, b);
+}
+
+inline LaneInt TruncateLanes(LaneFloat x) {
+  return vcvtq_s32_f32(x);
+}
+
+inline LaneFloat ConvertLanes(LaneInt x) {
+  return vcvtq_f32_s32(x);
+}
+
+inline LaneInt XorLanes(LaneInt a, LaneInt b) {
+  return veorq_s32(a, b);
+}
+
+inline LaneFloat SumLanes(LaneFloat a, LaneFloat b, LaneFloat c, LaneFloat d) {
+  float32x4x2_t ab = vtrnq_f32(a, b);
+  float32x4x2_t cd = vtrnq_f32(c, d);
+  float32x4_t ab_sum = vaddq_f32(ab.val[0], ab.val[1]);
+  float32x4_t cd_sum = vaddq_f32(cd.val[0], cd.val[1]);
+  return vaddq_f32(
+      vcombine_f32(vget_low_f32(ab_sum), vget_low_f32(cd_sum)),
+      vcombine_f32(vget_high_f32(ab_sum), vget_high_f32(cd_sum)));
+}
+
+#else
+
+struct LaneFloat {
+  float x[kNumLanes];
+};
+
+#define WARPS_LANE_LOOP(expression) \
+  LaneFloat r; \
+  for (size_t i = 0; i < kNumLanes; ++i) { \
+    r.x[i] = expression; \
+  } \
+  return r;
+
+inline LaneFloat LoadLanes(const float* p) {
+  WARPS_LANE_LOOP(p[i])
+}
+
+inline void StoreLanes(float* p, const LaneFloat& x) {
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    p[i] = x.x[i];
+  }
+}
+
+inline LaneFloat SplatLanes(float x) {
+  WARPS_LANE_LOOP(x)
+}
+
+inline LaneFloat AddLanes(const LaneFloat& a, const LaneFloat& b) {
+  WARPS_LANE_LOOP(a.x[i] + b.x[i])
+}
+
+inline LaneFloat SubLanes(const LaneFloat& a, const LaneFloat& b) {
+  WARPS_LANE_LOOP(a.x[i] - b.x[i])
+}
+
+inline LaneFloat MulLanes(const LaneFloat& a, const LaneFloat& b) {
+  WARPS_LANE_LOOP(a.x[i] * b.x[i])
+}
+
+struct LaneMask {
+  bool x[kNumLanes];
+};
+
+struct LaneInt {
+  int32_t x[kNumLanes];
+};
+
+inline LaneFloat SetLanes(float a, float b, float c, float d) {
+  const float x[kNumLanes] = { a, b, c, d };
+  return LoadLanes(x);
+}
+
+inline LaneFloat DivLanes(const LaneFloat& a, const LaneFloat& b) {
+  WARPS_LANE_LOOP(a.x[i] / b.x[i])
+}
+
+inline LaneFloat AbsLanes(const LaneFloat& x) {
+  WARPS_LANE_LOOP(fabsf(x.x[i]))
+}
+
+inline LaneFloat MinLanes(const LaneFloat& a, const LaneFloat& b) {
+  WARPS_LANE_LOOP(a.x[i] < b.x[i] ? a.x[i] : b.x[i])
+}
+
+inline LaneFloat MaxLanes(const LaneFloat& a, const LaneFloat& b) {
+  WARPS_LANE_LOOP(a.x[i] > b.x[i] ? a.x[i] : b.x[i])
+}
+
+inline LaneFloat SelectLanes(
+    const LaneMask& mask,
+    const LaneFloat& a,
+    const LaneFloat& b) {
+  WARPS_LANE_LOOP(mask.x[i] ? a.x[i] : b.x[i])
+}
+
+inline LaneFloat ConvertLanes(const LaneInt& x) {
+  WARPS_LANE_LOOP(static_cast<float>(x.x[i]))
+}
+
+inline LaneFloat SumLanes(
+    const LaneFloat& a,
+    const LaneFloat& b,
+    const LaneFloat& c,
+    const LaneFloat& d) {
+  const LaneFloat* v[kNumLanes] = { &a, &b, &c, &d };
+  WARPS_LANE_LOOP(v[i]->x[0] + v[i]->x[1] + v[i]->x[2] + v[i]->x[3])
+}
+
+#undef WARPS_LANE_LOOP
+
+inline LaneMask LessLanes(const LaneFloat& a, const LaneFloat& b) {
+  LaneMask r;
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    r.x[i] = a.x[i] < b.x[i];
+  }
+  return r;
+}
+
+inline LaneMask GreaterLanes(const LaneFloat& a, const LaneFloat& b) {
+  return LessLanes(b, a);
+}
+
+inline LaneInt TruncateLanes(const LaneFloat& x) {
+  LaneInt r;
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    r.x[i] = static_cast<int32_t>(x.x[i]);
+  }
+  return r;
+}
+
+inline LaneInt XorLanes(const LaneInt& a, const LaneInt& b) {
+  LaneInt r;
+  for (size_t i = 0; i < kNumLanes; ++i) {
+    r.x[i] = a.x[i] ^ b.x[i];
+  }
+  return r;
+}
+
+#endif
+
+}  // namespace warps
+
+#endif  // WARPS_DSP_SIMD_H_
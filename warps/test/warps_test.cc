@@ -29,6 +29,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <vector>
 #include <xmmintrin.h>
 
@@ -105,6 +106,158 @@ void TestSRC96To576To96() {
   }
 }
 
+#ifdef WARPS_SIMD
+
+template<SampleRateConversionDirection direction, int32_t ratio, int32_t size>
+void TestSRCLanes(const char* name) {
+  SampleRateConverter<direction, ratio, size> lanes;
+  SampleRateConverter<direction, ratio, size> scalar;
+  lanes.Init();
+  scalar.Init();
+  
+  // Small block sizes exercise the blocks shorter than the filter. When
+  // downsampling, the blocks are kept short enough for the scalar code to
+  // use its circular buffer, which has the same phase as the vectorized
+  // code.
+  const size_t kBlockSizes[] = { 60, 4, 8, 12, 4, 60, 48, 12 };
+  const size_t num_blocks = 20000;
+  float in[kBlockSize * ratio];
+  float out_lanes[kBlockSize * ratio];
+  float out_scalar[kBlockSize * ratio];
+  float max_error = 0.0f;
+  float phase = 0.0f;
+  for (size_t i = 0; i < num_blocks; ++i) {
+    size_t input_size = kBlockSizes[i % 8];
+    if (direction == SRC_DOWN) {
+      input_size *= ratio;
+    }
+    for (size_t j = 0; j < input_size; ++j) {
+      phase += 0.001f + 0.1f * float(i) / float(num_blocks);
+      if (phase >= 1.0f) {
+        phase -= 1.0f;
+      }
+      in[j] = 0.5f * (phase - 0.5f) + 0.1f * (Random::GetFloat() - 0.5f);
+    }
+    size_t output_size = direction == SRC_UP
+        ? input_size * ratio
+        : input_size / ratio;
+    
+    lanes.ProcessLanes(in, out_lanes, input_size);
+    scalar.ProcessScalar(in, out_scalar, input_size);
+    for (size_t j = 0; j < output_size; ++j) {
+      max_error = max(max_error, fabsf(out_lanes[j] - out_scalar[j]));
+    }
+  }
+  assert(max_error < 1e-6f);
+  
+  // Block size of the modulator.
+  const size_t input_size = direction == SRC_UP ? 60 : 60 * ratio;
+  clock_t start = clock();
+  for (size_t i = 0; i < num_blocks * 10; ++i) {
+    lanes.ProcessLanes(in, out_lanes, input_size);
+  }
+  float lanes_time = float(clock() - start) / CLOCKS_PER_SEC;
+  start = clock();
+  for (size_t i = 0; i < num_blocks * 10; ++i) {
+    scalar.ProcessScalar(in, out_scalar, input_size);
+  }
+  float scalar_time = float(clock() - start) / CLOCKS_PER_SEC;
+  printf("%s: %.2fx faster than scalar, error %g\n",
+         name, scalar_time / lanes_time, max_error);
+}
+
+void TestModulatorLanes() {
+  static Modulator modulator[2];
+
+  // Block size of the firmware. With larger blocks, the scalar downsampler
+  // switches to its unrolled code, which aligns each output with the first
+  // input sample of its group rather than the last one.
+  const size_t kModulatorBlockSize = 60;
+  
+  // Errors are tallied separately for each pair of cross-faded algorithms.
+  const int32_t kNumXmodPairs = 6;
+  
+  float phase[2] = { 0.0f, 0.0f };
+  const size_t num_blocks = 20000;
+  int32_t max_error[kNumXmodPairs] = { 0, 0, 0, 0, 0, 0 };
+  size_t num_outliers[kNumXmodPairs] = { 0, 0, 0, 0, 0, 0 };
+  size_t num_samples[kNumXmodPairs] = { 0, 0, 0, 0, 0, 0 };
+  float time[2] = { 0.0f, 0.0f };
+  for (int32_t lanes = 0; lanes < 2; ++lanes) {
+    modulator[lanes].Init(kSampleRate);
+    modulator[lanes].set_use_lanes(lanes == 1);
+  }
+  for (size_t i = 0; i < num_blocks; ++i) {
+    ShortFrame input[kModulatorBlockSize];
+    ShortFrame output[2][kModulatorBlockSize];
+    for (size_t j = 0; j < kModulatorBlockSize; ++j) {
+      phase[0] += 0.0031f;
+      phase[1] += 0.0003f + 0.01f * float(i % 1000) / 1000.0f;
+      for (int32_t k = 0; k < 2; ++k) {
+        if (phase[k] >= 1.0f) {
+          phase[k] -= 1.0f;
+        }
+      }
+      input[j].l = static_cast<short>(sinf(phase[0] * 2 * M_PI) * 24000.0f);
+      input[j].r = static_cast<short>((phase[1] - 0.5f) * 40000.0f);
+    }
+    
+    // Sweeps all the cross-modulation algorithms, and their parameter.
+    const float algorithm = 0.675f * float(i) / float(num_blocks);
+    for (int32_t lanes = 0; lanes < 2; ++lanes) {
+      Parameters* p = modulator[lanes].mutable_parameters();
+      p->carrier_shape = 0;
+      p->channel_drive[0] = 0.7f;
+      p->channel_drive[1] = 0.7f;
+      p->modulation_algorithm = algorithm;
+      p->modulation_parameter = float(i % 777) / 777.0f;
+      p->note = 48.0f;
+      
+      clock_t start = clock();
+      modulator[lanes].Process(input, output[lanes], kModulatorBlockSize);
+      time[lanes] += float(clock() - start);
+    }
+    
+    // Same selection of the pair of algorithms as in Modulator::Process.
+    const int32_t pair = static_cast<int32_t>(min(algorithm * 8.0f, 5.999f));
+    for (size_t j = 0; j < kModulatorBlockSize; ++j) {
+      int32_t error = max(
+          abs(output[0][j].l - output[1][j].l),
+          abs(output[0][j].r - output[1][j].r));
+      max_error[pair] = max(max_error[pair], error);
+      num_outliers[pair] += error > 1 ? 1 : 0;
+    }
+    num_samples[pair] += kModulatorBlockSize;
+  }
+  
+  // The sample rate converters differ by float rounding, and the lanes may
+  // round differently where the division is approximated (ARMv7 NEON). This
+  // is within 1 LSB, or a few LSB through the steep slopes of the fold table.
+  // XOR is discontinuous: a rounding difference which makes a sample cross a
+  // quantization step flips its bits. For the pairs using it, only the number
+  // of outliers is bounded. The bounds are just above the measured errors.
+  const char* names[kNumXmodPairs] = {
+    "xfade/fold", "fold/analog rm", "analog rm/digital rm",
+    "digital rm/xor", "xor/comparator", "comparator/nop"
+  };
+  const int32_t kDiscontinuous = -1;
+  const int32_t bound[kNumXmodPairs] = {
+    8, 8, 2, kDiscontinuous, kDiscontinuous, 2
+  };
+  for (int32_t pair = 0; pair < kNumXmodPairs; ++pair) {
+    printf("Modulator %s: error %d LSB, %d samples above 1 LSB\n",
+           names[pair], max_error[pair], int(num_outliers[pair]));
+    if (bound[pair] == kDiscontinuous) {
+      assert(num_outliers[pair] * 1000 < num_samples[pair]);
+    } else {
+      assert(max_error[pair] <= bound[pair]);
+    }
+  }
+  printf("Modulator: %.2fx faster than scalar\n", time[0] / time[1]);
+}
+
+#endif  // WARPS_SIMD
+
 void TestModulator() {
   FILE* fp_in = fopen("audio_samples/modulation_96k.wav", "rb");
   WavWriter wav_writer(2, kSampleRate, 15);
@@ -367,6 +520,108 @@ void TestQuadratureOscillator() {
   }
 }
 
+// Band by band implementation of FilterBank::Analyze.
+class ReferenceAnalysis {
+ public:
+  void Init() {
+    mid_src_down_.Init();
+    low_src_down_.Init();
+    for (int32_t i = 0; i < kNumBands; ++i) {
+      const float* coefficients = filter_bank_table[i];
+      decimation_factor_[i] = static_cast<int32_t>(coefficients[0]);
+      post_gain_[i] = coefficients[2];
+      for (int32_t pass = 0; pass < 2; ++pass) {
+        svf_[i][pass].Init();
+        svf_[i][pass].set_f_fq(
+            coefficients[pass * 2 + 3],
+            coefficients[pass * 2 + 4]);
+      }
+    }
+  }
+  
+  void Analyze(const float* in, size_t size) {
+    mid_src_down_.Process(in, tmp_[0], size);
+    low_src_down_.Process(tmp_[0], tmp_[1], size / kMidFactor);
+    for (int32_t i = 0; i < kNumBands; ++i) {
+      const size_t band_size = size / decimation_factor_[i];
+      const float* input = decimation_factor_[i] == 1
+          ? in
+          : (decimation_factor_[i] == kMidFactor ? tmp_[0] : tmp_[1]);
+      for (int32_t pass = 0; pass < 2; ++pass) {
+        const float* source = pass == 0 ? input : samples_[i];
+        if (i == 0) {
+          svf_[i][pass].Process<FILTER_MODE_LOW_PASS>(
+              source, samples_[i], band_size);
+        } else if (i == kNumBands - 1) {
+          svf_[i][pass].Process<FILTER_MODE_HIGH_PASS>(
+              source, samples_[i], band_size);
+        } else {
+          svf_[i][pass].Process<FILTER_MODE_BAND_PASS_NORMALIZED>(
+              source, samples_[i], band_size);
+        }
+      }
+      for (size_t j = 0; j < band_size; ++j) {
+        samples_[i][j] *= post_gain_[i];
+      }
+    }
+  }
+  
+  const float* samples(int32_t band) const { return samples_[band]; }
+  
+ private:
+  SampleRateConverter<SRC_DOWN, kMidFactor, 36> mid_src_down_;
+  SampleRateConverter<SRC_DOWN, kLowFactor, 48> low_src_down_;
+  CrossoverSvf svf_[kNumBands][2];
+  int32_t decimation_factor_[kNumBands];
+  float post_gain_[kNumBands];
+  float tmp_[2][kMaxFilterBankBlockSize];
+  float samples_[kNumBands][kMaxFilterBankBlockSize];
+};
+
+void TestFilterBankAnalysis() {
+  static FilterBank fb;
+  static ReferenceAnalysis reference;
+  fb.Init(96000.0f);
+  reference.Init();
+  
+  const size_t num_blocks = 10000;
+  float in[kBlockSize];
+  float max_error = 0.0f;
+  float phase = 0.0f;
+  for (size_t i = 0; i < num_blocks; ++i) {
+    for (size_t j = 0; j < kBlockSize; ++j) {
+      phase += 0.001f + 0.05f * float(i) / float(num_blocks);
+      if (phase >= 1.0f) {
+        phase -= 1.0f;
+      }
+      in[j] = 0.5f * (phase - 0.5f) + 0.1f * (Random::GetFloat() - 0.5f);
+    }
+    fb.Analyze(in, kBlockSize);
+    reference.Analyze(in, kBlockSize);
+    for (int32_t band = 0; band < kNumBands; ++band) {
+      size_t size = kBlockSize / fb.band(band).decimation_factor;
+      for (size_t j = 0; j < size; ++j) {
+        float error = fb.band(band).samples[j] - reference.samples(band)[j];
+        max_error = max(max_error, fabsf(error));
+      }
+    }
+  }
+  assert(max_error < 1e-6f);
+  
+  clock_t start = clock();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    fb.Analyze(in, kBlockSize);
+  }
+  float fb_time = float(clock() - start) / CLOCKS_PER_SEC;
+  start = clock();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    reference.Analyze(in, kBlockSize);
+  }
+  float reference_time = float(clock() - start) / CLOCKS_PER_SEC;
+  printf("Filter bank analysis: %.2fx faster than band by band, error %g\n",
+         reference_time / fb_time, max_error);
+}
+
 int main(void) {
   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
   TestSRCUp<SampleRateConverter<SRC_UP, 6, 48> >("warps_src_up_fir_48.wav");
@@ -375,7 +630,17 @@ int main(void) {
   // TestEasterEgg();
   TestOscillators();
   TestFilterBankReconstruction();
+  TestFilterBankAnalysis();
   TestSineTransition();
   TestGain();
   TestQuadratureOscillator();
+#ifdef WARPS_SIMD
+  TestSRCLanes<SRC_UP, 6, 48>("SRC up 6x");
+  TestSRCLanes<SRC_DOWN, 6, 48>("SRC down 6x");
+  TestSRCLanes<SRC_UP, 4, 48>("SRC up 4x");
+  TestSRCLanes<SRC_DOWN, 4, 48>("SRC down 4x");
+  TestSRCLanes<SRC_UP, 3, 36>("SRC up 3x");
+  TestSRCLanes<SRC_DOWN, 3, 36>("SRC down 3x");
+  TestModulatorLanes();
+#endif  // WARPS_SIMD
 }
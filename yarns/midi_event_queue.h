@@ -0,0 +1,107 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Queue of timestamped MIDI events, for hosts receiving MIDI on a different
+// thread than the one rendering the CVs and audio. There is one producer and
+// one consumer, which never block or wait for each other.
+
+#ifndef YARNS_MIDI_EVENT_QUEUE_H_
+#define YARNS_MIDI_EVENT_QUEUE_H_
+
+#include "stmlib/stmlib.h"
+
+namespace yarns {
+
+struct MidiEvent {
+  // In audio samples.
+  uint32_t timestamp;
+  uint8_t size;
+  uint8_t data[3];
+};
+
+template<size_t capacity>
+class MidiEventQueue {
+ public:
+  MidiEventQueue() { }
+  ~MidiEventQueue() { }
+  
+  void Init() {
+    read_ptr_ = write_ptr_ = 0;
+  }
+  
+  // Producer side. Returns false when the queue is full.
+  inline bool Push(const MidiEvent& event) {
+    uint32_t write_ptr = write_ptr_;
+    if (write_ptr - Acquire(&read_ptr_) >= capacity) {
+      return false;
+    }
+    events_[write_ptr & (capacity - 1)] = event;
+    // The event must be complete before the consumer can see it.
+    Release(&write_ptr_, write_ptr + 1);
+    return true;
+  }
+  
+  // Consumer side. Returns NULL when the queue is empty.
+  inline const MidiEvent* Peek() const {
+    uint32_t read_ptr = read_ptr_;
+    if (read_ptr == Acquire(&write_ptr_)) {
+      return NULL;
+    }
+    return &events_[read_ptr & (capacity - 1)];
+  }
+  
+  inline void Pop() {
+    // The event must have been read before the producer can overwrite it.
+    Release(&read_ptr_, read_ptr_ + 1);
+  }
+  
+  inline size_t readable() const {
+    return Acquire(&write_ptr_) - Acquire(&read_ptr_);
+  }
+  
+ private:
+  // Each index is only written by one side. Reading the other side's index
+  // with acquire semantics makes the writes it released visible.
+  static inline uint32_t Acquire(const uint32_t* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+  }
+  
+  static inline void Release(uint32_t* ptr, uint32_t value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+  }
+  
+  STATIC_ASSERT((capacity & (capacity - 1)) == 0, capacity_power_of_two);
+  
+  MidiEvent events_[capacity];
+  uint32_t read_ptr_;
+  uint32_t write_ptr_;
+  
+  DISALLOW_COPY_AND_ASSIGN(MidiEventQueue);
+};
+
+}  // namespace yarns
+
+#endif  // YARNS_MIDI_EVENT_QUEUE_H_
@@ -34,6 +34,7 @@
 #include "stmlib/utils/ring_buffer.h"
 #include "stmlib/midi/midi.h"
 
+#include "yarns/midi_event_queue.h"
 #include "yarns/multi.h"
 
 namespace yarns {
@@ -191,6 +192,48 @@ class MidiHandler {
     }
   }
   
+  static void ProcessEvent(const MidiEvent& event) {
+    for (uint8_t i = 0; i < event.size; ++i) {
+      parser_.PushByte(event.data[i]);
+    }
+  }
+  
+  // Replaces ProcessInput and Multi::RenderAudio on a host: renders size
+  // samples (at most kAudioBlockSize) of audio starting at sample time,
+  // and applies each queued event on the sample it is timestamped with by
+  // splitting the block at this sample. The pitch and CV outputs of the
+  // voices follow the event from this sample on; Multi::Refresh() still
+  // has to be called at the control rate to advance the modulations.
+  template<size_t capacity>
+  static void RenderAudio(
+      MidiEventQueue<capacity>* queue,
+      uint32_t time,
+      size_t size) {
+    while (size) {
+      size_t chunk_size = size;
+      bool applied_events = false;
+      const MidiEvent* event;
+      while ((event = queue->Peek()) != NULL) {
+        int32_t delay = static_cast<int32_t>(event->timestamp - time);
+        if (delay > 0) {
+          if (static_cast<size_t>(delay) < chunk_size) {
+            chunk_size = delay;
+          }
+          break;
+        }
+        ProcessEvent(*event);
+        queue->Pop();
+        applied_events = true;
+      }
+      if (applied_events) {
+        multi.RefreshNotes();
+      }
+      multi.RenderAudio(chunk_size);
+      time += chunk_size;
+      size -= chunk_size;
+    }
+  }
+  
   static inline MidiBuffer* mutable_output_buffer() { return &output_buffer_; }
   static inline SmallMidiBuffer* mutable_high_priority_output_buffer() {
     return &high_priority_output_buffer_;
@@ -300,8 +300,20 @@ class Multi {
   }
 
   inline void RenderAudio() {
+    RenderAudio(kAudioBlockSize);
+  }
+  
+  inline void RefreshNotes() {
+    for (uint8_t i = 0; i < kNumVoices; ++i) {
+      voice_[i].RefreshNote();
+    }
+  }
+  
+  // Renders a fraction of a block, when a block is split at the time of a
+  // MIDI event.
+  inline void RenderAudio(size_t size) {
     for (uint8_t i = 0; i < kNumVoices; ++i) {
-      voice_[i].RenderAudio();
+      voice_[i].RenderAudio(size);
     }
   }
   
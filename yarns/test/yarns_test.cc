@@ -0,0 +1,343 @@
+// Copyright 2021 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Timing of the MIDI events applied by MidiHandler::RenderAudio, measured on
+// the audio output of the first voice.
+
+#include <pthread.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+#include "yarns/midi_event_queue.h"
+#include "yarns/midi_handler.h"
+#include "yarns/multi.h"
+
+using namespace yarns;
+
+const uint32_t kSampleRate = 48000;
+
+// Events are spaced by 8 to 40 samples: 2000 events/s on average.
+const size_t kNumEvents = 4000;
+const int32_t kMinInterval = 8;
+const int32_t kMaxInterval = 40;
+const size_t kMaxNumSamples = kNumEvents * kMaxInterval + 16 * kAudioBlockSize;
+
+const uint8_t kLowNote = 36;
+const uint8_t kHighNote = 60;
+
+MidiEventQueue<4096> queue;
+uint32_t event_time[kNumEvents];
+uint16_t audio[kMaxNumSamples];
+
+// In the real-time test, the events are pushed by another thread at most
+// kLookahead samples before they are due. With events 24 samples apart on
+// average, this is more than the queue can hold.
+const uint32_t kLookahead = 2048;
+MidiEventQueue<64> realtime_queue;
+uint32_t audio_time;
+int32_t num_full_pushes;
+bool in_time[kNumEvents];
+
+void Reset() {
+  multi.Init(true);
+  // Gated saw wave on the audio output of the first voice.
+  multi.mutable_part(0)->mutable_voicing_settings()->audio_mode = 0x81;
+  multi.mutable_part(0)->Touch();
+  midi_handler.Init();
+  queue.Init();
+}
+
+MidiEvent Note(uint32_t time, bool on, uint8_t note) {
+  MidiEvent event;
+  event.timestamp = time;
+  event.size = 3;
+  event.data[0] = on ? 0x90 : 0x80;
+  event.data[1] = note;
+  event.data[2] = 100;
+  return event;
+}
+
+void PushNote(uint32_t time, bool on, uint8_t note) {
+  bool pushed = queue.Push(Note(time, on, note));
+  assert(pushed);
+}
+
+// Draws the times of kNumEvents events at random intervals.
+size_t DrawEventTimes(uint32_t start) {
+  uint32_t time = start;
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    time += kMinInterval + rand() % (kMaxInterval - kMinInterval + 1);
+    event_time[i] = time;
+  }
+  return time + kMaxInterval;
+}
+
+// Schedules kNumEvents events toggling the given note, starting with a note
+// on, at random intervals.
+size_t ScheduleToggles(uint32_t start, uint8_t note) {
+  size_t num_samples = DrawEventTimes(start);
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    PushNote(event_time[i], !(i & 1), note);
+  }
+  return num_samples;
+}
+
+// Renders in blocks of kAudioBlockSize samples, with the control-rate
+// refresh at the beginning of each block, like the firmware does.
+void Render(size_t num_samples) {
+  for (uint32_t time = 0; time < num_samples; time += kAudioBlockSize) {
+    multi.Refresh();
+    MidiHandler::RenderAudio(&queue, time, kAudioBlockSize);
+    for (size_t i = 0; i < kAudioBlockSize; ++i) {
+      audio[time + i] = multi.mutable_voice(0)->ReadSample();
+    }
+  }
+}
+
+struct Latency {
+  int32_t min;
+  int32_t max;
+  int32_t sum;
+  int32_t count;
+
+  void Init() {
+    min = 0x7fffffff;
+    max = -0x7fffffff;
+    sum = count = 0;
+  }
+
+  void Add(int32_t latency) {
+    min = std::min(min, latency);
+    max = std::max(max, latency);
+    sum += latency;
+    ++count;
+  }
+
+  void Print(const char* name) const {
+    printf(
+        "%s: %d events, latency min=%d max=%d mean=%.2f samples, jitter=%d\n",
+        name,
+        count,
+        min,
+        max,
+        static_cast<float>(sum) / count,
+        max - min);
+  }
+};
+
+double Now() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void Sleep(double seconds) {
+  timespec t;
+  t.tv_sec = 0;
+  t.tv_nsec = static_cast<long>(seconds * 1e9);
+  nanosleep(&t, NULL);
+}
+
+// Pushes the note toggles as a MIDI input thread would: polling every 100us,
+// and waiting for the audio thread to make room when the queue is full.
+void* ProduceToggles(void* unused) {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    while (event_time[i] > __atomic_load_n(&audio_time, __ATOMIC_RELAXED) + \
+        kLookahead) {
+      Sleep(1e-4);
+    }
+    while (!realtime_queue.Push(Note(event_time[i], !(i & 1), kLowNote))) {
+      ++num_full_pushes;
+      Sleep(1e-4);
+    }
+    // This thread may not be scheduled in time on a loaded machine, or the
+    // event may be due in the block being rendered. It is then applied at
+    // the beginning of the next block instead.
+    in_time[i] = __atomic_load_n(&audio_time, __ATOMIC_RELAXED) + \
+        kAudioBlockSize <= event_time[i];
+  }
+  return NULL;
+}
+
+// Same as Render, but at the pace of the wall clock.
+void RenderRealtime(size_t num_samples) {
+  const double start = Now();
+  for (uint32_t time = 0; time < num_samples; time += kAudioBlockSize) {
+    while (Now() - start < static_cast<double>(time) / kSampleRate) {
+      Sleep(5e-5);
+    }
+    multi.Refresh();
+    MidiHandler::RenderAudio(&realtime_queue, time, kAudioBlockSize);
+    for (size_t i = 0; i < kAudioBlockSize; ++i) {
+      audio[time + i] = multi.mutable_voice(0)->ReadSample();
+    }
+    __atomic_store_n(&audio_time, time + kAudioBlockSize, __ATOMIC_RELAXED);
+  }
+}
+
+// Finds the edges of the gate toggled by the events in the rendered audio. A
+// lost or reordered event leaves the gate in the wrong state until the next
+// one, and shows up as a late edge. Only the events for which checked is
+// true (all of them if it is NULL) are measured.
+Latency MeasureGateLatency(size_t num_samples, const bool* checked) {
+  const uint16_t silence = multi.voice(0).calibration_dac_code(3);
+  Latency latency;
+  latency.Init();
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    if (checked && !checked[i]) {
+      continue;
+    }
+    uint32_t start = event_time[i];
+    uint32_t end = i + 1 < kNumEvents ? event_time[i + 1] : num_samples;
+    uint32_t t = start - kMinInterval / 2;
+    if (!(i & 1)) {
+      // Note on: first sample of the saw.
+      while (t < end && audio[t] == silence) {
+        ++t;
+      }
+    } else {
+      // Note off: first sample of the silence that lasts until the next event.
+      t = end;
+      while (t > start - kMinInterval / 2 && audio[t - 1] == silence) {
+        --t;
+      }
+    }
+    latency.Add(static_cast<int32_t>(t - start));
+  }
+  return latency;
+}
+
+void TestGateLatency() {
+  Reset();
+  size_t num_samples = ScheduleToggles(0, kLowNote);
+  Render(num_samples);
+
+  Latency latency = MeasureGateLatency(num_samples, NULL);
+  latency.Print("Gate");
+  assert(latency.count == static_cast<int32_t>(kNumEvents));
+  assert(latency.min >= 0 && latency.max <= 1);
+}
+
+void TestRealtimeGateLatency() {
+  Reset();
+  realtime_queue.Init();
+  audio_time = 0;
+  num_full_pushes = 0;
+  size_t num_samples = DrawEventTimes(0);
+
+  pthread_t producer;
+  pthread_create(&producer, NULL, &ProduceToggles, NULL);
+  RenderRealtime(num_samples);
+  pthread_join(producer, NULL);
+
+  // All the events went through the queue. A late event also moves the edge
+  // of the following one if it is applied after it should have started.
+  assert(realtime_queue.readable() == 0);
+  bool checked[kNumEvents];
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    checked[i] = in_time[i] && (i == 0 || in_time[i - 1]);
+  }
+  Latency latency = MeasureGateLatency(num_samples, checked);
+  latency.Print("Real-time gate");
+  printf(
+      "Queue full on %d pushes, %d events possibly late\n",
+      num_full_pushes,
+      static_cast<int>(std::count(in_time, in_time + kNumEvents, false)));
+  assert(num_full_pushes > 0);
+  assert(latency.count > 0);
+  assert(latency.min >= 0 && latency.max <= 1);
+}
+
+void TestPitchLatency() {
+  Reset();
+
+  // Hold the low note, and toggle the high one: the pitch of the saw changes
+  // at each event while its gate stays high. The high note is first held for
+  // a few blocks to measure its slope.
+  const uint32_t kHighNoteOn = kAudioBlockSize * 4;
+  const uint32_t kHighNoteOff = kAudioBlockSize * 8;
+  PushNote(0, true, kLowNote);
+  PushNote(kHighNoteOn, true, kHighNote);
+  PushNote(kHighNoteOff, false, kHighNote);
+  size_t num_samples = ScheduleToggles(kAudioBlockSize * 12, kHighNote);
+  Render(num_samples);
+
+  // The slope of the saw tells which note is playing. Its reset, smoothed by
+  // the polyblep over two samples, makes the output jump up.
+  int32_t low_slope = 0;
+  int32_t high_slope = 0;
+  for (size_t i = kAudioBlockSize; i < kHighNoteOn; ++i) {
+    low_slope = std::max(low_slope, audio[i - 1] - audio[i]);
+  }
+  for (size_t i = kHighNoteOn + kAudioBlockSize; i < kHighNoteOff; ++i) {
+    high_slope = std::max(high_slope, audio[i - 1] - audio[i]);
+  }
+  assert(high_slope > 2 * low_slope);
+  const int32_t threshold = (low_slope + high_slope) / 2;
+
+  Latency latency;
+  latency.Init();
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    uint32_t start = event_time[i] - kMinInterval / 2;
+    uint32_t end = event_time[i] + kMinInterval / 2;
+
+    // Skip the events too close to a reset of the saw.
+    bool reset = false;
+    for (uint32_t t = start - 2; t < end + 2; ++t) {
+      reset = reset || audio[t] >= audio[t - 1];
+    }
+    if (reset) {
+      continue;
+    }
+
+    // Search for the change of slope until the next event.
+    bool high = !(i & 1);
+    uint32_t next = i + 1 < kNumEvents ? event_time[i + 1] : num_samples;
+    uint32_t t = start;
+    while (t < next && ((audio[t - 1] - audio[t] > threshold) != high)) {
+      ++t;
+    }
+    latency.Add(static_cast<int32_t>(t - event_time[i]));
+  }
+  latency.Print("Pitch");
+  assert(latency.count > static_cast<int32_t>(kNumEvents / 4));
+  assert(latency.min >= 0 && latency.max <= 1);
+}
+
+int main(void) {
+  printf(
+      "%d events at %d events/s\n",
+      static_cast<int>(kNumEvents),
+      static_cast<int>(kSampleRate * 2 / (kMinInterval + kMaxInterval)));
+  TestGateLatency();
+  TestRealtimeGateLatency();
+  TestPitchLatency();
+  return 0;
+}
@@ -109,13 +109,41 @@ void Voice::ResetAllControllers() {
 }
 
 void Voice::Refresh() {
-  // Compute base pitch with portamento.
+  // Advance the portamento.
   portamento_phase_ += portamento_phase_increment_;
   if (portamento_phase_ < portamento_phase_increment_) {
     portamento_phase_ = 0;
     portamento_phase_increment_ = 0;
     note_source_ = note_target_;
   }
+  
+  // Advance the vibrato LFO.
+  if (modulation_rate_ < 100) {
+    lfo_phase_ += lut_lfo_increments[modulation_rate_];
+  } else {
+    lfo_phase_ += lfo_pll_phase_increment_;
+  }
+  
+  if (retrigger_delay_) {
+    --retrigger_delay_;
+  }
+  
+  if (trigger_pulse_) {
+    --trigger_pulse_;
+  }
+  
+  if (trigger_phase_increment_) {
+    trigger_phase_ += trigger_phase_increment_;
+    if (trigger_phase_ < trigger_phase_increment_) {
+      trigger_phase_ = 0;
+      trigger_phase_increment_ = 0;
+    }
+  }
+  RefreshNote();
+}
+
+void Voice::RefreshNote() {
+  // Compute base pitch with portamento.
   uint16_t portamento_level = portamento_exponential_shape_
       ? Interpolate824(lut_env_expo, portamento_phase_)
       : portamento_phase_ >> 16;
@@ -131,11 +159,6 @@ void Voice::Refresh() {
   note += tuning_;
   
   // Add vibrato.
-  if (modulation_rate_ < 100) {
-    lfo_phase_ += lut_lfo_increments[modulation_rate_];
-  } else {
-    lfo_phase_ += lfo_pll_phase_increment_;
-  }
   int32_t lfo = lfo_phase_ < 1UL << 31
       ?  -32768 + (lfo_phase_ >> 15)
       : 0x17fff - (lfo_phase_ >> 15);
@@ -146,21 +169,6 @@ void Voice::Refresh() {
   mod_aux_[6] = (lfo * mod_wheel_ >> 7) + 32768;
   mod_aux_[7] = lfo + 32768;
   
-  if (retrigger_delay_) {
-    --retrigger_delay_;
-  }
-  
-  if (trigger_pulse_) {
-    --trigger_pulse_;
-  }
-  
-  if (trigger_phase_increment_) {
-    trigger_phase_ += trigger_phase_increment_;
-    if (trigger_phase_ < trigger_phase_increment_) {
-      trigger_phase_ = 0;
-      trigger_phase_increment_ = 0;
-    }
-  }
   if (note != note_ || dirty_) {
     note_dac_code_ = NoteToDacCode(note);
     note_ = note;
@@ -287,15 +295,13 @@ uint32_t Oscillator::ComputePhaseIncrement(int16_t midi_pitch) {
   return phase_increment;
 }
 
-void Oscillator::RenderSilence() {
-  size_t size = kAudioBlockSize;
+void Oscillator::RenderSilence(size_t size) {
   while (size--) {
     audio_buffer_.Overwrite(offset_);
   }
 }
 
-void Oscillator::RenderSine(uint32_t phase_increment) {
-  size_t size = kAudioBlockSize;
+void Oscillator::RenderSine(uint32_t phase_increment, size_t size) {
   while (size--) {
     phase_ += phase_increment;
     int32_t sample = Interpolate1022(wav_sine, phase_);
@@ -303,18 +309,16 @@ void Oscillator::RenderSine(uint32_t phase_increment) {
   }
 }
 
-void Oscillator::RenderNoise() {
-  size_t size = kAudioBlockSize;
+void Oscillator::RenderNoise(size_t size) {
   while (size--) {
     int16_t sample = Random::GetSample();
     audio_buffer_.Overwrite(offset_ - (scale_ * sample >> 16));
   }
 }
 
-void Oscillator::RenderSaw(uint32_t phase_increment) {
+void Oscillator::RenderSaw(uint32_t phase_increment, size_t size) {
   uint32_t phase = phase_;
   int32_t next_sample = next_sample_;
-  size_t size = kAudioBlockSize;
 
   while (size--) {
     int32_t this_sample = next_sample;
@@ -336,12 +340,12 @@ void Oscillator::RenderSaw(uint32_t phase_increment) {
 void Oscillator::RenderSquare(
     uint32_t phase_increment,
     uint32_t pw,
-    bool integrate) {
+    bool integrate,
+    size_t size) {
   uint32_t phase = phase_;
   int32_t next_sample = next_sample_;
   int32_t integrator_state = integrator_state_;
   int16_t integrator_coefficient = phase_increment >> 18;
-  size_t size = kAudioBlockSize;
 
   while (size--) {
     int32_t this_sample = next_sample;
@@ -375,35 +379,35 @@ void Oscillator::RenderSquare(
   phase_ = phase;
 }
 
-void Oscillator::Render(uint8_t mode, int16_t note, bool gate) {
-  if (mode == 0 || audio_buffer_.writable() < kAudioBlockSize) {
+void Oscillator::Render(uint8_t mode, int16_t note, bool gate, size_t size) {
+  if (mode == 0 || audio_buffer_.writable() < size) {
     return;
   }
   
   if ((mode & 0x80) && !gate) {
-    RenderSilence();
+    RenderSilence(size);
     return;
   }
   
   uint32_t phase_increment = ComputePhaseIncrement(note);
   switch ((mode & 0x0f) - 1) {
     case 0:
-      RenderSaw(phase_increment);
+      RenderSaw(phase_increment, size);
       break;
     case 1:
-      RenderSquare(phase_increment, 0x40000000, false);
+      RenderSquare(phase_increment, 0x40000000, false, size);
       break;
     case 2:
-      RenderSquare(phase_increment, 0x80000000, false);
+      RenderSquare(phase_increment, 0x80000000, false, size);
       break;
     case 3:
-      RenderSquare(phase_increment, 0x80000000, true);
+      RenderSquare(phase_increment, 0x80000000, true, size);
       break;
     case 4:
-      RenderSine(phase_increment);
+      RenderSine(phase_increment, size);
       break;
     default:
-      RenderNoise();
+      RenderNoise(size);
       break;
   }
 }
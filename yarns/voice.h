@@ -59,7 +59,7 @@ class Oscillator {
   Oscillator() { }
   ~Oscillator() { }
   void Init(int32_t scale, int32_t offset);
-  void Render(uint8_t mode, int16_t note, bool gate);
+  void Render(uint8_t mode, int16_t note, bool gate, size_t size);
   inline uint16_t ReadSample() {
     return audio_buffer_.ImmediateRead();
   }
@@ -67,11 +67,15 @@ class Oscillator {
  private:
   uint32_t ComputePhaseIncrement(int16_t pitch);
   
-  void RenderSilence();
-  void RenderNoise();
-  void RenderSine(uint32_t phase_increment);
-  void RenderSaw(uint32_t phase_increment);
-  void RenderSquare(uint32_t phase_increment, uint32_t pw, bool integrate);
+  void RenderSilence(size_t size);
+  void RenderNoise(size_t size);
+  void RenderSine(uint32_t phase_increment, size_t size);
+  void RenderSaw(uint32_t phase_increment, size_t size);
+  void RenderSquare(
+      uint32_t phase_increment,
+      uint32_t pw,
+      bool integrate,
+      size_t size);
 
   inline int32_t ThisBlepSample(uint32_t t) {
     if (t > 65535) {
@@ -109,6 +113,11 @@ class Voice {
 
   void Calibrate(uint16_t* calibrated_dac_code);
   void Refresh();
+  
+  // Recomputes the pitch and the CV outputs from the current state of the
+  // voice, without advancing the portamento, LFO and trigger phases. Called
+  // when a MIDI event is applied in the middle of an audio block.
+  void RefreshNote();
   void NoteOn(int16_t note, uint8_t velocity, uint8_t portamento, bool trigger);
   void NoteOff();
   void ControlChange(uint8_t controller, uint8_t value);
@@ -202,8 +211,8 @@ class Voice {
   inline uint8_t audio_mode() {
     return audio_mode_;
   }
-  inline void RenderAudio() {
-    oscillator_.Render(audio_mode_, note_, gate_);
+  inline void RenderAudio(size_t size) {
+    oscillator_.Render(audio_mode_, note_, gate_, size);
   }
   inline uint16_t ReadSample() {
     return oscillator_.ReadSample();